@@ -81,6 +81,11 @@ implementation {
   TagnetC.DblkLastSyncOffset    -> CollectC.DblkLastSyncOffset;
   TagnetC.DblkCommittedOffset   -> CollectC.DblkCommittedOffset;
   TagnetC.DblkResyncOffset      -> CollectC.DblkResyncOffset;
+  TagnetC.DblkSeekRecNum        -> CollectC.DblkSeekRecNum;
+  TagnetC.DblkPrevSync          -> CollectC.DblkPrevSync;
+
+  components FileSystemC;
+  TagnetC.DblkCacheStats        -> FileSystemC.DblkCacheStats;
 
   TagnetMonitorP.CollectEvent   -> CollectC;
 
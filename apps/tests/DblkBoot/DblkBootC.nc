@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkBoot: check where DblkManager thinks the DBLK ends against a walk
+ * of the stream, across runs (boots) on mmhost.  See DblkBootP.
+ */
+
+#include <platform.h>
+#include <dblk_sd.h>
+
+configuration DblkBootC {}
+implementation {
+  components DblkBootP;
+  components MainC, SystemBootC;
+  MainC.SoftwareInit -> DblkBootP;
+  DblkBootP.Boot     -> SystemBootC.Boot;
+
+  components DblkManagerC, FileSystemC;
+  DblkBootP.DblkManager -> DblkManagerC;
+  DblkBootP.FileSystem  -> FileSystemC;
+
+  components CollectC;
+  DblkBootP.Collect      -> CollectC;
+  DblkBootP.CollectEvent -> CollectC;
+
+  components PlatformC;
+  DblkBootP.SysReboot -> PlatformC;
+
+  components SD0C, HostClockP;
+  DblkBootP.HostSD0 -> SD0C;
+  DblkBootP.HostSim -> HostClockP;
+#if DBLK_SD_MODE != DBLK_SD_SINGLE
+  components SD1C;
+  DblkBootP.HostSD1 -> SD1C;
+#endif
+
+  components new TimerMilliC() as TickC;
+  components new TimerMilliC() as DrainC;
+  DblkBootP.Tick  -> TickC;
+  DblkBootP.Drain -> DrainC;
+}
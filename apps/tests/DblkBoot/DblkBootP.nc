@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkBootP: DblkManager boot check (mmhost only).
+ *
+ * Each run is one boot of the tag.  Once the system is up we walk the
+ * DBLK stream ourselves, straight out of the image files, and hold what
+ * DblkManager came up with against it:
+ *
+ *   - recnums are contiguous, headers and recsums check out
+ *   - the walk gets to boot_offset and the record before it is
+ *     boot_recnum - 1
+ *   - boot_offset is erased or starts with this boot's SYNC/R
+ *
+ * The walk starts at the first data sector.  Circular, once the front
+ * has been eaten it starts at the tail and hunts for the first SYNC (the
+ * front of the tail unit is usually the back of a record that got eaten).
+ * That starts a couple of units before the head wraps, erase ahead takes
+ * the front units first, and tail_offset is still 0 then.  Once wrapped
+ * the walk comes around the end of the area.  Striped, logical sectors
+ * are mapped to the cards here (dblk_sd.h), not by DblkSDP.
+ *
+ * A crash can tear the last record, the header made it out and the rest
+ * didn't.  DblkManager counts its recnum so we do too.  The next boot
+ * starts on the next sector with its SYNC/R, so a torn record is one
+ * with a bad recsum that runs into a sector starting with a SYNC/R that
+ * follows on (or into boot_offset).  They get counted on the walk line.
+ *
+ * Then DBLKB_RECORDS records go down (accel sized, an event every 8th)
+ * and the run ends the way DBLKB_END says:
+ *
+ *   seal   SysReboot.flush, shutdown_flush seals the noinit checkpoint
+ *   flush  close_sector, let SSW drain, nothing sealed
+ *   crash  exit, whatever is sitting in SSW's buffers is lost
+ *
+ * With MMHOST_NOINIT the checkpoint survives to the next run.  If it was
+ * sealed the next boot has to be the fast one, DBLKB_FAST_READS SD reads
+ * (locator, dir, dblk_nxt, dblk_nxt - 1).  Remove the file (power loss)
+ * or end with flush/crash and the next boot goes the long way.
+ *
+ *   fresh, seal, seal again    fast boot
+ *   seal, rm noinit            cold, gallop from the dir mirror
+ *   flush                      cold, SYNC_FLUSH pad at the end
+ *   crash                      cold, recnums carry on from what made it
+ *   CIRCULAR=1                 small DBLK, records enough to go around
+ *   STRIPE=1                   same runs over sd0.img + sd1.img
+ *
+ * Environment:
+ *
+ *   DBLKB_RECORDS  how many records              (default 5000)
+ *   DBLKB_RATE     records per simulated second  (default 200)
+ *   DBLKB_END      seal, flush, crash            (default seal)
+ *
+ * Anything off prints "dblkb: FAIL ..." and exits 1.
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sd.h>
+#include <fs_loc.h>
+#include <typed_data.h>
+#include <dblk_dir.h>
+#include <dblk_sd.h>
+#include "mmhost.h"
+
+#ifndef DBLKB_TICK_MS
+#define DBLKB_TICK_MS   10
+#endif
+
+#ifndef DBLKB_DRAIN_MS
+#define DBLKB_DRAIN_MS  (5 * 60 * 1024UL)
+#endif
+
+enum {
+  DBLKB_END_SEAL = 0,
+  DBLKB_END_FLUSH,
+  DBLKB_END_CRASH,
+
+  DBLKB_ACCEL_NS   = 32,
+  DBLKB_FAST_READS = 4,
+};
+
+/* DblkManagerP's, noinit */
+extern dblk_ckpt_t dblk_ckpt;
+
+module DblkBootP {
+  provides interface Init;
+  uses {
+    interface Boot;
+    interface DblkManager;
+    interface FileSystem;
+    interface Collect;
+    interface CollectEvent;
+    interface SysReboot;
+    interface HostSD as HostSD0;
+    interface HostSD as HostSD1;
+    interface HostSim;
+    interface Timer<TMilli> as Tick;
+    interface Timer<TMilli> as Drain;
+  }
+}
+
+implementation {
+  uint32_t dblkb_records, dblkb_rate, dblkb_end;
+  uint32_t sent, credit, seed;
+  bool     sealed;                      /* sealed ckpt at Init */
+  bool     ev_surfaced;
+
+  int      img_fd[DBLK_SD_CARDS];
+  uint32_t lower, upper;                /* logical, inclusive */
+  uint32_t span;                        /* data sectors */
+  uint32_t cache_blk;
+  uint8_t  cache[SD_BLOCKSIZE];
+  uint32_t hbuf[(sizeof(dt_sync_t) + 3) / 4];   /* quad aligned hdr */
+
+  uint8_t  rec_buf[sizeof(dt_sensor_nsamples_t) + DBLKB_ACCEL_NS * 3]
+                __attribute__((aligned(4)));
+
+
+  uint32_t env_knob(char *name, uint32_t def) {
+    char *s;
+
+    if ((s = getenv(name)))
+      return strtoul(s, NULL, 0);
+    return def;
+  }
+
+
+  void fail(char *what, uint32_t a0, uint32_t a1) {
+    printf("dblkb: FAIL %s (0x%x, %u)\n", what, a0, a1);
+    fflush(stdout);
+    exit(1);
+  }
+
+
+  uint32_t sd_reads() {
+    host_sd_stats_t *sp;
+    uint32_t reads;
+
+    reads = call HostSD0.stats()->reads;
+    if ((sp = call HostSD1.stats()))
+      reads += sp->reads;
+    return reads;
+  }
+
+
+  command error_t Init.init() {
+    sealed = (dblk_ckpt.ckpt_sig == DBLK_CKPT_SIG &&
+              (dblk_ckpt.flags & DBLK_CKPT_EXACT));
+    return SUCCESS;
+  }
+
+
+  /*
+   * The walk reads the images itself, the same files HostSDP has open.
+   */
+  void walk_open() {
+    char *image;
+
+    if (!(image = getenv("MMHOST_SD_IMAGE")))
+      image = MMHOST_SD_IMAGE;
+    if ((img_fd[0] = open(image, O_RDONLY)) < 0)
+      fail("can't open sd0 image", 0, 0);
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+    if (!(image = getenv("MMHOST_SD1_IMAGE")))
+      image = MMHOST_SD1_IMAGE;
+    if ((img_fd[1] = open(image, O_RDONLY)) < 0)
+      fail("can't open sd1 image", 0, 1);
+#endif
+    lower = call FileSystem.area_start(FS_LOC_DBLK);
+    upper = DBLK_SD_UPPER(lower, call FileSystem.area_end(FS_LOC_DBLK));
+    span  = upper - lower;
+  }
+
+
+  /* logical DBLK sector, striped: card (s & 1), lower + 1 + (s >> 1) */
+  uint8_t *walk_sector(uint32_t blk) {
+    uint32_t pblk;
+    int      card;
+
+    if (blk == cache_blk)
+      return cache;
+    card = 0;
+    pblk = blk;
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+    card = (blk - lower - 1) & 1;
+    pblk = lower + 1 + ((blk - lower - 1) >> 1);
+#endif
+    if (pread(img_fd[card], cache, SD_BLOCKSIZE,
+              (off_t) pblk * SD_BLOCKSIZE) != SD_BLOCKSIZE)
+      fail("image read", blk, card);
+    cache_blk = blk;
+    return cache;
+  }
+
+
+  /*
+   * Walk offsets keep going past the end of the area, circular.  That
+   * is back at the front (0x200) which is where the sector comes from.
+   */
+  uint8_t *walk_at(uint32_t o) {
+    if ((o >> SD_BLOCKSIZE_NBITS) > span)
+      o -= span << SD_BLOCKSIZE_NBITS;
+    return walk_sector(lower + (o >> SD_BLOCKSIZE_NBITS));
+  }
+
+  uint8_t walk_byte(uint32_t o) {
+    return walk_at(o)[o & (SD_BLOCKSIZE - 1)];
+  }
+
+  /* header at o, sync sized for the majik, into hbuf (quad aligned) */
+  dt_header_t *walk_hdr(uint32_t o) {
+    uint8_t *p;
+    uint16_t i;
+
+    p = (void *) hbuf;
+    for (i = 0; i < sizeof(dt_sync_t); i++)
+      p[i] = walk_byte(o + i);
+    return (void *) hbuf;
+  }
+
+  /* byte sum less the recsum bytes, see CollectP stamp_header */
+  bool walk_recsum(uint32_t o, dt_header_t *hp) {
+    uint16_t sum, recsum;
+    uint32_t i;
+
+    recsum = hp->recsum;
+    sum = 0;
+    for (i = 0; i < hp->len; i++)
+      sum += walk_byte(o + i);
+    sum -= (recsum >> 8) + (recsum & 0xff);
+    return sum == recsum;
+  }
+
+  bool walk_zeros(uint32_t o, uint32_t end) {
+    for (; o < end; o++)
+      if (walk_byte(o))
+        return FALSE;
+    return TRUE;
+  }
+
+  bool walk_is_sync(dt_header_t *hp) {
+    if (!call DblkManager.hdrValid(hp))
+      return FALSE;
+    if (hp->dtype != DT_SYNC && hp->dtype != DT_SYNC_FLUSH &&
+        hp->dtype != DT_SYNC_REBOOT)
+      return FALSE;
+    return ((dt_sync_t *) hp)->sync_majik == SYNC_MAJIK;
+  }
+
+
+  /* after a crash the next boot starts on a new sector with its SYNC/R */
+  bool walk_next_boot(uint32_t o, uint32_t end, uint32_t recnum) {
+    dt_header_t *hp;
+
+    if (o == end)
+      return TRUE;                      /* this boot's, checked below */
+    hp = walk_hdr(o);
+    return (walk_is_sync(hp) && hp->dtype == DT_SYNC_REBOOT &&
+            hp->recnum == recnum);
+  }
+
+
+  void walk() {
+    dt_header_t *hp;
+    uint32_t boot_off, boot_rec, tail;
+    uint32_t o, nxt, end, last, recs, torn, reads;
+
+    reads    = sd_reads();
+    boot_off = call DblkManager.boot_offset();
+    boot_rec = call DblkManager.boot_recnum();
+    walk_open();
+    tail     = 0;
+#ifdef DBLK_CIRCULAR
+    if (call DblkManager.get_dblk_tail() > lower + 1)
+      tail = (call DblkManager.get_dblk_tail() - lower) << SD_BLOCKSIZE_NBITS;
+#endif
+    printf("dblkb: boot %s, %u sd reads, area 0x%x - 0x%x, boot_offset "
+           "0x%x, boot_recnum %u, tail 0x%x\n",
+           sealed ? "sealed ckpt" : "no ckpt", reads, lower, upper,
+           boot_off, boot_rec, tail);
+    if (sealed && reads != DBLKB_FAST_READS)
+      fail("sealed ckpt, not a fast boot", reads, DBLKB_FAST_READS);
+    if (!boot_off)
+      fail("dblk full", 0, 0);
+    if (call DblkManager.tail_offset() != (tail > boot_off ? tail : 0))
+      fail("tail_offset", call DblkManager.tail_offset(), tail);
+
+    o    = SD_BLOCKSIZE;
+    end  = boot_off;
+    last = 0;
+    recs = 0;
+    torn = 0;
+    if (tail) {
+      /* wrapped, tail to the end of the area and around to boot_off */
+      if (tail > boot_off)
+        end += span << SD_BLOCKSIZE_NBITS;
+      for (o = tail; !walk_is_sync(walk_hdr(o)); o += 4)
+        if (o - tail >= 2 * SYNC_MAX_SECTORS * SD_BLOCKSIZE)
+          fail("no sync after the tail", tail, 0);
+      last = ((dt_header_t *) hbuf)->recnum - 1;
+    }
+
+    while (o < end) {
+      if (!(o & (SD_BLOCKSIZE - 1)) && walk_zeros(o, o + SD_BLOCKSIZE))
+        fail("erased short of boot_offset", o, last);
+      nxt = (o + SD_BLOCKSIZE) & ~(SD_BLOCKSIZE - 1);
+      hp  = walk_hdr(o);
+      if (!call DblkManager.hdrValid(hp)) {
+        /*
+         * zeros to the end of the sector, shutdown_flush had no room
+         * for its SYNC_FLUSH.  Or a header torn by a crash.
+         */
+        if (!walk_zeros(o, nxt)) {
+          if (o + sizeof(dt_header_t) <= nxt ||
+              !walk_next_boot(nxt, end, last + 1))
+            fail("bad header", o, last);
+          torn++;
+        }
+        o = nxt;
+        continue;
+      }
+      if (hp->recnum != last + 1)
+        fail("recnum", o, last);
+      last = hp->recnum;
+      recs++;
+      if (!walk_recsum(o, hp)) {
+        if (o + hp->len <= nxt || !walk_next_boot(nxt, end, last + 1))
+          fail("recsum", o, last);
+        torn++;
+        o = nxt;
+        continue;
+      }
+      o += (hp->len + 3) & ~3;
+      if (hp->dtype == DT_SYNC_FLUSH)
+        o = (o + SD_BLOCKSIZE - 1) & ~(SD_BLOCKSIZE - 1);
+    }
+    if (o != end)
+      fail("walk went past boot_offset", o, end);
+    if (last + 1 != boot_rec)
+      fail("boot_recnum", last, boot_rec);
+    if (!walk_zeros(end, end + SD_BLOCKSIZE)) {
+      hp = walk_hdr(end);
+      if (!walk_is_sync(hp) || hp->dtype != DT_SYNC_REBOOT ||
+          hp->recnum != boot_rec)
+        fail("boot_offset not erased or SYNC/R", end, hp->recnum);
+    }
+    printf("dblkb: walk ok, %u records, last %u, %u torn\n", recs, last,
+           torn);
+  }
+
+
+  /* numerical recipes LCG, the samples are noise */
+  uint32_t lcg() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+  }
+
+
+  void gen_one() {
+    dt_sensor_nsamples_t *ap;
+    uint8_t *dp;
+    uint16_t i;
+
+    if ((sent & 7) == 7) {
+      ev_surfaced = !ev_surfaced;
+      call CollectEvent.logEvent(ev_surfaced ? DT_EVENT_SURFACED
+                                             : DT_EVENT_SUBMERGED,
+                                 sent, 0, 0, 0);
+      sent++;
+      return;
+    }
+    ap = (void *) rec_buf;
+    dp = rec_buf + sizeof(*ap);
+    for (i = 0; i < DBLKB_ACCEL_NS * 3; i++)
+      dp[i] = lcg();
+    ap->len         = sizeof(*ap) + DBLKB_ACCEL_NS * 3;
+    ap->dtype       = DT_SNS_ACCEL_N8S;
+    ap->sched_delta = 0;
+    ap->nsamples    = DBLKB_ACCEL_NS;
+    ap->datarate    = 100;
+    call Collect.collect((void *) ap, sizeof(*ap), dp, DBLKB_ACCEL_NS * 3);
+    sent++;
+  }
+
+
+  event void Boot.booted() {
+    char *s;
+
+    dblkb_records = env_knob("DBLKB_RECORDS", 5000);
+    dblkb_rate    = env_knob("DBLKB_RATE",    200);
+    seed          = 1;
+    dblkb_end     = DBLKB_END_SEAL;
+    if ((s = getenv("DBLKB_END"))) {
+      if (!strcmp(s, "flush"))
+        dblkb_end = DBLKB_END_FLUSH;
+      else if (!strcmp(s, "crash"))
+        dblkb_end = DBLKB_END_CRASH;
+      else if (strcmp(s, "seal"))
+        fail("DBLKB_END is seal, flush, or crash", 0, 0);
+    }
+    if (!dblkb_rate)
+      fail("DBLKB_RATE", 0, 0);
+
+    walk();
+    call Tick.startPeriodic(DBLKB_TICK_MS);
+  }
+
+
+  void report() {
+    printf("dblkb: sent %u, end %s, dblk_nxt 0x%x, tail 0x%x\n", sent,
+           dblkb_end == DBLKB_END_SEAL  ? "seal"  :
+           dblkb_end == DBLKB_END_FLUSH ? "flush" : "crash",
+           call DblkManager.dblk_nxt_offset(),
+           call DblkManager.tail_offset());
+    fflush(stdout);
+  }
+
+
+  /* same credit scheme as SSWBench, binary ms */
+  event void Tick.fired() {
+    credit += dblkb_rate * DBLKB_TICK_MS;
+    while (credit >= 1024 && sent < dblkb_records) {
+      credit -= 1024;
+      gen_one();
+    }
+    if (sent < dblkb_records)
+      return;
+    call Tick.stop();
+    switch (dblkb_end) {
+      case DBLKB_END_SEAL:
+        call SysReboot.flush();
+        break;
+
+      case DBLKB_END_FLUSH:
+        call Collect.close_sector();
+        call Drain.startOneShot(DBLKB_DRAIN_MS);
+        return;
+
+      default:
+        break;
+    }
+    report();
+    exit(0);
+  }
+
+
+  event void Drain.fired() {
+    report();
+    exit(0);
+  }
+
+
+  default command host_sd_stats_t *HostSD1.stats() { return NULL; }
+  default command host_sd_model_t *HostSD1.model() { return NULL; }
+
+  event void Collect.collectBooted()             { }
+  event void FileSystem.eraseDone(uint8_t which) { }
+  async event void SysReboot.shutdown_flush()    { }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SSWBench: replay a synthetic record mix through the real storage
+ * pipeline on mmhost and report what it costs.  See SSWBenchP.
+ */
+
+configuration SSWBenchC {}
+implementation {
+  components SSWBenchP;
+  components SystemBootC;
+  SSWBenchP.Boot -> SystemBootC.Boot;
+
+  components CollectC;
+  SSWBenchP.Collect      -> CollectC;
+  SSWBenchP.CollectEvent -> CollectC;
+
+  components SSWriteC;
+  SSWBenchP.SSW -> SSWriteC;
+
+  components SD0C, HostClockP;
+  SSWBenchP.HostSD  -> SD0C;
+  SSWBenchP.HostSim -> HostClockP;
+
+  components new TimerMilliC() as TickC;
+  components new TimerMilliC() as DrainC;
+  SSWBenchP.Tick  -> TickC;
+  SSWBenchP.Drain -> DrainC;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SSWBenchP: storage pipeline benchmark driver (mmhost only).
+ *
+ * Once the system is up (Collect has laid down REBOOT/VERSION) we
+ * replay a synthetic mix of records through Collect:
+ *
+ *   gps    DT_GPS_RAW_SIRFBIN, dt_gps_t + 20..91 byte SirfBin packet
+ *   accel  DT_SNS_ACCEL_N8S, dt_sensor_nsamples_t + 32 samples (x,y,z)
+ *   event  DT_EVENT, SURFACED/SUBMERGED via CollectEvent (critical lane)
+ *
+ * Records go out every SSWB_TICK_MS at SSWB_RATE records per simulated
+ * second until SSWB_RECORDS have been sent.  Then we close the sector,
+ * let things drain for SSWB_DRAIN_MS and report:
+ *
+ *   records/sec   simulated (what the tag would see) and wall (host cpu)
+ *   SSW max_full  high water of full buffers
+ *   SD            transactions, sectors written, power ups, busy time
+ *   commit        per lane collect -> on SD latency (SSW lane_stats)
+ *
+ * Environment:
+ *
+ *   SSWB_RECORDS   how many records              (default 20000)
+ *   SSWB_RATE      records per simulated second  (default 200)
+ *   SSWB_MIX       "gps,accel,event" weights     (default "70,25,5")
+ *   SSWB_SEED      LCG seed                      (default 1)
+ *
+ * Records are deterministic for a given seed so runs can be compared.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <typed_data.h>
+#include <stream_storage.h>
+#include "mmhost.h"
+
+#ifndef SSWB_TICK_MS
+#define SSWB_TICK_MS    10
+#endif
+
+#ifndef SSWB_DRAIN_MS
+#define SSWB_DRAIN_MS   (5 * 60 * 1024UL)
+#endif
+
+enum {
+  SSWB_GPS = 0,
+  SSWB_ACCEL,
+  SSWB_EVENT,
+  SSWB_KINDS,
+
+  SSWB_GPS_MIN    = 20,
+  SSWB_GPS_MAX    = 91,
+  SSWB_ACCEL_NS   = 32,
+};
+
+module SSWBenchP {
+  uses {
+    interface Boot;
+    interface Collect;
+    interface CollectEvent;
+    interface SSWrite as SSW;
+    interface HostSD;
+    interface HostSim;
+    interface Timer<TMilli> as Tick;
+    interface Timer<TMilli> as Drain;
+  }
+}
+
+implementation {
+  uint32_t sswb_records, sswb_rate, sswb_seed;
+  uint32_t sswb_mix[SSWB_KINDS];
+  uint32_t sswb_mix_total;
+
+  uint32_t sent, sent_kind[SSWB_KINDS], sent_bytes;
+  uint32_t credit;                      /* records owed, x1024 */
+  uint64_t t0_us, t1_us;
+  struct timespec w0, w1;
+  bool     ev_surfaced;
+
+  uint8_t  rec_buf[sizeof(dt_sensor_nsamples_t) + SSWB_ACCEL_NS * 3]
+                __attribute__((aligned(4)));
+  uint8_t  data_buf[SSWB_GPS_MAX + 1];
+
+
+  uint32_t env_knob(char *name, uint32_t def) {
+    char *s;
+
+    if ((s = getenv(name)))
+      return strtoul(s, NULL, 0);
+    return def;
+  }
+
+
+  /* numerical recipes LCG, good enough for picking records */
+  uint32_t lcg() {
+    sswb_seed = sswb_seed * 1664525UL + 1013904223UL;
+    return sswb_seed >> 8;
+  }
+
+
+  void gen_gps() {
+    dt_gps_t *gp;
+    uint16_t  plen, i;
+
+    gp   = (void *) rec_buf;
+    plen = SSWB_GPS_MIN + lcg() % (SSWB_GPS_MAX - SSWB_GPS_MIN + 1);
+    data_buf[0] = 0xa0;                 /* SirfBin framing, body is noise */
+    data_buf[1] = 0xa2;
+    for (i = 2; i < plen; i++)
+      data_buf[i] = lcg();
+    gp->len     = sizeof(*gp) + plen;
+    gp->dtype   = DT_GPS_RAW_SIRFBIN;
+    gp->mark_us = (uint32_t) call HostSim.now_us();
+    gp->chip_id = CHIP_GPS_GSD4E;
+    gp->dir     = GPS_DIR_RX;
+    gp->pad     = 0;
+    call Collect.collect((void *) gp, sizeof(*gp), data_buf, plen);
+    sent_bytes += gp->len;
+  }
+
+
+  void gen_accel() {
+    dt_sensor_nsamples_t *ap;
+    uint8_t *dp;
+    uint16_t i;
+
+    ap = (void *) rec_buf;
+    dp = rec_buf + sizeof(*ap);
+    for (i = 0; i < SSWB_ACCEL_NS * 3; i++)
+      dp[i] = lcg();
+    ap->len         = sizeof(*ap) + SSWB_ACCEL_NS * 3;
+    ap->dtype       = DT_SNS_ACCEL_N8S;
+    ap->sched_delta = 0;
+    ap->nsamples    = SSWB_ACCEL_NS;
+    ap->datarate    = 100;
+    call Collect.collect((void *) ap, sizeof(*ap), dp, SSWB_ACCEL_NS * 3);
+    sent_bytes += ap->len;
+  }
+
+
+  void gen_event() {
+    ev_surfaced = !ev_surfaced;
+    call CollectEvent.logEvent(ev_surfaced ? DT_EVENT_SURFACED
+                                           : DT_EVENT_SUBMERGED,
+                               sent, 0, 0, 0);
+    sent_bytes += sizeof(dt_event_t);
+  }
+
+
+  void gen_one() {
+    uint32_t pick;
+    uint8_t  kind;
+
+    pick = lcg() % sswb_mix_total;
+    for (kind = 0; kind < SSWB_KINDS - 1; kind++) {
+      if (pick < sswb_mix[kind])
+        break;
+      pick -= sswb_mix[kind];
+    }
+    switch (kind) {
+      case SSWB_GPS:    gen_gps();   break;
+      case SSWB_ACCEL:  gen_accel(); break;
+      default:          gen_event(); break;
+    }
+    sent_kind[kind]++;
+    sent++;
+  }
+
+
+  event void Boot.booted() {
+    char *s;
+
+    sswb_records = env_knob("SSWB_RECORDS", 20000);
+    sswb_rate    = env_knob("SSWB_RATE",    200);
+    sswb_seed    = env_knob("SSWB_SEED",    1);
+    sswb_mix[SSWB_GPS]   = 70;
+    sswb_mix[SSWB_ACCEL] = 25;
+    sswb_mix[SSWB_EVENT] = 5;
+    if ((s = getenv("SSWB_MIX")))
+      sscanf(s, "%u,%u,%u", &sswb_mix[SSWB_GPS], &sswb_mix[SSWB_ACCEL],
+             &sswb_mix[SSWB_EVENT]);
+    sswb_mix_total = sswb_mix[SSWB_GPS] + sswb_mix[SSWB_ACCEL] +
+      sswb_mix[SSWB_EVENT];
+    if (!sswb_mix_total || !sswb_rate) {
+      fprintf(stderr, "sswb: bad SSWB_MIX/SSWB_RATE\n");
+      exit(2);
+    }
+
+    printf("sswb: %u records, %u/s, mix gps %u accel %u event %u\n",
+           sswb_records, sswb_rate, sswb_mix[SSWB_GPS],
+           sswb_mix[SSWB_ACCEL], sswb_mix[SSWB_EVENT]);
+    t0_us = call HostSim.now_us();
+    clock_gettime(CLOCK_MONOTONIC, &w0);
+    call Tick.startPeriodic(SSWB_TICK_MS);
+  }
+
+
+  /*
+   * each tick owes rate * tick records, in binary ms.  credit carries
+   * the fraction so the long run rate comes out right.
+   */
+  event void Tick.fired() {
+    credit += sswb_rate * SSWB_TICK_MS;
+    while (credit >= 1024 && sent < sswb_records) {
+      credit -= 1024;
+      gen_one();
+    }
+    if (sent < sswb_records)
+      return;
+    call Tick.stop();
+    t1_us = call HostSim.now_us();
+    clock_gettime(CLOCK_MONOTONIC, &w1);
+    call Collect.close_sector();
+    call Drain.startOneShot(SSWB_DRAIN_MS);
+  }
+
+
+  void report_lane(char *name, ssw_lane_stats_t *lp) {
+    if (!lp || !lp->count) {
+      printf("  commit %-5s  none\n", name);
+      return;
+    }
+    printf("  commit %-5s  %u sectors, avg %u ms, max %u ms, last %u ms\n",
+           name, lp->count, lp->total_ms / lp->count, lp->max_ms,
+           lp->last_ms);
+  }
+
+
+  event void Drain.fired() {
+    host_sd_stats_t *sp;
+    host_sd_model_t *mp;
+    double sim_s, wall_s;
+
+    sp = call HostSD.stats();
+    mp = call HostSD.model();
+    sim_s  = (t1_us - t0_us) / 1e6;
+    wall_s = (w1.tv_sec - w0.tv_sec) + (w1.tv_nsec - w0.tv_nsec) / 1e9;
+
+    printf("sswb: sent %u (gps %u, accel %u, event %u), %u bytes\n",
+           sent, sent_kind[SSWB_GPS], sent_kind[SSWB_ACCEL],
+           sent_kind[SSWB_EVENT], sent_bytes);
+    printf("  records/sec   sim %.1f (%.3f s), wall %.1f (%.3f s)\n",
+           sim_s  > 0 ? sent / sim_s  : 0.0, sim_s,
+           wall_s > 0 ? sent / wall_s : 0.0, wall_s);
+    printf("  ssw max_full  %u\n", call SSW.max_full());
+    printf("  sd writes     %u xfers, %u sectors (%.1f sect/xfer), %u sa\n",
+           sp->writes, sp->sectors_wr,
+           sp->writes ? (double) sp->sectors_wr / sp->writes : 0.0,
+           sp->sa_writes);
+    printf("  sd reads      %u xfers, %u sectors, %u erases\n",
+           sp->reads, sp->sectors_rd, sp->erases);
+    printf("  sd power      %u ups, busy %.3f s (%.1f%%)\n",
+           sp->power_ups, sp->busy_us / 1e6,
+           call HostSim.now_us() ? 100.0 * sp->busy_us /
+             call HostSim.now_us() : 0.0);
+    printf("  model         pwr %u cmd %u xfer %u prog %u erase %u us, idle %u ms\n",
+           mp->pwr_us, mp->cmd_us, mp->xfer_us, mp->prog_us,
+           mp->erase_us, mp->idle_ms);
+    report_lane("bulk", call SSW.lane_stats(SSW_LANE_BULK));
+    report_lane("crit", call SSW.lane_stats(SSW_LANE_CRIT));
+    fflush(stdout);
+    exit(0);
+  }
+
+
+  event void Collect.collectBooted() { }
+}
@@ -61,6 +61,6 @@
  */
 
 #define CORE_REV   22
-#define CORE_MINOR 8
+#define CORE_MINOR 10
 
 #endif  /* __CORE_REV_H__ */
@@ -48,6 +48,11 @@
  * assigned to a FAT file.  Max size is 4Gbytes.  On large
  * SDs we may have more than one.  The first one is named
  * DBLK0001 and has file_idx 1.
+ *
+ * sd_mode is how the DBLK is laid down across the SDs (dblk_sd.h).
+ * tagfmtsd leaves it 0 (SINGLE), DblkManager fills it in when it
+ * mirrors its checkpoint.  dblk_low/dblk_high are always the physical
+ * area on each card.
  */
 
 #define DBLK_DIR_QUADS 9
@@ -59,9 +64,147 @@ typedef struct {                        /* Image Directory */
   uint32_t   dblk_high;
   rtctime_t  incept_date;
   uint8_t    file_idx;                  /* file idx */
-  uint8_t    pad;
+  uint8_t    sd_mode;                   /* DBLK_SD_xxx, see dblk_sd.h */
   uint32_t   dblk_dir_sig_a;
   uint32_t   chksum;
 } dblk_dir_t;
 
+
+/*
+ * Dblk Checkpoint
+ *
+ * Where the data stream was when we last looked.  On boot DblkManager
+ * would rather not binary search the Dblk area for the first erased
+ * sector, resync back from there, and walk records to find the last
+ * record number and time.
+ *
+ * One copy lives in noinit RAM (DblkManagerP, dblk_ckpt).  Collect seals
+ * it (DBLK_CKPT_EXACT) on its way down (shutdown_flush) after SSW has
+ * pushed everything out.  At that point it says exactly what is on the
+ * disk.  A warm reboot (panic, reboot, strange) then only has to check
+ * that dblk_nxt is erased and dblk_nxt - 1 isn't.
+ *
+ * A second copy is mirrored into the Dblk directory sector at
+ * DBLK_CKPT_OFFSET every DBLK_CKPT_MIRROR syncs.  It isn't exact, the
+ * stream only grows, so it is a lower bound for dblk_nxt on a cold boot.
+ *
+ * Same protections as the directory, two sigs and a 32 bit checksum
+ * over DBLK_CKPT_QUADS.
+ *
+ * dblk_tail is where the oldest data lives (circular, see below), 0 if
+ * the DBLK isn't circular.  Readers of the directory sector (tagdump,
+ * Tagnet) start there.
+ */
+
+#define DBLK_CKPT_SIG    0x18961776
+#define DBLK_CKPT_OFFSET 64
+#define DBLK_CKPT_QUADS  12
+#define DBLK_CKPT_EXACT  0x01
+
+#ifndef DBLK_CKPT_MIRROR
+#define DBLK_CKPT_MIRROR 32             /* syncs between dir mirrors */
+#endif
+
+typedef struct {
+  uint32_t   ckpt_sig;
+  uint32_t   dblk_low;                  /* must match the dir */
+  uint32_t   dblk_high;
+  uint32_t   dblk_nxt;                  /* abs blk_id, next to write */
+  uint32_t   cur_recnum;                /* last recnum used */
+  uint32_t   last_sync_offset;          /* file offset of last SYNC */
+  rtctime_t  last_rt;                   /* when we took it */
+  uint8_t    flags;                     /* DBLK_CKPT_EXACT */
+  uint8_t    pad;
+  uint32_t   dblk_tail;                 /* abs blk_id, oldest data */
+  uint32_t   ckpt_sig_a;
+  uint32_t   chksum;
+} dblk_ckpt_t;
+
+
+/*
+ * SD characterisation
+ *
+ * Cards differ a lot in what it costs to power them up, to push one
+ * sector, and how much a multi-block write saves.  SSW grouping (how many
+ * sectors to collect before firing up the SD) and the SSWPolicy flush
+ * lead are tuned from these, see SSWPolicyP.  Lives in the Dblk
+ * directory sector at DBLK_SDCHAR_OFFSET.
+ *
+ * Two ways it gets there:
+ *
+ * o tagfmtsd -C measures write latency through the host's reader.  The
+ *   host can't power cycle the card so pwr_us is left 0 (unknown).
+ * o the tag learns it from its own writes (SSWPolicy) when there is
+ *   nothing valid in the directory.  With a host characterisation the
+ *   tag only fills in pwr_us, the host's write costs stand.  The result
+ *   goes out with the next checkpoint mirror.
+ *
+ * pwr_us:      request to granted, includes power up and reset.  0 unknown.
+ * wr1_us:      one sector, single block write, start to not busy.
+ * wrm_us:      wrm_cnt sectors in one multi-block write.
+ * src:         who measured, DBLK_SDC_SRC_xxx.
+ *
+ * Same protections as the directory, two sigs and a 32 bit checksum over
+ * DBLK_SDCHAR_QUADS.
+ */
+
+#define DBLK_SDCHAR_SIG    0x18961969
+#define DBLK_SDCHAR_OFFSET 128
+#define DBLK_SDCHAR_QUADS  7
+
+enum {
+  DBLK_SDC_SRC_NONE = 0,
+  DBLK_SDC_SRC_HOST = 1,                /* tagfmtsd -C */
+  DBLK_SDC_SRC_TAG  = 2,                /* learned by SSWPolicy */
+};
+
+typedef struct {
+  uint32_t   sdc_sig;
+  uint32_t   pwr_us;                    /* power up, 0 unknown */
+  uint32_t   wr1_us;                    /* single block write */
+  uint32_t   wrm_us;                    /* multi-block, wrm_cnt blks */
+  uint16_t   wrm_cnt;
+  uint8_t    src;                       /* DBLK_SDC_SRC_xxx */
+  uint8_t    pad;
+  uint32_t   sdc_sig_a;
+  uint32_t   chksum;
+} dblk_sdchar_t;
+
+
+/*
+ * Circular DBLK (DBLK_CIRCULAR, define it in platform.h)
+ *
+ * Normally when the stream runs off the end of the DBLK area we are done
+ * (SS.dblk_stream_full) and the tag stops recording.  Circular, dblk_nxt
+ * wraps back to the first data sector and the oldest data gets eaten.
+ *
+ * The data sectors are carved into DBLK_ERASE_UNIT sector units starting
+ * at lower + 1, the last one can be short.  DblkManager keeps at least
+ * DBLK_ERASE_AHEAD units erased in front of dblk_nxt, when the head gets
+ * closer than that the oldest unit is erased (SDerase).  The first
+ * sector past the erased gap is the tail, the oldest data.  Until the
+ * first unit is eaten the tail is lower + 1.
+ *
+ * File offsets stay physical.  The stream runs from the tail to the end
+ * of the area and then from the front (0x200) up to dblk_nxt.  A record
+ * can straddle the wrap, offsets past the end of the area fold back to
+ * the front (SS.where).
+ *
+ * On boot the erased gap is found by comparing recnums rather than just
+ * looking for an erased sector, anything older than where the scan
+ * started is on the far side of the gap.  The tail is the first unit
+ * past the gap that isn't erased.  Every tail move forces a checkpoint
+ * mirror.
+ *
+ * The DBLK has to be at least DBLK_ERASE_AHEAD + 3 units.
+ */
+
+#ifndef DBLK_ERASE_UNIT
+#define DBLK_ERASE_UNIT  2048           /* sectors, 1 MiB */
+#endif
+
+#ifndef DBLK_ERASE_AHEAD
+#define DBLK_ERASE_AHEAD 2              /* units kept erased */
+#endif
+
 #endif  /* __DBLK_DIR_H__ */
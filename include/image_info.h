@@ -105,7 +105,8 @@ typedef struct {
   uint32_t    image_chk;                /*  s  simple checksum over entire image  */
   hw_ver_t    hw_ver;                   /*  b  2 byte hw_ver                      */
   uint16_t    plus_len;                 /*  b  2 byte plus block size             */
-  uint8_t     reserved[8];              /*  b  reserved                           */
+  uint32_t    image_crc32;              /*  s  CRC-32 over entire image           */
+  uint8_t     reserved[4];              /*  b  reserved                           */
 } image_info_basic_t;
 
 
@@ -129,6 +130,7 @@ typedef struct {
  * 'binfin' (tools/utils/binfin) is used to fill in the following cells:
  *
  *      o image_chk
+ *      o image_crc32
  *      o image_desc
  *      o repo0_desc
  *      o repo1_desc
@@ -168,8 +170,15 @@ typedef struct {
  * To verify the image_chk, first it must be copied out (saved), zeroed,
  * and the checksum computed then compared against the saved value.
  *
+ * image_crc32 is a standard CRC-32 (IEEE 802.3, same as zlib's crc32)
+ * over the entire image computed with both image_chk and image_crc32
+ * zero.  It is computed first and laid in, then image_chk is computed
+ * (image_chk covers image_crc32).  When verifying, the bytes of both
+ * fields are fed to the CRC as zeros.  If image_crc32 is 0, the image
+ * predates it and image_chk is used.
+ *
  * image_desc, repo_desc{0,1}, and stamp_date must be filled in prior to
- * computing the value of image_chk.
+ * computing the value of image_crc32 and image_chk.
  */
 
 #endif  /* __IMAGE_INFO_H__ */
@@ -89,6 +89,7 @@ typedef enum {
   DT_GPS_PROTO_STATS    = 25,
   DT_GPS_TRK            = 26,
   DT_GPS_CLK            = 27,
+  DT_INDEX              = 28,
 
   DT_SNS_NONE           = 32,           /* 0x20 + sns_id */
   DT_SNS_BATT           = 33,
@@ -247,6 +248,59 @@ typedef struct {
 } PACKED dt_sync_t;             /* quad granular */
 
 
+/*
+ * INDEXing:
+ *
+ * Finding a record by number or by time used to mean walking the stream
+ * from some SYNC.  To avoid this Collect lays down INDEX records.  The
+ * file is carved into spans of INDEX_SECTORS sectors, span n starts at
+ * file offset n * INDEX_SPAN.  When the stream crosses into a new span,
+ * an INDEX is laid down at the next record boundary.  A record is at most
+ * DT_MAX_RLEN so the INDEX always starts in the first INDEX_SCAN_SECTORS
+ * sectors of its span.  This is what makes the index searchable, a reader
+ * only has to look at the front of a span to find its INDEX.
+ *
+ * The INDEX header (recnum, rt) tells where the stream was as it entered
+ * the span.  The entries are the SYNCs laid down since the previous INDEX
+ * (the last INDEX_MAX_ENTRIES of them), oldest first, which gives finer
+ * grained places to start inside the previous span.  prev_index chains
+ * back to the previous INDEX, 0 if none (first INDEX after a reboot).
+ *
+ * A span that Collect enters other than at its front (a reboot landing in
+ * the middle of a span) doesn't get an INDEX.  Readers treat a span with
+ * no INDEX as being past what they are looking for, which only costs a
+ * longer walk.
+ *
+ * INDEX_MAJIK sits at the same offset as SYNC_MAJIK in a SYNC.
+ */
+
+#define INDEX_MAJIK         0xdedf1dccUL
+#define INDEX_SECTORS       64
+#define INDEX_SPAN          (INDEX_SECTORS * 512)   /* bytes, SD_BLOCKSIZE */
+#define INDEX_SCAN_SECTORS  2
+#define INDEX_MAX_ENTRIES   16
+
+typedef struct {
+  uint32_t   offset;            /* file offset of the SYNC */
+  uint32_t   recnum;            /* and its recnum */
+  rtctime_t  rt;                /* and its time */
+  uint16_t   pad;
+} PACKED dt_index_entry_t;      /* size 20, quad granular */
+
+typedef struct {
+  uint16_t   len;               /* size 32 + nentries * 20 */
+  dtype_t    dtype;
+  uint8_t    hdr_crc8;          /* single byte CRC-8 */
+  uint32_t   recnum;
+  rtctime_t  rt;                /* 10 byte rtctime, 2quad align */
+  uint16_t   recsum;            /* part of header */
+  uint32_t   prev_index;        /* file offset of previous INDEX */
+  uint32_t   index_majik;       /* same place as sync_majik */
+  uint16_t   nentries;          /* dt_index_entry_t's that follow */
+  uint16_t   pad;
+} PACKED dt_index_t;            /* quad granular */
+
+
 typedef enum {
   DT_EVENT_NONE             = 0,
 
@@ -262,7 +316,7 @@ typedef enum {
   DT_EVENT_GPS_FIRST_FIX    = 7,       // boot to first fix
 
   DT_EVENT_SSW_DELAY_TIME   = 8,
-  DT_EVENT_SSW_BLK_TIME     = 9,
+  DT_EVENT_SSW_BLK_TIME     = 9,        // blk, cnt/polls, max_us, total_us
   DT_EVENT_SSW_GRP_TIME     = 10,
 
   DT_EVENT_SURFACED         = 11,
@@ -282,6 +336,7 @@ typedef enum {
   DT_EVENT_SD_REQ           = 22,       // SD request
   DT_EVENT_SD_REL           = 23,       // SD release
   DT_EVENT_RADIO_MODE       = 24,       // report radio major mode changes
+  DT_EVENT_SSW_LANE_TIME    = 25,       // per lane latency, collect to SD
 
   /***********************************/
 
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * copy_sum_bench: host cycle counts for Collect's record copy.
+ *
+ * Times laying a record down into 512 byte sector buffers the way
+ * CollectP does it, the old way (sum every byte for recsum, then copy
+ * byte by byte) against copy_sum (tos/mm/copy_sum.h, the code Collect
+ * actually runs).  28 byte records (a SYNC) and 1 KiB records (largest
+ * record, crosses sectors), from aligned and unaligned sources.  Also
+ * checks that both come up with the same sum and the same bytes.
+ *
+ * x86 host, rdtsc.  -fno-tree-vectorize keeps gcc from turning the byte
+ * loops into SIMD the Cortex-M4 doesn't have.  The numbers are host
+ * cycles, the ratio is the interesting part.
+ *
+ * gcc -O2 -fno-tree-vectorize -I../tos/mm -o copy_sum_bench copy_sum_bench.c
+ * ./copy_sum_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "copy_sum.h"
+
+#define SD_BLOCKSIZE 512
+#define ITERS        20000
+#define NSECTS       64
+
+static uint8_t sectors[NSECTS][SD_BLOCKSIZE] __attribute__((aligned(4)));
+static uint8_t src_buf[1024 + 8]             __attribute__((aligned(4)));
+
+static uint8_t *cur_ptr;
+static uint16_t remaining;
+static int      cur_sect;
+
+static void reset_stream(void) {
+  cur_sect  = 0;
+  cur_ptr   = sectors[0];
+  remaining = SD_BLOCKSIZE;
+}
+
+static void next_sector(void) {
+  cur_sect  = (cur_sect + 1) % NSECTS;
+  cur_ptr   = sectors[cur_sect];
+  remaining = SD_BLOCKSIZE;
+}
+
+/* what CollectP did before copy_sum: finish_record sum, then copy_out */
+static uint16_t old_way(uint8_t *data, uint16_t dlen) {
+  uint16_t sum, n, i;
+  uint8_t *p;
+
+  sum = 0;
+  for (p = data, i = dlen; i; i--)
+    sum += *p++;
+  while (dlen) {
+    n = (dlen < remaining) ? dlen : remaining;
+    for (i = 0; i < n; i++)
+      *cur_ptr++ = *data++;
+    remaining -= n;
+    dlen      -= n;
+    if (!remaining)
+      next_sector();
+  }
+  return sum;
+}
+
+/* copy_out/copy_block_out with copy_sum */
+static uint16_t new_way(uint8_t *data, uint16_t dlen) {
+  uint16_t sum, n;
+
+  sum = 0;
+  while (dlen) {
+    n = (dlen < remaining) ? dlen : remaining;
+    sum += copy_sum(cur_ptr, data, n);
+    cur_ptr   += n;
+    data      += n;
+    remaining -= n;
+    dlen      -= n;
+    if (!remaining)
+      next_sector();
+  }
+  /* Collect realigns each record to a quad */
+  n = (4 - ((uintptr_t) cur_ptr & 3)) & 3;
+  cur_ptr += n; remaining -= n;
+  if (!remaining)
+    next_sector();
+  return sum;
+}
+
+static uint16_t old_rec(uint8_t *data, uint16_t dlen) {
+  uint16_t sum, n;
+
+  sum = old_way(data, dlen);
+  n = (4 - ((uintptr_t) cur_ptr & 3)) & 3;
+  cur_ptr += n; remaining -= n;
+  if (!remaining)
+    next_sector();
+  return sum;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static uint64_t run(uint16_t (*fn)(uint8_t *, uint16_t),
+                    uint8_t *src, uint16_t len, uint16_t *sump) {
+  static uint64_t t[ITERS];
+  uint64_t t0;
+  int      i;
+
+  reset_stream();
+  for (i = 0; i < ITERS; i++) {
+    t0    = __rdtsc();
+    *sump = fn(src, len);
+    t[i]  = __rdtsc() - t0;
+  }
+  qsort(t, ITERS, sizeof(t[0]), cmp_u64);
+  return t[ITERS / 2];                  /* median */
+}
+
+static int check(uint8_t *src, uint16_t len) {
+  static uint8_t a[2][NSECTS * SD_BLOCKSIZE];
+  uint16_t s0, s1;
+
+  memset(sectors, 0, sizeof(sectors));
+  reset_stream(); s0 = old_rec(src, len); memcpy(a[0], sectors, sizeof(a[0]));
+  memset(sectors, 0, sizeof(sectors));
+  reset_stream(); s1 = new_way(src, len); memcpy(a[1], sectors, sizeof(a[1]));
+  return s0 == s1 && !memcmp(a[0], a[1], sizeof(a[0]));
+}
+
+int main(void) {
+  static const uint16_t lens[] = { 28, 1024 };
+  uint16_t  s0, s1;
+  uint64_t  c_old, c_new;
+  uint8_t  *src;
+  int       i, l, off, fails;
+
+  srand(1);
+  for (i = 0; i < (int) sizeof(src_buf); i++)
+    src_buf[i] = rand();
+
+  fails = 0;
+  printf("  len  src        old cyc   new cyc   old c/B   new c/B   x\n");
+  for (l = 0; l < 2; l++) {
+    for (off = 0; off < 2; off++) {
+      src = src_buf + off;
+      if (!check(src, lens[l])) {
+        printf("*** %u bytes, src+%d: old and new disagree\n", lens[l], off);
+        fails++;
+      }
+      c_old = run(old_rec, src, lens[l], &s0);
+      c_new = run(new_way, src, lens[l], &s1);
+      printf("%5u  %-9s %9llu %9llu %9.2f %9.2f %5.2f\n", lens[l],
+             off ? "unaligned" : "aligned",
+             (unsigned long long) c_old, (unsigned long long) c_new,
+             (double) c_old / lens[l], (double) c_new / lens[l],
+             (double) c_old / c_new);
+    }
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * sd_crc_test: host check of tos/chips/sd/sd_crc.h
+ *
+ * o sd_crc16_tab against the table generated bitwise from 0x1021.
+ * o sd_crc16 and sd_crc7_cmd against the reference vectors:
+ *     "123456789"        -> 0x31c3
+ *     512 bytes of 0xff  -> 0x7fa1
+ *     CMD0,  arg 0       -> 0x95
+ *     CMD8,  arg 0x1aa   -> 0x87
+ * o sd_crc16 bytes/cycle over a 512 byte sector (rdtsc, x86 host).
+ *
+ * gcc -O2 -I../tos/chips/sd -o sd_crc_test sd_crc_test.c
+ * ./sd_crc_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "sd_crc.h"
+
+#define SD_BLOCKSIZE 512
+#define ITERS        20000
+
+static int fails;
+
+static void expect(const char *what, unsigned got, unsigned want) {
+  printf("%-24s 0x%04x  %s\n", what, got, got == want ? "ok" : "FAIL");
+  if (got != want)
+    fails++;
+}
+
+static uint16_t crc16_bitwise(uint8_t *data, uint16_t len) {
+  uint16_t crc;
+  int      bit;
+
+  crc = 0;
+  while (len--) {
+    crc ^= (uint16_t) *data++ << 8;
+    for (bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+int main(void) {
+  static uint64_t t[ITERS];
+  uint8_t  blk[SD_BLOCKSIZE], b;
+  uint64_t t0;
+  volatile uint16_t sink;
+  int      i, bad;
+
+  bad = 0;
+  for (i = 0; i < 256; i++) {
+    b = i;
+    if (sd_crc16_tab[i] != crc16_bitwise(&b, 1))
+      bad++;
+  }
+  expect("crc16 table mismatches", bad, 0);
+
+  expect("crc16 \"123456789\"", sd_crc16((uint8_t *) "123456789", 9), 0x31c3);
+  memset(blk, 0xff, sizeof(blk));
+  expect("crc16 512 x 0xff", sd_crc16(blk, SD_BLOCKSIZE), 0x7fa1);
+  expect("crc7 CMD0 arg 0", sd_crc7_cmd(0x40 | 0, 0), 0x95);
+  expect("crc7 CMD8 arg 0x1aa", sd_crc7_cmd(0x40 | 8, 0x1aa), 0x87);
+
+  srand(1);
+  for (i = 0; i < SD_BLOCKSIZE; i++)
+    blk[i] = rand();
+  expect("crc16 random vs bitwise", sd_crc16(blk, SD_BLOCKSIZE),
+         crc16_bitwise(blk, SD_BLOCKSIZE));
+
+  for (i = 0; i < ITERS; i++) {
+    t0   = __rdtsc();
+    sink = sd_crc16(blk, SD_BLOCKSIZE);
+    t[i] = __rdtsc() - t0;
+  }
+  (void) sink;
+  qsort(t, ITERS, sizeof(t[0]), cmp_u64);
+  printf("crc16 512 bytes: %llu cycles (median), %.2f bytes/cycle\n",
+         (unsigned long long) t[ITERS / 2],
+         (double) SD_BLOCKSIZE / t[ITERS / 2]);
+
+  return fails ? 1 : 0;
+}
@@ -4,8 +4,10 @@ binfin: Update MamMark (mm) META_INFO data
 @author: R. Li Fo Sjoe
 """
 
-__version__ = '1.0.0'
+__version__ = '1.0.1'
 
+# 1.0.1         compute and lay down image_crc32 (zlib CRC-32) ahead of
+#               image_chk.
 # 1.0.0         release
 # 0.1.4         rework core binfin to deal with plus tlvs as reworked.
 #               rework options, add -c (clear), -d (desc), --version,
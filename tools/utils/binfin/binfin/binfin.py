@@ -82,6 +82,7 @@ from   __init__   import __version__ as VERSION
 import sys
 import argparse
 import os.path
+import binascii
 
 from   elf                  import *
 from   tagcore.base_objs    import *
@@ -306,15 +307,24 @@ def processMeta(argv):
     data_offset = progs[1].p_offset
     data_size   = progs[1].p_filesz
 
-    # To update the checksum, we first zero it, calculate the checksum
-    # then lay it into place.
+    # To update the crc32 and checksum, we first zero both and calculate
+    # the crc32 (zlib CRC-32) and lay it into place.  Then the checksum
+    # is calculated (it covers the crc32) and laid into place.  See
+    # image_info.h.
     ii_cls.setChecksum(0)
+    ii_cls.setCRC32(0)
     mod_im  = ii_cls.build()
     if debug:
         dump_buf(mod_im, '', 'mod:  ')
         print()
     raw_elf = raw_elf[:elf_meta_offset] + mod_im + raw_elf[elf_meta_offset + meta_size:]
 
+    bin_img   = raw_elf[text_offset:text_offset+text_size] + raw_elf[data_offset:data_offset+data_size]
+    imgcrc32  = binascii.crc32(bin_img) & 0xffffffff
+    ii_cls.setCRC32(imgcrc32)
+    mod_im  = ii_cls.build()
+    raw_elf = raw_elf[:elf_meta_offset] + mod_im + raw_elf[elf_meta_offset + meta_size:]
+
     bin_img   = raw_elf[text_offset:text_offset+text_size] + raw_elf[data_offset:data_offset+data_size]
     bin_bytes = bytearray(bin_img)
     imgchksum = sum(bin_bytes) & 0xffffffff
@@ -3,6 +3,7 @@ pix: Panic Inspector and eXtractor
 @author: /Rick Li Fo Sjoe
 """
 
+# 0.0.1.dev4    expand compressed (PANIC_ADDITIONS_RLE) ram sections
 # 0.0.1.dev3    Initial version
 
-__version__ = '0.0.1.dev3'
+__version__ = '0.0.1.dev4'
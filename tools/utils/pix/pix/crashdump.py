@@ -40,6 +40,42 @@ from   tagcore.imageinfo    import *
 from   tagcore.core_headers import *
 from   tagcore.panic_headers import *
 
+def prle_expand(buf, clen, rlen):
+    '''
+    expand a compressed (PANIC_ADDITIONS_RLE) ram section.
+
+    buf:  ram section bytes, clen bytes of compressed words.
+    rlen: expanded ram size, from the ram_header.
+
+    returns a bytearray of rlen bytes.  Short (truncated on the tag)
+    is zero filled, long is cut back.
+    '''
+    nwords = clen / 4
+    words  = struct.unpack_from('<{}I'.format(nwords), buffer(buf), 0)
+    out    = []
+    idx    = 0
+    while idx < nwords:
+        tok  = words[idx]
+        cnt  = tok & PRLE_CNT_MASK
+        idx += 1
+        if tok & PRLE_TYPE_MASK == PRLE_LIT:
+            out.extend(words[idx:idx + cnt])
+            idx += cnt
+        elif tok & PRLE_TYPE_MASK == PRLE_RUN:
+            if idx >= nwords:
+                break
+            out.extend([words[idx]] * cnt)
+            idx += 1
+        else:
+            print('*** prle: bad token {:08x} @ word {}'.format(tok, idx - 1))
+            break
+    ram = bytearray(struct.pack('<{}I'.format(len(out)), *out))
+    if len(ram) < rlen:
+        print('*** prle: short, {} of {} bytes'.format(len(ram), rlen))
+        ram.extend('\0' * (rlen - len(ram)))
+    return ram[:rlen]
+
+
 class CrashDumpFormat:
     global CRASH_CATCHER_SIG
 
@@ -190,6 +226,10 @@ class CrashDumpFormat:
         outFile.write("\n")
 
         rambytes = bytearray(self.panic_raw[ram_offset:])
+        if ai_sig == PANIC_ADDITIONS_RLE:
+            print('RAM: compressed, {} bytes'.format(ram_size))
+            ram_size = ram_end - ram_start
+            rambytes = prle_expand(rambytes, add_info['ram_size'].val, ram_size)
         offset = 0
         while True:
             b = rambytes[offset]
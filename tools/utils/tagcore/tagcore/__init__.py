@@ -3,7 +3,7 @@ tagcore: utility and common routines for many tag things
 @author:   Eric B. Decker
 """
 
-__version__ = '0.4.7'
+__version__ = '0.4.8.dev14'
 
 __all__ = [
     'CORE_REV',                         # core_rev.py
@@ -18,6 +18,63 @@ from    .core_rev       import CORE_MINOR
 from    .misc_utils     import buf_str, dump_buf
 from    .core_headers   import obj_dt_hdr
 
+# 0.4.8.dev14
+#       o base_objs: tlv_aggie/tlv_block_aggie peek tlv_type/tlv_len the
+#         same for str and bytearray buffers (tagdump hands bytearray).
+#
+# 0.4.8.dev13
+#       o json_emitters: InfluxWriter, export batched on a background
+#         thread, line protocol, bounded queue, retry with back-off.
+#         influx_close drains it and prints stats.
+#       o influx_stub, stand in influxdb and --bench for offline work.
+#
+# 0.4.8.dev12
+#       o TagFile.resync scans RESYNC_WINDOW at a time with find, only
+#         majik hits get checked (type, len, chksum, prev_sync points
+#         back).  Reports bytes skipped, running total resync_skipped.
+#
+# 0.4.8.dev11
+#       o base_objs: aggies of plain atoms/aggies compile to one
+#         struct.Struct, set() is a single unpack_from.  atom __slots__.
+#       o decode_bench, records/sec per rtype, compiled vs. field walk.
+#
+# 0.4.8.dev10
+#       o TagFile mmaps regular local files, read is a slice of the map.
+#         TagFile.peek for the SYNC/INDEX scans.
+#
+# 0.4.8.dev9
+#       o TagFile.sync_after, first good SYNC at or after an offset.
+#       o dt_defs.hourly_hook/hourly_str, json_emitters.influx_sink/
+#         influx_flush for parallel tagdump.
+#
+# 0.4.8.dev8 CR 22/10
+#       o PANIC_ADDITIONS_RLE and PRLE tokens, compressed panic ram.
+#
+# 0.4.8.dev7
+#       o circular DBLK, TagFile.dir_tail/set_wrap, reads off the end
+#         come around to the front.
+#
+# 0.4.8.dev6
+#       o StripeFile, two card dumps of a striped DBLK as one stream.
+#       o TagFile.size, works for --net and StripeFile.
+#
+# 0.4.8.dev5
+#       o SSW_LANE_TIME event, per lane latency collect to SD.
+#       o export SSW_BLK_TIME from core_events.
+#
+# 0.4.8.dev4
+#       o SSW_BLK_TIME event, SD program busy per blk.
+#
+# 0.4.8.dev3 CR 22/9
+#       o TagFile.prev_sync, go back N SYNCs using the prev_sync chain.
+#
+# 0.4.8.dev2 CR 22/9
+#       o DT_INDEX, index records, obj and emitter
+#       o TagFile.index_seek, find records/times using the INDEX records.
+#
+# 0.4.8.dev1
+#       o image_info basic: split im_crc32 out of reserved.
+#
 # 0.4.7 CR 22/8
 #       o collapse sns_id into DT_types.
 #
@@ -21,6 +21,7 @@
 
 '''base classes for defining record objects'''
 
+import sys
 import struct
 import copy
 from   collections import OrderedDict
@@ -33,7 +34,37 @@ from   tagcore.imageinfo_defs import iip_tlv_name
 from   tagcore.imageinfo_defs import IMAGE_INFO_PLUS_SIZE
 from   tagcore.imageinfo_defs import IIP_TLV_END
 
-__version__ = '0.4.7'
+__version__ = '0.4.8'
+
+# compile_aggies: when set, an aggie made up purely of atoms and plain
+# aggies is flattened into one struct.Struct and decoded with a single
+# unpack_from.  Clear it to force the old field by field walk (see
+# decode_bench).
+compile_aggies = True
+
+# format chars that are byte wide, byte order doesn't matter for these.
+_ORDER_FREE = 'xcbB?sp0123456789 '
+
+def _split_fmt(fmt):
+    '''
+    split a struct format into (order, body).
+
+    order is '<' or '>' (normalized), None if the body is only byte wide
+    items and any order will do.  Native alignment ('@' or no prefix)
+    with multibyte items returns '@' and can't be flattened.
+    '''
+    if fmt[:1] in '@=<>!':
+        order, body = fmt[0], fmt[1:]
+    else:
+        order, body = '@', fmt
+    if not body.strip(_ORDER_FREE):
+        return None, body
+    if order == '!':
+        order = '>'
+    elif order == '=':
+        order = '<' if sys.byteorder == 'little' else '>'
+    return order, body
+
 
 class atom(object):
     '''
@@ -43,6 +74,8 @@ class atom(object):
     set will set the instance.attribute "val" to the value
     of the atom's decode of the buffer.
     '''
+    __slots__ = ('s_str', 's_rec', 'p_str', 'f_str', 'val')
+
     def __init__(self, a_tuple):
         self.s_str = a_tuple[0]
         self.s_rec = struct.Struct(self.s_str)
@@ -84,11 +117,88 @@ class aggie(OrderedDict):
     '''
     aggie: aggregation node.
     takes one parameter a dictionary of key -> {atom | aggie}
+
+    The first set() (or len()) compiles a plan.  If everything below us
+    is atoms and plain aggies with one byte order, the leaf atoms are
+    flattened into one struct.Struct and set() is a single unpack_from
+    that drops each value into its atom.  The atom tree stays as is,
+    decoders and emitters still see obj['field'].val.  Anything else
+    (tlvs, special atoms, native alignment, mixed order) falls back to
+    walking the fields one at a time.
+
+    Adding or removing an atom/aggie throws the plan away.  Other values
+    (decoders hang per sample dicts off int keys) don't touch it.
     '''
+    _plan = None                        # None: not compiled, False: can't
+
     def __init__(self, a_dict):
         super(aggie, self).__init__(a_dict)
 
+    def __setitem__(self, key, value, **kwargs):
+        if isinstance(value, (atom, aggie)):
+            self._plan = None
+        OrderedDict.__setitem__(self, key, value, **kwargs)
+
+    def __delitem__(self, key, **kwargs):
+        if isinstance(self.get(key), (atom, aggie)):
+            self._plan = None
+        OrderedDict.__delitem__(self, key, **kwargs)
+
+    def _leaves(self, leaves, parts):
+        '''
+        collect leaf atoms and (order, body) format pieces.  Return
+        False if something below us can't be flattened.
+        '''
+        for key, v_obj in self.iteritems():
+            if type(v_obj) is atom:
+                order, body = _split_fmt(v_obj.s_str)
+                if order == '@':
+                    return False
+                leaves.append(v_obj)
+                parts.append((order, body))
+            elif type(v_obj) is aggie:
+                if v_obj._leaves(leaves, parts) is False:
+                    return False
+            elif hasattr(v_obj, 'set'):
+                return False            # tlvs, special atoms, own set()
+        return True
+
+    def _compile(self):
+        self._plan = False
+        if not compile_aggies:
+            return False
+        leaves, parts = [], []
+        if self._leaves(leaves, parts) is False or not leaves:
+            return False
+        orders = set([o for o, b in parts if o])
+        if len(orders) > 1:
+            return False
+        fmt = (orders.pop() if orders else '<') + \
+              ''.join([b for o, b in parts])
+        try:
+            s_rec = struct.Struct(fmt)
+        except struct.error:
+            return False
+        if s_rec.size != sum([a.s_rec.size for a in leaves]):
+            return False
+        #
+        # an atom only keeps the first value its format unpacks to
+        # (see atom.set), so index each leaf by where its first value
+        # lands in the flattened tuple.
+        #
+        setters, idx = [], 0
+        for a in leaves:
+            setters.append((a, idx))
+            idx += len(a.s_rec.unpack('\0' * a.s_rec.size))
+        self._plan = (s_rec, setters)
+        return self._plan
+
     def __len__(self):
+        plan = self._plan
+        if plan is None:
+            plan = self._compile()
+        if plan:
+            return plan[0].size
         l = 0
         for key, v_obj in self.iteritems():
             if isinstance(v_obj, atom) or isinstance(v_obj, aggie):
@@ -111,6 +221,15 @@ class aggie(OrderedDict):
         return s
 
     def set(self, buf):
+        plan = self._plan
+        if plan is None:
+            plan = self._compile()
+        if plan:
+            s_rec, setters = plan
+            vals = s_rec.unpack_from(buf)
+            for a, i in setters:
+                a.val = vals[i]
+            return s_rec.size
         consumed = 0
         for key, v_obj in self.iteritems():
             consumed += v_obj.set(buf[consumed:])
@@ -146,8 +265,7 @@ class tlv_aggie(aggie):
         # tlv_type and tlv_len.  Using tlv_len, we can suck the appropriate
         # number of bytes as tlv_value.
         #
-        tlv_type  = ord(buf[0])
-        tlv_len   = ord(buf[1])
+        tlv_type, tlv_len = bytearray(buf[0:2])  # str or bytearray
         tlv_value = buf[2: tlv_len]
         self['tlv_type'].val  = tlv_type
         self['tlv_len'].val   = tlv_len
@@ -199,12 +317,13 @@ class tlv_block_aggie(aggie):
         consumed = super(tlv_block_aggie, self).set(buf)
         tlv_consumed = 0
         while True:
-            if consumed >= len(buf) or buf[consumed] == '\0':
-                break;
             # first, peek, 1st byte tlv_type, 2nd tlv_len
             # we need tlv_len to properly build the tlv_aggie.
-            tlv_type = ord(buf[consumed])
-            tlv_len  = ord(buf[consumed + 1])
+            # buf can be a str or a bytearray, peek the same for both.
+            peek = bytearray(buf[consumed:consumed + 2])
+            if len(peek) < 2 or peek[0] == 0:
+                break;
+            tlv_type, tlv_len = peek
             tlv = tlv_aggie(aggie(OrderedDict([
                 ('tlv_type',  atom(('<B', '{}'))),
                 ('tlv_len',   atom(('<B', '{}'))),
@@ -38,6 +38,7 @@ from   core_events  import radio_major_name
 from   core_events  import radio_minor_name
 from   core_headers import rtc_src_name
 from   core_headers import img_mgr_event_name
+from   core_headers import obj_dt_index_entry
 
 from   gps_mon      import *
 
@@ -248,7 +249,7 @@ ver2b0= '                [https://github.com/tp-freeforall/prod]'
 ver2c = '    repo1:  (m) heads/recsum-0-g04de0f8-dirty'
 ver2c0= '                [https://github.com/cire831/mm]'
 ver2d = '    date:   Fri Dec 29 04:05:07 UTC 2017      ib/len: 0x{:x}/{:d} (0x{:x})'
-ver2e = '    ii_sig: 0x{:08x}  chksum: 0x{:08x}'
+ver2e = '    ii_sig: 0x{:08x}  chksum: 0x{:08x}  crc32: 0x{:08x}'
 
 def emit_version(level, offset, buf, obj):
     xlen     = obj['hdr']['len'].val
@@ -298,7 +299,8 @@ def emit_version(level, offset, buf, obj):
                        ii['basic']['im_len'].val,
                        ii['basic']['im_len'].val))
         print(ver2e.format(ii['basic']['ii_sig'].val,
-                           ii['basic']['im_chk'].val))
+                           ii['basic']['im_chk'].val,
+                           ii['basic']['im_crc32'].val))
 
 
 ################################################################
@@ -332,6 +334,45 @@ def emit_sync(level, offset, buf, obj):
         print(sync1b.format())
 
 
+################################################################
+#
+# INDEX emitter
+# uses decode_default with dt_index_obj to decode, entries follow
+#
+
+index0  = '  prev: @{:d} (0x{:x})  entries: {}'
+
+index1a = '    INDEX: majik:  0x{:x}   prev: {} (0x{:x})'
+index1b = '      sync @{:<10d} rec: {:<8d} {}'
+
+dt_index_entry = obj_dt_index_entry()
+
+def emit_index(level, offset, buf, obj):
+    xlen     = obj['hdr']['len'].val
+    xtype    = obj['hdr']['type'].val
+    recnum   = obj['hdr']['recnum'].val
+    rtctime  = obj['hdr']['rt']
+    brt      = secsFromHour_str(rtctime)
+
+    majik    = obj['majik'].val
+    prev     = obj['prev_index'].val
+    nentries = obj['nentries'].val
+
+    print_hourly(rtctime)
+    print(rec0.format(offset, recnum, brt, xlen, xtype,
+                      dt_name(xtype)), end = '')
+    print(index0.format(prev, prev, nentries))
+
+    if (level >= 1):
+        print(index1a.format(majik, prev, prev))
+        e = dt_index_entry
+        consumed = len(obj)
+        for i in range(nentries):
+            consumed += e.set(buf[consumed:])
+            print(index1b.format(e['offset'].val, e['recnum'].val,
+                                 rtctime_full(e['rt'])))
+
+
 ################################################################
 #
 # EVENT emitter
@@ -446,6 +487,21 @@ def emit_event(level, offset, buf, obj):
                         cur_s, new_s, delta1000/1000., skew))
         return
 
+    if event == SSW_BLK_TIME:
+        # group program busy, per blk.  arg1: count << 16 | timer polls
+        count = (arg1 >> 16) & 0xffff
+        polls = arg1 & 0xffff
+        avg   = arg3 / count if count else 0
+        print(' {:14s} {}/{}  busy avg: {} max: {} us  polls: {}'.format(
+            event_name(event), arg0, count, avg, arg2, polls))
+        return
+
+    if event == SSW_LANE_TIME:
+        # worst wait (collect to SD) in the group, then worst ever.  ms.
+        print(' {:14s} crit: {}  bulk: {}  max crit: {}  bulk: {} ms'.format(
+            event_name(event), arg0, arg1, arg2, arg3))
+        return
+
     if event == SD_ON:
         print(' {:14s} ({})                  max: {:7}'.format(event_name(event),
                        arg0, arg3))
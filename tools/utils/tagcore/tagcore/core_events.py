@@ -32,6 +32,7 @@ __all__ = [
     'EV_GPS_TIME',
     'GPS_CYCLE_LTFF',
     'GPS_FIRST_FIX',
+    'SSW_BLK_TIME',
     'DCO_REPORT',
     'DCO_SYNC',
     'TIME_SRC',
@@ -42,6 +43,7 @@ __all__ = [
     'SD_REQ',
     'SD_REL',
     'RADIO_MODE',
+    'SSW_LANE_TIME',
     'GPS_CYCLE_START',
     'GPS_CYCLE_END',
     'GPS_DELTA',
@@ -111,6 +113,7 @@ event_names = {
     22: 'SD_REQ',
     23: 'SD_REL',
     24: 'RADIO_MODE',
+    25: 'SSW_LANE_TIME',
 
     29: 'GPS_CYCLE_START',
     30: 'GPS_CYCLE_END',
@@ -162,6 +165,7 @@ EV_GPS_XYZ    = 4
 EV_GPS_TIME   = 5
 GPS_CYCLE_LTFF= 6
 GPS_FIRST_FIX = 7
+SSW_BLK_TIME  = 9
 DCO_REPORT    = 15
 DCO_SYNC      = 16
 TIME_SRC      = 17
@@ -172,6 +176,7 @@ SD_OFF        = 21
 SD_REQ        = 22
 SD_REL        = 23
 RADIO_MODE    = 24
+SSW_LANE_TIME = 25
 GPS_CYCLE_START = 29
 GPS_CYCLE_END = 30
 GPS_DELTA     = 31
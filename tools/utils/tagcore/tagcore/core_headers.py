@@ -271,7 +271,8 @@ def obj_image_basic():
         ('im_chk',    atom(('<I', '0x{:08x}'))),
         ('hw_ver',    obj_hw_version()),
         ('im_plus_len', atom(('<H', '{}'))),
-        ('reserved',  atom(('8s', '{}'))),
+        ('im_crc32',  atom(('<I', '0x{:08x}'))),
+        ('reserved',  atom(('4s', '{}'))),
     ]))
 
 
@@ -325,6 +326,26 @@ def obj_dt_sync():
     ]))
 
 
+# followed by nentries obj_dt_index_entry
+def obj_dt_index():
+    return aggie(OrderedDict([
+        ('hdr',        obj_dt_hdr()),
+        ('prev_index', atom(('<I', '0x{:x}'))),
+        ('majik',      atom(('<I', '0x{:08x}'))),
+        ('nentries',   atom(('<H', '{}'))),
+        ('pad',        atom(('<H', '{}'))),
+    ]))
+
+
+def obj_dt_index_entry():
+    return aggie(OrderedDict([
+        ('offset',    atom(('<I', '0x{:x}'))),
+        ('recnum',    atom(('<I', '{}'))),
+        ('rt',        obj_rtctime()),
+        ('pad',       atom(('<H', '{}'))),
+    ]))
+
+
 img_mgr_events = {
     0: 'none',
     1: 'alloc',
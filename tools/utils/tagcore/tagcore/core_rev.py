@@ -28,7 +28,7 @@ the basic ability to decode.   ie.  adding new events.
 '''
 
 CORE_REV   = 22
-CORE_MINOR = 8
+CORE_MINOR = 10
 
 from    .__init__       import __version__   as core_ver
 from    .base_objs      import __version__   as base_ver
@@ -0,0 +1,127 @@
+# Copyright (c) 2019 Eric B. Decker
+# All rights reserved.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+# See COPYING in the top level directory of this source tree.
+#
+# Contact: Eric B. Decker <cire831@gmail.com>
+
+'''
+decode_bench: records/sec per record type, compiled vs. field walk.
+
+    python -m tagcore.decode_bench [-p passes] [-n max] <dblk file>
+
+Pulls up to max good records of each type out of the file (dt_hdr,
+length and checksum must check out, anything else we step a quad and
+look again) and then runs each type's decoder over them, first with
+base_objs.compile_aggies off (old per field set) and then on.  Best of
+passes is reported.
+'''
+
+from   __future__   import print_function
+
+import sys
+import time
+import argparse
+
+import tagcore.base_objs      as     bo
+import tagcore.dt_defs        as     dtd
+import tagcore.core_populate                    # fills in dt_records
+from   tagcore.core_headers   import obj_dt_hdr
+
+RLEN_MAX_SIZE = 1024
+
+
+def unplan(obj):
+    '''throw away any compiled plans, obj and everything below it'''
+    if isinstance(obj, bo.aggie):
+        obj._plan = None
+        for v_obj in obj.itervalues():
+            unplan(v_obj)
+
+
+def collect(buf, max_recs):
+    hdr     = obj_dt_hdr()
+    hdr_len = len(hdr)
+    recs    = {}
+    offset  = 0
+    while offset + hdr_len <= len(buf):
+        hdr.set(buf[offset:offset + hdr_len])
+        rlen   = hdr['len'].val
+        rtype  = hdr['type'].val
+        recsum = hdr['recsum'].val
+        v = dtd.dt_records.get(rtype)
+        if rlen < hdr_len or rlen > RLEN_MAX_SIZE or \
+           offset + rlen > len(buf) or hdr['recnum'].val == 0 or \
+           v is None or v[dtd.DTR_DECODER] is None or \
+           v[dtd.DTR_OBJ] is None:
+            offset += 4
+            continue
+        rec = buf[offset:offset + rlen]
+        chksum  = sum(rec) - (recsum >> 8) - (recsum & 0xff)
+        if (chksum & 0xffff) != recsum:
+            offset += 4
+            continue
+        l = recs.setdefault(rtype, [])
+        if len(l) < max_recs:
+            l.append((offset, rec))
+        offset = (offset + rlen + 3) & ~3
+    return recs
+
+
+def run(rtype, recs, passes):
+    v       = dtd.dt_records[rtype]
+    decoder = v[dtd.DTR_DECODER]
+    obj     = v[dtd.DTR_OBJ]
+    best    = None
+    unplan(obj)
+    for p in range(passes):
+        t0 = time.time()
+        for offset, rec in recs:
+            decoder(0, offset, rec, obj)
+        t = time.time() - t0
+        if best is None or t < best:
+            best = t
+    return len(recs) / best if best else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='decode records/sec per rtype, compiled vs field walk')
+    parser.add_argument('input', type = argparse.FileType('rb'))
+    parser.add_argument('-p', '--passes', type = int, default = 3)
+    parser.add_argument('-n', '--max', type = int, default = 20000,
+                        help = 'max records of each type')
+    args = parser.parse_args()
+
+    recs = collect(bytearray(args.input.read()), args.max)
+    if not recs:
+        print('*** no records found')
+        return 1
+
+    print('{:>5s}  {:16s} {:>7s} {:>10s} {:>10s} {:>6s}'.format(
+        'rtype', 'name', 'recs', 'walk r/s', 'comp r/s', 'x'))
+    for rtype in sorted(recs):
+        bo.compile_aggies = False
+        old = run(rtype, recs[rtype], args.passes)
+        bo.compile_aggies = True
+        new = run(rtype, recs[rtype], args.passes)
+        print('{:5d}  {:16s} {:7d} {:10.0f} {:10.0f} {:6.2f}'.format(
+            rtype, dtd.dt_name(rtype), len(recs[rtype]), old, new,
+            new / old if old else 0))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -34,6 +34,7 @@ Includes the following:
 
       rec0              initial record print format
       secsFromHour_str  convert rtctime into number of secs since hour
+      hourly_str        the hourly banner
       print_hourly      hourly banner if boundary crossed
       dt_name           convert a dt code to its printable name
       dump_hdr          simple hdr display (from raw buffer)
@@ -47,6 +48,11 @@ __version__ = '0.4.7'
 
 cfg_print_hourly = True
 
+# parallel tagdump, workers don't know the last hour seen.  When set,
+# print_hourly hands the record's rtctime here instead and the banner is
+# sorted out when the pieces are put back together.
+hourly_hook      = None
+
 # __all__ exports commonly used definitions.  It gets used
 # when someone does a wild import of this module.
 
@@ -84,6 +90,7 @@ __all__ = [
     'DT_GPS_PROTO_STATS',
     'DT_GPS_TRK',
     'DT_GPS_CLK',
+    'DT_INDEX',
 
     'DT_SNS_NONE',
     'DT_SNS_BATT',
@@ -107,6 +114,10 @@ __all__ = [
     'dt_records',
     'dt_count',
     'dt_sync_majik',
+    'dt_index_majik',
+    'DT_INDEX_SECTORS',
+    'DT_INDEX_SPAN',
+    'DT_INDEX_SCAN_SECTORS',
 ]
 
 
@@ -149,6 +160,12 @@ DTR_OBJ_NAME = 5                        # object name
 
 dt_sync_majik = 0xdedf00ef
 
+# INDEX records, see typed_data.h.  One near the front of each span.
+dt_index_majik          = 0xdedf1dcc
+DT_INDEX_SECTORS        = 64
+DT_INDEX_SPAN           = DT_INDEX_SECTORS * 512
+DT_INDEX_SCAN_SECTORS   = 2
+
 DT_NONE                 = 0
 DT_REBOOT               = 1
 DT_VERSION              = 2
@@ -173,6 +190,7 @@ DT_CONFIG		= 24
 DT_GPS_PROTO_STATS      = 25
 DT_GPS_TRK              = 26
 DT_GPS_CLK              = 27
+DT_INDEX                = 28
 
 DT_SNS_NONE             = 32
 DT_SNS_BATT             = 33
@@ -237,6 +255,13 @@ def set_last(rt):
     last_rt['year'] = rt['year'].val
 
 
+def hourly_str(rt):
+    '''the hourly banner for rt'''
+    return '---                      ' \
+        '0.{:06d} {}/{}/{} {}:00 ({}) UTC'.format(
+            0, rt['year'], rt['mon'], rt['day'], rt['hr'], rt['dow'])
+
+
 def print_hourly(rtctime):
     '''print an hourly banner if a hour boundary has been crossed.
 
@@ -247,6 +272,9 @@ def print_hourly(rtctime):
     '''
 
     if not cfg_print_hourly: return
+    if hourly_hook:
+        hourly_hook(rtctime)
+        return
     rt      = rtctime
     lrt     = last_rt
     pstamp  = False
@@ -256,9 +284,7 @@ def print_hourly(rtctime):
     if rt['year'].val != lrt['year']: pstamp = True
     set_last(rt)
     if pstamp:
-        print('---                      '
-              '0.{:06d} {}/{}/{} {}:00 ({}) UTC'.format(
-            0, rt['year'], rt['mon'], rt['day'], rt['hr'], rt['dow']))
+        print(hourly_str(rt))
 
 
 def dt_name(rtype):
@@ -34,6 +34,8 @@ Includes:
                  numeric level for how much to display
     - mr_emitters: False, nope
                    True, use machine readable emitters
+    - export_batch: points per influxdb write
+    - export_flush: secs a point waits before a partial batch is written
 '''
 
 verbose   = 0
@@ -43,3 +45,5 @@ quiet     = 0
 pretty    = 0
 gps_level = None
 mr_emitters = False
+export_batch = 5000
+export_flush = 1.0
@@ -75,6 +75,7 @@ class ImageInfo:
         ver_id = self.im_basic['ver_id']
         hw_ver = self.im_basic['hw_ver']
         chksum = self.im_basic['im_chk'].val
+        crc32  = self.im_basic['im_crc32'].val
         xtype = 'Golden' if load_addr == 0 else 'NIB' if load_addr == 0x20000 else 'UNK'
         out  = 'load\t: {:06d} (0x{:06x})     len    : {:06d} (0x{:06x})\t{}\n'.format(
             load_addr, load_addr, load_len, load_len, xtype)
@@ -83,7 +84,8 @@ class ImageInfo:
                                              ver_id['build'])
         out += '        hw_m/r : {}/{}\n'.format(
             hw_ver['model'], hw_ver['rev'])
-        out += 'chksum\t: 0x{:08x}\n'.format(chksum)
+        out += 'chksum\t: 0x{:08x}         crc32  : 0x{:08x}\n'.format(
+            chksum, crc32)
         for k,tlv in self.im_plus.get_tlv_rows():
             tlv_type = self._iipGetKeyByValue(k)
             out += '{}\t: {}\n'.format(tlv_type, tlv['tlv_value'])
@@ -103,6 +105,9 @@ class ImageInfo:
     def setChecksum(self, val):
         self.im_basic['im_chk'].val = val
 
+    def setCRC32(self, val):
+        self.im_basic['im_crc32'].val = val
+
     def _iipGetKeyByValue(self, val):
         for k, v in iip_tlv.items():
             if v == val:
@@ -0,0 +1,175 @@
+# Copyright (c) 2019 Eric B. Decker
+# All rights reserved.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+# See COPYING in the top level directory of this source tree.
+#
+# Contact: Eric B. Decker <cire831@gmail.com>
+
+'''
+influx_stub: stand in influxdb (1.x) for working on the export offline.
+
+    python -m tagcore.influx_stub [-p port] [-d ms]
+    python -m tagcore.influx_stub --bench N [-d ms] [-b batch]
+
+Answers /ping (X-Influxdb-Version 1.7.0) and /query (SHOW DATABASES says
+the db exists) well enough for json_emitters to connect, and takes
+/write bodies, counting lines and bytes.  -d adds a delay to every write
+to look like a far away database.  ^C prints what it saw.
+
+--bench N runs the stub on a private port and pushes N synthetic points
+through json_emitters.InfluxWriter twice, one point per write (what the
+old write_points per record did) and then batched, and reports
+points/sec for each.
+'''
+
+from   __future__   import print_function
+
+import sys
+import time
+import json
+import threading
+import argparse
+from   BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+from   SocketServer   import ThreadingMixIn
+
+import tagcore.globals        as     g
+
+STUB_VERSION = '1.7.0'
+
+
+class StubHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'       # keep-alive, like the real thing
+    wbufsize         = -1               # reply in one send, no nagle stall
+
+    def log_message(self, *args):
+        pass
+
+    def reply(self, code, body = ''):
+        self.send_response(code)
+        self.send_header('X-Influxdb-Version', STUB_VERSION)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        if self.path.startswith('/ping'):
+            self.reply(204)
+        elif self.path.startswith('/query'):
+            self.reply(200, json.dumps({ 'results': [{ 'statement_id': 0,
+                'series': [{ 'name': 'databases', 'columns': [ 'name' ],
+                             'values': [[ self.server.dbname ]]}]}]}))
+        else:
+            self.reply(404)
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+        if self.path.startswith('/query'):
+            self.reply(200, json.dumps({ 'results': [{ 'statement_id': 0 }]}))
+            return
+        if not self.path.startswith('/write'):
+            self.reply(404)
+            return
+        if self.server.delay:
+            time.sleep(self.server.delay)
+        with self.server.lock:
+            self.server.writes += 1
+            self.server.lines  += body.count('\n') + 1 if body else 0
+            self.server.nbytes += len(body)
+        self.reply(204)
+
+
+class StubServer(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+    def __init__(self, port, delay = 0, dbname = 'test'):
+        HTTPServer.__init__(self, ('localhost', port), StubHandler)
+        self.delay  = delay
+        self.dbname = dbname
+        self.lock   = threading.Lock()
+        self.writes = self.lines = self.nbytes = 0
+
+    def stats(self):
+        return '{} writes, {} lines, {} bytes'.format(
+            self.writes, self.lines, self.nbytes)
+
+
+def bench_point(n):
+    return { 'measurement': 'GPS_GEO',
+             'time':   '2018-09-12T22:{:02d}:{:02d}.{:06d}'.format(
+                           (n / 60) % 60, n % 60, (n * 30517) % 1000000),
+             'tags':   { 'app': 'tagdump' },
+             'fields': { 'hdr_recnum': n, 'hdr_len': 69, 'hdr_type': 18,
+                         'lat': 344308392 + n, 'lon': -1199234921 - n,
+                         'alt_ell': 3157, 'nsats': 9,
+                         'nav_type': '0x{:04x}'.format(n & 0xffff) }}
+
+
+def bench(count, delay, batch):
+    import tagcore.json_emitters as je
+
+    server = StubServer(0, delay)
+    port   = server.server_address[1]
+    t = threading.Thread(target = server.serve_forever)
+    t.daemon = True
+    t.start()
+
+    points = [ bench_point(n) for n in range(count) ]
+    for name, size in (('per record', 1), ('batched', batch)):
+        w  = je.InfluxWriter('localhost', port, 'test',
+                             batch_size = size, flush_interval = 1.0)
+        t0 = time.time()
+        w.start()
+        for p in points:
+            w.put([ p ])
+        st = w.close()
+        secs = time.time() - t0
+        print('{:12s} batch {:5d}: {:7d} points {:8.2f}s {:10.0f} points/s'
+              '  ({} dropped)'.format(name, size, st['points'], secs,
+                                      st['points'] / secs, st['dropped']))
+    print('stub: ' + server.stats())
+    server.shutdown()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='stand in influxdb for offline export work')
+    parser.add_argument('-p', '--port', type = int, default = 8086)
+    parser.add_argument('-d', '--delay', type = float, default = 0,
+                        help = 'ms added to each write')
+    parser.add_argument('-b', '--batch', type = int,
+                        default = g.export_batch,
+                        help = '--bench batch size')
+    parser.add_argument('--bench', type = int, metavar = 'N',
+                        help = 'push N points through InfluxWriter')
+    args = parser.parse_args()
+
+    if args.bench:
+        g.export = -1                   # json_emitters, don't go looking
+        bench(args.bench, args.delay / 1000., args.batch)
+        return 0
+
+    server = StubServer(args.port, args.delay / 1000.)
+    print('influx_stub: localhost:{}'.format(args.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print()
+        print('influx_stub: ' + server.stats())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
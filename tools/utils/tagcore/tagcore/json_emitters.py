@@ -21,11 +21,20 @@
 
 from   __future__         import print_function
 
-__version__ = '0.4.6'
+__version__ = '0.4.7'
 
 TEST = False
 
 import sys
+import time
+import atexit
+import socket
+import urllib
+import httplib
+import calendar
+import threading
+import Queue
+from datetime import datetime
 from time     import sleep
 from binascii import hexlify
 from requests.exceptions import ConnectionError
@@ -37,13 +46,18 @@ from base_objs   import atom
 from dt_defs     import dt_records
 from dt_defs     import secsFromHour_str
 from misc_utils  import rtctime_iso
+from misc_utils  import eprint
 from core_events import event_name
 
 import tagcore.globals
 
-__all__ = [ 'emit_influx' ]
+__all__ = [ 'emit_influx', 'influx_flush', 'influx_close' ]
 versions_ok = [ '1.5.2', '1.7.0' ]
 
+# parallel tagdump, workers hold their points here (influx_sink = [])
+# and hand them back, influx_flush writes them out in record order.
+influx_sink = None
+
 
 host     = 'localhost'
 port     = 8086
@@ -51,6 +65,16 @@ user     = 'root'
 password = 'root'
 dbname   = 'test'
 
+# export writer.  points are batched up and written as line protocol by
+# a background thread (InfluxWriter).  batch_size and flush_interval
+# come from tagcore.globals (tagdump --xbatch/--xflush).  queue_max
+# bounds how far decode can get ahead of the database, when full emit
+# blocks.
+queue_max      = 20000              # points
+retries        = 5                  # per batch, then it gets dropped
+backoff_start  = .25                # secs, doubles each retry
+backoff_max    = 8
+
 
 def influx_print():
     if tagcore.globals.verbose > 0 or tagcore.globals.export:
@@ -228,6 +252,229 @@ def emit_influx(level, offset, buf, obj):
                                 flatten_dict(obj, ''),
                                 build_tags(obj))
         # zzz print('### influx JSON:', json_rec)
-        influx_db.write_points(json_rec)
+        if influx_sink is not None:
+            influx_sink.extend(json_rec)
+            return
+        influx_writer().put(json_rec)
     else:
         print('### emit_influx error level: {}, offset: {}, buf: {}'.format(hexlify(buf)))
+
+
+def influx_flush(points):
+    '''write points a worker held onto (influx_sink)'''
+    if influxdb_version == '' or not points:
+        return
+    influx_writer().put(points)
+
+
+def influx_writer():
+    '''the export writer, started on first use'''
+    global _writer
+    if _writer is None:
+        _writer = InfluxWriter(host, port, dbname, user, password,
+                               tagcore.globals.export_batch,
+                               tagcore.globals.export_flush)
+        _writer.start()
+    return _writer
+
+_writer = None
+
+
+def influx_close():
+    '''
+    drain the export queue, wait for the writer and print what it did.
+    Safe to call more than once, also run at exit.
+    '''
+    global _writer
+    w, _writer = _writer, None
+    if w is None:
+        return None
+    st = w.close()
+    eprint('### influx export: {} points, {} batches, {} bytes, {:.2f}s writing, '
+           '{} retries, {} dropped'.format(st['points'], st['batches'],
+                st['bytes'], st['secs'], st['retries'], st['dropped']))
+    return st
+
+atexit.register(influx_close)
+
+
+#
+# line protocol
+#
+# measurement,tag=v,... field=v,... ns_timestamp
+#
+# same encoding influxdb-python's make_lines uses: tags and fields
+# sorted, ints get an 'i', strings quoted.  Points keep the JSON shape
+# (influx_record) so parallel workers can hand them back as is, the
+# conversion happens on the writer thread.
+#
+
+def _lp_key(k):
+    return str(k).replace(',', '\\,').replace('=', '\\=').replace(' ', '\\ ')
+
+
+def _lp_field(v):
+    if isinstance(v, bool):
+        return 'true' if v else 'false'
+    if isinstance(v, (int, long)):
+        return '{}i'.format(v)
+    if isinstance(v, float):
+        return repr(v)
+    return '"' + str(v).replace('\\', '\\\\').replace('"', '\\"') \
+                      .replace('\n', '\\n') + '"'
+
+
+_secs_cache = {}
+
+def _iso_ns(t):
+    '''rtctime_iso string (UTC, no zone) to ns since the epoch'''
+    secs = _secs_cache.get(t[:19])
+    if secs is None:
+        if len(_secs_cache) > 4096:
+            _secs_cache.clear()
+        secs = calendar.timegm(
+            datetime.strptime(t[:19], '%Y-%m-%dT%H:%M:%S').timetuple())
+        _secs_cache[t[:19]] = secs
+    usecs = int(t[20:26].ljust(6, '0')) if len(t) > 20 else 0
+    return (secs * 1000000 + usecs) * 1000
+
+
+def influx_line(point):
+    '''one influx_record point as a line protocol line, None if no fields'''
+    fields = ','.join([ _lp_key(k) + '=' + _lp_field(v)
+                        for k, v in sorted(point['fields'].items())
+                        if v is not None ])
+    if not fields:
+        return None
+    line = str(point['measurement']).replace(',', '\\,').replace(' ', '\\ ')
+    for k, v in sorted(point.get('tags', {}).items()):
+        line += ',' + _lp_key(k) + '=' + _lp_key(v)
+    return line + ' ' + fields + ' ' + str(_iso_ns(point['time']))
+
+
+class InfluxWriter(object):
+    '''
+    background batch writer for influxdb (1.x /write, line protocol).
+
+    put() queues points (bounded, blocks when full).  The writer thread
+    pulls them off, converts to line protocol and POSTs a batch when it
+    has batch_size points or the oldest has waited flush_interval secs.
+    One keep-alive connection.  Connection errors, 5xx and 429 are
+    retried with back-off (backoff_start doubling to backoff_max) up to
+    retries times, then the batch is dropped and counted.  Other 4xx
+    are the data's fault, dropped straight away.
+
+    close() flushes what's left, stops the thread and returns the stats.
+    '''
+
+    _STOP = object()
+
+    def __init__(self, host, port, db, user = None, password = None,
+                 batch_size = 5000, flush_interval = 1.0):
+        params = { 'db': db }
+        if user:
+            params['u'] = user
+            params['p'] = password or ''
+        self.host      = host
+        self.port      = port
+        self.url       = '/write?' + urllib.urlencode(params)
+        self.batch_size= max(int(batch_size), 1)
+        self.interval  = flush_interval
+        self.q         = Queue.Queue(queue_max)
+        self.conn      = None
+        self.thread    = None
+        self.stats     = { 'points': 0, 'batches': 0, 'bytes': 0,
+                           'secs': 0.0, 'retries': 0, 'dropped': 0 }
+
+    def start(self):
+        self.thread = threading.Thread(target = self.run,
+                                       name = 'influx_writer')
+        self.thread.daemon = True
+        self.thread.start()
+
+    def put(self, points):
+        for p in points:
+            self.q.put(p)
+
+    def close(self):
+        if self.thread:
+            self.q.put(self._STOP)
+            self.thread.join()
+            self.thread = None
+        return self.stats
+
+    def run(self):
+        batch    = []
+        deadline = 0
+        while True:
+            try:
+                if batch:
+                    p = self.q.get(True, max(deadline - time.time(), .001))
+                else:
+                    p = self.q.get()
+            except Queue.Empty:
+                self.write(batch)       # flush_interval ran out
+                batch = []
+                continue
+            if p is self._STOP:
+                self.write(batch)
+                if self.conn:
+                    self.conn.close()
+                return
+            if not batch:
+                deadline = time.time() + self.interval
+            batch.append(p)
+            if len(batch) >= self.batch_size:
+                self.write(batch)
+                batch = []
+
+    def write(self, batch):
+        if not batch:
+            return
+        lines = []
+        for p in batch:
+            try:
+                l = influx_line(p)
+            except (KeyError, ValueError, TypeError):
+                l = None
+            if l is None:
+                self.stats['dropped'] += 1
+            else:
+                lines.append(l)
+        if not lines:
+            return
+        body  = '\n'.join(lines)
+        wait  = backoff_start
+        t0    = time.time()
+        for attempt in range(retries + 1):
+            if attempt:
+                self.stats['retries'] += 1
+                sleep(wait)
+                wait = min(wait * 2, backoff_max)
+            try:
+                if self.conn is None:
+                    self.conn = httplib.HTTPConnection(self.host, self.port,
+                                                       timeout = 30)
+                self.conn.request('POST', self.url, body,
+                    { 'Content-Type': 'application/octet-stream' })
+                rsp = self.conn.getresponse()
+                msg = rsp.read()
+            except (socket.error, httplib.HTTPException) as e:
+                if self.conn:
+                    self.conn.close()
+                self.conn = None
+                why = str(e)
+                continue
+            if rsp.status // 100 == 2:
+                self.stats['points']  += len(lines)
+                self.stats['batches'] += 1
+                self.stats['bytes']   += len(body)
+                self.stats['secs']    += time.time() - t0
+                return
+            why = '{} {}'.format(rsp.status, msg.strip())
+            if rsp.status // 100 == 4 and rsp.status != 429:
+                break                   # won't get any better
+        self.stats['dropped'] += len(lines)
+        self.stats['secs']    += time.time() - t0
+        eprint('### influx export: batch of {} dropped: {}'.format(
+            len(lines), why))
@@ -35,6 +35,7 @@ dtd.dt_records[DT_CONFIG]           = (  0, decode_default, [ emit_default_mr ],
 dtd.dt_records[DT_GPS_PROTO_STATS]  = (  0, decode_default, [ emit_gps_proto_mr ],     obj_dt_gps_proto_stats(), 'GPS_STATS',    'obj_dt_gps_proto_stats' )
 dtd.dt_records[DT_GPS_TRK]          = (  0, decode_gps_trk, [ emit_gps_trk_mr ],       obj_dt_gps_trk(),         'GPS_TRK',      'obj_dt_trk' )
 dtd.dt_records[DT_GPS_CLK]          = (  0, decode_default, [ emit_default_mr ],       obj_dt_gps_clk(),         'GPS_CLK',      'obj_dt_clk' )
+dtd.dt_records[DT_INDEX]            = (  0, decode_default, [ emit_default_mr ],       obj_dt_index(),           'INDEX',        'obj_dt_index'    )
 
 dtd.dt_records[DT_SNS_TMP_PX]       = (  0, decode_sensor,  [ emit_sensor_data_mr ],   obj_dt_sns_data(),        'SNS_TMP_PX',      'obj_dt_sns_data' )
 dtd.dt_records[DT_SNS_ACCEL_N8S]    = (  0, decode_sensor,  [ emit_sensor_data_mr ],   obj_dt_sns_data(),        'SNS_ACCEL_N8S',   'obj_dt_sns_data' )
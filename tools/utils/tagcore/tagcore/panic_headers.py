@@ -19,7 +19,7 @@
 
 '''Panic headers'''
 
-__version__ = '0.4.6'
+__version__ = '0.4.7'
 
 import binascii
 from   collections  import OrderedDict
@@ -56,6 +56,13 @@ PANIC_INFO_SIG      = 0x44665041
 CRASH_INFO_SIG      = 0x4349B00B
 CRASH_CATCHER_SIG   = 0x63430300
 PANIC_ADDITIONS     = 0x44664144
+PANIC_ADDITIONS_RLE = 0x44664152
+
+# compressed ram section, see panic.h
+PRLE_LIT            = 0x4c000000
+PRLE_RUN            = 0x52000000
+PRLE_TYPE_MASK      = 0xff000000
+PRLE_CNT_MASK       = 0x00ffffff
 
 
 def obj_panic_dir():
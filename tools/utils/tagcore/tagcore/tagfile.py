@@ -25,18 +25,23 @@ from   __future__         import print_function
 
 __all__ = [
     'TagFile',
+    'StripeFile',
     'TF_SEEK_END',
 ]
 
 import os
 import sys
+import stat
+import mmap
 import types
 import time
 import errno
 import struct
 
-from   .dt_defs    import *
-from   .misc_utils import eprint
+from   .dt_defs      import *
+from   .misc_utils   import eprint
+from   .misc_utils   import rtc2datetime
+from   .core_headers import obj_dt_index, obj_dt_index_entry
 
 # negative offset indicates file i/o error
 EODATA = -14
@@ -60,18 +65,110 @@ def int32(x):
 
 TF_SEEK_END = os.SEEK_END
 
-MAX_ZERO_SIGS           = 1024          # 1024 quads, 4K bytes of zero
+# 1st sector of the file is the directory, records start after
+DBLK_FIRST_OFFSET       = 0x200
+INDEX_MAJIK_OFFSET      = 24            # same place as a SYNC's majik
+SYNC_MAJIK_OFFSET       = 24
+
+# a SYNC is laid down at least every SYNC_MAX_SECTORS, look back twice that
+SYNC_WINDOW             = 2 * 8 * 512
+
+# resync scans this much of the stream per find pass
+RESYNC_WINDOW           = 64 * 1024
+
+SECTOR_SIZE             = 512
+
+# checkpoint in the directory sector, see tos include/dblk_dir.h
+DBLK_CKPT_OFFSET        = 64
+DBLK_CKPT_SIG           = 0x18961776
+DBLK_CKPT_QUADS         = 12
+
+
+class StripeFile(object):
+    '''two card dumps of a striped DBLK, read as one data stream
+
+    A striped DBLK (DBLK_SD_STRIPE, see tos/mm/dblk_sd.h) alternates its
+    data sectors between SD0 and SD1.  card0 and card1 are the DBLK files
+    from each card, both start with the directory.  Stream sector 0 is
+    the directory (card0), stream sector s > 0 lives on card (s-1) & 1
+    at sector 1 + ((s-1) >> 1).
+
+    Looks enough like a file (read, seek, tell, size, name) for TagFile.
+    The stream ends where one of the cards runs out.
+    '''
+
+    def __init__(self, card0, card1):
+        super(StripeFile, self).__init__()
+        self.cards = [ card0, card1 ]
+        self.name  = card0.name
+        self.pos   = 0
+
+    def size(self):
+        data = []
+        for f in self.cards:
+            f.seek(0, os.SEEK_END)
+            data.append(max(f.tell() // SECTOR_SIZE - 1, 0))
+        if data[0] > data[1]:
+            nsect = 2 * data[1] + 1
+        else:
+            nsect = 2 * data[0]
+        return (nsect + 1) * SECTOR_SIZE
+
+    def locate(self, pos):
+        '''stream position to (card, position on that card)'''
+        sect, off = divmod(pos, SECTOR_SIZE)
+        if sect == 0:
+            return 0, off
+        sect -= 1
+        return sect & 1, (1 + (sect >> 1)) * SECTOR_SIZE + off
+
+    def read(self, cnt = -1):
+        if cnt < 0:
+            cnt = max(self.size() - self.pos, 0)
+        buf = ''
+        while cnt > 0:
+            card, cpos = self.locate(self.pos)
+            n = min(cnt, SECTOR_SIZE - (self.pos % SECTOR_SIZE))
+            f = self.cards[card]
+            f.seek(cpos)
+            new = f.read(n)
+            buf      += new
+            self.pos += len(new)
+            cnt      -= len(new)
+            if len(new) < n:
+                break
+        return buf
+
+    def tell(self):
+        return self.pos
+
+    def seek(self, pos, how = os.SEEK_SET):
+        if how == os.SEEK_CUR:
+            pos += self.pos
+        elif how == os.SEEK_END:
+            pos += self.size()
+        self.pos = max(pos, 0)
+
+    def close(self):
+        for f in self.cards:
+            f.close()
 
 class TagFile(object):
     '''TagDump File Class
 
-    inputs:     input   FileType, input file stream
+    inputs:     input   FileType, input file stream, or a StripeFile
+                        putting two striped card dumps back together
                 net_io  true if doing network i/o
                 tail    true if hang at the tail of input, keep trying
                         waiting for more network i/o.  Forces net_io.
                 verbose vebosity level (see tagdump.py)
                 timeout timeout value (default 60 secs) for --tail/net_io
 
+    A regular local file (no net_io, no tail) is mmap'd.  read is then
+    a slice of the map, no system call and no building up the result a
+    piece at a time.  Anything that won't map (tagfuse, pipes, empty)
+    stays with the file.
+
     methods:    read    reads CNT bytes from the input stream.  If doing
                         network i/o (net_io true) and --tail is set will
                         repeated try for additional reads when at eof.
@@ -80,14 +177,48 @@ class TagFile(object):
 
                 seek    set stream position to position/whence.  Whence
                         determines the base that is used for using position.
+
+                resync  find the next SYNC record.
+
+                index_seek
+                        use the INDEX records to get to a record number
+                        or time quickly.
+
+                prev_sync
+                        go back some number of SYNCs from the last one
+                        using the prev_sync chain.
+
+                sync_after
+                        first good SYNC at or after an offset.  tagdump
+                        --parallel cuts the file up with it.
+
+                peek    bytes at an offset, for the SYNC and INDEX
+                        scans.
+
+                dir_tail
+                        where a circular DBLK's oldest data is, from the
+                        directory sector.
+
+                set_wrap
+                        circular DBLK, reads off the end of the file come
+                        around to the front.
+
+                data_start, data_end
+                        where the oldest data is and just past the newest.
+
+                stream_pos
+                        a file offset's place in the data stream, the
+                        tail is first when circular.
     '''
 
     def __init__(self, input, net_io = False, tail = False,
                  verbose = 0, timeout = 60):
         super( TagFile, self ).__init__()
 
-        if not isinstance(input, types.FileType):
+        if not isinstance(input, (types.FileType, StripeFile)):
             raise IOError('not expected file type {}'.format(input))
+        if net_io and isinstance(input, StripeFile):
+            raise IOError('striped input is local only, no --net/--tail')
 
         self.net_io = net_io
         self.tail   = tail
@@ -96,17 +227,40 @@ class TagFile(object):
         self.fd     = input
         self.name   = input.name
         self.rsname = os.path.dirname(os.path.realpath(os.path.expanduser(self.name))) + '/.resync'
+        self.wrap_at  = None            # circular, tail offset
+        self.wrapped  = False           # came around to the front
+        self.in_front = False           # reading the front since
+        self.mm       = None            # mmap of a regular file
+        self.pos      = 0               # stream position when mapped
+        self.resync_skipped = 0         # bytes resync has stepped over
 
         if (self.net_io):
             self.fd.close()
             self.fileno   = os.open(self.name, os.O_DIRECT | os.O_RDONLY)
+        elif not tail and isinstance(input, types.FileType):
+            try:
+                if stat.S_ISREG(os.fstat(input.fileno()).st_mode):
+                    self.mm  = mmap.mmap(input.fileno(), 0,
+                                         access = mmap.ACCESS_READ)
+                    self.pos = input.tell()
+            except (mmap.error, ValueError, EnvironmentError):
+                self.mm = None          # plain file reads it is
 
     def read(self, cnt):
         buf = ''
+        if self.wrap_at:
+            pos = self.tell()
+            if pos < self.wrap_at:
+                self.in_front = self.wrapped
+            elif self.in_front:
+                return ''               # all the way around, done
         while True:
             try:
                 if (self.net_io):
                     new = os.read(self.fileno, cnt - len(buf))
+                elif self.mm is not None:
+                    new = self.mm[self.pos:self.pos + cnt - len(buf)]
+                    self.pos += len(new)
                 else:
                     new = self.fd.read(cnt - len(buf))
 
@@ -123,6 +277,13 @@ class TagFile(object):
                 return buf
             except (OSError, IOError) as e:
                 if (e.errno == errno.ENODATA):
+                    if self.wrap_at and pos >= self.wrap_at:
+                        if self.verbose >= 2:
+                            eprint('*** circular: end of the DBLK, '
+                                   'around to the front')
+                        self.seek(DBLK_FIRST_OFFSET)
+                        self.wrapped = True
+                        continue
                     if (self.tail):
                         if self.verbose >= 5:
                             eprint('*** TF.read: buf len: ', len(buf))
@@ -138,18 +299,126 @@ class TagFile(object):
                 eprint('*** TF.read: unhandled exception', sys.exc_info()[0])
                 raise
 
+    def size(self):
+        '''current size of the input stream in bytes'''
+        if (self.net_io):
+            return os.fstat(self.fileno).st_size
+        if isinstance(self.fd, StripeFile):
+            return self.fd.size()
+        return os.fstat(self.fd.fileno()).st_size
+
+    def dir_tail(self):
+        '''file offset of the oldest data in a circular DBLK
+
+        The tail is in the checkpoint DblkManager mirrors into the
+        directory sector (dblk_ckpt_t.dblk_tail, see tos include/
+        dblk_dir.h).  None if the checkpoint is no good, the DBLK
+        isn't circular, or it hasn't eaten its first unit yet.
+        '''
+        pos = self.tell()
+        self.seek(DBLK_CKPT_OFFSET)
+        buf = self.read(DBLK_CKPT_QUADS * 4)
+        self.seek(pos)
+        if len(buf) != DBLK_CKPT_QUADS * 4:
+            return None
+        quads = struct.unpack('<{}I'.format(DBLK_CKPT_QUADS), buf)
+        if quads[0] != DBLK_CKPT_SIG or quads[-2] != DBLK_CKPT_SIG:
+            return None
+        if sum(quads) & 0xffffffff:
+            return None
+        low, tail = quads[1], quads[9]
+        if tail <= low + 1:
+            return None
+        return (tail - low) * SECTOR_SIZE
+
+    def set_wrap(self, tail):
+        '''circular DBLK, the stream starts at tail (file offset), runs
+        to the end of the file and comes around to DBLK_FIRST_OFFSET.
+        We only go around once.
+        '''
+        self.wrap_at  = tail if tail > DBLK_FIRST_OFFSET else None
+        self.wrapped  = False
+        self.in_front = False
+
+    def data_start(self):
+        '''where the first (oldest) record is'''
+        return self.wrap_at if self.wrap_at else DBLK_FIRST_OFFSET
+
+    def data_end(self):
+        '''file offset just past the newest data
+
+        Not circular, the end of the file.  Circular, the head is in
+        front of the tail with the erased gap (DBLK_ERASE_AHEAD units or
+        so, see tos include/dblk_dir.h) in between.  Step back from the
+        tail over erased sectors (all 0 or all 0xff) to the last sector
+        written.
+        '''
+        if not self.wrap_at:
+            return self.size()
+        end = self.wrap_at
+        while end > DBLK_FIRST_OFFSET:
+            start = max(end - RESYNC_WINDOW, DBLK_FIRST_OFFSET)
+            buf = self.peek(start, end - start)
+            n = min(len(buf.rstrip('\0')), len(buf.rstrip('\xff')))
+            if n:
+                return min(start + ((n + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1)),
+                           self.wrap_at)
+            end = start
+        return DBLK_FIRST_OFFSET
+
+    def stream_pos(self, offset):
+        '''where file offset is in the data stream, for ordering
+
+        Circular (set_wrap), the stream runs from the tail to the end of
+        the file and then from the front.  Otherwise it is the offset.
+        '''
+        if not self.wrap_at:
+            return offset
+        if offset >= self.wrap_at:
+            return offset - self.wrap_at
+        return offset - DBLK_FIRST_OFFSET + self.size() - self.wrap_at
+
+    def seek_data(self, offset):
+        '''seek to a record found by prev_sync or index_seek
+
+        Circular, something in front of the tail is already around, a
+        read from there stops at the tail.
+        '''
+        self.seek(offset)
+        if self.wrap_at:
+            self.wrapped  = offset < self.wrap_at
+            self.in_front = False
+
     def tell(self):
         if (self.net_io):
             return os.lseek(self.fileno, 0, os.SEEK_CUR)
+        elif self.mm is not None:
+            return self.pos
         else:
             return self.fd.tell()
 
     def seek(self, pos, how=os.SEEK_SET):
         if (self.net_io):
             return os.lseek(self.fileno, pos, how)
+        elif self.mm is not None:
+            if how == os.SEEK_CUR:
+                pos += self.pos
+            elif how == os.SEEK_END:
+                pos += len(self.mm)
+            if pos < 0:
+                raise IOError(errno.EINVAL, os.strerror(errno.EINVAL))
+            self.pos = pos
         else:
             return self.fd.seek(pos, how)
 
+    def peek(self, pos, cnt):
+        '''cnt bytes at pos.  Mapped, a slice of the map and the stream
+        stays put, otherwise the file is left after what was read.'''
+        if self.mm is not None:
+            return self.mm[pos:pos + cnt]
+        self.fd.seek(pos)
+        return self.fd.read(cnt)
+
     def resync(self, offset):
         '''resync the data stream to the next SYNC record
 
@@ -168,19 +437,27 @@ class TagFile(object):
         new file position or could be a sync error, which is indicated
         by the negative offset value.
 
-        Otherwise the search will be conducted on file by reading
-        the byte stream to look for a valid sync record. This is
-        done by advancing one quad-aligned word and inspecting the
-        byte stream for a valid SYNC record. There are three possible
-        SYNC record types that all share the same record format and
-        only differ in type. (SYNC, SYNC_FLUSH, SYNC_REBOOT). A valid
-        record has the correct type, length, majik value, and header
-        checksum.
+        Otherwise the byte stream is searched locally.  We pull
+        RESYNC_WINDOW bytes at a time and use find to hop between
+        candidate SYNC majiks (little endian, at SYNC_MAJIK_OFFSET in a
+        quad aligned record).  Only the hits get validated, see sync_at:
+        type (SYNC, SYNC_FLUSH, SYNC_REBOOT), length, majik, and the
+        record checksum.  And the candidate's prev_sync has to point back
+        before it, a SYNC claiming an earlier one at or after itself is
+        garbage that happens to look right.
+
+        A circular DBLK comes around to the front, same as read.  Once
+        around, "before" for a SYNC in front of the tail also covers
+        [tail, end of file), the first SYNC written after the wrap points
+        back there.
 
         Once we think we have a good SYNC, we leave the file position
         at the start of the SYNC.  And let other checks needed be
         performed by get_record.
 
+        Each resync reports how many bytes it stepped over, the running
+        total is in resync_skipped.
+
         We use the smallest negative numbers to indicate various tag
         errors. The offset is an unsigned 32bit number, meaning this
         overlaps with the last bytes of the file. But we assert
@@ -200,6 +477,7 @@ class TagFile(object):
         # if using network then have remote tag search for sync record
         #
         if self.net_io:
+            start = offset
             rsfileno = os.open(self.rsname, os.O_RDWR)
             if (self.verbose >= 3):
                 eprint('resync',self.rsname, offset, rsfileno)
@@ -213,6 +491,8 @@ class TagFile(object):
             if (self.verbose >= 3):
                 eprint('resync2',offset,i)
             if int32(offset) > 0 or int32(offset) < ELAST:
+                if offset > start:
+                    self.resync_skipped += offset - start
                 self.seek(offset)
                 return offset
             if int32(offset) == EODATA:
@@ -221,57 +501,357 @@ class TagFile(object):
 
         # else search file byte stream for sync record
         #
-        record = dt_records[DT_SYNC][DTR_OBJ]
-        zero_sigs = 0
-        while (True):
-            # read a sync record's worth of data and check field validity
-            try:
-                self.seek(offset)
-                buf = self.read(dt_records[DT_SYNC][DTR_REQ_LEN])
-                if len(buf) < dt_records[DT_SYNC][DTR_REQ_LEN]:
-                  if (self.verbose >= 4):
-                    eprint('*** resync: too few bytes read for resync record, '
-                          'wanted {}, got {}'.format(
-                            dt_records[DT_SYNC][DTR_REQ_LEN], len(buf)))
-                  return EODATA
-                record.set(buf)
-                # check majik, length, type and header sum
-                if ((record['majik'].val == dt_sync_majik) and
-                    (record['hdr']['len'].val == len(record)) and
-                    ((record['hdr']['type'].val == DT_SYNC) or
-                     (record['hdr']['type'].val == DT_SYNC_FLUSH) or
-                     (record['hdr']['type'].val == DT_SYNC_REBOOT))): # found valid sync record
-                    self.seek(offset) # backup file pointer to beginning of record
-                    return offset     # and return offset of record
-                if (record['majik'] == 0):
-                    zero_sigs += 1    # series of zeros means no data in file
-                    if (zero_sigs > MAX_ZERO_SIGS):
-                        eprint('*** resync: too many zeros ({} x 4), bailing, @{}'.format(
-                            MAX_ZERO_SIGS, offset))
-                        return EODATA      # file looks empty
-                    else:
-                        zero_sigs = 0
-                offset += 4         # advance to next quad-aligned word and repeat
-                if (self.verbose >= 3):
-                    rlen   = record['hdr']['len'].val
-                    rtype  = record['hdr']['type'].val
-                    recnum = record['hdr']['recnum'].val
-                    resync2 = '*** resync: failed record @{} (0x{:x}): ' + \
-                              'len: {}, type: {}, rec: {}'
-                    eprint(resync2.format(offset-4, offset-4, rlen, rtype, recnum))
-                    eprint('    moving to: @{0} (0x{0:x})'.format(offset, offset))
-            except struct.error:
-                resync1 = '*** resync: (struct error) [len: {0}] @{1} (0x{1:x})'
-                eprint(resync1.format(len(buf), offset, offset))
-                raise
-            except IOError:
-                eprint('*** resync: file io error @{}'.format(offset))
-                raise
-            except EOFError:
-                eprint('*** resync: end of file @{}'.format(offset))
-                raise
-            except:
-                eprint('*** resync: exception error: {} @{}'.format(
-                    sys.exc_info()[0], offset))
-                raise
+        rlen    = dt_records[DT_SYNC][DTR_REQ_LEN]
+        majik   = struct.pack('<I', dt_sync_majik)
+        pos     = offset                # window start
+        seg     = offset                # where this stretch of skipping began
+        skipped = 0
+        fsize   = self.size()
+        end     = fsize
+        if self.wrap_at and self.wrapped and pos < self.wrap_at:
+            end = self.wrap_at          # front of a circular, stops at the tail
+        try:
+            while True:
+                if pos + rlen > end:
+                    if self.wrap_at and not self.wrapped and pos >= self.wrap_at:
+                        if self.verbose >= 2:
+                            eprint('*** resync: end of the DBLK, around to the front')
+                        skipped += end - seg
+                        pos = seg = DBLK_FIRST_OFFSET
+                        end = self.wrap_at
+                        self.wrapped = True
+                        continue
+                    skipped += max(end - seg, 0)
+                    self.resync_skipped += skipped
+                    eprint('*** resync: no SYNC from @{0} (0x{0:x}) to the end, '
+                           'skipped {1} bytes'.format(offset, skipped))
+                    self.seek(end)
+                    return EODATA
+                buf = self.peek(pos, min(RESYNC_WINDOW + rlen, end - pos))
+                i = buf.find(majik, SYNC_MAJIK_OFFSET)
+                while i >= 0:
+                    cand = i - SYNC_MAJIK_OFFSET
+                    if cand >= RESYNC_WINDOW:
+                        break           # next window has it
+                    prev = self.sync_at(buf, cand)
+                    if prev is not None and (prev < pos + cand or
+                            (self.wrapped and pos + cand < self.wrap_at and
+                             self.wrap_at <= prev < fsize)):
+                        found = pos + cand
+                        skipped += found - seg
+                        self.resync_skipped += skipped
+                        eprint('*** resync: @{0} (0x{0:x}) -> @{1} (0x{1:x}), '
+                               'skipped {2} bytes'.format(offset, found, skipped))
+                        self.seek(found)    # leave the file at the SYNC
+                        return found
+                    if (self.verbose >= 3) and not (cand & 3):
+                        resync2 = '*** resync: failed candidate @{0} (0x{0:x}), ' + \
+                                  'prev_sync: {1}'
+                        eprint(resync2.format(pos + cand, prev))
+                    i = buf.find(majik, i + 1)
+                pos += RESYNC_WINDOW
+        except struct.error:
+            resync1 = '*** resync: (struct error) @{0} (0x{0:x})'
+            eprint(resync1.format(pos))
+            raise
+        except (OSError, IOError):
+            eprint('*** resync: file io error @{}'.format(pos))
+            raise
         return -1
+
+
+    def sync_at(self, buf, i):
+        '''return prev_sync if buf[i:] holds a valid SYNC, else None'''
+        rlen = dt_records[DT_SYNC][DTR_REQ_LEN]
+        if i < 0 or (i & 3) or i + rlen > len(buf):
+            return None
+        rec    = bytearray(buf[i:i + rlen])
+        record = dt_records[DT_SYNC][DTR_OBJ]
+        record.set(rec)
+        recsum = record['hdr']['recsum'].val
+        chksum = sum(rec) - ((recsum >> 8) & 0xff) - (recsum & 0xff)
+        if ((record['majik'].val == dt_sync_majik) and
+            (record['hdr']['len'].val == rlen) and
+            ((record['hdr']['type'].val == DT_SYNC) or
+             (record['hdr']['type'].val == DT_SYNC_FLUSH) or
+             (record['hdr']['type'].val == DT_SYNC_REBOOT)) and
+            ((chksum & 0xffff) == recsum)):
+            return record['prev_sync'].val
+        return None
+
+
+    def sync_before(self, offset):
+        '''find the last SYNC that ends at or before offset
+
+        Looks back SYNC_WINDOW bytes.  Read the window in one go and use
+        rfind to hop between candidate majiks.  Circular, from past the
+        tail we don't look in front of it, that is the erased gap.
+
+        output: (offset, prev_sync) or None
+        '''
+        start = max(0, offset - SYNC_WINDOW) & ~3
+        if self.wrap_at and offset > self.wrap_at:
+            start = max(start, self.wrap_at)
+        buf   = self.peek(start, offset - start)
+        majik = struct.pack('<I', dt_sync_majik)
+        i = buf.rfind(majik)
+        while i >= SYNC_MAJIK_OFFSET:
+            prev = self.sync_at(buf, i - SYNC_MAJIK_OFFSET)
+            if prev is not None:
+                return (start + i - SYNC_MAJIK_OFFSET, prev)
+            i = buf.rfind(majik, 0, i)
+        return None
+
+
+    def sync_after(self, offset):
+        '''find the first SYNC that starts at or after offset
+
+        Looks forward SYNC_WINDOW bytes, find to hop between candidate
+        majiks.  Local files only.
+
+        output: (offset, prev_sync) or None
+        '''
+        start = (offset + 3) & ~3
+        buf   = self.peek(start, SYNC_WINDOW + SYNC_MAJIK_OFFSET +
+                          dt_records[DT_SYNC][DTR_REQ_LEN])
+        majik = struct.pack('<I', dt_sync_majik)
+        i = buf.find(majik, SYNC_MAJIK_OFFSET)
+        while i >= 0 and i - SYNC_MAJIK_OFFSET <= SYNC_WINDOW:
+            prev = self.sync_at(buf, i - SYNC_MAJIK_OFFSET)
+            if prev is not None:
+                return (start + i - SYNC_MAJIK_OFFSET, prev)
+            i = buf.find(majik, i + 1)
+        return None
+
+
+    def prev_sync(self, count):
+        '''go back count SYNCs from the last SYNC written
+
+        input:  count       number of SYNCs to go back, 0 is the last SYNC.
+
+        output: offset      offset of the SYNC found.  The file is left
+                            positioned there.
+                            negative, something went wrong.
+
+        Each SYNC carries prev_sync, the file offset of the SYNC before
+        it.  Find the last SYNC and follow the chain, a few bytes per SYNC
+        rather than a resync per SYNC.  A link that doesn't point at a
+        good SYNC is repaired by looking back from it for the SYNC before.
+        If the chain runs out early, we stop at the oldest SYNC found.
+
+        Circular (set_wrap), the last SYNC is in front of the erased gap
+        (data_end) and the chain goes back through the front, across the
+        wrap to the end of the file and back toward the tail.  A link has
+        to go back in stream order (stream_pos), one going into the gap
+        or past the tail ends the chain.
+
+        In the case of 'net_io' the tag walks the chain.  Writing count
+        to 'dblk/.prev_sync' (file.truncate()) starts it, the file size
+        becomes non-zero when the tag has the answer.
+        '''
+        if count < 0:
+            return EINVAL
+
+        if self.net_io:
+            psname = os.path.dirname(self.rsname) + '/.prev_sync'
+            psfileno = os.open(psname, os.O_RDWR)
+            os.ftruncate(psfileno, count)
+            for i in range(100):
+                offset = os.fstat(psfileno).st_size
+                if offset != 0: break
+                time.sleep(.1)
+            os.close(psfileno)
+            if offset == 0:
+                return EBUSY
+            if int32(offset) < 0 and int32(offset) >= ELAST:
+                return int32(offset)
+            self.seek(offset)
+            return offset
+
+        size = self.size()
+        found = self.sync_before(self.data_end())
+        if found is None:
+            return EODATA
+        offset, prev = found
+        steps = repairs = 0
+        rlen  = dt_records[DT_SYNC][DTR_REQ_LEN]
+        while steps < count:
+            if prev == 0 or prev >= size or (prev & 3) or \
+               self.stream_pos(prev) >= self.stream_pos(offset):
+                break                   # front of the chain
+            nprev = self.sync_at(self.peek(prev, rlen), 0)
+            if nprev is not None:
+                offset, prev = prev, nprev
+            else:
+                found = self.sync_before(prev)
+                if found is None or \
+                   self.stream_pos(found[0]) >= self.stream_pos(offset):
+                    break
+                repairs += 1
+                offset, prev = found
+            steps += 1
+        if (self.verbose >= 2):
+            eprint('*** prev_sync: back {} (of {}), {} repairs, @{} (0x{:x})'.format(
+                steps, count, repairs, offset, offset))
+        self.seek_data(offset)
+        return offset
+
+
+    def index_probe(self, span):
+        '''look for the INDEX record at the front of span
+
+        Collect always starts a span's INDEX in the first
+        DT_INDEX_SCAN_SECTORS sectors of the span (see typed_data.h).  Read
+        those (and enough beyond to hold a whole INDEX) and look for the
+        majik.
+
+        output: None if the span doesn't have a good INDEX, otherwise
+                (offset, recnum, datetime, entries), entries is a list of
+                (offset, recnum, datetime) for the SYNCs it carries.
+        '''
+        start = span * DT_INDEX_SPAN
+        scan  = DT_INDEX_SCAN_SECTORS * 512
+        buf   = self.peek(start, scan + 512)
+        majik = struct.pack('<I', dt_index_majik)
+        xobj  = obj_dt_index()
+        eobj  = obj_dt_index_entry()
+        xlen  = len(xobj)
+        elen  = len(eobj)
+
+        i = buf.find(majik, INDEX_MAJIK_OFFSET)
+        while i >= 0:
+            rec = i - INDEX_MAJIK_OFFSET
+            if rec >= scan:
+                break
+            if (rec & 3) == 0 and rec + xlen <= len(buf):
+                xobj.set(buf[rec:])
+                rlen = xobj['hdr']['len'].val
+                nent = xobj['nentries'].val
+                rbuf = bytearray(buf[rec:rec + rlen])
+                recsum = xobj['hdr']['recsum'].val
+                chksum = sum(rbuf) - ((recsum >> 8) & 0xff) - (recsum & 0xff)
+                if (xobj['hdr']['type'].val == DT_INDEX and
+                        rlen == xlen + nent * elen and
+                        len(rbuf) == rlen and
+                        (chksum & 0xffff) == recsum):
+                    try:
+                        entries = []
+                        for n in range(nent):
+                            eobj.set(buf[rec + xlen + n * elen:])
+                            entries.append((eobj['offset'].val,
+                                            eobj['recnum'].val,
+                                            rtc2datetime(eobj['rt'])))
+                        return (start + rec, xobj['hdr']['recnum'].val,
+                                rtc2datetime(xobj['hdr']['rt']), entries)
+                    except ValueError:
+                        pass            # bad time, not an INDEX we can use
+            i = buf.find(majik, i + 4)
+        return None
+
+    def index_seek(self, recnum = None, when = None):
+        '''find a record boundary at or before recnum (or time when)
+
+        input:  recnum      record number looking for
+                when        or a datetime looking for
+
+        output: offset      a record boundary at or before what is being
+                            looked for.  The file is left positioned
+                            there.  Walk forward from it.
+                            negative, something went wrong.
+
+        Binary search the spans for the last INDEX at or before the
+        target.  The first INDEX past the target carries the SYNCs just
+        before it, use the last of those that is still at or before the
+        target.
+
+        A span without an INDEX (never laid down, or trashed) says
+        nothing about which way to go.  Calling it either way breaks the
+        search, a good INDEX further on could be on the other side.  So
+        we keep probing the spans after it until one with an INDEX
+        decides.  If none of [mid, hi) has one, there is nothing in
+        there to find and the window closes at mid.
+
+        Circular (set_wrap), the spans are searched in stream order, the
+        tail's span to the end of the file then from the front.  The
+        tail's span shows up twice, its INDEX counts as the oldest if it
+        is past the tail and the newest if it is in front of it.  Spans
+        in the erased gap have no INDEX.
+
+        In the case of 'net_io' the tag does the search.  Writing the
+        record number to 'dblk/.seek' (file.truncate()) starts it, the
+        file size becomes non-zero when the tag has the answer.  The tag
+        only searches on record numbers.
+        '''
+        def at_or_before(ix):
+            if when is not None:
+                return ix[2] <= when
+            return ix[1] <= recnum
+
+        if recnum is None and when is None:
+            return EINVAL
+
+        if self.net_io:
+            if recnum is None:
+                return EINVAL
+            skname = os.path.dirname(self.rsname) + '/.seek'
+            skfileno = os.open(skname, os.O_RDWR)
+            os.ftruncate(skfileno, recnum)
+            for i in range(100):
+                offset = os.fstat(skfileno).st_size
+                if offset != 0: break
+                time.sleep(.1)
+            os.close(skfileno)
+            if offset == 0:
+                return EBUSY
+            self.seek(offset)
+            return offset
+
+        def probe(k):                   # k, span in stream order
+            ix = self.index_probe((first + k) % nspans)
+            if ix and self.wrap_at:
+                if k == 0 and ix[0] < self.wrap_at:
+                    return None         # newest, counted at k == nspans
+                if k == nspans and ix[0] >= self.wrap_at:
+                    return None         # oldest, counted at k == 0
+            return ix
+
+        size   = self.size()
+        nspans = (size + DT_INDEX_SPAN - 1) // DT_INDEX_SPAN
+        first  = 0
+        lo, hi = 0, nspans
+        if self.wrap_at:
+            first  = self.wrap_at // DT_INDEX_SPAN
+            hi     = nspans + 1
+        below = above = None
+        probes = 0
+        while lo < hi:
+            mid  = (lo + hi) // 2
+            span = mid
+            ix   = None
+            while span < hi:
+                ix = probe(span)
+                probes += 1
+                if ix:
+                    break
+                span += 1
+            if ix is None:
+                hi = mid                # no INDEX in [mid, hi)
+            elif at_or_before(ix):
+                below = ix
+                lo = span + 1
+            else:
+                above = ix
+                hi = mid
+
+        offset = below[0] if below else self.data_start()
+        if above:
+            for e in reversed(above[3]):
+                if self.stream_pos(offset) <= self.stream_pos(e[0]) < \
+                   self.stream_pos(above[0]) and at_or_before(e):
+                    offset = e[0]
+                    break
+        if (self.verbose >= 2):
+            eprint('*** index_seek: {} probes, @{} (0x{:x})'.format(
+                probes, offset, offset))
+        self.seek_data(offset)
+        return offset
@@ -3,8 +3,44 @@ tagdump:  decode and display Tag Data Stream file
 @author: Dan Maltbie/Eric B. Decker
 """
 
-__version__ = '0.4.7'
+__version__ = '0.4.8.dev8'
 
+# 0.4.8.dev8
+#       o --xbatch/--xflush, influx export batch size and flush interval.
+#         export stats at the end.
+#
+# 0.4.8.dev7
+#       o resync bytes skipped, per resync and in the summary.
+#
+# 0.4.8.dev6
+#       o get_record, one bytearray per record, checksum without the
+#         slice copy.  Local files are mmap'd by TagFile.
+#
+# 0.4.8.dev5
+#       o -P/--parallel, cut the file up at SYNCs and decode the pieces
+#         in worker processes.  Same output as a serial run.
+#
+# 0.4.8.dev4
+#       o circular DBLK, start at the tail from the directory and come
+#         around to the front at the end.
+#
+# 0.4.8.dev3
+#       o --stripe, put a DBLK striped across two SDs back together.
+#         Warn if the directory says striped and we only have one card.
+#
+# 0.4.8.dev2
+#       o SYNC_FLUSH, skip to the sector boundary after the end of the
+#         record, partial sector closes can straddle.
+#
+# 0.4.8.dev1
+#       o -s implemented, walks the prev_sync chain (TagFile.prev_sync).
+#         No longer forces --net.
+#
+# 0.4.8.dev0    core_rev: 22/9
+#       o -r and --start use the INDEX records (TagFile.index_seek) to
+#         get close, rather than walking the whole file.
+#       o --start filters on record time.
+#
 # 0.4.7rc0:
 # 0.4.6, release, core_rev 22/6
 # 0.4.6.dev+, core_rev: 22/1+:
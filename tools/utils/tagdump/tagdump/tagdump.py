@@ -38,12 +38,19 @@ usage: tagdump.py [-h] [-v] [-V] [-H] [-j JUMP] [-e EndFilePos]
                   [-r START_REC]  [-l LAST_REC]
                   [-g GPS_EVAL]
                   [-p | --pretty]
+                  [-P NPROC | --parallel NPROC]
                   input
 '''
 
 from   __future__         import print_function
 
+import os
+import sys
+import signal
 import struct
+import multiprocessing
+from   collections         import OrderedDict
+from   datetime            import datetime
 
 # parse arguments and import result
 from   tagdumpargs         import args
@@ -54,8 +61,11 @@ import tagcore.core_rev    as     vers
 from   tagcore.dt_defs     import *
 import tagcore.dt_defs     as     dtd
 import tagcore.sirf_defs   as     sirf
+import tagcore.sensor_defs as     sns
+import tagcore.json_emitters as   je
 from   tagcore.tagfile     import *
 from   tagcore.misc_utils  import eprint
+from   tagcore.misc_utils  import rtc2datetime
 from   tagcore.mr_emitters import mr_chksum_err
 
 import tagdump_config                   # populate configuration
@@ -79,15 +89,25 @@ ver_str = '\ntagdump: ' + VERSION + ':  core: ' + str(CORE_REV) + \
 rec_low                 = 0            # inclusive
 rec_high                = 0            # inclusive
 rec_last                = 0            # last rec num looked at
+rec_first               = None         # (recnum, offset) 1st looked at
+start_time              = None         # datetime, --start
 
 # 1st sector of the first is the directory
 DBLK_DIR_SIZE           = 0x200
+DBLK_DIR_SIG            = 0x18961492
+DBLK_DIR_SD_MODE        = 27            # offset of dblk_dir.sd_mode
+DBLK_SD_STRIPE          = 2
 RLEN_MAX_SIZE           = 1024
 RESYNC_HDR_OFFSET       = 28            # how to get back to the start
                                         # or how to move past the majik
 
+# --parallel, partition sizes
+PART_MIN                = 1024 * 1024
+PART_MAX                = 8 * 1024 * 1024
+
 # global stat counters
 num_resyncs             = 0             # how often we've resync'd
+resync_bytes            = 0             # bytes resync stepped over
 chksum_errors           = 0             # checksum errors seen
 unk_rtypes              = 0             # unknown record types
 total_records           = 0
@@ -96,14 +116,23 @@ dt_hdr                  = obj_dt_hdr()
 
 
 def init_globals():
-    global rec_low, rec_high, rec_last
-    global num_resyncs, chksum_errors, unk_rtypes
-    global total_records, total_bytes
+    global rec_low, rec_high, start_time
 
     rec_low             = 0
     rec_high            = 0
+    start_time          = None
+    init_counters()
+
+
+def init_counters():
+    global rec_last, rec_first
+    global num_resyncs, resync_bytes, chksum_errors, unk_rtypes
+    global total_records, total_bytes
+
     rec_last            = 0
+    rec_first           = None
     num_resyncs         = 0             # how often we've resync'd
+    resync_bytes        = 0             # bytes resync stepped over
     chksum_errors       = 0             # checksum errors seen
     unk_rtypes          = 0             # unknown record types
     total_records       = 0
@@ -115,11 +144,15 @@ def resync(fd, offset):
     resync the data stream to the next SYNC record
 
     the actual work is handled in the tagfile module, but count
-    number of times resync has been performed.
+    number of times resync has been performed and how much it skipped.
     '''
-    global num_resyncs
+    global num_resyncs, resync_bytes
     num_resyncs += 1
-    return fd.resync(offset)
+    before = fd.resync_skipped
+    try:
+        return fd.resync(offset)
+    finally:
+        resync_bytes += fd.resync_skipped - before
 
 
 def get_record(fd):
@@ -234,7 +267,7 @@ def get_record(fd):
             dlen += extra
 
         if (dlen > 0):
-            rec_buf.extend(bytearray(fd.read(dlen)))
+            rec_buf.extend(fd.read(dlen))
 
         if (len(rec_buf) < rlen):
             eprint('*** record read too short: wanted {} got {} @{}'.format(
@@ -248,7 +281,10 @@ def get_record(fd):
         # so we need to remove it before comparing.  Recsum is 16 bits wide so can not
         # simply be added in as part of the checksum computation.
         #
-        chksum = sum(rec_buf[:rlen])
+        # rec_buf runs to the next quad, take the pad back out rather than
+        # copying the record to sum it.
+        #
+        chksum = sum(rec_buf) - sum(rec_buf[rlen:])
         chksum -= (recsum & 0xff00) >> 8
         chksum -= (recsum & 0x00ff)
         chksum &= 0xffff                # force to 16 bits vs. 16 bit recsum
@@ -289,8 +325,408 @@ def get_record(fd):
     return -1, hdr, ''
 
 
+def count_dt(rtype):
+    """
+    increment counter in dict of rtypes, create new entry if needed
+    also check for existence of dtd.dt_records entry.  If not known
+    count it as unknown.
+    """
+    global unk_rtypes
+
+    try:
+        dtd.dt_records[rtype]
+    except KeyError:
+        unk_rtypes += 1
+
+    try:
+        dtd.dt_count[rtype] += 1
+    except KeyError:
+        dtd.dt_count[rtype] = 1
+
+
+def process_records(infile, end = None):
+    """
+    decode and emit records from where infile is until we run out, or
+    something says stop.
+
+    end:     (--parallel) stop at the first record at or past end, it
+             belongs to the next partition.
+
+    returns (why, offset)
+             'eof'   get_record ran out.
+             'stop'  -l, -e, or -n bounds.
+             'end'   got to end, offset is where the next record is.
+    """
+    global rec_last, rec_first
+    global total_records, total_bytes
+
+    while(True):
+        rec_offset, hdr, rec_buf = get_record(infile)
+
+        if (rec_offset < 0):
+            return 'eof', rec_offset
+        if (end is not None and rec_offset >= end):
+            return 'end', rec_offset
+
+        # hdr was populated (.set) by get_record
+        rlen     = hdr['len'].val
+        rtype    = hdr['type'].val
+        recnum   = hdr['recnum'].val
+
+        if (recnum < rec_last):
+            eprint('*** recnum went backwards.  last: {}, new: {}, @{}'.format(
+                rec_last, recnum, rec_offset))
+        if (rec_last and recnum > rec_last + 1):
+            eprint('*** record gap: ({}) records @{}'.format(
+                recnum - rec_last, rec_offset))
+        rec_last = recnum
+        if rec_first is None:
+            rec_first = (recnum, rec_offset)
+
+        # apply any filters (inclusion)
+        if (args.rtypes):
+            # either the number rtype must be in the search list
+            # or the name of the rtype must be in the search list
+            if ((str(rtype)       not in args.rtypes) and
+                  (dt_name(rtype) not in args.rtypes)):
+                continue                   # not an rtype of interest
+
+        # look to see if record number bounds
+        if (rec_low and recnum < rec_low):
+            continue
+        if (rec_high and recnum > rec_high):
+            return 'stop', rec_offset   # all done
+
+        # and time bounds
+        if (start_time):
+            try:
+                if (rtc2datetime(hdr['rt']) < start_time):
+                    continue
+            except ValueError:
+                pass
+
+        # look to see if past file position bound
+        if (args.endpos and rec_offset > args.endpos):
+            return 'stop', rec_offset   # all done
+
+        count_dt(rtype)
+        v = dtd.dt_records.get(rtype, (0, None, None, None, ''))
+        decoder  = v[DTR_DECODER]           # dt function
+        emitters = v[DTR_EMITTERS]          # emitter list
+        obj      = v[DTR_OBJ]               # dt object
+        if (decoder):                       # BRK
+            try:
+                decoder(g.verbose, rec_offset, rec_buf, obj)
+                if emitters and len(emitters):
+                    for e in emitters:
+                        e(g.verbose, rec_offset, rec_buf, obj)
+            except struct.error:
+                eprint('*** decoder/emitter struct/obj error: (len: {}, '
+                      'rtype: {} {}, wanted: {}), @{}'.format(
+                          rlen, rtype, dt_name(rtype),
+                          len(obj) if obj else 0, rec_offset))
+        else:
+            if g.debug or not g.quiet or g.verbose >= 5:
+                eprint('*** no decoder installed for rtype {}, @{}'.format(
+                    rtype, rec_offset))
+        if (g.verbose >= 3):
+            print()
+            dump_hdr(rec_offset, rec_buf, '    ')
+            dump_buf(rec_buf, '    ')
+        if g.verbose >= 1 and not g.quiet and not g.mr_emitters:
+            print()
+        total_records += 1
+        total_bytes   += rlen
+        if (args.num and total_records >= args.num):
+            return 'stop', rec_offset
+        #
+        # if we have a SYNC_FLUSH then advance to the next sector
+        # boundary.  The rest of the sector is padding.  Either a
+        # System_Flush (we should have a reboot record in the next
+        # sector) or the tag closed a partial sector to get its data
+        # out.  The latter can straddle, so go from the end of it.
+        #
+        if rtype == DT_SYNC_FLUSH:
+            new_offset = rec_offset + rlen + 511
+            new_offset &= 0xfffffe00
+            eprint()
+            eprint('*** SYNC_FLUSH: @{} advancing to next '
+                   'sector @{}'.format(rec_offset, new_offset))
+            eprint()
+            infile.seek(new_offset)
+
+
 def process_dir(fd):
-    fd.seek(DBLK_DIR_SIZE)
+    fd.seek(fd.data_start())            # past the dir, or the tail
+
+
+def dir_sd_mode(fd):
+    '''sd_mode from the DBLK directory, None if no good directory'''
+    fd.seek(0)
+    buf = fd.read(DBLK_DIR_SD_MODE + 1)
+    if len(buf) < DBLK_DIR_SD_MODE + 1:
+        return None
+    dblk_id, sig = struct.unpack('<4sI', buf[:8])
+    if dblk_id != 'DBLK' or sig != DBLK_DIR_SIG:
+        return None
+    return ord(buf[DBLK_DIR_SD_MODE])
+
+
+#
+# --parallel
+#
+# Collect lays down a SYNC at least every SYNC_MAX_SECTORS, so the file
+# can be cut up at SYNCs and the pieces decoded by a pool of worker
+# processes.  Each worker decodes its piece exactly the way the serial
+# loop would (process_records) with stdout/stderr captured in order.
+# The parent puts the pieces back together in file order, which is
+# recnum order, and what comes out is what a serial run prints.
+#
+# Things that cross a cut are fixed up by the parent:
+#
+#   o hourly banners.  Workers don't know the last hour printed, they
+#     leave a marker (dtd.hourly_hook) and the parent decides.
+#   o recnum gap/backwards checks on the first record of a piece.
+#   o counters and the rtype/mid/sensor counts (summed, counts keep the
+#     order keys first showed up so the dicts print the same).
+#   o export points (json_emitters.influx_sink), written by the parent
+#     in order.
+#
+# If a piece runs past the SYNC the next one starts on (a resync off the
+# end, shouldn't happen) the next piece is redone from where it really
+# stopped.
+#
+
+SEG_HOURLY = 0                          # segs: (0, banner, (y, m, d, h))
+wk_file    = None                       # worker's own TagFile
+
+
+class SeenDict(dict):
+    '''dict that remembers the order its keys showed up in'''
+
+    def __init__(self):
+        dict.__init__(self)
+        self.order = []
+
+    def __setitem__(self, key, val):
+        if key not in self:
+            self.order.append(key)
+        dict.__setitem__(self, key, val)
+
+    def seen(self):
+        return [ (key, self[key]) for key in self.order ]
+
+
+class PartOut(object):
+    '''stdout (1) or stderr (2) while decoding a partition'''
+
+    def __init__(self, segs, fd):
+        self.segs = segs
+        self.fd   = fd
+
+    def write(self, s):
+        self.segs.append((self.fd, s, None))
+
+    def flush(self):
+        pass
+
+
+def seg_pack(segs):
+    '''glue runs of writes to the same stream together'''
+    out = []
+    run = []
+    for seg in segs:
+        if run and seg[0] != run[0][0] or seg[0] == SEG_HOURLY:
+            if run:
+                out.append((run[0][0], ''.join([ x[1] for x in run ]), None))
+                run = []
+        if seg[0] == SEG_HOURLY:
+            out.append(seg)
+        else:
+            run.append(seg)
+    if run:
+        out.append((run[0][0], ''.join([ x[1] for x in run ]), None))
+    return out
+
+
+def part_file():
+    '''our own TagFile on the input, for decoding partitions'''
+    in_fd = open(args.input.name, 'rb')
+    if args.stripe:
+        in_fd = StripeFile(in_fd, open(args.stripe.name, 'rb'))
+    return TagFile(in_fd, verbose = g.verbose, timeout = args.timeout)
+
+
+def part_init():
+    '''pool worker start up.  ^C is the parent's problem.'''
+    global wk_file
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    wk_file = part_file()
+
+
+def partition(infile, start, stop, nproc):
+    '''
+    cut [start, stop) up at SYNCs.  A few partitions per worker keeps
+    them all busy to the end.
+
+    returns list of (start, end), end None for the last one.
+    '''
+    span  = stop - start
+    psize = min(PART_MAX, max(PART_MIN, span / (nproc * 4)))
+    parts = []
+    lo    = start
+    nxt   = start + psize
+    while nxt < stop:
+        found = infile.sync_after(nxt)
+        if found is None:               # nothing here, look further on
+            nxt += psize
+            continue
+        cut = found[0]
+        if cut >= stop:
+            break
+        if cut > lo:
+            parts.append((lo, cut))
+            lo = cut
+        nxt = cut + psize
+    parts.append((lo, None))
+    return parts
+
+
+def decode_part(part):
+    '''decode one partition, (start, end), everything it says captured'''
+    start, end = part
+    segs   = []
+    points = []
+
+    def hourly(rt):
+        key = (rt['year'].val, rt['mon'].val, rt['day'].val, rt['hr'].val)
+        segs.append((SEG_HOURLY, dtd.hourly_str(rt), key))
+
+    init_counters()
+    saved = (sys.stdout, sys.stderr, dtd.dt_count, sirf.mid_count,
+             sns.sns_count)
+    dtd.dt_count   = SeenDict()
+    sirf.mid_count = SeenDict()
+    sns.sns_count  = SeenDict()
+    sys.stdout     = PartOut(segs, 1)
+    sys.stderr     = PartOut(segs, 2)
+    dtd.hourly_hook = hourly
+    je.influx_sink  = points
+    try:
+        wk_file.seek(start)
+        why, offset = process_records(wk_file, end)
+        res = {
+            'start':    start,
+            'why':      why,
+            'offset':   offset,
+            'tell':     wk_file.tell(),
+            'segs':     seg_pack(segs),
+            'points':   points,
+            'first':    rec_first,
+            'last':     rec_last,
+            'resyncs':  num_resyncs,
+            'skipped':  resync_bytes,
+            'chksums':  chksum_errors,
+            'unk':      unk_rtypes,
+            'records':  total_records,
+            'bytes':    total_bytes,
+            'dt_count': dtd.dt_count.seen(),
+            'mids':     sirf.mid_count.seen(),
+            'sns':      sns.sns_count.seen(),
+        }
+    finally:
+        (sys.stdout, sys.stderr, dtd.dt_count, sirf.mid_count,
+         sns.sns_count) = saved
+        dtd.hourly_hook = None
+        je.influx_sink  = None
+    return res
+
+
+def dump_parallel(infile, nproc):
+    '''
+    decode from where infile is using nproc workers.  Same output as
+    process_records.
+
+    returns where we ended up (tell)
+    '''
+    global wk_file, rec_last, rec_first
+    global num_resyncs, resync_bytes, chksum_errors, unk_rtypes
+    global total_records, total_bytes
+
+    start = infile.tell()
+    stop  = infile.size()
+    if args.endpos and args.endpos < stop:
+        stop = args.endpos + 1
+    parts = partition(infile, start, stop, nproc)
+    if g.debug:
+        eprint('*** parallel: {} workers, {} partitions'.format(
+            nproc, len(parts)))
+
+    last_hr = (0, 0, 0, 0)              # dtd.last_rt to start with
+    last    = 0                         # rec_last across partitions
+    counts  = (OrderedDict(), OrderedDict(), OrderedDict())
+    tot     = { 'resyncs': 0, 'skipped': 0, 'chksums': 0, 'unk': 0,
+                'records': 0, 'bytes': 0 }
+    nxt     = start
+    tell    = start
+    pool    = multiprocessing.Pool(nproc, part_init)
+    try:
+        for i, res in enumerate(pool.imap(decode_part, parts)):
+            if res['start'] != nxt:
+                # last one ran past where this one starts, redo it
+                if wk_file is None:
+                    wk_file = part_file()
+                res = decode_part((nxt, parts[i][1]))
+
+            if res['first']:
+                recnum, offset = res['first']
+                if (recnum < last):
+                    eprint('*** recnum went backwards.  last: {}, new: {}, @{}'.format(
+                        last, recnum, offset))
+                if (last and recnum > last + 1):
+                    eprint('*** record gap: ({}) records @{}'.format(
+                        recnum - last, offset))
+                last = res['last']
+
+            for fd, s, key in res['segs']:
+                if fd == SEG_HOURLY:
+                    if key == last_hr:
+                        continue
+                    last_hr = key
+                    sys.stdout.write(s + '\n')
+                elif fd == 1:
+                    sys.stdout.write(s)
+                else:
+                    sys.stderr.write(s)
+            je.influx_flush(res['points'])
+
+            for key in tot:
+                tot[key] += res[key]
+            for total, seen in zip(counts, (res['dt_count'], res['mids'],
+                                            res['sns'])):
+                for key, cnt in seen:
+                    total[key] = total.get(key, 0) + cnt
+            tell = res['tell']
+            if res['why'] != 'end':
+                break
+            nxt = res['offset']
+    finally:
+        pool.terminate()
+        pool.join()
+        init_counters()
+        rec_last      = last
+        num_resyncs   = tot['resyncs']
+        resync_bytes  = tot['skipped']
+        chksum_errors = tot['chksums']
+        unk_rtypes    = tot['unk']
+        total_records = tot['records']
+        total_bytes   = tot['bytes']
+        for d, total in zip((dtd.dt_count, sirf.mid_count, sns.sns_count),
+                            counts):
+            d.clear()
+            for key, cnt in total.items():
+                d[key] = cnt
+    return tell
 
 
 def dump():
@@ -308,7 +744,7 @@ def dump():
     and dt-specific decoder summary
     """
 
-    global rec_low, rec_high, rec_last
+    global rec_low, rec_high, rec_last, start_time
     global num_resyncs, chksum_errors, unk_rtypes
     global total_records, total_bytes
 
@@ -327,26 +763,8 @@ def dump():
             vers.snsd_ver, vers.snse_ver, vers.snsh_ver))
         eprint()
 
-    def count_dt(rtype):
-        """
-        increment counter in dict of rtypes, create new entry if needed
-        also check for existence of dtd.dt_records entry.  If not known
-        count it as unknown.
-        """
-        global unk_rtypes
-
-        try:
-            dtd.dt_records[rtype]
-        except KeyError:
-            unk_rtypes += 1
-
-        try:
-            dtd.dt_count[rtype] += 1
-        except KeyError:
-            dtd.dt_count[rtype] = 1
-
-    # Any -s argument (walk syncs backward) or -r -1 (last_rec) forces net io
-    if (args.sync is not None or args.start_rec == -1 or args.tail):
+    # -r -1 (last_rec) forces net io
+    if (args.start_rec == -1 or args.tail):
         args.net = True
 
     if g.debug:
@@ -372,14 +790,34 @@ def dump():
         eprint()
 
 
+    # striped, the two card dumps look like one stream
+    in_fd = args.input
+    if args.stripe:
+        in_fd = StripeFile(args.input, args.stripe)
+
     # create file object that handles both buffered and direct io
-    infile  = TagFile(args.input, net_io = args.net, tail = args.tail,
+    infile  = TagFile(in_fd, net_io = args.net, tail = args.tail,
                       verbose = g.verbose, timeout = args.timeout)
 
+    if not args.net and not args.stripe and \
+       dir_sd_mode(infile) == DBLK_SD_STRIPE:
+        eprint('*** DBLK is striped across two SDs, this is half of it')
+        eprint('*** use --stripe <SD1 DBLK file>')
+
+    # circular DBLK that has been around, the oldest data is at the tail
+    # and reading comes around to the front at the end.
+    tail = infile.dir_tail()
+    if tail:
+        infile.set_wrap(tail)
+        if not g.quiet:
+            eprint('*** circular DBLK, oldest data @{0} (0x{0:x})'.format(tail))
+
     if (args.start_rec):
         rec_low  = args.start_rec
     if (args.last_rec):
         rec_high = args.last_rec
+    if (args.start):
+        start_time = datetime.utcfromtimestamp(args.start)
 
     # process the directory, this will leave us pointing at the first header
     process_dir(infile)
@@ -392,103 +830,63 @@ def dump():
         else:
             infile.seek(args.jump)
 
+    # -s, some number of SYNCs back from the last one.  Follows the
+    # prev_sync chain (on the tag with --net).
+    if (args.sync is not None):
+        offset = infile.prev_sync(abs(args.sync))
+        if (offset < 0):
+            eprint('*** prev_sync failed ({}), walking from the front'.format(
+                offset))
+            process_dir(infile)
+
+    # -r or --start, no -j.  Use the INDEX records to get close rather
+    # than walking the whole file.
+    if (not args.jump and args.sync is None and (rec_low > 0 or start_time)):
+        if rec_low > 0:
+            offset = infile.index_seek(recnum = rec_low)
+        else:
+            offset = infile.index_seek(when = start_time)
+        if (offset < 0):
+            eprint('*** index_seek failed ({}), walking from the front'.format(
+                offset))
+            process_dir(infile)
+
     no_header = args.quiet or args.mr_emitters
     if not no_header:
         print(dtd.rec_title_str)
 
+    # --parallel, local files that we can cut up and read from the front
+    nproc = 0
+    if args.parallel is not None:
+        nproc = args.parallel if args.parallel > 0 \
+                else multiprocessing.cpu_count()
+        if args.net or args.num or tail or \
+           not os.path.isfile(args.input.name):
+            eprint('*** --parallel: not with --net/--tail, -n, circular, '
+                   'or a non-file input.  serial')
+            nproc = 0
+
     # extract record from input file and output decoded results
+    end_pos = -1
     try:
-        while(True):
-            rec_offset, hdr, rec_buf = get_record(infile)
-
-            if (rec_offset < 0):
-                break
-
-            # hdr was populated (.set) by get_record
-            rlen     = hdr['len'].val
-            rtype    = hdr['type'].val
-            recnum   = hdr['recnum'].val
-
-            if (recnum < rec_last):
-                eprint('*** recnum went backwards.  last: {}, new: {}, @{}'.format(
-                    rec_last, recnum, rec_offset))
-            if (rec_last and recnum > rec_last + 1):
-                eprint('*** record gap: ({}) records @{}'.format(
-                    recnum - rec_last, rec_offset))
-            rec_last = recnum
-
-            # apply any filters (inclusion)
-            if (args.rtypes):
-                # either the number rtype must be in the search list
-                # or the name of the rtype must be in the search list
-                if ((str(rtype)       not in args.rtypes) and
-                      (dt_name(rtype) not in args.rtypes)):
-                    continue                   # not an rtype of interest
-
-            # look to see if record number bounds
-            if (rec_low and recnum < rec_low):
-                continue
-            if (rec_high and recnum > rec_high):
-                break                       # all done
-
-            # look to see if past file position bound
-            if (args.endpos and rec_offset > args.endpos):
-                break                       # all done
-
-            count_dt(rtype)
-            v = dtd.dt_records.get(rtype, (0, None, None, None, ''))
-            decoder  = v[DTR_DECODER]           # dt function
-            emitters = v[DTR_EMITTERS]          # emitter list
-            obj      = v[DTR_OBJ]               # dt object
-            if (decoder):                       # BRK
-                try:
-                    decoder(g.verbose, rec_offset, rec_buf, obj)
-                    if emitters and len(emitters):
-                        for e in emitters:
-                            e(g.verbose, rec_offset, rec_buf, obj)
-                except struct.error:
-                    eprint('*** decoder/emitter struct/obj error: (len: {}, '
-                          'rtype: {} {}, wanted: {}), @{}'.format(
-                              rlen, rtype, dt_name(rtype),
-                              len(obj) if obj else 0, rec_offset))
-            else:
-                if g.debug or not g.quiet or g.verbose >= 5:
-                    eprint('*** no decoder installed for rtype {}, @{}'.format(
-                        rtype, rec_offset))
-            if (g.verbose >= 3):
-                print()
-                dump_hdr(rec_offset, rec_buf, '    ')
-                dump_buf(rec_buf, '    ')
-            if g.verbose >= 1 and not g.quiet and not g.mr_emitters:
-                print()
-            total_records += 1
-            total_bytes   += rlen
-            if (args.num and total_records >= args.num):
-                break
-            #
-            # if we have a SYNC_FLUSH then advance to the next sector
-            # boundary.  System_Flush and we should have a reboot record
-            # in the next sector.
-            #
-            if rtype == DT_SYNC_FLUSH:
-                new_offset = rec_offset + 512
-                new_offset &= 0xfffffe00
-                eprint()
-                eprint('*** SYNC_FLUSH: @{} advancing to next '
-                       'sector @{}'.format(rec_offset, new_offset))
-                eprint()
-                infile.seek(new_offset)
-
+        if nproc:
+            end_pos = dump_parallel(infile, nproc)
+        else:
+            process_records(infile)
     except KeyboardInterrupt:
         eprint()
         eprint()
         eprint('*** user stop')
 
+    je.influx_close()                   # drain the export, print its stats
+    if end_pos < 0:
+        end_pos = infile.tell()
     eprint()
     eprint('*** end of processing @{}  (0x{:x})  processed: {} records  {} bytes'.format(
-            infile.tell(), infile.tell(), total_records, total_bytes))
-    eprint('*** reboots: {}  resyncs: {}  chksum_errs: {}  unk_rtypes: {}'.format(
-        dtd.dt_count.get(DT_REBOOT, 0), num_resyncs, chksum_errors, unk_rtypes))
+            end_pos, end_pos, total_records, total_bytes))
+    eprint('*** reboots: {}  resyncs: {} ({} bytes skipped)  chksum_errs: {}  unk_rtypes: {}'.format(
+        dtd.dt_count.get(DT_REBOOT, 0), num_resyncs, resync_bytes,
+        chksum_errors, unk_rtypes))
     if chksum_errors > 0:
         eprint()
         eprint('****** non-zero chksum_errors: {}'.format(chksum_errors))
@@ -62,18 +62,27 @@ optional arguments:
                   (args.net, boolean)
 
   -s SYNC_DELTA   search some number of syncs backward
-                  always implies --net, -s 0 says .last_sync
-                  -s 1 and -s -1 both say sync one back.
+                  -s 0 says the last sync, -s 1 and -s -1 both say
+                  sync one back.  Follows the prev_sync chain, with
+                  --net the tag does the walk (dblk/.prev_sync).
                   (args.sync, int)
 
   --start START_TIME
-                  include records with rtctime greater than START_TIME
+                  include records with rtctime >= START_TIME, seconds
+                  since the epoch (UTC).  Uses the INDEX records to
+                  find where to start.
   --end END_TIME  (args.{start,end}_time)
 
   -r START_REC    starting/ending records to dump.
                   -r -1 says start with .last_rec (implies --net)
+                  START_REC is found using the INDEX records.
   -l LAST_REC     (args.{start,last}_rec, integer)
 
+  --stripe CARD1  the DBLK is striped across two SDs (DBLK_SD_STRIPE).
+                  input is the DBLK file from SD0 and CARD1 the one from
+                  SD1, tagdump puts the data stream back together.
+                  Local files only.  (args.stripe, file)
+
   -t, --timeout TIMEOUT
                   set --tail timeout to TIMEOUT seconds, defaults to 60
 
@@ -87,6 +96,10 @@ optional arguments:
   --noexport      override implicit export.  Used to examine incoming data
                   without exporting to influxdb.
 
+  --xbatch N      export, points per database write (default 5000)
+  --xflush SECS   export, write a partial batch once its oldest point has
+                  waited SECS (default 1.0)
+
   -v, --verbose   increase output verbosity
                   (args.verbose)
 
@@ -101,6 +114,15 @@ optional arguments:
   -m
   --mr_emitters   use machine readable emitters.
 
+  -P NPROC
+  --parallel NPROC
+                  decode using NPROC worker processes, 0 one per
+                  cpu.  The file is cut up at SYNC records and the
+                  pieces are put back together in order, same output
+                  as a serial run.  Local files only, not with -n,
+                  --net, --tail, or a circular DBLK.
+                  (args.parallel, int)
+
   -g<n>
   --gps_eval <n>  switch to gps evaluation emitters with display level <n>
                   9 display all gps entries.
@@ -176,10 +198,9 @@ def parseargs():
                         type=int,
                         help='sync backward SYNC syncs')
 
-    # not working yet
     parser.add_argument('--start',
                         type=int,
-                        help='include records with rtctime >= than START')
+                        help='include records with rtctime >= START (epoch secs)')
 
     # not working yet
     parser.add_argument('--end',
@@ -194,6 +215,11 @@ def parseargs():
                         type=int,
                         help='last record to dump.')
 
+    parser.add_argument('--stripe',
+                        type=argparse.FileType('rb'),
+                        metavar='CARD1',
+                        help='striped DBLK, input from SD0, CARD1 from SD1')
+
     parser.add_argument('-t', '--timeout',
                         type=int,
                         default=60,
@@ -213,6 +239,18 @@ def parseargs():
                         default=0,
                         help='override export to external database')
 
+    parser.add_argument('--xbatch',
+                        type=int,
+                        default=5000,
+                        metavar='N',
+                        help='export batch size, points per write')
+
+    parser.add_argument('--xflush',
+                        type=float,
+                        default=1.0,
+                        metavar='SECS',
+                        help='export flush interval, seconds')
+
     parser.add_argument('-m', '--mr_emitters',
                         action='store_true',
                         help='enable machine readable export emitters')
@@ -221,6 +259,11 @@ def parseargs():
                         action='store_true',
                         help='print pretty when able')
 
+    parser.add_argument('-P', '--parallel',
+                        type=int,
+                        metavar='NPROC',
+                        help='decode in parallel, NPROC workers (0 all cpus)')
+
     parser.add_argument('-g', '--gps_eval',
                         type=int,
                         help='use gps_eval emitters, at level <GPS_EVAL>')
@@ -244,6 +287,8 @@ tagcore.globals.quiet     = args.quiet
 tagcore.globals.pretty    = args.pretty
 tagcore.globals.gps_level = args.gps_eval
 tagcore.globals.mr_emitters = args.mr_emitters
+tagcore.globals.export_batch = args.xbatch
+tagcore.globals.export_flush = args.xflush
 
 if args.mr_emitters and args.gps_eval:
     print('*** gps_eval and mr_emitters are mutually exclusive')
@@ -86,6 +86,8 @@ extern ms_rtn ms_read_blk(uint32_t blk_id, void *buf);
 extern ms_rtn ms_read_blk_fail(uint32_t blk_id, void *buf);
 extern ms_rtn ms_read8(uint32_t blk_id, void *buf);
 extern ms_rtn ms_write_blk(uint32_t blk_id, void *buf);
+extern ms_rtn ms_write_multi(uint32_t blk_id, void *buf, uint32_t count);
+extern ms_rtn ms_sync(void);
 
 extern char * ms_dsp_err(ms_rtn err);
 
@@ -271,6 +271,52 @@ ms_write_blk(uint32_t blk_id, void *buf) {
 }
 
 
+/*
+ * ms_write_multi: count contiguous blocks starting at blk_id in one
+ * write.  Lets the kernel hand the card a multi-block write.
+ */
+ms_rtn
+ms_write_multi(uint32_t blk_id, void *buf, uint32_t count) {
+    loff_t off, pos;
+    int wrote, len;
+
+    off = (loff_t) blk_id * MS_BLOCK_SIZE;
+    len = count * MS_BLOCK_SIZE;
+    pos = lseek64(fd, off, SEEK_SET);
+    if (pos == -1) {
+	fprintf(stderr, "ms_write_multi: seek fail: %s (%d)\n",
+		strerror(errno), errno);
+	return(MS_WRITE_FAIL);
+    }
+    wrote = write(fd, buf, len);
+    if (wrote == -1) {
+	fprintf(stderr, "ms_write_multi: write fail: %s (%d)\n",
+		strerror(errno), errno);
+	return(MS_WRITE_FAIL);
+    }
+    if (wrote != len) {
+	fprintf(stderr, "ms_write_multi: write too short, req: %d, wrote: %d\n",
+		len, wrote);
+	return(MS_WRITE_TOO_SHORT);
+    }
+    return(MS_OK);
+}
+
+
+/*
+ * ms_sync: push anything the kernel is holding out to the card.
+ */
+ms_rtn
+ms_sync(void) {
+    if (fdatasync(fd)) {
+	fprintf(stderr, "ms_sync: fdatasync fail: %s (%d)\n",
+		strerror(errno), errno);
+	return(MS_WRITE_FAIL);
+    }
+    return(MS_OK);
+}
+
+
 char *
 ms_dsp_err(ms_rtn err) {
     switch (err) {
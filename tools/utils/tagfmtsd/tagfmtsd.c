@@ -27,6 +27,7 @@
  *
  * vfat format:     mkdosfs -F 32 -I -n"TagTest" -v /dev/sdb
  * create locators: tagfmtsd -w /dev/sdb
+ * characterise SD: tagfmtsd -Cw /dev/sdb
  */
 
 #include <mm_types.h>
@@ -41,6 +42,7 @@
 #include <fat_fs.h>
 #include <fatxfc.h>
 #include <ms.h>
+#include <ms_util.h>
 
 #include <dblk_dir.h>
 
@@ -48,11 +50,12 @@
 extern fs_loc_t loc;
 
 
-#define VERSION "tagfmtsd: v4.5.0  2020/01/10\n"
+#define VERSION "tagfmtsd: v4.6.0  2020/02/14\n"
 
 int debug	= 0,
     verbose	= 0,
     do_write	= 0,
+    do_char     = 0,
     force       = 0;
 
 const uint8_t *dblk_id_str = (void *) "DBLK";
@@ -106,8 +109,9 @@ static void usage(char *name) {
     fprintf(stderr, VERSION);
     fprintf(stderr, "\n");
     display_gpl();
-    fprintf(stderr, "\nusage: %s [-c <config_size>] [-d <data_size>] [-p <panic size>] [-Dfvw] device_file\n", name);
+    fprintf(stderr, "\nusage: %s [-c <config_size>] [-d <data_size>] [-p <panic size>] [-CDfvw] device_file\n", name);
     fprintf(stderr, "  -c <size>    set config size\n");
+    fprintf(stderr, "  -C           characterise the SD (write timing, needs -w)\n");
     fprintf(stderr, "  -d <size>    set dblk size\n");
     fprintf(stderr, "  -f           force (rewrite dirs)\n");
     fprintf(stderr, "  -h           this usage\n");
@@ -129,6 +133,8 @@ display_info(uint8_t *buf) {
     fat_dir_entry_t *de;
     u32_t rds;
     dblk_dir_t *ddp;
+    dblk_ckpt_t *dcp;
+    dblk_sdchar_t *scp;
     uint32_t    sum, *p32;
     int err, i;
 
@@ -206,6 +212,29 @@ display_info(uint8_t *buf) {
                   ddp->incept_date.hr,
                   ddp->incept_date.min,
                   ddp->incept_date.sec);
+          dcp = (void *) &buf[DBLK_CKPT_OFFSET];
+          p32 = (void *) dcp;
+          sum = 0;
+          for (i = 0; i < DBLK_CKPT_QUADS; i++)
+            sum += *p32++;
+          if (dcp->ckpt_sig != DBLK_CKPT_SIG || dcp->ckpt_sig_a != DBLK_CKPT_SIG || sum)
+            fprintf(stderr, "  ckpt:   none\n");
+          else
+            fprintf(stderr, "  ckpt:   nxt: 0x%x  recnum: %u  sync: 0x%x  flags: 0x%02x\n",
+                    dcp->dblk_nxt, dcp->cur_recnum, dcp->last_sync_offset,
+                    dcp->flags);
+          scp = (void *) &buf[DBLK_SDCHAR_OFFSET];
+          p32 = (void *) scp;
+          sum = 0;
+          for (i = 0; i < DBLK_SDCHAR_QUADS; i++)
+            sum += *p32++;
+          if (scp->sdc_sig != DBLK_SDCHAR_SIG || scp->sdc_sig_a != DBLK_SDCHAR_SIG || sum)
+            fprintf(stderr, "  sdchar: none\n");
+          else
+            fprintf(stderr, "  sdchar: pwr: %u  wr1: %u  wrm: %u/%u  (uS)  src: %s\n",
+                    scp->pwr_us, scp->wr1_us, scp->wrm_us, scp->wrm_cnt,
+                    (scp->src == DBLK_SDC_SRC_HOST) ? "host" :
+                    (scp->src == DBLK_SDC_SRC_TAG)  ? "tag"  : "unk");
         }
     } else
 	fprintf(stderr, "DBLK0001: not found\n");
@@ -275,6 +304,116 @@ int write_dblk_dir(uint8_t *buf, uint8_t file_idx) {
 }
 
 
+/*
+ * characterise_sd: time writes to the card, leave the result in the dblk
+ * directory sector (dblk_sdchar_t, see dblk_dir.h).
+ *
+ * Uses the last SDC_TEST_BLKS sectors of the DBLK area, which had better
+ * be empty (we put zeros back when done).  SDC_WR1_N single block writes
+ * and one SDC_WRM_CNT multi-block write, each pushed out with ms_sync
+ * so we time the card rather than the page cache.  What we see includes
+ * the host's reader and the kernel, the tag will be a bit better.
+ *
+ * We can't power cycle the card from here, pwr_us is left 0 and the tag
+ * fills it in from what it sees (SSWPolicy).
+ */
+
+#define SDC_TEST_BLKS 64
+#define SDC_WR1_N     16
+#define SDC_WRM_CNT   32
+
+static uint32_t sdc_now_us(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+int characterise_sd(uint8_t *buf) {
+  static uint8_t mbuf[SDC_WRM_CNT * MS_BUF_SIZE];
+  dblk_sdchar_t *scp;
+  uint32_t base, blk, t0, wr1, wrm, sum, *p32;
+  int err, i;
+
+  if (loc.locators[FS_LOC_DBLK].end - loc.locators[FS_LOC_DBLK].start
+      < 2 * SDC_TEST_BLKS) {
+    fprintf(stderr, "characterise_sd: DBLK area missing or too small\n");
+    return 1;
+  }
+  base = loc.locators[FS_LOC_DBLK].end - SDC_TEST_BLKS + 1;
+  for (blk = base; blk <= loc.locators[FS_LOC_DBLK].end; blk++) {
+    err = ms_read_blk(blk, buf);
+    if (err || !msu_blk_empty(buf)) {
+      fprintf(stderr, "characterise_sd: 0x%x not empty, won't write test sectors\n",
+              blk);
+      return 1;
+    }
+  }
+
+  memset(buf, 0, MS_BUF_SIZE);
+  for (i = 0; i < MS_BUF_SIZE; i++)
+    buf[i] = i;
+  wr1 = wrm = 0;
+  for (i = 0; i < SDC_WR1_N; i++) {
+    t0 = sdc_now_us();
+    if ((err = ms_write_blk(base + i, buf)) || (err = ms_sync()))
+      goto zap;
+    wr1 += sdc_now_us() - t0;
+  }
+  wr1 /= SDC_WR1_N;
+
+  for (i = 0; i < sizeof(mbuf); i++)
+    mbuf[i] = i;
+  t0 = sdc_now_us();
+  if ((err = ms_write_multi(base + SDC_WR1_N, mbuf, SDC_WRM_CNT)) ||
+      (err = ms_sync()))
+    goto zap;
+  wrm = sdc_now_us() - t0;
+
+zap:
+  memset(mbuf, 0, sizeof(mbuf));
+  if (ms_write_multi(base, mbuf, SDC_WR1_N) ||
+      ms_write_multi(base + SDC_WR1_N, mbuf, SDC_WRM_CNT) || ms_sync())
+    fprintf(stderr, "characterise_sd: couldn't zero test sectors 0x%x - 0x%x\n",
+            base, loc.locators[FS_LOC_DBLK].end);
+  if (err) {
+    fprintf(stderr, "characterise_sd: test write failed: %s (0x%x)\n",
+            ms_dsp_err(err), err);
+    return err;
+  }
+
+  err = ms_read_blk(loc.locators[FS_LOC_DBLK].start, buf);
+  if (err) {
+    fprintf(stderr, "characterise_sd: could not read dblk dir: %s (0x%x)\n",
+            ms_dsp_err(err), err);
+    return err;
+  }
+  scp = (void *) &buf[DBLK_SDCHAR_OFFSET];
+  memset(scp, 0, sizeof(*scp));
+  scp->sdc_sig   = DBLK_SDCHAR_SIG;
+  scp->pwr_us    = 0;                   /* unknown, tag fills it in */
+  scp->wr1_us    = wr1;
+  scp->wrm_us    = wrm;
+  scp->wrm_cnt   = SDC_WRM_CNT;
+  scp->src       = DBLK_SDC_SRC_HOST;
+  scp->sdc_sig_a = DBLK_SDCHAR_SIG;
+  sum = 0;
+  p32 = (void *) scp;
+  for (i = 0; i < DBLK_SDCHAR_QUADS; i++)
+    sum += *p32++;
+  scp->chksum = (uint32_t) (0 - sum);
+  if (verbose)
+    fprintf(stderr, "*** sdchar: wr1: %u uS  wrm: %u uS / %u blks\n",
+            wr1, wrm, SDC_WRM_CNT);
+  err = ms_write_blk(loc.locators[FS_LOC_DBLK].start, buf);
+  if (err)
+    fprintf(stderr, "characterise_sd: could not write dblk dir: %s (0x%x)\n",
+            ms_dsp_err(err), err);
+  return err;
+}
+
+
 int main(int argc, char **argv) {
     int     c;
     int     err;
@@ -283,11 +422,14 @@ int main(int argc, char **argv) {
     u32_t   panic_size;
     int     do_fs_loc;
 
-    while ((c = getopt_long(argc,argv,"c:d:i:p:DfhvVw", longopts, NULL)) != EOF)
+    while ((c = getopt_long(argc,argv,"c:Cd:i:p:DfhvVw", longopts, NULL)) != EOF)
 	switch (c) {
 	  case 'c':
 	      fprintf(stderr, "-c not implemented yet, defaults to 8192\n");
 	      break;
+	  case 'C':
+	      do_char++;
+	      break;
 	  case 'd':
 	      fprintf(stderr, "-d not implemented yet, defaults to 0 (rest of partition)\n");
 	      break;
@@ -324,6 +466,10 @@ int main(int argc, char **argv) {
 	}
     if (optind != argc - 1)
 	usage(argv[0]);
+    if (do_char && !do_write) {
+	fprintf(stderr, "tagfmtsd: -C writes test sectors, needs -w\n");
+	exit(2);
+    }
 
     if (verbose)
 	fprintf(stderr, VERSION);
@@ -428,6 +574,13 @@ int main(int argc, char **argv) {
       }
     }
 
+    if (do_char) {
+      if (verbose)
+        fprintf(stderr, "*** characterising SD\n");
+      if (characterise_sd(buf))
+        fprintf(stderr, "*** SD not characterised\n");
+    }
+
     msc_dblk_nxt = find_dblk_nxt(buf);
     display_info(buf);
 
@@ -501,17 +501,21 @@ implementation {
    * add a gps packet to the data stream.  Debugging etc.
    */
   static void collect_gps_pak(uint8_t *pak, uint16_t len, uint8_t dir) {
-    dt_gps_t hdr;
+    dt_gps_t     *hdrp;
+    collect_rsv_t rsv;
 
     if (call OverWatch.getLoggingFlag(OW_LOG_GPS_RAW)) {
-      hdr.len      = sizeof(hdr) + len;
-      hdr.dtype    = DT_GPS_RAW_SIRFBIN;
-      hdr.mark_us  = 0;
-      hdr.chip_id  = CHIP_GPS_GSD4E;
-      hdr.dir      = dir;
+      /* built in place, straight into the stream buffers */
+      hdrp = (void *) call Collect.reserve(sizeof(*hdrp), len, &rsv);
+      hdrp->len      = sizeof(*hdrp) + len;
+      hdrp->dtype    = DT_GPS_RAW_SIRFBIN;
+      hdrp->mark_us  = 0;
+      hdrp->chip_id  = CHIP_GPS_GSD4E;
+      hdrp->dir      = dir;
+      collect_rsv_fill(&rsv, 0, pak, len);
 
       /* time stamp added by Collect */
-      call Collect.collect((void *) &hdr, sizeof(hdr), pak, len);
+      call Collect.commit((void *) hdrp);
     }
   }
 
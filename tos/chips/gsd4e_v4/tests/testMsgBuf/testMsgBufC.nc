@@ -1,3 +1,5 @@
+#include <slab_arena.h>
+
 configuration testMsgBufC {}
 implementation {
   components testMsgBufP, MainC;
@@ -9,6 +11,9 @@ implementation {
   MsgBufP.Panic      -> PanicC;
   MsgBufP.Rtc        -> PlatformC;
 
+  components SlabArenaC;
+  MsgBufP.SlabArena  -> SlabArenaC.SlabArena[SLAB_OWNER_MSGBUF];
+
   testMsgBufP.MsgReceive -> MsgBufP;
   testMsgBufP.MsgBuf     -> MsgBufP;
   testMsgBufP.Platform   -> PlatformC;
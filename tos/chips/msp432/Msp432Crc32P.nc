@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * Msp432Crc32P: CRC-32 using the msp432 CRC32 module.
+ *
+ * The module is seeded with the running crc (inverted, the module
+ * doesn't do the pre/post inversion) and fed 16 bits at a time with a
+ * possible leading and trailing byte.  Input bits are processed LSB
+ * first which gives us the reflected (zlib) CRC-32.  The CPU feeds the
+ * module directly, OverWatch (the only user) runs before there is
+ * anything else for the CPU to be doing.
+ */
+
+module Msp432Crc32P {
+  provides interface HwCrc32;
+}
+implementation {
+
+  async command uint32_t HwCrc32.crc32(uint32_t crc, uint8_t *buf, uint32_t len) {
+    uint16_t *hp;
+
+    crc = ~crc;
+    CRC32->INIRES32_LO = (uint16_t) crc;
+    CRC32->INIRES32_HI = (uint16_t) (crc >> 16);
+    if (len && ((uint32_t) buf & 1)) {
+      *((volatile uint8_t *) &CRC32->DI32) = *buf++;
+      len--;
+    }
+    hp = (void *) buf;
+    while (len > 1) {
+      CRC32->DI32 = *hp++;
+      len -= 2;
+    }
+    if (len)
+      *((volatile uint8_t *) &CRC32->DI32) = *((uint8_t *) hp);
+    crc = ((uint32_t) CRC32->INIRES32_HI << 16) | CRC32->INIRES32_LO;
+    return ~crc;
+  }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+interface SDreadMulti {
+  /**
+   * SD multi-block read, split phase.
+   *
+   * Reads count contiguous blocks starting at blk as a single
+   * READ_MULTIPLE_BLOCK (CMD18) transaction, terminated with
+   * STOP_TRANSMISSION (CMD12).  Each block's data CRC is checked.
+   *
+   * @input	blk:	 first block to read
+   *		bufs:	 array of count buffer pointers, blk + i lands in
+   *			 bufs[i].  Each must be SD_BLOCKSIZE (512).  The
+   *			 array and the buffers must remain valid until
+   *			 readDone is signalled.
+   *		count:	 number of blocks to read, > 0.
+   *
+   * @return
+   *   <li>SUCCESS if the request was accepted,
+   *   <li>EINVAL  if the parameters are invalid
+   *   <li>EBUSY if a request is already being processed.
+   *
+   * if SUCCESS, it is guaranteed that a future readDone will be signalled.
+   */
+  command error_t read(uint32_t blk, uint8_t **bufs, uint16_t count);
+  event   void    readDone(uint32_t blk, uint8_t **bufs, uint16_t count,
+                           error_t error);
+}
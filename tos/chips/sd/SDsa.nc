@@ -29,4 +29,14 @@ interface SDsa {
   async command void off();
   async command void read(uint32_t blk_id, uint8_t *buf);
   async command void write(uint32_t blk, uint8_t *buf);
+
+  /*
+   * multi-block, one transaction for a run of contiguous blks starting
+   * at blk.  count is a pre-erase hint (0 for none), the run is whatever
+   * write_multi_blk pushes before write_multi_stop.  The buffer handed
+   * to write_multi_blk is free on return.
+   */
+  async command void write_multi_start(uint32_t blk, uint32_t count);
+  async command void write_multi_blk(uint8_t *buf);
+  async command void write_multi_stop();
 }
@@ -40,6 +40,7 @@
 #include "hardware.h"
 #include "sd.h"
 #include "sd_cmd.h"
+#include "sd_crc.h"
 #include <panic.h>
 #include <platform_panic.h>
 
@@ -59,7 +60,9 @@ enum {
 generic module SDspP() {
   provides {
     interface SDread[uint8_t cid];
+    interface SDreadMulti[uint8_t cid];
     interface SDwrite[uint8_t cid];
+    interface SDwriteMulti[uint8_t cid];
     interface SDerase[uint8_t cid];
     interface SDsa;			/* standalone */
     interface SDraw;			/* raw */
@@ -103,6 +106,12 @@ implementation {
     SDS_WRITE_BUSY,
     SDS_ERASE,
     SDS_ERASE_BUSY,
+    SDS_MWRITE_DMA,                     /* multi-block write, sending blk */
+    SDS_MWRITE_BUSY,                    /* multi-block, blk programming   */
+    SDS_MWRITE_STOP,                    /* multi-block, stop tran busy    */
+    SDS_MREAD,                          /* multi-block read, wait token   */
+    SDS_MREAD_DMA,                      /* multi-block read, receiving    */
+    SDS_MREAD_STOP,                     /* multi-block read, CMD12 busy   */
   } sd_state_t;
 
   uint32_t w_t, w_diff;
@@ -131,14 +140,25 @@ implementation {
    * cur_cid   client id of who has requested the activity.
    * data_ptr  buffer pointer if needed.
    * erase_state when erased the default state of a sector
+   * mw_bufs   multi-block read/write, array of buffer pointers
+   * mw_count  multi-block read/write, number of blocks in the transaction
+   * mw_idx    multi-block read/write, which block is currently moving
+   * mw_crc    multi-block write, crc of the block about to move (staged)
+   * mw_staged multi-block write, TRUE if mw_crc is good for mw_idx
+   * sa_mw_blk stand alone multi-block write, next blk to go out
+   * sa_mw_cnt stand alone multi-block write, blks pushed so far
+   * sa_mw     stand alone multi-block write, SA_MW_{NONE,OPEN,BUSY}
    * majik_b   protection tombstone, SD_MAJIK
    *
-   * if sd_state is SDS_IDLE, blk_start, blk_end, cur_cid, and data_ptr are
-   * meaningless.
+   * if sd_state is SDS_IDLE, blk_start, blk_end, cur_cid, data_ptr, and
+   * mw_{bufs,count,idx,crc,staged} are meaningless.
    */
 
 #define SD_MAJIK 0x5aa5
 #define SDSA_MAJIK 0xAAAA5555
+#define SA_MW_NONE 0
+#define SA_MW_OPEN 1
+#define SA_MW_BUSY 2
 #define CID_NONE 0xff;
 
   /*
@@ -157,6 +177,14 @@ implementation {
     uint8_t    cur_cid;			/* current client */
     uint8_t    *data_ptr;
     uint16_t   erase_state;             /* dp, 0x00 or 0xff */
+    uint8_t  **mw_bufs;                 /* multi-block buffers  */
+    uint16_t   mw_count;                /* multi-block, num blks */
+    uint16_t   mw_idx;                  /* multi-block, cur blk  */
+    uint16_t   mw_crc;                  /* multi-block, staged crc */
+    bool       mw_staged;               /* mw_crc good for mw_idx  */
+    uint32_t   sa_mw_blk;               /* SA multi, next blk      */
+    uint32_t   sa_mw_cnt;               /* SA multi, blks pushed   */
+    uint8_t    sa_mw;                   /* SA multi, state         */
     uint16_t   majik_b;
   } sdc;
 
@@ -189,6 +217,24 @@ implementation {
   uint32_t     max_write_time_ms, last_write_delta_ms;
   uint32_t     max_write_time_us, last_write_delta_us;
 
+  uint32_t     max_mwrite_time_ms, last_mwrite_delta_ms;
+  uint32_t     max_mwrite_time_us, last_mwrite_delta_us;
+  uint32_t     max_mwrite_blk_ms;               /* longest single blk */
+  uint32_t     mwrite_blk_t0_ms;                /* start of current blk */
+  uint32_t     mwrite_count;                    /* multi-block transactions */
+  uint32_t     mwrite_blocks;                   /* blocks written via multi */
+
+  norace uint32_t     busy_t0_us;               /* start of current write busy */
+         uint32_t     busy_t0_ms;
+         uint32_t     max_busy_us;              /* longest blk busy, any write */
+         uint32_t     busy_timer_polls;         /* times we backed off to SDtimer */
+         sd_busy_stats_t mw_bstats;             /* last multi-block write */
+
+  uint32_t     max_mread_time_ms, last_mread_delta_ms;
+  uint32_t     max_mread_time_us, last_mread_delta_us;
+  uint32_t     mread_count;                     /* multi-block read transactions */
+  uint32_t     mread_blocks;                    /* blocks read via multi */
+
   uint32_t     max_erase_time_ms, last_erase_delta_ms;
   uint32_t     max_erase_time_us, last_erase_delta_us;
 
@@ -207,6 +253,14 @@ implementation {
   }
 
 
+  /* write busy handling, see Write busy below */
+  task void sd_busy_task();
+  void sd_busy_check();
+  void sd_write_busy_done();
+  void sd_mwrite_busy_done(uint32_t busy_us);
+  void sd_mwrite_done();
+
+
   /*
    * sd_raw_cmd
    *
@@ -232,11 +286,11 @@ implementation {
     uint16_t  i;
     uint8_t   rsp, crc;
 
-    switch (cmd) {
-      case CMD0: crc = 0x95; break;
-      case CMD8: crc = 0x87; break;
-      default:   crc = 0x55; break;
-    }
+    /*
+     * CRC_ON_OFF is turned on once the card is up, so every command
+     * needs a real CRC7.  CMD0 -> 0x95, CMD8 (0x1aa) -> 0x87.
+     */
+    crc = sd_crc7_cmd(cmd, arg);
 
     call HW.spi_check_clean();
 
@@ -422,6 +476,29 @@ implementation {
   }
 
 
+  /*
+   * sd_set_crc
+   *
+   * turn on CRC_ON_OFF (CMD59).  From here on the SD checks the CRC7
+   * on commands and the CRC16 on data blocks we send.  A bad data
+   * CRC shows up as a data response of 0x0B rather than 0x05.
+   *
+   * returns: SUCCESS   crc checking is on
+   *          FAIL      the SD didn't like it
+   */
+  error_t sd_set_crc() {
+    uint8_t rsp;
+
+    call HW.sd_set_cs();
+    rsp = sd_raw_cmd(SD_SET_CRC, 1);
+    call HW.spi_get();
+    call HW.sd_clr_cs();
+    if (rsp)
+      return FAIL;
+    return SUCCESS;
+  }
+
+
   /*
    * sd_get_ocr
    *
@@ -622,15 +699,21 @@ implementation {
     uint8_t   rsp;
 
     switch (sdc.sd_state) {
+      case SDS_WRITE_BUSY:		/* backed off busy poll, see Write busy */
+      case SDS_MWRITE_BUSY:
+      case SDS_MWRITE_STOP:
+        sd_busy_check();
+        return;
+
       default:
       case SDS_ERASE_BUSY:		/* these are various timeout states */
-      case SDS_WRITE_BUSY:		/* the timer went off which shouldn't happen */
-      case SDS_WRITE_DMA:
+      case SDS_WRITE_DMA:		/* the timer went off which shouldn't happen */
       case SDS_READ_DMA:
 	w_t = call lt.get();
 	w_diff = w_t - op_t0_ms;
 	rsp = call HW.spi_get();
-        if (sdc.sd_state == SDS_WRITE_DMA || sdc.sd_state == SDS_READ_DMA)
+        if (sdc.sd_state == SDS_WRITE_DMA || sdc.sd_state == SDS_READ_DMA ||
+            sdc.sd_state == SDS_MWRITE_DMA || sdc.sd_state == SDS_MREAD_DMA)
           call HW.sd_capture_dma_state();
 	call Panic.panic(PANIC_SD, 38, sdc.sd_state, w_diff, 0, 0);
         /* no rtn */
@@ -675,6 +758,11 @@ implementation {
 
 	last_full_reset_time_us = call Platform.usecsRaw() - sd_pwr_on_time_us;
 
+        if (sd_set_crc()) {
+          sd_panic_idle(80, 0);
+          return;
+        }
+
         /*
          * if we haven't filled in the disk parameters, we have a little more
          * work to do.  This is indicated by sdc.blocks being 0.
@@ -788,7 +876,9 @@ implementation {
    */
 
   int sd_check_crc(uint8_t *data, uint16_t crc) {
-    return SUCCESS;
+    if (sd_crc16(data, SD_BLOCKSIZE) == crc)
+      return SUCCESS;
+    return FAIL;
   }
 
 
@@ -797,10 +887,12 @@ implementation {
    *
    * i: data	ptr to 512 bytes of data
    * o: returns 16 bit CRC.
+   *
+   * CRC-16-CCITT, table driven, see sd_crc.h.
    */
 
   uint16_t sd_compute_crc(uint8_t *data) {
-    return 0x5512;
+    return sd_crc16(data, SD_BLOCKSIZE);
   }
 
 
@@ -973,24 +1065,307 @@ implementation {
 
   /************************************************************************
    *
-   * Write
+   * Multi-block Read
+   *
+   * A multi-block read pulls a run of contiguous blocks from the card
+   * using one READ_MULTIPLE_BLOCK (CMD18) transaction.  The card keeps
+   * streaming blocks until told to stop with STOP_TRANSMISSION (CMD12).
+   *
+   *   CMD18(blk)
+   *   [ 0xFE  <512 bytes>  crc(2) ] * count
+   *   CMD12  stuff  R1  busy
    *
+   * CS is held asserted for the entire transaction.  Each block has its
+   * own start token, we wait for it the same way a single block read
+   * does, by reposting the task.  One CMD18 costs about the same as one
+   * CMD17 so a run of n blocks saves n-1 command turnarounds and keeps
+   * the card in its read state.
+   *
+   * State progression:
+   *
+   *   SDS_MREAD      -> SDS_MREAD_DMA  -> (next blk) SDS_MREAD ...
+   *   SDS_MREAD_DMA  -> (last blk)     -> SDS_MREAD_STOP -> SDS_IDLE
    */
 
-  task void sd_write_task() {
-    uint16_t status;
-    uint8_t  tmp;
+  /*
+   * sd_stop_trans: send CMD12 in the middle of a read stream.
+   *
+   * The byte following the command is a stuff byte (it may still be
+   * data) and has to be tossed before we look for the R1.  The caller
+   * holds CS and handles the busy that follows.
+   */
+  uint8_t sd_stop_trans() {
+    uint16_t  i;
+    uint8_t   rsp, crc;
+
+    crc = sd_crc7_cmd(SD_STOP_TRANS, 0);
+
+    call HW.spi_check_clean();
+    call HW.spi_put(SD_STOP_TRANS);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(0);
+    call HW.spi_put(crc);
+    call HW.spi_get();                  /* stuff byte */
+
+    i=0;
+    do {
+      rsp = call HW.spi_get();
+      i++;
+    } while ((rsp & 0x80) && (i < SD_CMD_TIMEOUT));
+
+    if (i >= SD_CMD_TIMEOUT) {
+      sd_panic(81, rsp);
+      return 0xf0;
+    }
+    return rsp;
+  }
+
+
+  void sd_mread_done() {
     uint8_t  cid;
 
-    /* card is busy writing the block.  ask if still busy. */
+    last_mread_delta_us = call Platform.usecsRaw() - op_t0_us;
+    if (last_mread_delta_us > max_mread_time_us)
+      max_mread_time_us = last_mread_delta_us;
+
+    last_mread_delta_ms = call lt.get() - op_t0_ms;
+    if (last_mread_delta_ms > max_mread_time_ms)
+      max_mread_time_ms = last_mread_delta_ms;
+
+    mread_count++;
+    mread_blocks += sdc.mw_count;
+    cid = sdc.cur_cid;
+    sdc.sd_state = SDS_IDLE;
+    sdc.cur_cid = CID_NONE;
+    signal SDreadMulti.readDone[cid](sdc.blk_start, sdc.mw_bufs,
+                                     sdc.mw_count, SUCCESS);
+  }
+
+
+  task void sd_mread_task() {
+    uint8_t tmp;
+
+    if (sdc.sd_state == SDS_MREAD_STOP) {
+      /* CMD12 is R1b, wait for the card to let go of busy */
+      tmp = call HW.spi_get();
+      if (tmp != 0xff) {                /* protected by timeout timer */
+        post sd_mread_task();
+        return;
+      }
+      call SDtimer.stop();
+      call HW.spi_get();                /* extra clocking */
+      call HW.sd_clr_cs();
+      sd_mread_done();
+      return;
+    }
+
+    if (sdc.sd_state != SDS_MREAD)
+      sd_panic(82, sdc.sd_state);
+
+    /* Wait for the token, see sd_read_task */
+    sd_read_tok_count++;
+    tmp = call HW.spi_get();
+
+    if ((tmp & MSK_TOK_DATAERROR) == 0 || sd_read_tok_count >= SD_READ_TOK_MAX) {
+      /* Clock out a byte before returning, let SD finish */
+      call HW.spi_get();
+      call Panic.panic(PANIC_SD, 83, tmp, sd_read_tok_count, sdc.mw_idx, 0);
+      /* no return */
+      return;
+    }
+
+    if (tmp == 0xFF) {
+      post sd_mread_task();
+      return;
+    }
+
+    if (tmp != SD_START_TOK)
+      call Panic.panic(PANIC_SD, 84, tmp, sd_read_tok_count, sdc.mw_idx, 0);
+
+    sdc.data_ptr = sdc.mw_bufs[sdc.mw_idx];
+    if (!sdc.data_ptr)
+      sd_panic(85, sdc.mw_idx);
+    sdc.sd_state = SDS_MREAD_DMA;
+    call HW.spi_check_clean();
+    call HW.sd_dma_enable_int();
+    call HW.sd_start_dma(NULL, sdc.data_ptr, SD_BLOCKSIZE);
+    call SDtimer.startOneShot(SD_SECTOR_XFER_TIMEOUT);
+  }
+
+
+  void sd_mread_dma_handler() {
+    uint16_t crc;
+    uint8_t  rsp;
+
+    if (call HW.sd_dma_active())
+      sd_panic(86, sdc.sd_state);
+    call HW.sd_stop_dma();
+
+    /* crc follows the data, big endian */
+    crc = (call HW.spi_get() << 8) | call HW.spi_get();
+    if (sd_check_crc(sdc.data_ptr, crc)) {
+      call Panic.panic(PANIC_SD, 87, crc, sdc.mw_idx, sdc.blk_start, 0);
+      /* no return */
+      return;
+    }
+
+    if (++sdc.mw_idx < sdc.mw_count) {
+      sd_read_tok_count = 0;
+      sdc.sd_state = SDS_MREAD;
+      post sd_mread_task();
+      return;
+    }
+
+    /* have everything, shut the stream off */
+    if ((rsp = sd_stop_trans())) {
+      call HW.sd_clr_cs();
+      sd_panic_idle(81, rsp);
+      return;
+    }
+    sdc.sd_state = SDS_MREAD_STOP;
+    call SDtimer.startOneShot(SD_SECTOR_XFER_TIMEOUT);
+    post sd_mread_task();
+  }
+
+
+  command error_t SDreadMulti.read[uint8_t cid](uint32_t blk_id,
+                                                uint8_t **bufs, uint16_t count) {
+    uint8_t   rsp;
+
+    if (sdc.sd_state != SDS_IDLE) {
+      sd_panic_idle(47, sdc.sd_state);
+      return EBUSY;
+    }
+
+    if (!bufs || !count)
+      return EINVAL;
+
+    op_t0_us = call Platform.usecsRaw();
+    op_t0_ms = call lt.get();
+
+    sdc.sd_state  = SDS_MREAD;
+    sdc.cur_cid   = cid;
+    sdc.blk_start = blk_id;
+    sdc.blk_end   = blk_id + count - 1;
+    sdc.mw_bufs   = bufs;
+    sdc.mw_count  = count;
+    sdc.mw_idx    = 0;
+
+    if (!sdc.sdhc)
+      blk_id = blk_id << SD_BLOCKSIZE_NBITS;
+
+    /*
+     * CMD18 opens the stream.  Like CMD25 we can't use sd_send_command,
+     * CS has to stay down until the CMD12 is done.
+     */
+    call HW.sd_set_cs();
+    if ((rsp = sd_raw_cmd(SD_READ_MULTI, blk_id))) {
+      call HW.spi_get();
+      call HW.sd_clr_cs();
+      sd_panic_idle(48, rsp);
+      return FAIL;
+    }
+    sd_read_tok_count = 0;
+    post sd_mread_task();
+    return SUCCESS;
+  }
+
+
+  /************************************************************************
+   *
+   * Write busy
+   *
+   * Once the card has taken a block (data response 0x05) it holds DO low
+   * while it programs.  Spinning on this from a self posting task keeps
+   * the cpu awake and hogs the task queue for the whole program time.
+   * Instead we look SD_BUSY_SPIN_POLLS times from a task, short programs
+   * finish in there, then back off and let SDtimer look every
+   * SD_BUSY_POLL_TIME ms.  SD_WRITE_BUSY_TIMEOUT bounds the total.
+   *
+   * Used by single block writes (SDS_WRITE_BUSY), and multi-block writes,
+   * both the per block program (SDS_MWRITE_BUSY) and the busy following
+   * the Stop Tran (SDS_MWRITE_STOP).
+   *
+   * Busy time per block is measured from the data response to busy
+   * release, see sd_busy_stats_t.
+   */
+
+  void sd_busy_start() {
+    sd_write_busy_count = 0;
+    busy_t0_us = call Platform.usecsRaw();
+    busy_t0_ms = call lt.get();
+    post sd_busy_task();
+  }
+
+
+  void sd_busy_check() {
+    uint32_t busy_us;
+    uint8_t  tmp;
 
     tmp = call HW.spi_get();
     sd_write_busy_count++;
-    if (tmp != 0xff) {			/* protected by timeout timer */
-      post sd_write_task();
+    if (tmp != 0xff) {
+      if (sd_write_busy_count < SD_BUSY_SPIN_POLLS) {
+        post sd_busy_task();
+        return;
+      }
+      w_diff = call lt.get() - busy_t0_ms;
+      if (w_diff > SD_WRITE_BUSY_TIMEOUT) {
+        call Panic.panic(PANIC_SD, 38, sdc.sd_state, w_diff, 0, 0);
+        /* no rtn */
+        return;
+      }
+      busy_timer_polls++;
+      if (sdc.sd_state == SDS_MWRITE_BUSY)
+        mw_bstats.timer_polls++;
+      call SDtimer.startOneShot(SD_BUSY_POLL_TIME);
       return;
     }
-    call SDtimer.stop();		/* write busy done, kill timeout timer */
+
+    busy_us = call Platform.usecsRaw() - busy_t0_us;
+    switch (sdc.sd_state) {
+      case SDS_WRITE_BUSY:
+        if (busy_us > max_busy_us)
+          max_busy_us = busy_us;
+        sd_write_busy_done();
+        return;
+
+      case SDS_MWRITE_BUSY:
+        if (busy_us > max_busy_us)
+          max_busy_us = busy_us;
+        sd_mwrite_busy_done(busy_us);
+        return;
+
+      case SDS_MWRITE_STOP:
+        call HW.spi_get();              /* extra clocking */
+        call HW.sd_clr_cs();
+        sd_mwrite_done();
+        return;
+
+      default:
+        sd_panic(73, sdc.sd_state);
+        return;
+    }
+  }
+
+
+  task void sd_busy_task() {
+    sd_busy_check();
+  }
+
+
+  /************************************************************************
+   *
+   * Write
+   *
+   */
+
+  void sd_write_busy_done() {
+    uint16_t status;
+    uint8_t  cid;
+
     call HW.spi_get();                  /* extra clocking */
     call HW.sd_clr_cs();
 
@@ -1043,14 +1418,10 @@ implementation {
 
     /*
      * the SD goes busy until the block is written.  (busy is data out low).
-     * we poll using a task.
-     *
-     * We also start up a timeout timer to protect against hangs.
+     * see Write busy above.
      */
-    sd_write_busy_count = 0;
     sdc.sd_state = SDS_WRITE_BUSY;
-    call SDtimer.startOneShot(SD_WRITE_BUSY_TIMEOUT);
-    post sd_write_task();
+    sd_busy_start();
   }
 
 
@@ -1102,6 +1473,235 @@ implementation {
 
 
 
+  /************************************************************************
+   *
+   * Multi-block Write
+   *
+   * A multi-block write streams a run of contiguous blocks to the card
+   * using one WRITE_MULTIPLE_BLOCK (CMD25) transaction.  Prior to the
+   * CMD25 we tell the card how many blocks are coming via
+   * SET_WR_BLK_ERASE_COUNT (ACMD23) which lets the card pre-erase the
+   * space.  This is only a hint, the transaction is always terminated
+   * with the Stop Tran token.
+   *
+   *   ACMD23(count)
+   *   CMD25(blk)
+   *   [ 0xFC  <512 bytes>  crc(2)  data_rsp  busy ] * count
+   *   0xFD  (stop tran)  busy
+   *
+   * CS is held asserted for the entire transaction.  The card goes busy
+   * after each block while it programs, see Write busy above.
+   *
+   * Writes are pipelined.  The data line is tied up while the card is
+   * busy so the next block can't go out until busy releases, but
+   * everything else for it can be done in the shadow of the program
+   * time.  While blk N programs we stage blk N+1 (buffer check and crc)
+   * so on busy release all that is left is the start token and firing the
+   * dma.  The crc for the first blk is computed while its dma runs.
+   *
+   * State progression:
+   *
+   *   SDS_MWRITE_DMA  -> SDS_MWRITE_BUSY -> (next blk) SDS_MWRITE_DMA ...
+   *   SDS_MWRITE_BUSY -> (last blk)      -> SDS_MWRITE_STOP -> SDS_IDLE
+   */
+
+  void sd_mwrite_start_blk() {
+    sdc.data_ptr = sdc.mw_bufs[sdc.mw_idx];
+    if (!sdc.data_ptr)
+      sd_panic(71, sdc.mw_idx);
+    mwrite_blk_t0_ms = call lt.get();
+
+    call HW.spi_put(SD_TOK_WRITE_STARTBLOCK_M);
+    sdc.sd_state = SDS_MWRITE_DMA;
+    call HW.spi_check_clean();
+    call HW.sd_dma_enable_int();
+    call HW.sd_start_dma(sdc.data_ptr, NULL, SD_BLOCKSIZE);
+    call SDtimer.startOneShot(SD_SECTOR_XFER_TIMEOUT);
+    if (!sdc.mw_staged) {
+      /* first blk, nothing staged.  crc while the dma runs. */
+      sdc.mw_crc = sd_compute_crc(sdc.data_ptr);
+      sdc.mw_staged = TRUE;
+    }
+  }
+
+
+  /*
+   * stage the next blk while the card is busy programming the current
+   * one.  Buffers are required to stay put until writeDone so the crc
+   * is good when the blk goes out.
+   */
+  void sd_mwrite_stage() {
+    uint8_t *nxt;
+
+    sdc.mw_staged = FALSE;
+    if (sdc.mw_idx + 1 >= sdc.mw_count)
+      return;
+    nxt = sdc.mw_bufs[sdc.mw_idx + 1];
+    if (!nxt)
+      sd_panic(71, sdc.mw_idx + 1);
+    sdc.mw_crc = sd_compute_crc(nxt);
+    sdc.mw_staged = TRUE;
+  }
+
+
+  void sd_mwrite_done() {
+    uint16_t status;
+    uint8_t  cid;
+
+    status = sd_read_status();
+    if (status)
+      sd_panic(72, status);
+
+    last_mwrite_delta_us = call Platform.usecsRaw() - op_t0_us;
+    if (last_mwrite_delta_us > max_mwrite_time_us)
+      max_mwrite_time_us = last_mwrite_delta_us;
+
+    last_mwrite_delta_ms = call lt.get() - op_t0_ms;
+    if (last_mwrite_delta_ms > max_mwrite_time_ms)
+      max_mwrite_time_ms = last_mwrite_delta_ms;
+
+    mwrite_count++;
+    mwrite_blocks += sdc.mw_count;
+    cid = sdc.cur_cid;
+    sdc.sd_state = SDS_IDLE;
+    sdc.cur_cid = CID_NONE;
+    signal SDwriteMulti.writeDone[cid](sdc.blk_start, sdc.mw_bufs,
+                                       sdc.mw_count, SUCCESS);
+  }
+
+
+  /* blk mw_idx has finished programming */
+  void sd_mwrite_busy_done(uint32_t busy_us) {
+    uint32_t blk_ms;
+
+    mw_bstats.count++;
+    mw_bstats.total_us += busy_us;
+    if (busy_us < mw_bstats.min_us)
+      mw_bstats.min_us = busy_us;
+    if (busy_us > mw_bstats.max_us)
+      mw_bstats.max_us = busy_us;
+
+    blk_ms = call lt.get() - mwrite_blk_t0_ms;
+    if (blk_ms > max_mwrite_blk_ms)
+      max_mwrite_blk_ms = blk_ms;
+    if (blk_ms > SD_WRITE_WARN_THRESHOLD) {
+      call Panic.warn(PANIC_SD, 50, sdc.blk_start + sdc.mw_idx, blk_ms, 0, 0);
+      /* no return */
+    }
+
+    if (++sdc.mw_idx < sdc.mw_count) {
+      sd_mwrite_start_blk();            /* already staged */
+      return;
+    }
+
+    /*
+     * all blocks sent.  Send the Stop Tran token.  The card takes one
+     * byte time and then goes busy while it finishes up.
+     */
+    call HW.spi_put(SD_TOK_STOP_MULTI);
+    call HW.spi_get();
+    sdc.sd_state = SDS_MWRITE_STOP;
+    sd_busy_start();
+  }
+
+
+  void sd_mwrite_dma_handler() {
+    uint8_t  tmp;
+    uint16_t status, crc;
+
+    if (call HW.sd_dma_active())
+      sd_panic(74, sdc.sd_state);
+    call HW.sd_stop_dma();              /* clean out any pending residuals */
+
+    /* crc is the next two bytes out, big endian, staged */
+    crc = sdc.mw_crc;
+    call HW.spi_put((crc >> 8) & 0xff);
+    call HW.spi_put(crc & 0xff);
+
+    /*
+     * each block gets its own data response token.  0x05 says all is
+     * good.  Anything else and the card has aborted the transaction.
+     */
+    tmp = call HW.spi_get();
+    if ((tmp & 0x1F) != 0x05) {
+      status = sd_read_status();
+      call Panic.panic(PANIC_SD, 75, tmp, status, sdc.mw_idx, 0);
+      /* no return */
+      return;
+    }
+
+    /* card is now busy programming, get the next blk ready meanwhile */
+    sdc.sd_state = SDS_MWRITE_BUSY;
+    sd_busy_start();
+    sd_mwrite_stage();
+  }
+
+
+  command error_t SDwriteMulti.write[uint8_t cid](uint32_t blk_id,
+                                                  uint8_t **bufs, uint16_t count) {
+    uint8_t   rsp;
+
+    if (sdc.sd_state != SDS_IDLE) {
+      sd_panic_idle(76, sdc.sd_state);
+      return EBUSY;
+    }
+
+    if (!bufs || !count)
+      return EINVAL;
+
+    op_t0_us = call Platform.usecsRaw();
+    op_t0_ms = call lt.get();
+
+    sdc.sd_state  = SDS_WRITE;
+    sdc.cur_cid   = cid;
+    sdc.blk_start = blk_id;
+    sdc.blk_end   = blk_id + count - 1;
+    sdc.mw_bufs   = bufs;
+    sdc.mw_count  = count;
+    sdc.mw_idx    = 0;
+    sdc.mw_staged = FALSE;
+
+    mw_bstats.blk         = blk_id;
+    mw_bstats.count       = 0;
+    mw_bstats.timer_polls = 0;
+    mw_bstats.min_us      = (uint32_t) -1;
+    mw_bstats.max_us      = 0;
+    mw_bstats.total_us    = 0;
+
+    /* pre-erase hint, number of blocks about to be written */
+    if ((rsp = sd_send_acmd(SD_SET_PRE_ERASE, count))) {
+      sd_panic_idle(77, rsp);
+      return FAIL;
+    }
+
+    if (!sdc.sdhc)
+      blk_id = blk_id << SD_BLOCKSIZE_NBITS;
+
+    /*
+     * CMD25 opens the transaction.  We can't use sd_send_command
+     * because it deasserts CS, and the data blocks need to follow
+     * the command directly.
+     */
+    call HW.sd_set_cs();
+    if ((rsp = sd_raw_cmd(SD_WRITE_MULTI, blk_id))) {
+      call HW.spi_get();
+      call HW.sd_clr_cs();
+      sd_panic_idle(78, rsp);
+      return FAIL;
+    }
+    call HW.spi_get();                  /* sandisk needs this */
+
+    sd_mwrite_start_blk();
+    return SUCCESS;
+  }
+
+
+  command void SDwriteMulti.busy_stats[uint8_t cid](sd_busy_stats_t *bsp) {
+    if (bsp)
+      *bsp = mw_bstats;
+  }
+
+
   /************************************************************************
    *
    * SDerase.erase
@@ -1283,6 +1883,8 @@ implementation {
 
     if (rsp & MSK_IDLE)
       sd_panic(59, sa_op_cnt);
+    if (sd_set_crc())
+      return sdsa_abort(FAIL);
     if (sdc.blocks == 0)
       sd_get_disk_params();
     return SUCCESS;
@@ -1293,6 +1895,7 @@ implementation {
     call HW.sd_spi_disable();
     call HW.sd_off();
     sdc.sdsa_majik = 0;
+    sdc.sa_mw = SA_MW_NONE;
   }
 
 
@@ -1354,9 +1957,29 @@ implementation {
   }
 
 
+  /*
+   * SA write busy.  While programming, the card holds the data line low.
+   * Wait until we see one full byte of 1's to indicate not busy.
+   */
+  void sdsa_busy_wait() {
+    uint8_t  tmp;
+    uint32_t t, last_time;
+
+    last_time = call Platform.usecsRaw();
+    sd_write_busy_count = 0;
+    do {				/* count how many iterations and time */
+      sd_write_busy_count++;
+      tmp =  call HW.spi_get();
+      if (tmp == 0xFF)                  /* wait for data line to be deasserted */
+	break;
+      if (((t = call Platform.usecsRaw()) - last_time) > SD_WR_TIMEOUT)
+        call Panic.panic(PANIC_SD, 65, t, last_time, 0, 0);
+    } while (1);
+  }
+
+
   async command void SDsa.write(uint32_t blk_id, uint8_t *buf) {
     uint8_t   rsp, tmp;
-    uint32_t  t, last_time;
     uint16_t  crc, status;
 
     crc = sd_compute_crc(buf);
@@ -1397,21 +2020,7 @@ implementation {
      * We get usec raw time from Platform.usecsRaw().  We will timeout the
      * write if we exceed ~300ms (see SD_WR_TIMEOUT in sd.h).
      */
-    last_time = call Platform.usecsRaw();
-    sd_write_busy_count = 0;
-
-    /*
-     * while busy writing, card is indicating busy, Data line low.  Wait until
-     * we see one full byte of 1's to indicate not busy.
-     */
-    do {				/* count how many iterations and time */
-      sd_write_busy_count++;
-      tmp =  call HW.spi_get();
-      if (tmp == 0xFF)                  /* wait for data line to be deasserted */
-	break;
-      if (((t = call Platform.usecsRaw()) - last_time) > SD_WR_TIMEOUT)
-        call Panic.panic(PANIC_SD, 65, t, last_time, 0, 0);
-    } while (1);
+    sdsa_busy_wait();
 
     call HW.spi_get();                  /* extra clocks */
     call HW.sd_clr_cs();		/* deassert. */
@@ -1421,6 +2030,101 @@ implementation {
   }
 
 
+  /*
+   * SDsa multi-block write.
+   *
+   * Same CMD25 transaction as SDwriteMulti but run to completion with a
+   * single buffer.  Panic uses it to lay down the RAM section without
+   * paying for a command and a full program cycle per sector.
+   *
+   *   write_multi_start:  ACMD23(count) pre-erase hint, CMD25(blk).  CS
+   *                       stays asserted until write_multi_stop.
+   *   write_multi_blk:    0xFC <512 bytes> crc data_rsp.  Returns as soon
+   *                       as the card takes the blk, while it is still
+   *                       busy programming.  The buffer is free.
+   *   write_multi_stop:   0xFD (stop tran), wait busy, deassert.
+   *
+   * Busy from the previous blk is waited out at the front of the next
+   * write_multi_blk (or the stop) so the caller gets to build its next
+   * sector in the shadow of the program time.
+   */
+  async command void SDsa.write_multi_start(uint32_t blk_id, uint32_t count) {
+    uint8_t rsp;
+
+    if (sdc.sa_mw != SA_MW_NONE)
+      sd_panic(89, sdc.sa_mw_blk);
+
+    if (count && (rsp = sd_send_acmd(SD_SET_PRE_ERASE, count)))
+      sd_panic(89, rsp);
+
+    sdc.sa_mw_blk = blk_id;
+    sdc.sa_mw_cnt = 0;
+    if (!sdc.sdhc)
+      blk_id = blk_id << SD_BLOCKSIZE_NBITS;
+
+    call HW.sd_set_cs();
+    if ((rsp = sd_raw_cmd(SD_WRITE_MULTI, blk_id))) {
+      call HW.spi_get();
+      call HW.sd_clr_cs();
+      sd_panic(90, rsp);
+      return;
+    }
+    call HW.spi_get();                  /* sandisk needs this */
+    sdc.sa_mw = SA_MW_OPEN;
+  }
+
+
+  async command void SDsa.write_multi_blk(uint8_t *buf) {
+    uint8_t  tmp;
+    uint16_t crc, status;
+
+    if (sdc.sa_mw == SA_MW_NONE)
+      sd_panic(91, 0);
+
+    crc = sd_compute_crc(buf);          /* while the last blk programs */
+    if (sdc.sa_mw == SA_MW_BUSY)
+      sdsa_busy_wait();
+
+    call HW.spi_put(SD_TOK_WRITE_STARTBLOCK_M);
+    call HW.spi_check_clean();
+    call HW.sd_start_dma(buf, NULL, SD_BLOCKSIZE);
+    call HW.sd_wait_dma(SD_BLOCKSIZE);
+    call HW.spi_put((crc >> 8) & 0xff);
+    call HW.spi_put(crc & 0xff);
+
+    tmp = call HW.spi_get();
+    if ((tmp & 0x1F) != 0x05) {
+      status = sd_read_status();
+      call Panic.panic(PANIC_SD, 91, tmp, status, sdc.sa_mw_cnt, sdc.sa_mw_blk);
+      return;
+    }
+    sdc.sa_mw_blk++;
+    sdc.sa_mw_cnt++;
+    sdc.sa_mw = SA_MW_BUSY;
+  }
+
+
+  async command void SDsa.write_multi_stop() {
+    uint16_t status;
+
+    if (sdc.sa_mw == SA_MW_NONE)
+      return;
+    if (sdc.sa_mw == SA_MW_BUSY)
+      sdsa_busy_wait();
+
+    call HW.spi_put(SD_TOK_STOP_MULTI);
+    call HW.spi_get();                  /* busy shows up a byte later */
+    sdsa_busy_wait();
+
+    call HW.spi_get();                  /* extra clocks */
+    call HW.sd_clr_cs();		/* deassert. */
+    sdc.sa_mw = SA_MW_NONE;
+    status = sd_read_status();
+    if (status)
+      call Panic.panic(PANIC_SD, 66, status, sdc.sa_mw_blk, sdc.sa_mw_cnt, 0);
+  }
+
+
   /*************************************************************************
    *
    * SDraw: raw interface to SD card from test programs.
@@ -1687,6 +2391,14 @@ implementation {
 	sd_write_dma_handler();
 	break;
 
+      case SDS_MWRITE_DMA:
+	sd_mwrite_dma_handler();
+	break;
+
+      case SDS_MREAD_DMA:
+	sd_mread_dma_handler();
+	break;
+
       default:
 	sd_panic(67, sdc.sd_state);
 	break;
@@ -1718,11 +2430,23 @@ implementation {
   }
 
 
+  default event void SDreadMulti.readDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                      uint16_t count, error_t error) {
+    sd_panic(88, cid);
+  }
+
+
   default event void SDwrite.writeDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t error) {
     sd_panic(69, cid);
   }
 
 
+  default event void SDwriteMulti.writeDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                        uint16_t count, error_t error) {
+    sd_panic(79, cid);
+  }
+
+
   default event void SDerase.eraseDone[uint8_t cid](uint32_t blk_start, uint32_t blk_end, error_t error) {
     sd_panic(70, cid);
   }
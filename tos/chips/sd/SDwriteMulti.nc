@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#include "sd.h"
+
+interface SDwriteMulti {
+  /**
+   * SD multi-block write, split phase.
+   *
+   * Writes count contiguous blocks starting at blk as a single
+   * WRITE_MULTIPLE_BLOCK (CMD25) transaction.  The card is told how many
+   * blocks are coming (ACMD23, pre-erase) so it can prepare the erase
+   * units ahead of time.
+   *
+   * @input	blk:	 first block to write
+   *		bufs:	 array of count buffer pointers, bufs[i] is written
+   *			 to blk + i.  Each must be SD_BLOCKSIZE (512).  The
+   *			 array and the buffers must remain valid until
+   *			 writeDone is signalled.
+   *		count:	 number of blocks to write, > 0.
+   *
+   * @return
+   *   <li>SUCCESS if the request was accepted,
+   *   <li>EINVAL  if the parameters are invalid
+   *   <li>EBUSY if a request is already being processed.
+   *
+   * if SUCCESS, it is guaranteed that a future writeDone will be signalled.
+   */
+  command error_t write(uint32_t blk, uint8_t **bufs, uint16_t count);
+  event   void    writeDone(uint32_t blk, uint8_t **bufs, uint16_t count,
+                            error_t error);
+
+  /**
+   * busy_stats: program busy statistics for the last multi-block write.
+   *
+   * Per block card busy times (min/max/total uS) for the most recently
+   * completed transaction.  Typically called from writeDone.
+   *
+   * @input	bsp:	 where to put them, see sd.h.
+   */
+  command void    busy_stats(sd_busy_stats_t *bsp);
+}
@@ -116,6 +116,35 @@
 #define SD_ERASE_BUSY_TIMEOUT	20480
 
 
+/*
+ * Write busy polling.
+ *
+ * When the card goes busy programming a block we first look from a task,
+ * SD_BUSY_SPIN_POLLS times.  Short programs finish in there.  After that
+ * we back off and let SDtimer look every SD_BUSY_POLL_TIME ms, the cpu
+ * is free to do other things (or sleep) in between.  SD_WRITE_BUSY_TIMEOUT
+ * still bounds the whole thing.
+ */
+#define SD_BUSY_SPIN_POLLS	64
+#define SD_BUSY_POLL_TIME	1
+
+
+/*
+ * busy statistics for the last multi-block write, see
+ * SDwriteMulti.busy_stats.  Times are in uS, per block, measured from
+ * the data response to busy release.  timer_polls counts how many times
+ * we had to back off to SDtimer.
+ */
+typedef struct {
+  uint32_t blk;                         /* first blk of the transaction */
+  uint16_t count;                       /* blks programmed */
+  uint16_t timer_polls;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t total_us;
+} sd_busy_stats_t;
+
+
 /*
  * Definitions for each of the SD registers
  */
@@ -101,7 +101,8 @@ implementation {
 
 
   command bool DblkNote.set_value(tagnet_dblk_note_t *db, uint32_t *lenp) {
-    dt_note_t    note_block;
+    dt_note_t    *notep;
+    collect_rsv_t rsv;
 
     if (!db || !lenp)
       call Panic.panic(0, 0, 0, 0, 0, 0);
@@ -124,10 +125,11 @@ implementation {
     }
 
     ++dblk_notes_count;
-    note_block.len = *lenp + sizeof(note_block);
-    note_block.dtype = DT_NOTE;
-    call Collect.collect((void *) &note_block, sizeof(note_block),
-                         db->block, *lenp);
+    notep = (void *) call Collect.reserve(sizeof(*notep), *lenp, &rsv);
+    notep->len = *lenp + sizeof(*notep);
+    notep->dtype = DT_NOTE;
+    collect_rsv_fill(&rsv, 0, db->block, *lenp);
+    call Collect.commit((void *) notep);
     db->count  = dblk_notes_count;
     *lenp = 0;
     return TRUE;
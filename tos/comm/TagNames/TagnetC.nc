@@ -22,6 +22,9 @@ configuration TagnetC {
     interface             TagnetAdapter<tagnet_block_t>     as RadioStats;
     interface             TagnetAdapter<uint32_t>           as DblkCommittedOffset;
     interface             TagnetAdapter<uint32_t>           as DblkResyncOffset;
+    interface             TagnetAdapter<uint32_t>           as DblkSeekRecNum;
+    interface             TagnetAdapter<tagnet_block_t>     as DblkCacheStats;
+    interface             TagnetAdapter<uint32_t>           as DblkPrevSync;
     interface             TagnetAdapter<uint32_t>           as DblkLastRecOffset;
     interface      TagnetSysExecAdapter                     as SysNIB;
     interface             TagnetAdapter<int32_t>            as PollCount;
@@ -91,6 +94,9 @@ implementation {
     components new  TagnetUnsignedAdapterP ( TN_38_ID )        as   tn_38_Vx;
     components new  TagnetUnsignedAdapterP ( TN_39_ID )        as   tn_39_Vx;
     components new  TagnetUnsignedAdapterP ( TN_40_ID )        as   tn_40_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_41_ID )        as   tn_41_Vx;
+    components new     TagnetBlockAdapterP ( TN_42_ID )        as   tn_42_Vx;
+    components new  TagnetUnsignedAdapterP ( TN_43_ID )        as   tn_43_Vx;
 
     Tagnet           =     tn_0_Vx;
        tn_1_Vx.Super ->     tn_0_Vx.Sub[unique(TN_0_UQ)];
@@ -160,4 +166,10 @@ implementation {
     DblkLastSyncOffset  =     tn_39_Vx.Adapter;
       tn_40_Vx.Super ->     tn_4_Vx.Sub[unique(TN_4_UQ)];
     DblkResyncOffset  =     tn_40_Vx.Adapter;
+      tn_41_Vx.Super ->     tn_4_Vx.Sub[unique(TN_4_UQ)];
+    DblkSeekRecNum   =     tn_41_Vx.Adapter;
+      tn_42_Vx.Super ->     tn_4_Vx.Sub[unique(TN_4_UQ)];
+    DblkCacheStats   =     tn_42_Vx.Adapter;
+      tn_43_Vx.Super ->     tn_4_Vx.Sub[unique(TN_4_UQ)];
+    DblkPrevSync     =     tn_43_Vx.Adapter;
 }
@@ -42,7 +42,10 @@ typedef enum {                   //      (parent) name
   TN_38_ID              =    38, //  (   dblk   ) .last_rec
   TN_39_ID              =    39, //  (   dblk   ) .last_sync
   TN_40_ID              =    40, //  (   dblk   ) .resync
-  TN_LAST_ID            =    41,
+  TN_41_ID              =    41, //  (   dblk   ) .seek
+  TN_42_ID              =    42, //  (   dblk   ) .cache
+  TN_43_ID              =    43, //  (   dblk   ) .prev_sync
+  TN_LAST_ID            =    44,
   TN_ROOT_ID            =     0,
   TN_MAX_ID             =  65000,
 } tn_ids_t;
@@ -88,6 +91,9 @@ typedef enum {                   //      (parent) name
 #define  TN_38_UQ                "TN_38_UQ"
 #define  TN_39_UQ                "TN_39_UQ"
 #define  TN_40_UQ                "TN_40_UQ"
+#define  TN_41_UQ                "TN_41_UQ"
+#define  TN_42_UQ                "TN_42_UQ"
+#define  TN_43_UQ                "TN_43_UQ"
 #define UQ_TAGNET_ADAPTER_LIST  "UQ_TAGNET_ADAPTER_LIST"
 #define UQ_TN_ROOT               TN_0_UQ
 /* structure used to hold configuration values for each of the elements
@@ -142,5 +148,8 @@ const TN_data_t tn_name_data_descriptors[TN_LAST_ID]={
   { TN_38_ID, "\01\011.last_rec", "\01\026TagnetAdapter.uint32_t", TN_38_UQ },
   { TN_39_ID, "\01\012.last_sync", "\01\026TagnetAdapter.uint32_t", TN_39_UQ },
   { TN_40_ID, "\01\07.resync", "\01\026TagnetAdapter.uint32_t", TN_40_UQ },
+  { TN_41_ID, "\01\05.seek", "\01\026TagnetAdapter.uint32_t", TN_41_UQ },
+  { TN_42_ID, "\01\06.cache", "\01\013dmf_stats_t", TN_42_UQ },
+  { TN_43_ID, "\01\012.prev_sync", "\01\026TagnetAdapter.uint32_t", TN_43_UQ },
 };
 
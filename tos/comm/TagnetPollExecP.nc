@@ -138,6 +138,7 @@ implementation {
   command bool PollEvent.get_value(message_t *msg, uint32_t *l) {
     poll_req_t     poll_params = {0,0,0,0,0,0,0,0};
     dt_header_t    dt_hdr;
+    collect_seg_t  iov[2];
     uint16_t       delay;
 
     nop();                            /* BRK */
@@ -146,9 +147,11 @@ implementation {
         poll_count++;
         dt_hdr.len = call THdr.get_message_len(msg) + sizeof(dt_hdr);
         dt_hdr.dtype = DT_TAGNET;
-        call Collect.collect(&dt_hdr, sizeof(dt_hdr),
-                             (uint8_t *) msg,
-                             call THdr.get_message_len(msg));
+        iov[0].buf = (void *) &dt_hdr;
+        iov[0].len = sizeof(dt_hdr);
+        iov[1].buf = (uint8_t *) msg;   /* straight out of the msg buffer */
+        iov[1].len = call THdr.get_message_len(msg);
+        call Collect.collect_iov(iov, 2);
         get_params(&poll_params, msg);
         call TPload.reset_payload(msg);
         call THdr.set_response(msg);
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HwCrc32: CRC-32 done by a hardware CRC engine.
+ *
+ * zlib compatible (reflected 0x04c11db7, pre and post inverted).  crc is
+ * the running value, start with 0 and feed the result of one call into
+ * the next to crc something in pieces.
+ */
+
+interface HwCrc32 {
+  async command uint32_t crc32(uint32_t crc, uint8_t *buf, uint32_t len);
+}
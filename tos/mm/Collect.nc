@@ -20,6 +20,7 @@
  */
 
 #include <typed_data.h>
+#include <collect.h>
 
 interface Collect {
   command void collect(dt_header_t *header, uint16_t hlen,
@@ -29,8 +30,52 @@ interface Collect {
   command void collect_nots(dt_header_t *header, uint16_t hlen,
                             uint8_t     *data,   uint16_t dlen);
 
+  /*
+   * collect_iov: collect a record described by a list of areas.
+   *
+   * iov[0] is the header (aligned(4), quad granular length) followed by
+   * niov - 1 data areas, laid down back to back.  header->len must match
+   * the total of all the areas.  Layout is the same as collect with the
+   * data concatenated.  niov <= COLLECT_MAX_IOV.  Time stamped like
+   * collect.
+   */
+  command void collect_iov(collect_seg_t *iov, uint16_t niov);
+
+  /*
+   * reserve/commit: zero-copy record building.
+   *
+   * reserve sets aside hlen + dlen bytes at the current end of the
+   * record stream and returns a pointer to where the header should be
+   * built.  The data area is described by rsv (see collect.h) and points
+   * directly into the underlying sector buffers.  The producer fills in
+   * the header (len, dtype, and any type specific fields) and the data,
+   * then calls commit.  commit stamps the time, recnum, hdr_crc8, and
+   * recsum and hands the record to the stream.
+   *
+   * reserve and commit must be called from the same task invocation.
+   * No other collect may be done while a reservation is outstanding.
+   *
+   * hlen has the same constraints as collect (quad granular, <=
+   * DT_MAX_HEADER) and hlen + dlen <= DT_MAX_RLEN.
+   */
+  command dt_header_t *reserve(uint16_t hlen, uint16_t dlen, collect_rsv_t *rsv);
+  command void         commit(dt_header_t *header);
+
   async command uint32_t buf_offset();
 
+  /*
+   * close_sector: close out the sector currently being filled.
+   *
+   * Lays down a SYNC_FLUSH, which tells readers the rest of the sector
+   * is padding, and hands the sector to SSW even though it isn't full.
+   * The next record starts on the following sector.  Used by SSW to
+   * bound how long data sits in RAM.
+   *
+   * returns TRUE if a sector was closed, FALSE if nothing to close (or a
+   * reservation is outstanding).
+   */
+  command bool close_sector();
+
   /* signal on Boot that Collect is happy and up */
   event void collectBooted();
 }
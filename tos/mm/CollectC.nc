@@ -32,6 +32,8 @@ configuration CollectC {
     interface TagnetAdapter<uint32_t> as DblkLastSyncOffset;
     interface TagnetAdapter<uint32_t> as DblkCommittedOffset;
     interface TagnetAdapter<uint32_t> as DblkResyncOffset;
+    interface TagnetAdapter<uint32_t> as DblkSeekRecNum;
+    interface TagnetAdapter<uint32_t> as DblkPrevSync;
   }
   uses {
     interface Boot;                     /* in  boot */
@@ -41,6 +43,7 @@ configuration CollectC {
 implementation {
   enum {
     RESYNC_CID = unique("Resync.cid"),
+    INDEX_CID  = unique("DblkIndex.cid"),
   };
 
   components MainC, SystemBootC, CollectP;
@@ -63,6 +66,8 @@ implementation {
   DblkLastSyncOffset  = CollectP.DblkLastSyncOffset;
   DblkCommittedOffset = CollectP.DblkCommittedOffset;
   DblkResyncOffset    = CollectP.DblkResyncOffset;
+  DblkSeekRecNum      = CollectP.DblkSeekRecNum;
+  DblkPrevSync        = CollectP.DblkPrevSync;
 
   components new TimerMilliC() as SyncTimerC;
   CollectP.SyncTimer -> SyncTimerC;
@@ -77,6 +82,9 @@ implementation {
   components ResyncC;
   CollectP.Resync -> ResyncC.Resync[RESYNC_CID];
 
+  components DblkIndexC;
+  CollectP.DblkIndex -> DblkIndexC.DblkIndex[INDEX_CID];
+
   components Crc8C;
   CollectP.Crc8 -> Crc8C;
 
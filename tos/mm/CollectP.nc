@@ -57,6 +57,15 @@
  * Collect is responsible for managing prev_sync file offsets.  This a
  * combination of blk_id and byte offset within the buffer of the SYNC or
  * REBOOT being lay'd down.
+ *
+ * Collect also lays down INDEX records, one near the front of each span
+ * of INDEX_SECTORS sectors.  Each carries the SYNCs laid down since the
+ * previous INDEX.  See typed_data.h and DblkIndexP for how they get used.
+ *
+ * Records are sorted into lanes, critical and bulk (collect_lane).  The
+ * lane doesn't change where a record goes, it still lands right behind
+ * the one before it.  It tells SSW how long the record can wait to get
+ * to the SD, see stream_storage.h.
  */
 
 #include <core_rev.h>
@@ -65,6 +74,8 @@
 #include <overwatch.h>
 #include <stream_storage.h>
 #include <sd.h>
+#include <collect.h>
+#include <copy_sum.h>
 
 /*
  * Data Collector (dc) control structure
@@ -81,7 +92,19 @@
  * last_rec_offset:     file offset of last record laid down
  * last_sync_offset:    file offset of last REBOOT/SYNC laid down
  * bufs_to_next_sync:   number of buffers/sectors before we do next sync
-
+ *
+ * index_span:          span (INDEX_SPAN) the last record ended in
+ * last_index_offset:   file offset of last INDEX laid down, 0 none
+ * index_next:          next slot in index_ent
+ * index_nentries:      SYNCs held in index_ent, since last INDEX
+ * index_ent:           ring of SYNCs for the next INDEX
+ *
+ * rsv_hdr:             outstanding reservation (Collect.reserve), header
+ * rsv_hlen/rsv_dlen:   size of the outstanding reservation
+ * rsv_nareas:          number of sector areas the reservation spans
+ * rsv_area:            where each piece of the record (hdr + data) lands
+ * rsv_handle:          extra SSW handles for areas 1.. (area 0 is handle)
+ *
  * DblkManager is responsible for keeping track of where in the Data Stream
  * we are.
  */
@@ -98,6 +121,19 @@ typedef struct {
   uint32_t     last_sync_offset;        /* file offset */
   uint16_t     bufs_to_next_sync;
 
+  uint32_t     index_span;
+  uint32_t     last_index_offset;       /* file offset */
+  uint16_t     index_next;
+  uint16_t     index_nentries;
+  dt_index_entry_t index_ent[INDEX_MAX_ENTRIES];
+
+  dt_header_t  *rsv_hdr;                /* NULL, no reservation */
+  uint16_t      rsv_hlen;
+  uint16_t      rsv_dlen;
+  uint16_t      rsv_nareas;
+  collect_seg_t rsv_area[COLLECT_MAX_SEGS];
+  ss_wr_buf_t  *rsv_handle[COLLECT_MAX_SEGS];
+
   uint16_t     majik_b;
 } dc_control_t;
 
@@ -124,6 +160,8 @@ module CollectP {
     interface TagnetAdapter<uint32_t> as DblkLastSyncOffset;
     interface TagnetAdapter<uint32_t> as DblkCommittedOffset;
     interface TagnetAdapter<uint32_t> as DblkResyncOffset;
+    interface TagnetAdapter<uint32_t> as DblkSeekRecNum;
+    interface TagnetAdapter<uint32_t> as DblkPrevSync;
 
     /* private */
     interface Init;                     /* SoftwareInit */
@@ -140,6 +178,7 @@ module CollectP {
     interface OverWatch;
     interface Rtc;
     interface Resync;
+    interface DblkIndex;
     interface Crc<uint8_t> as Crc8;
     interface DblkManager;
 
@@ -155,6 +194,12 @@ implementation {
 
   norace dc_control_t dcc;
 
+  /*
+   * staging area for a reserved header that doesn't fit in what is left
+   * of the current sector.  Copied into place on commit.
+   */
+  uint8_t dcc_rsv_hdr_buf[DT_MAX_HEADER] __attribute__((aligned(4)));
+
 
   // structure to manage state variables for reSync operation
   typedef struct {
@@ -196,8 +241,9 @@ implementation {
 
 
   void write_sync_record(dtype_t dtype) {
-    dt_sync_t  s;
-    dt_sync_t *sp;
+    dt_sync_t         s;
+    dt_sync_t        *sp;
+    dt_index_entry_t *ep;
 
     sp = &s;
     sp->len = sizeof(s);
@@ -206,14 +252,93 @@ implementation {
     sp->prev_sync  = dcc.last_sync_offset;
     dcc.last_sync_offset = get_rec_offset();
     call Collect.collect((void *) sp, sizeof(dt_sync_t), NULL, 0);
+    call DblkManager.checkpoint(dcc.last_sync_offset, FALSE);
+
+    /* remember it for the next INDEX, ring keeps the most recent */
+    ep = &dcc.index_ent[dcc.index_next];
+    ep->offset = dcc.last_sync_offset;
+    ep->recnum = sp->recnum;
+    ep->rt     = sp->rt;
+    ep->pad    = 0;
+    if (++dcc.index_next >= INDEX_MAX_ENTRIES)
+      dcc.index_next = 0;
+    if (dcc.index_nentries < INDEX_MAX_ENTRIES)
+      dcc.index_nentries++;
+  }
+
+
+  /*
+   * write_index_record: lay down an INDEX with the SYNCs seen since the
+   * last one, oldest first.  The ring may wrap, which is just one more
+   * piece of the iov.
+   */
+  void write_index_record() {
+    dt_index_t    x;
+    dt_index_t   *xp;
+    collect_seg_t iov[3];
+    uint16_t      n, first, niov;
+
+    n     = dcc.index_nentries;
+    first = (dcc.index_next + INDEX_MAX_ENTRIES - n) % INDEX_MAX_ENTRIES;
+
+    xp = &x;
+    xp->len         = sizeof(x) + n * sizeof(dt_index_entry_t);
+    xp->dtype       = DT_INDEX;
+    xp->prev_index  = dcc.last_index_offset;
+    xp->index_majik = INDEX_MAJIK;
+    xp->nentries    = n;
+    xp->pad         = 0;
+    dcc.last_index_offset = get_rec_offset();
+
+    iov[0].buf = (void *) xp;
+    iov[0].len = sizeof(x);
+    niov = 1;
+    if (n) {
+      iov[1].buf = (void *) &dcc.index_ent[first];
+      iov[1].len = INDEX_MAX_ENTRIES - first;
+      if (iov[1].len > n)
+        iov[1].len = n;
+      n -= iov[1].len;
+      iov[1].len *= sizeof(dt_index_entry_t);
+      niov = 2;
+      if (n) {
+        iov[2].buf = (void *) &dcc.index_ent[0];
+        iov[2].len = n * sizeof(dt_index_entry_t);
+        niov = 3;
+      }
+    }
+    dcc.index_nentries = 0;
+    call Collect.collect_iov(iov, niov);
+  }
+
+
+  /*
+   * index_check: called after each record is laid down.  If the stream
+   * has moved into a new span lay down its INDEX.  Only if we are still
+   * near the front of the span, that is where readers look for it.
+   *
+   * The INDEX itself comes back through here but is in the same span so
+   * we don't recurse.
+   */
+  void index_check() {
+    uint32_t offset, span;
+
+    offset = get_rec_offset();
+    span   = offset / INDEX_SPAN;
+    if (!offset || span == dcc.index_span)
+      return;
+    dcc.index_span = span;
+    if (offset - span * INDEX_SPAN < INDEX_SCAN_SECTORS * SD_BLOCKSIZE)
+      write_index_record();
   }
 
 
   void write_reboot_record() {
-    dt_reboot_t  r;
-    dt_reboot_t *rp;
-    uint8_t     *id;
-    unsigned int len, i;
+    dt_reboot_t   r;
+    dt_reboot_t  *rp;
+    collect_seg_t iov[2];
+    uint8_t      *id;
+    unsigned int  len, i;
 
     rp = &r;
     rp->len = sizeof(r) + sizeof(ow_control_block_t);
@@ -225,9 +350,11 @@ implementation {
     if (len > 6) len = 6;
     for (i = 0; i < len; i++)
       rp->node_id[i] = id[i];
-    call Collect.collect((void *) rp, sizeof(r),
-                         (void *) &ow_control_block,
-                         sizeof(ow_control_block_t));
+    iov[0].buf = (void *) rp;
+    iov[0].len = sizeof(r);
+    iov[1].buf = (void *) &ow_control_block;
+    iov[1].len = sizeof(ow_control_block_t);
+    call Collect.collect_iov(iov, 2);
     call OverWatch.clearReset();        /* clears owcb copies */
     call OverWatch.clearPanicInfo();    /* clear persistant panic info */
 
@@ -247,16 +374,22 @@ implementation {
    * DblkManager on the DataStream restart.
    */
   event void Boot.booted() {
-    /* Resync has already found a sync record as a result of
-     * DblkManager looking for its last record for initialition.
-     * We use this value as the initial dcc.last_sync_offset.
-     * If boot order is changed or Resync is executed another
-     * time, this value may be wrong.
+    /* DblkManager has already found the last sync record, either from
+     * its checkpoint or by resyncing back from the end of the dblk.  We
+     * use this value as the initial dcc.last_sync_offset.
      */
-    dcc.last_sync_offset = call Resync.offset();
+    dcc.last_sync_offset = call DblkManager.last_sync_offset();
+
+    /*
+     * hold off INDEXing until the reboot sequence is down, then see if
+     * we are near enough to the front of our span to INDEX it.
+     */
+    dcc.index_span = get_rec_offset() / INDEX_SPAN;
     write_sync_record(DT_SYNC_REBOOT);
     write_reboot_record();
     write_version_record();
+    dcc.index_span = (uint32_t) -1;
+    index_check();
     call OverWatch.checkFaults();
     call CollectEvent.logEvent(DT_EVENT_TIME_SRC, call OverWatch.getRtcSrc(),
                                0, 0, 1);
@@ -386,6 +519,69 @@ implementation {
   event void Resync.done(error_t err, uint32_t offset) { }
 
 
+  command bool DblkPrevSync.get_value(uint32_t *t, uint32_t *l) {
+    if (!t || !l)
+      call Panic.panic(0, 0, 0, 0, 0, 0);
+    *t = call Resync.offset();
+    *l = sizeof(uint32_t);
+    return TRUE;
+  }
+
+
+  /**
+   * DblkPrevSync.set_value: find the Nth previous sync
+   *
+   * follow the prev_sync chain back N syncs from the last sync written.
+   * 0 is the last sync.  The result (get_value) is the sync found, 0 says
+   * still looking.  Shares Resync with .resync.
+   */
+  command bool DblkPrevSync.set_value(uint32_t *t, uint32_t *l) {
+    error_t  err;
+    uint32_t count;
+
+    if (!l || !t || *l != sizeof(uint32_t))
+      call Panic.panic(0, 0, 0, 0, 0, 0);
+    count = *t;
+    if (count > 0xffff)
+      return FALSE;
+    *t  = dcc.last_sync_offset;
+    err = call Resync.prev(t, count);
+    if (err == EBUSY) *t = 0;
+    else if (err) return FALSE;
+    return TRUE;
+  }
+
+
+  command bool DblkSeekRecNum.get_value(uint32_t *t, uint32_t *l) {
+    if (!t || !l)
+      call Panic.panic(0, 0, 0, 0, 0, 0);
+    *t = call DblkIndex.offset();
+    *l = sizeof(uint32_t);
+    return TRUE;
+  }
+
+
+  /**
+   * DblkSeekRecNum.set_value: find where a record number lives
+   *
+   * start an index search for the record number.  The result (get_value)
+   * is a record boundary at or before the record.  0 says still looking.
+   */
+  command bool DblkSeekRecNum.set_value(uint32_t *t, uint32_t *l) {
+    error_t  err;
+
+    if (!l || !t || *l != sizeof(uint32_t))
+      call Panic.panic(0, 0, 0, 0, 0, 0);
+    err = call DblkIndex.find_recnum(*t);
+    if (err == EINVAL)
+      return FALSE;
+    *t = 0;                             /* busy, ask again */
+    return TRUE;
+  }
+
+  event void DblkIndex.done(error_t err, uint32_t offset) { }
+
+
   command bool DblkBootRecNum.set_value(uint32_t *t, uint32_t *l)      { return FALSE; }
   command bool DblkBootOffset.set_value(uint32_t *t, uint32_t *l)      { return FALSE; }
   command bool DblkLastRecNum.set_value(uint32_t *t, uint32_t *l)      { return FALSE; }
@@ -447,53 +643,125 @@ implementation {
   }
 
 
+  /* sum_bytes: byte sum (recsum definition) of a buffer, no copy */
+  static uint16_t sum_bytes(uint8_t *buf, uint16_t len) {
+    uint16_t sum;
+
+    sum = 0;
+    if (!buf)
+      return sum;
+    while (len--)
+      sum += *buf++;
+    return sum;
+  }
+
+
   /*
-   * returns amount actually copied
+   * returns amount actually copied, byte sum is added to *sump
    */
-  static uint16_t copy_block_out(uint8_t *data, uint16_t dlen) {
-    uint8_t  *ptr;
+  static uint16_t copy_block_out(uint8_t *data, uint16_t dlen, uint16_t *sump) {
     uint16_t num_to_copy;
-    unsigned int i;
 
     num_to_copy = ((dlen < dcc.remaining) ? dlen : dcc.remaining);
-    ptr = dcc.cur_ptr;
-    for (i = 0; i < num_to_copy; i++)
-      *ptr++  = *data++;
-    dcc.cur_ptr = ptr;
+    *sump += copy_sum(dcc.cur_ptr, data, num_to_copy);
+    dcc.cur_ptr += num_to_copy;
     dcc.remaining -= num_to_copy;
     return num_to_copy;
   }
 
 
-  void copy_out(uint8_t *data, uint16_t dlen) {
-    uint16_t num_copied;
+  /*
+   * get_buffer: no space left, get another buffer
+   * get_free_buf_handle either works or panics.
+   */
+  void get_buffer() {
+    dcc.handle = call SSW.get_free_buf_handle();
+    dcc.cur_ptr = dcc.cur_buf = call SSW.buf_handle_to_buf(dcc.handle);
+    dcc.remaining = SD_BLOCKSIZE;
+  }
+
+
+  /*
+   * copy_out: lay dlen bytes down into the stream, crossing sectors as
+   * needed.  returns the byte sum of everything copied.
+   */
+  uint16_t copy_out(uint8_t *data, uint16_t dlen) {
+    uint16_t num_copied, sum;
 
+    sum = 0;
     if (!data || !dlen)            /* nothing to do? */
-      return;
+      return sum;
     while (dlen > 0) {
-      if (dcc.cur_buf == NULL) {
-        /*
-         * no space left, get another buffer
-         * get_free_buf_handle either works or panics.
-         */
-        dcc.handle = call SSW.get_free_buf_handle();
-        dcc.cur_ptr = dcc.cur_buf = call SSW.buf_handle_to_buf(dcc.handle);
-        dcc.remaining = SD_BLOCKSIZE;
-      }
-      num_copied = copy_block_out(data, dlen);
+      if (dcc.cur_buf == NULL)
+        get_buffer();
+      num_copied = copy_block_out(data, dlen, &sum);
       data += num_copied;
       dlen -= num_copied;
       if (dcc.remaining == 0)
         finish_sector();
     }
+    return sum;
   }
 
 
-  void finish_record(dt_header_t *header, uint16_t hlen,
-                     uint8_t     *data,   uint16_t dlen) {
-    uint16_t    chksum;
-    uint32_t    i;
+  /*
+   * collect_lane: which lane does a record ride in.
+   *
+   * Critical are the things we want to see after a hard crash: syncs and
+   * reboots (the stream's anchors) and events, which are rare and say
+   * what the tag was doing.  Except the SD/SSW instrumentation events,
+   * those come out of writing and would just keep the SD cycling.
+   * Everything else (sensor data, gps, version, index, notes) is bulk.
+   */
+  uint8_t collect_lane(dt_header_t *header) {
+    if (!SSW_CRIT_LATENCY)
+      return SSW_LANE_BULK;
+    switch (header->dtype) {
+      case DT_SYNC:
+      case DT_SYNC_FLUSH:
+      case DT_SYNC_REBOOT:
+      case DT_REBOOT:
+        return SSW_LANE_CRIT;
+
+      case DT_EVENT:
+        switch (((dt_event_t *) header)->ev) {
+          case DT_EVENT_SSW_DELAY_TIME:
+          case DT_EVENT_SSW_BLK_TIME:
+          case DT_EVENT_SSW_GRP_TIME:
+          case DT_EVENT_SSW_LANE_TIME:
+          case DT_EVENT_SD_ON:
+          case DT_EVENT_SD_OFF:
+          case DT_EVENT_SD_REQ:
+          case DT_EVENT_SD_REL:
+            return SSW_LANE_BULK;
+        }
+        return SSW_LANE_CRIT;
+    }
+    return SSW_LANE_BULK;
+  }
+
 
+  /*
+   * stamp_header: assign recnum and compute hdr_crc8.
+   *
+   * On return recsum has been zeroed and is ready to be computed.
+   *
+   * upper layers are responsible for filling in any pad fields,
+   * typically 0.  Pad fields are don't care but are part of the record
+   * and are significant in the checksum.  We set to zero by convention.
+   *
+   * recsum is the byte by byte sum of all header and data bytes, taken
+   * with recsum set to 0.  The header fields have to be final before
+   * the sum is done.  Normally the sum is taken while copying
+   * (copy_sum) and recsum is then laid into the header sitting in the
+   * sector buffer.
+   *
+   * To verify, sum all bytes.  This result will include both recsum
+   * bytes.  Remove the recsum bytes from result (as individual bytes)
+   * and compare the result to recsum itself.  See checksum verify in
+   * get_record in tagdump.py.  (tools/utils/tagdump/tagdump)
+   */
+  void stamp_header(dt_header_t *header) {
     dcc.cur_bootrec++;
     header->recnum = call DblkManager.adv_cur_recnum();
     dcc.last_rec_offset = get_rec_offset();
@@ -508,33 +776,7 @@ implementation {
      */
     header->hdr_crc8 = 0;
     header->hdr_crc8 = call Crc8.crc((void *) header, HDR_CRC_LEN);
-
-    /*
-     * upper layers are responsible for filling in any pad fields,
-     * typically 0.  Pad fields are don't care but are part of the record
-     * and are significant in the checksum.  We set to zero by convention.
-     *
-     * we need to compute the record chksum over all bytes of the header and
-     * all bytes of the data area.  Additions to the chksum are done byte by
-     * byte.  This has to be done before copying any of the data out and added
-     * to the header (recsum).  Duh.  In other words, we have to finish updating
-     * critical fields in the record header before coping it else where.
-     *
-     * Set recsum to 0.  Sum byte by byte all header and data bytes.  Then lay
-     * in the computed 16 bit result as recsum.
-     *
-     * To verify, sum all bytes.  This result will include both recsum
-     * bytes.  Remove the recsum bytes from result (as individual bytes)
-     * and compare the result to recsum itself.  See checksum verify in
-     * get_record in tagdump.py.  (tools/utils/tagdump/tagdump)
-     */
-    chksum = 0;
     header->recsum = 0;
-    for (i = 0; i < hlen; i++)
-      chksum += ((uint8_t *) header)[i];
-    for (i = 0; data && i < dlen; i++)
-      chksum += data[i];
-    header->recsum = (uint16_t) chksum;
   }
 
 
@@ -547,8 +789,9 @@ implementation {
    * DT_MAX_RLEN (+ 1).  Data is immediately copied after the header (its
    * contiguous).
    *
-   * hlen is the actual size of the header, dlen is the actual size of the
-   * data.  hlen + dlen should match what is laid down in header->len.
+   * The record comes in as an iov.  iov[0] is the header, hlen is its
+   * length.  The remaining areas are the data, dlen is their total.
+   * hlen + dlen should match what is laid down in header->len.
    *
    * All dblk headers are assumed to start on a 32 bit boundary (aligned(4)).
    *
@@ -557,14 +800,31 @@ implementation {
    * In other words we always keep typed_data blocks aligned in memory as
    * well as on the disk sector.
    *
-   * dblk headers are constrained to fit completely into a data sector.  Data
-   * immediately follows the dblk header as long as there is space.  Data
-   * can flow into as many sectors as needed following the dblk header.
+   * Data immediately follows the dblk header and can flow into as many
+   * sectors as needed.  The header normally fits in what is left of the
+   * current sector, and is summed while it and the data are copied.  If
+   * it doesn't fit, the header straddles the sector boundary too and the
+   * record is summed first and then copied.
    */
-  command void Collect.collect_nots(dt_header_t *header, uint16_t hlen,
-                                    uint8_t     *data,   uint16_t dlen) {
+  void collect_iov_nots(collect_seg_t *iov, uint16_t niov) {
+    dt_header_t *header, *hp;
+    ss_wr_buf_t *hdr_handle;
+    uint16_t     hlen, dlen, chksum, i;
+    uint8_t      lane;
+
     if (dcc.majik_a != DC_MAJIK || dcc.majik_b != DC_MAJIK)
       call Panic.panic(PANIC_SS, 1, dcc.majik_a, dcc.majik_b, 0, 0);
+    if (dcc.rsv_hdr)                    /* reservation outstanding */
+      call Panic.panic(PANIC_SS, 40, (parg_t) dcc.rsv_hdr, (parg_t) iov, 0, 0);
+    if (!iov || !niov || niov > COLLECT_MAX_IOV)
+      call Panic.panic(PANIC_SS, 45, (parg_t) iov, niov, 0, 0);
+
+    header = (dt_header_t *) iov[0].buf;
+    hlen   = iov[0].len;
+    dlen   = 0;
+    for (i = 1; i < niov; i++)
+      dlen += iov[i].len;
+
     if ((uint32_t) header & 0x3 || (uint32_t) dcc.cur_ptr & 0x03 ||
         dcc.remaining > SD_BLOCKSIZE)
       call Panic.panic(PANIC_SS, 2, (parg_t) header, (parg_t) dcc.cur_ptr, dcc.remaining, 0);
@@ -575,14 +835,63 @@ implementation {
       call Panic.panic(PANIC_SS, 3, hlen, dlen, header->len, header->dtype);
 
     if (hlen + dlen > DT_MAX_RLEN)
-      call Panic.panic(PANIC_SS, 4, (parg_t) data, dlen, 0, 0);
+      call Panic.panic(PANIC_SS, 4, (parg_t) iov, dlen, 0, 0);
+
+    if (dcc.cur_buf == NULL)
+      get_buffer();
+    hdr_handle = dcc.handle;            /* where the record starts */
+    lane = collect_lane(header);
+    if (dcc.remaining < hlen) {
+      /*
+       * header straddles a sector boundary.  No single place to patch
+       * recsum, so do it the long way, sum first then copy.  See
+       * stamp_header for the recsum definition.
+       */
+      stamp_header(header);
+      chksum = 0;
+      for (i = 0; i < niov; i++)
+        chksum += sum_bytes(iov[i].buf, iov[i].len);
+      header->recsum = chksum;
+      nop();                            /* BRK */
+      for (i = 0; i < niov; i++)
+        copy_out(iov[i].buf, iov[i].len);
+      align_next();
+      call SSW.mark_lane(hdr_handle, lane);
+      index_check();
+      return;
+    }
 
-    /* update recnum and calc the checksum */
-    finish_record(header, hlen, data, dlen);
+    /*
+     * normal case, header fits.  Stamp the header (recsum 0) and sum
+     * while copying, one pass over the record.  Then lay the recsum
+     * into the copy of the header sitting in the sector buffer.
+     *
+     * The header's sector may have gone FULL by the time we patch it,
+     * that's fine.  SSW doesn't touch FULL buffers until its task runs.
+     */
+    stamp_header(header);
+    hp = (dt_header_t *) dcc.cur_ptr;
     nop();                              /* BRK */
-    copy_out((void *)header, hlen);
-    copy_out((void *)data,   dlen);
+    chksum = 0;
+    for (i = 0; i < niov; i++)
+      chksum += copy_out(iov[i].buf, iov[i].len);
+    hp->recsum = chksum;
+    header->recsum = chksum;
     align_next();
+    call SSW.mark_lane(hdr_handle, lane);
+    index_check();
+  }
+
+
+  command void Collect.collect_nots(dt_header_t *header, uint16_t hlen,
+                                    uint8_t     *data,   uint16_t dlen) {
+    collect_seg_t iov[2];
+
+    iov[0].buf = (void *) header;
+    iov[0].len = hlen;
+    iov[1].buf = data;
+    iov[1].len = dlen;
+    collect_iov_nots(iov, 2);
   }
 
 
@@ -593,6 +902,169 @@ implementation {
   }
 
 
+  command void Collect.collect_iov(collect_seg_t *iov, uint16_t niov) {
+    if (!iov || !niov || !iov[0].buf)
+      call Panic.panic(PANIC_SS, 45, (parg_t) iov, niov, 0, 0);
+    call Rtc.getTime(&((dt_header_t *) iov[0].buf)->rt);
+    collect_iov_nots(iov, niov);
+  }
+
+
+  /*
+   * Collect.reserve: set aside space for a record in the sector buffers.
+   *
+   * Lays out where every byte of the record will land, grabbing more
+   * SSW buffers as needed.  Area 0 is what is left of the current
+   * buffer, subsequent areas are fresh buffers.  Nothing is handed to
+   * SSW until commit.
+   *
+   * The header is built in place if it fits completely in area 0, which
+   * is the normal case.  Otherwise the header is built in a staging
+   * buffer and split out on commit.
+   *
+   * The data segments handed back to the producer are the areas minus
+   * the first hlen bytes.
+   */
+  command dt_header_t *Collect.reserve(uint16_t hlen, uint16_t dlen,
+                                       collect_rsv_t *rsv) {
+    dt_header_t *hp;
+    uint16_t     left, n, skip, i;
+
+    if (dcc.majik_a != DC_MAJIK || dcc.majik_b != DC_MAJIK)
+      call Panic.panic(PANIC_SS, 1, dcc.majik_a, dcc.majik_b, 0, 0);
+    if (dcc.rsv_hdr || !rsv)
+      call Panic.panic(PANIC_SS, 41, (parg_t) dcc.rsv_hdr, (parg_t) rsv, 0, 0);
+    if (hlen < sizeof(dt_header_t) || hlen > DT_MAX_HEADER || (hlen & 3) ||
+        hlen + dlen > DT_MAX_RLEN)
+      call Panic.panic(PANIC_SS, 42, hlen, dlen, 0, 0);
+
+    if (dcc.cur_buf == NULL)
+      get_buffer();
+    if ((uint32_t) dcc.cur_ptr & 0x03 || dcc.remaining > SD_BLOCKSIZE ||
+        dcc.remaining == 0)
+      call Panic.panic(PANIC_SS, 2, 0, (parg_t) dcc.cur_ptr, dcc.remaining, 0);
+
+    left = hlen + dlen;
+    n = (left < dcc.remaining) ? left : dcc.remaining;
+    dcc.rsv_area[0].buf = dcc.cur_ptr;
+    dcc.rsv_area[0].len = n;
+    dcc.rsv_handle[0]   = dcc.handle;
+    dcc.rsv_nareas      = 1;
+    left -= n;
+    while (left) {
+      if (dcc.rsv_nareas >= COLLECT_MAX_SEGS)
+        call Panic.panic(PANIC_SS, 43, hlen, dlen, left, 0);
+      i = dcc.rsv_nareas++;
+      dcc.rsv_handle[i]   = call SSW.get_free_buf_handle();
+      dcc.rsv_area[i].buf = call SSW.buf_handle_to_buf(dcc.rsv_handle[i]);
+      n = (left < SD_BLOCKSIZE) ? left : SD_BLOCKSIZE;
+      dcc.rsv_area[i].len = n;
+      left -= n;
+    }
+
+    if (dcc.rsv_area[0].len >= hlen)
+      hp = (dt_header_t *) dcc.rsv_area[0].buf;
+    else
+      hp = (dt_header_t *) dcc_rsv_hdr_buf;
+    memset(hp, 0, hlen);                /* pad fields by convention */
+
+    rsv->nsegs = 0;
+    rsv->dlen  = dlen;
+    skip = hlen;
+    for (i = 0; i < dcc.rsv_nareas; i++) {
+      if (skip >= dcc.rsv_area[i].len) {
+        skip -= dcc.rsv_area[i].len;    /* all header */
+        continue;
+      }
+      rsv->seg[rsv->nsegs].buf = dcc.rsv_area[i].buf + skip;
+      rsv->seg[rsv->nsegs].len = dcc.rsv_area[i].len - skip;
+      rsv->nsegs++;
+      skip = 0;
+    }
+
+    dcc.rsv_hlen = hlen;
+    dcc.rsv_dlen = dlen;
+    dcc.rsv_hdr  = hp;
+    return hp;
+  }
+
+
+  /*
+   * Collect.commit: finish off a reserved record.
+   *
+   * The producer has filled in the header and all of the data.  Stamp
+   * the time, recnum, crc, and recsum (see stamp_header), copy a staged
+   * header into place, and then advance the collector over the record,
+   * handing completed sectors to SSW.
+   */
+  command void Collect.commit(dt_header_t *header) {
+    uint16_t chksum, skip, n, i;
+    uint8_t *p;
+
+    if (!header || header != dcc.rsv_hdr)
+      call Panic.panic(PANIC_SS, 44, (parg_t) header, (parg_t) dcc.rsv_hdr, 0, 0);
+    if (header->len != (dcc.rsv_hlen + dcc.rsv_dlen) ||
+        header->dtype > DT_MAX)
+      call Panic.panic(PANIC_SS, 3, dcc.rsv_hlen, dcc.rsv_dlen,
+                       header->len, header->dtype);
+
+    call Rtc.getTime(&header->rt);
+    stamp_header(header);
+
+    /* recsum, header then data (areas past the header) */
+    chksum = 0;
+    p = (uint8_t *) header;
+    for (i = 0; i < dcc.rsv_hlen; i++)
+      chksum += p[i];
+    skip = dcc.rsv_hlen;
+    for (i = 0; i < dcc.rsv_nareas; i++) {
+      if (skip >= dcc.rsv_area[i].len) {
+        skip -= dcc.rsv_area[i].len;
+        continue;
+      }
+      p = dcc.rsv_area[i].buf + skip;
+      for (n = dcc.rsv_area[i].len - skip; n; n--)
+        chksum += *p++;
+      skip = 0;
+    }
+    header->recsum = chksum;
+
+    if ((uint8_t *) header == dcc_rsv_hdr_buf) {
+      /* staged, split the header across the areas */
+      p = dcc_rsv_hdr_buf;
+      skip = dcc.rsv_hlen;
+      for (i = 0; i < dcc.rsv_nareas && skip; i++) {
+        n = (skip < dcc.rsv_area[i].len) ? skip : dcc.rsv_area[i].len;
+        memcpy(dcc.rsv_area[i].buf, p, n);
+        p += n;
+        skip -= n;
+      }
+    }
+
+    /*
+     * walk the collector over the record.  Every area but the last
+     * fills its sector.
+     */
+    for (i = 0; i < dcc.rsv_nareas; i++) {
+      if (i) {
+        dcc.handle    = dcc.rsv_handle[i];
+        dcc.cur_buf   = dcc.rsv_area[i].buf;
+        dcc.cur_ptr   = dcc.cur_buf;
+        dcc.remaining = SD_BLOCKSIZE;
+      }
+      dcc.cur_ptr   += dcc.rsv_area[i].len;
+      dcc.remaining -= dcc.rsv_area[i].len;
+      if (dcc.remaining == 0)
+        finish_sector();
+    }
+    dcc.rsv_hdr    = NULL;
+    dcc.rsv_nareas = 0;
+    align_next();
+    call SSW.mark_lane(dcc.rsv_handle[0], collect_lane(header));
+    index_check();
+  }
+
+
   /*
    * buf_offset: return the offset into the current Alloc buffer (if any).
    *
@@ -611,6 +1083,24 @@ implementation {
   }
 
 
+  /*
+   * close_sector: SSW wants what we have on the SD.
+   *
+   * The SYNC_FLUSH normally fits in what is left.  If not it straddles
+   * into the next sector and that one gets closed instead.  Readers
+   * skip from the end of a SYNC_FLUSH to the next sector boundary, the
+   * padding is the zeros the buffer started with.
+   */
+  command bool Collect.close_sector() {
+    if (!dcc.cur_buf || dcc.rsv_hdr)
+      return FALSE;
+    write_sync_record(DT_SYNC_FLUSH);
+    if (dcc.cur_buf)
+      finish_sector();
+    return TRUE;
+  }
+
+
   command void CollectEvent.logEvent(uint16_t ev, uint32_t arg0, uint32_t arg1,
                                                   uint32_t arg2, uint32_t arg3) {
     dt_event_t  e;
@@ -631,8 +1121,10 @@ implementation {
 
 
   async event void SysReboot.shutdown_flush() {
-    dt_sync_t  s;
-    dt_sync_t *sp;
+    dt_sync_t    s;
+    dt_sync_t   *sp;
+    dt_header_t *hp;
+    uint16_t     chksum;
 
     nop();                              /* BRK */
 
@@ -659,13 +1151,19 @@ implementation {
         sp->prev_sync  = dcc.last_sync_offset;
         dcc.last_sync_offset = get_rec_offset();
 
-        /* add recnum and checksum the record */
-        finish_record( (void *) sp, sizeof(dt_sync_t), NULL, 0);
-        copy_block_out((void *) sp, sizeof(dt_sync_t));
+        /* add recnum, sum while copying, then patch recsum in place */
+        stamp_header((void *) sp);
+        hp = (dt_header_t *) dcc.cur_ptr;
+        chksum = 0;
+        copy_block_out((void *) sp, sizeof(dt_sync_t), &chksum);
+        hp->recsum = chksum;
       }
       dcc.remaining = 0;
     }
     call SSW.flush_all();
+
+    /* everything is on the SD, tell DblkManager where it ended */
+    call DblkManager.checkpoint(dcc.last_sync_offset, TRUE);
   }
 
         event void SS.dblk_stream_full()           { }
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#include <typed_data.h>
+
+interface DblkIndex {
+  /**
+   * find_recnum/find_time: locate a record using the dblk INDEX records.
+   *
+   * Binary search the INDEX records Collect lays down (see typed_data.h)
+   * for the last known record boundary at or before the record wanted.
+   * The caller walks forward from there.
+   *
+   * @param   uint32_t   recnum    record number looking for.
+   * @param   rtctime_t *rtp       time looking for, copied.
+   *
+   * @return  error_t    SUCCESS   search started, done() will be signalled.
+   *                     EBUSY     a search is already in progress.
+   *                     EINVAL    bad target.
+   */
+  command error_t find_recnum(uint32_t recnum);
+  command error_t find_time(rtctime_t *rtp);
+
+  /**
+   * done: signal completion of the search
+   *
+   * @param error_t  err      SUCCESS, offset is a record boundary at or
+   *                          before what was asked for.  If nothing in
+   *                          the index helps, this is the front of the
+   *                          data stream.
+   *                          other, something went wrong (no data).
+   * @param uint32_t offset   file offset found.
+   */
+  event void done(error_t err, uint32_t offset);
+
+  /**
+   * offset: return last found offset.
+   *
+   * @return uint32_t   last offset found, 0 if none or a search is in
+   *                    progress.
+   */
+  command uint32_t offset();
+}
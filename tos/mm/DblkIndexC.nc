@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+configuration DblkIndexC {
+  provides interface DblkIndex[uint8_t cid];
+}
+implementation {
+  enum {
+    DMF_CID = unique("DblkMapFile.cid"),
+  };
+
+  components DblkIndexP;
+  DblkIndex = DblkIndexP;
+
+  components new TimerMilliC();
+  DblkIndexP.IndexTimer -> TimerMilliC;
+
+  components FileSystemC as FS;
+  DblkIndexP.DMF -> FS.DblkFileMap[DMF_CID];
+
+  components DblkManagerC;
+  DblkIndexP.DblkManager -> DblkManagerC;
+
+  components PlatformC;
+  DblkIndexP.Rtc -> PlatformC;
+
+  components PanicC;
+  DblkIndexP.Panic -> PanicC;
+}
@@ -0,0 +1,385 @@
+/*
+ * Copyright 2019: Eric B. Decker
+ * All rights reserved.
+ * Mam-Mark Project
+ *
+ * DblkIndexP.nc - find records in the data stream using INDEX records.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * Dblk Index Search
+ *
+ * Collect lays down an INDEX record near the front of every span of
+ * INDEX_SECTORS sectors (see typed_data.h).  Finding a record (by recnum
+ * or by time) is a binary search over the spans rather than a walk of the
+ * data stream.
+ *
+ * Algorithm
+ * - window of spans [lo, hi), hi is the span past the end of file.
+ * - probe the middle span: scan its first INDEX_SCAN_SECTORS sectors
+ *   a quad at a time (DMF.mapAll) for a valid INDEX header.
+ *   - INDEX at or before the target, remember it (below), lo moves past
+ *     the span it was found in.
+ *   - INDEX past the target, remember it (above), move hi down to mid.
+ *   - no INDEX, the span doesn't tell us which way to go.  Calling it
+ *     either way can throw away the side the target is on.  Move on to
+ *     the next span and keep going until one has an INDEX.  If nothing
+ *     in [mid, hi) has one there is nothing there to find, hi = mid.
+ * - when the window closes, below is the best whole span.  The entries
+ *   of above are the SYNCs just before above, walk them backwards for the
+ *   last one at or before the target and past below.
+ * - result is that SYNC, or below, or the front of the stream.
+ *
+ * Circular DBLK (dblk_dir.h) that has wrapped, the spans are taken in
+ * stream order: the span the tail is in, on to the end of the area, then
+ * from the front.  The tail's span shows up twice, first for what is
+ * past the tail (the oldest) and last for what is in front of it (the
+ * newest).  Entries and the result are compared by where they are in the
+ * stream (ix_pos).  Spans in the erased gap between the head and the tail
+ * are past the eof, DMF says EODATA and there is nothing after them.
+ *
+ * Each probe touches a couple of sectors (more when it has to step over
+ * spans without an INDEX), so a search on a multi-GB dblk is a couple
+ * of dozen sector reads.
+ *
+ * Like Resync, we are a DMF client.  When DMF returns EBUSY we wait for
+ * data_avail and pick up where we left off.
+ */
+
+#include <typed_data.h>
+#include <sd.h>
+
+/* front of the data stream, the first sector is the dblk directory */
+#define IX_FIRST_OFFSET   SD_BLOCKSIZE
+
+/* how much of an INDEX we can look at in one mapAll, up to the majik */
+#define IX_HDR_MAP_LEN    (sizeof(dt_index_t) - 4)
+
+typedef enum {
+  IXS_IDLE = 0,
+  IXS_PROBE,                            /* looking for a span's INDEX */
+  IXS_ENTRY,                            /* walking above's entries */
+} ix_state_t;
+
+typedef struct {
+  uint32_t offset;                      /* file offset of INDEX, 0 none */
+  uint16_t nentries;
+} ix_ref_t;
+
+typedef struct {
+  ix_state_t state;
+  uint8_t    cid;                       /* client id, current user */
+  bool       by_time;                   /* search key, time or recnum */
+  uint32_t   recnum;
+  rtctime_t  rt;
+
+  uint32_t   lo, hi, mid;               /* span window, [lo, hi) */
+  uint32_t   span;                      /* span being scanned, >= mid */
+  uint32_t   first;                     /* span 0 in the file, the tail's */
+  uint32_t   nspans;                    /* spans in the file */
+  uint32_t   tail;                      /* wrapped circular, 0 not */
+  uint32_t   area;                      /* wrapped, end of the area */
+  uint32_t   cur_offset;                /* scan position */
+  uint32_t   term_offset;               /* end of scan */
+  ix_ref_t   below;                     /* last INDEX at or before target */
+  ix_ref_t   above;                     /* first INDEX past target */
+  int16_t    entry;                     /* entry of above being looked at */
+
+  uint32_t   found_offset;
+  error_t    err;
+} ixcb_t;
+
+
+module DblkIndexP {
+  provides interface DblkIndex[uint8_t cid];
+  uses {
+    interface ByteMapFile as DMF;
+    interface DblkManager;
+    interface Rtc;
+    interface Timer<TMilli> as IndexTimer;
+    interface Panic;
+  }
+}
+implementation {
+  ixcb_t ixcb;
+
+  /* TRUE if the key (recnum, rt) is at or before what we want */
+  bool at_or_before(uint32_t recnum, rtctime_t *rtp) {
+    if (ixcb.by_time)
+      return (call Rtc.compareTimes(rtp, &ixcb.rt) <= 0);
+    return (recnum <= ixcb.recnum);
+  }
+
+
+  bool index_valid(dt_index_t *ip) {
+    uint16_t dlen;
+
+    if (ip->index_majik != INDEX_MAJIK || ip->dtype != DT_INDEX)
+      return FALSE;
+    if (ip->len < sizeof(dt_index_t))
+      return FALSE;
+    dlen = ip->len - sizeof(dt_index_t);
+    if (dlen % sizeof(dt_index_entry_t) ||
+        dlen / sizeof(dt_index_entry_t) > INDEX_MAX_ENTRIES)
+      return FALSE;
+    return call DblkManager.hdrValid((dt_header_t *) ip);
+  }
+
+
+  /*
+   * where offset is in the data stream.  Wrapped circular, the tail is
+   * first and the end of the area comes before the front.  Anything past
+   * the area isn't in the stream.
+   */
+  uint32_t ix_pos(uint32_t offset) {
+    if (!ixcb.tail)
+      return offset;
+    if (offset >= ixcb.area)
+      return (uint32_t) -1;
+    if (offset >= ixcb.tail)
+      return offset - ixcb.tail;
+    return offset + ixcb.area - ixcb.tail;
+  }
+
+
+  /* point the scan at the front of span (stream order) */
+  void scan_span(uint32_t span) {
+    uint32_t phys;
+
+    ixcb.span = span;
+    phys = ixcb.first + span;
+    if (phys >= ixcb.nspans)
+      phys -= ixcb.nspans;
+    ixcb.cur_offset  = phys * INDEX_SPAN;
+    ixcb.term_offset = ixcb.cur_offset + INDEX_SCAN_SECTORS * SD_BLOCKSIZE;
+    if (ixcb.tail) {
+      /*
+       * the tail's span, first time only past the tail (its front has
+       * been eaten), last time only in front of it.  And never off the
+       * end of the area, DMF would fold that around to the front.
+       */
+      if (span == 0 && ixcb.cur_offset < ixcb.tail)
+        ixcb.cur_offset = ixcb.tail;
+      if (span == ixcb.nspans && ixcb.term_offset > ixcb.tail)
+        ixcb.term_offset = ixcb.tail;
+      if (ixcb.term_offset > ixcb.area)
+        ixcb.term_offset = ixcb.area;
+    }
+  }
+
+
+  /* set up the next probe, or move on to the entries */
+  void next_probe() {
+    if (ixcb.lo < ixcb.hi) {
+      ixcb.mid = (ixcb.lo + ixcb.hi) / 2;
+      scan_span(ixcb.mid);
+      ixcb.state = IXS_PROBE;
+      return;
+    }
+    ixcb.found_offset = ixcb.below.offset;
+    if (!ixcb.found_offset)
+      ixcb.found_offset = ixcb.tail ? ixcb.tail : IX_FIRST_OFFSET;
+    ixcb.entry = ixcb.above.offset ? ixcb.above.nentries - 1 : -1;
+    ixcb.state = IXS_ENTRY;
+  }
+
+
+  task void ix_done_task() {
+    call IndexTimer.stop();
+    ixcb.state = IXS_IDLE;
+    signal DblkIndex.done[ixcb.cid](ixcb.err, ixcb.found_offset);
+  }
+
+
+  /*
+   * ix_search: run the search as far as the cache lets us.
+   *
+   * returns when DMF goes off to get more data (EBUSY) or when the
+   * search is done, in which case ix_done_task has been posted.
+   */
+  void ix_search() {
+    dt_index_t       *ip;
+    dt_index_entry_t *ep;
+    uint32_t          dlen;
+    error_t           err;
+
+    while (TRUE) {
+      switch (ixcb.state) {
+        default:
+          call Panic.panic(PANIC_SS, 46, ixcb.state, 0, 0, 0);
+          return;
+
+        case IXS_PROBE:
+          if (ixcb.cur_offset >= ixcb.term_offset) {
+            /* no INDEX in this span, undecided, try the next one */
+            if (ixcb.span + 1 < ixcb.hi) {
+              scan_span(ixcb.span + 1);
+              continue;
+            }
+            ixcb.hi = ixcb.mid;         /* none in [mid, hi) */
+            next_probe();
+            continue;
+          }
+          dlen = IX_HDR_MAP_LEN;
+          err = call DMF.mapAll(0, (uint8_t **) &ip, ixcb.cur_offset, &dlen);
+          if (err == EBUSY)
+            return;
+          if (err == EODATA) {          /* off the end, nothing further */
+            ixcb.hi = ixcb.mid;
+            next_probe();
+            continue;
+          }
+          if (err) {
+            ixcb.err = err;
+            ixcb.found_offset = 0;
+            post ix_done_task();
+            return;
+          }
+          if (dlen != IX_HDR_MAP_LEN || !ip)
+            call Panic.panic(PANIC_SS, 46, dlen, (parg_t) ip, 0, 0);
+          if (!index_valid(ip)) {
+            ixcb.cur_offset += sizeof(uint32_t);
+            continue;
+          }
+          if (at_or_before(ip->recnum, &ip->rt)) {
+            ixcb.below.offset   = ixcb.cur_offset;
+            ixcb.below.nentries = (ip->len - sizeof(dt_index_t)) /
+              sizeof(dt_index_entry_t);
+            ixcb.lo = ixcb.span + 1;
+          } else {
+            ixcb.above.offset   = ixcb.cur_offset;
+            ixcb.above.nentries = (ip->len - sizeof(dt_index_t)) /
+              sizeof(dt_index_entry_t);
+            ixcb.hi = ixcb.mid;
+          }
+          next_probe();
+          continue;
+
+        case IXS_ENTRY:
+          if (ixcb.entry < 0) {
+            /* found_offset already set to below (or front) */
+            ixcb.err = SUCCESS;
+            post ix_done_task();
+            return;
+          }
+          dlen = sizeof(dt_index_entry_t);
+          err = call DMF.mapAll(0, (uint8_t **) &ep, ixcb.above.offset +
+                                sizeof(dt_index_t) +
+                                ixcb.entry * sizeof(dt_index_entry_t), &dlen);
+          if (err == EBUSY)
+            return;
+          if (err) {                    /* use what we have */
+            ixcb.entry = -1;
+            continue;
+          }
+          if (dlen != sizeof(dt_index_entry_t) || !ep)
+            call Panic.panic(PANIC_SS, 46, dlen, (parg_t) ep, 1, 0);
+          if (ix_pos(ep->offset) >= ix_pos(ixcb.found_offset) &&
+              ix_pos(ep->offset) <  ix_pos(ixcb.above.offset) &&
+              at_or_before(ep->recnum, &ep->rt)) {
+            ixcb.found_offset = ep->offset;
+            ixcb.entry = -1;
+            continue;
+          }
+          ixcb.entry--;
+          continue;
+      }
+    }
+  }
+
+
+  error_t ix_start(uint8_t cid) {
+    uint32_t eof;
+
+    if (ixcb.state != IXS_IDLE)
+      return EBUSY;
+    eof = call DMF.filesize(0);
+    if (eof <= IX_FIRST_OFFSET)
+      return EINVAL;                    /* nothing there */
+    ixcb.cid   = cid;
+    ixcb.lo    = 0;
+    ixcb.first = 0;
+    ixcb.tail  = call DblkManager.tail_offset();
+    if (ixcb.tail) {
+      ixcb.area   = (call DblkManager.get_dblk_high() -
+                     call DblkManager.get_dblk_low() + 1) << SD_BLOCKSIZE_NBITS;
+      ixcb.nspans = (ixcb.area + INDEX_SPAN - 1) / INDEX_SPAN;
+      ixcb.first  = ixcb.tail / INDEX_SPAN;
+      ixcb.hi     = ixcb.nspans + 1;    /* the tail's span twice */
+    } else {
+      ixcb.nspans = (eof + INDEX_SPAN - 1) / INDEX_SPAN;
+      ixcb.hi     = ixcb.nspans;
+    }
+    ixcb.below.offset = 0;
+    ixcb.above.offset = 0;
+    ixcb.found_offset = 0;
+    ixcb.err = SUCCESS;
+    next_probe();
+    call IndexTimer.startOneShot(10000);        /* ten second deadman */
+    ix_search();
+    return SUCCESS;
+  }
+
+
+  command error_t DblkIndex.find_recnum[uint8_t cid](uint32_t recnum) {
+    if (ixcb.state != IXS_IDLE)
+      return EBUSY;
+    if (!recnum)
+      return EINVAL;
+    ixcb.by_time = FALSE;
+    ixcb.recnum  = recnum;
+    return ix_start(cid);
+  }
+
+
+  command error_t DblkIndex.find_time[uint8_t cid](rtctime_t *rtp) {
+    if (ixcb.state != IXS_IDLE)
+      return EBUSY;
+    if (!rtp)
+      return EINVAL;
+    ixcb.by_time = TRUE;
+    ixcb.rt      = *rtp;
+    return ix_start(cid);
+  }
+
+
+  command uint32_t DblkIndex.offset[uint8_t cid]() {
+    return (ixcb.state != IXS_IDLE) ? 0 : ixcb.found_offset;
+  }
+
+
+  event void DMF.data_avail(error_t err) {
+    if (ixcb.state == IXS_IDLE)
+      call Panic.panic(PANIC_SS, 46, 0, 0, 0, 0);
+    ix_search();
+  }
+
+
+  event void IndexTimer.fired() {
+    /* deadman timer expired */
+    call Panic.panic(PANIC_SS, 47, ixcb.state, ixcb.cur_offset, 0, 0);
+  }
+
+
+  default event void DblkIndex.done[uint8_t cid](error_t err, uint32_t offset) {
+    call Panic.panic(PANIC_SS, 48, cid, 0, 0, 0);
+  }
+
+  async event void Panic.hook() { }
+}
@@ -30,13 +30,30 @@ interface DblkManager {
   /* return the next abs blk_id that will be written next */
   async command uint32_t get_dblk_nxt();
 
+  /*
+   * return abs blk_id of the oldest data.  lower + 1 unless a circular
+   * DBLK has started eating its tail (see dblk_dir.h).
+   */
+  async command uint32_t get_dblk_tail();
+
   /*
    * return current file relative offset of dblk_nxt (from dblk_low)
    * this is the file offset of the next block to be written.
    */
   async command uint32_t dblk_nxt_offset();
 
-  /* advance dblk_nxt and return the new value */
+  /*
+   * return file offset of the tail once a circular DBLK has wrapped (the
+   * head is in front of the tail), 0 otherwise.  The data stream then
+   * runs from the tail to the end of the area and on from the front up
+   * to dblk_nxt.
+   */
+  async command uint32_t tail_offset();
+
+  /*
+   * advance dblk_nxt and return the new value.  0 says we ran off the
+   * end, circular wraps back to the front instead.
+   */
   async command uint32_t adv_dblk_nxt();
 
   /* return current record number */
@@ -51,6 +68,18 @@ interface DblkManager {
   /* return offset of 1st record written after boot, SYNC/R */
   async command uint32_t boot_offset();
 
+  /* return file offset of the last SYNC (found at boot, or from Collect) */
+  async command uint32_t last_sync_offset();
+
+  /*
+   * checkpoint: Collect has laid down a SYNC at sync_offset.
+   *
+   * seal is set on the way down (shutdown_flush) once SSW has pushed
+   * everything out to the SD.  The noinit checkpoint is then exact and the
+   * next boot can skip looking for the end of the dblk.  See dblk_dir.h.
+   */
+  async command void checkpoint(uint32_t sync_offset, bool seal);
+
   /**
    * validate a contiguous header
    *
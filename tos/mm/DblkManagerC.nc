@@ -27,6 +27,8 @@
  * on what DblkManager does.
  */
 
+#include <slab_arena.h>
+
 configuration DblkManagerC {
   provides {
     interface Boot        as Booted;    /* out Booted signal */
@@ -47,7 +49,7 @@ implementation {
   Booted = DMP;
   Boot   = DMP;
 
-  components new SD0_ArbC() as SD, SSWriteC;
+  components new DblkSDC() as SD, SSWriteC;
   components FileSystemC, SD0C;
   components ResyncC;
   components Crc8C;
@@ -57,6 +59,8 @@ implementation {
   DMP.SSW        -> SSWriteC;
   DMP.SDResource -> SD;
   DMP.SDread     -> SD;
+  DMP.SDwrite    -> SD;
+  DMP.SDerase    -> SD;
   DMP.SDraw      -> SD0C;
   DMP.FileSystem -> FileSystemC;
   DMP.DMF        -> FileSystemC.DblkFileMap[DMF_CID];
@@ -70,4 +74,10 @@ implementation {
 
   components CollectC;
   DMP.CollectEvent -> CollectC;
+
+  components SlabArenaC;
+  DMP.SlabArena -> SlabArenaC.SlabArena[SLAB_OWNER_DM];
+
+  components SSWPolicyC;
+  DMP.SDChar -> SSWPolicyC;
 }
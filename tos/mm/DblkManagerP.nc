@@ -29,18 +29,45 @@
  * On boot the DblkManager will keep track of its limits (start/end) and
  * which data block to use next.  On Boot it will use a binary search to
  * find the first empty data block within the Dblk Area.
+ *
+ * Fast boot: if the noinit checkpoint (dblk_ckpt, see dblk_dir.h) was
+ * sealed on the way down, it says exactly where the stream ended.  Check
+ * that dblk_nxt is erased and dblk_nxt - 1 isn't and we are done, no
+ * scan, no resync, no record walk.  Anything off and we do it the long
+ * way.
+ *
+ * Cold boot: the checkpoint mirrored in the directory sector is a lower
+ * bound for dblk_nxt.  Gallop out from it (1, 2, 4, ... sectors) until
+ * we hit an erased sector and binary search the last step.
+ *
+ * The mirror write borrows its sector buffer from the slab arena for
+ * the length of the write.  If nothing can be spared we skip it, the
+ * next mirror will catch up.
+ *
+ * Circular (DBLK_CIRCULAR, see dblk_dir.h): dblk_nxt wraps instead of
+ * going to 0 (full).  We erase the oldest unit when the head gets
+ * within DBLK_ERASE_AHEAD units of the tail and mirror the new tail.
+ * The scan looks for the first sector that is erased or older (recnum)
+ * than the sector it started on, then probes unit starts past that
+ * for the tail.
  */
 
 #include <panic.h>
 #include <platform_panic.h>
 #include <sd.h>
 #include <typed_data.h>
+#include <dblk_dir.h>
+#include <dblk_sd.h>
 
 typedef enum {
   DMS_IDLE = 0,                         /* doing nothing */
   DMS_REQUEST,                          /* resource requested */
+  DMS_DIR,                              /* read dblk dir, look at ckpts */
+  DMS_CKPT,                             /* ckpt dblk_nxt, chk empty */
+  DMS_CKPT1,                            /* ckpt dblk_nxt - 1, chk written */
   DMS_START,                            /* read first block, chk empty */
   DMS_SCAN,                             /* scanning for 1st blank */
+  DMS_TAIL,                             /* circular, find the tail */
   DMS_SYNC,                             /* find last sync record */
   DMS_LAST_REC,                         /* find last record after last sync */
   DMS_DONE,
@@ -56,6 +83,10 @@ enum {
 #endif
 
 
+/* survives reboots, Collect seals it in shutdown_flush */
+noinit dblk_ckpt_t dblk_ckpt;
+
+
 module DblkManagerP {
   provides {
     interface Boot        as Booted;    /* signals OutBoot */
@@ -65,6 +96,8 @@ module DblkManagerP {
     interface Boot;                     /* incoming boot signal */
     interface FileSystem;
     interface SDread;
+    interface SDwrite;
+    interface SDerase;
     interface SDraw;
     interface SSWrite as SSW;
     interface Resource as SDResource;
@@ -75,6 +108,8 @@ module DblkManagerP {
     interface Crc<uint8_t> as Crc8;
     interface Panic;
     interface CollectEvent;
+    interface SlabArena;
+    interface SDChar;
   }
 }
 
@@ -92,12 +127,17 @@ implementation {
      * file offsets are file relative so the first record in the
      *   first data sector is at file offset 0x200 which lives in
      *   absolute sector (fo / 512) + lower.
+     *
+     * With the DBLK striped across two SDs (dblk_sd.h) blk_ids are
+     *   logical and dblk_upper is past the physical end of the area,
+     *   DblkSDP sorts out which card.
      */
     uint32_t dblk_lower;                /* inclusive  */
                                         /* lower is where dir is */
     /* next blk_id to write */
     uint32_t dblk_nxt;                  /* 0 means full          */
     uint32_t dblk_upper;                /* inclusive  */
+    uint32_t dblk_tail;                 /* oldest data, circular */
 
     dm_state_t dm_state;
 
@@ -105,6 +145,7 @@ implementation {
     uint32_t boot_recnum;               /* record number when we booted */
     uint32_t boot_offset;               /* offset of 1st boot record, SYNC/R */
     uint32_t cur_recnum;                /* current record number */
+    uint32_t last_sync_offset;          /* last SYNC, from Collect */
     uint32_t dm_sig_b;
 
   } dmc;
@@ -112,18 +153,362 @@ implementation {
   /* search for last record */
   uint32_t   cur_offset;              // offset of current search
   uint32_t   found_offset;            // valid last record offset
+  uint32_t   last_end;                // walk up to here
   dt_header_t found_hdr;              // found record header
 
   uint8_t     *dm_buf;
   uint32_t     lower, cur_blk, upper;
   bool         do_erase = 0;
 
+  /* checkpoint/fast boot */
+  dblk_dir_t   dm_dir;                  /* copy of the directory */
+  bool         have_dir;                /* dm_dir is good, ok to mirror */
+  dblk_ckpt_t  dm_mirror;               /* ckpt from the dir sector */
+  uint32_t     ckpt_hint;               /* dblk_nxt lower bound, 0 none */
+  uint32_t     gallop;                  /* gallop step, 0 binary search */
+  bool         mirroring;               /* dir write in progress */
+  uint16_t     mirror_syncs;            /* syncs since last mirror */
+  uint8_t     *dm_dir_buf;              /* borrowed, while mirroring */
+  dblk_sdchar_t dm_sdchar;              /* SD characterisation, dir sector */
+
+#ifdef DBLK_CIRCULAR
+  uint32_t     scan_r0;                 /* recnum at scan start, 0 none */
+  uint8_t      tail_probes;             /* unit starts left to look at */
+  bool         erase_want;              /* head is close to the tail */
+  bool         erasing;                 /* have the SD for an erase */
+#endif
+
 
   void dm_panic(uint8_t where, parg_t p0, parg_t p1) {
     call Panic.panic(PANIC_DM, where, p0, p1, 0, 0);
   }
 
 
+  uint32_t quad_sum(void *p, uint16_t quads) {
+    uint32_t *p32, sum;
+
+    p32 = p;
+    for (sum = 0; quads; quads--)
+      sum += *p32++;
+    return sum;
+  }
+
+
+  bool dir_valid(dblk_dir_t *dp) {
+    return (dp->dblk_dir_sig   == DBLK_DIR_SIG &&
+            dp->dblk_dir_sig_a == DBLK_DIR_SIG &&
+            quad_sum(dp, DBLK_DIR_QUADS) == 0  &&
+            dp->dblk_low  == dmc.dblk_lower    &&
+            dp->dblk_high == call FileSystem.area_end(FS_LOC_DBLK));
+  }
+
+
+  bool sdchar_valid(dblk_sdchar_t *scp) {
+    return (scp->sdc_sig   == DBLK_SDCHAR_SIG &&
+            scp->sdc_sig_a == DBLK_SDCHAR_SIG &&
+            quad_sum(scp, DBLK_SDCHAR_QUADS) == 0);
+  }
+
+
+  /*
+   * a checkpoint has to be intact, for this dblk area, and make sense.
+   * dblk_nxt 0 (full) isn't worth trying to be clever about.
+   */
+  bool ckpt_valid(dblk_ckpt_t *cp) {
+    if (cp->ckpt_sig != DBLK_CKPT_SIG || cp->ckpt_sig_a != DBLK_CKPT_SIG)
+      return FALSE;
+    if (quad_sum(cp, DBLK_CKPT_QUADS))
+      return FALSE;
+    if (cp->dblk_low != dmc.dblk_lower || cp->dblk_high != dmc.dblk_upper)
+      return FALSE;
+    if (cp->dblk_nxt <= dmc.dblk_lower || cp->dblk_nxt > dmc.dblk_upper)
+      return FALSE;
+#ifdef DBLK_CIRCULAR
+    /* once wrapped the last SYNC can be anywhere */
+    if (cp->dblk_tail <= dmc.dblk_lower || cp->dblk_tail > dmc.dblk_upper)
+      return FALSE;
+#else
+    if (cp->last_sync_offset >=
+        ((cp->dblk_nxt - dmc.dblk_lower) << SD_BLOCKSIZE_NBITS))
+      return FALSE;
+#endif
+    return TRUE;
+  }
+
+
+  /*
+   * the directory says how the DBLK was laid down.  A striped DBLK is
+   * garbage any other way.  Mirrored is a good single on SD0.  Stamp our
+   * mode, it goes out with the next checkpoint mirror.
+   */
+  void dir_sd_mode() {
+    if (dm_dir.sd_mode == DBLK_SD_MODE)
+      return;
+    if (dm_dir.sd_mode == DBLK_SD_STRIPE || DBLK_SD_MODE == DBLK_SD_STRIPE) {
+      if (dm_dir.sd_mode != DBLK_SD_SINGLE)
+        dm_panic(14, dm_dir.sd_mode, DBLK_SD_MODE);
+    }
+    dm_dir.sd_mode = DBLK_SD_MODE;
+    dm_dir.chksum  = 0;
+    dm_dir.chksum  = 0 - quad_sum(&dm_dir, DBLK_DIR_QUADS);
+  }
+
+
+  void ckpt_fill(dblk_ckpt_t *cp, uint8_t flags) {
+    cp->ckpt_sig         = DBLK_CKPT_SIG;
+    cp->dblk_low         = dmc.dblk_lower;
+    cp->dblk_high        = dmc.dblk_upper;
+    cp->dblk_nxt         = dmc.dblk_nxt;
+    cp->cur_recnum       = dmc.cur_recnum;
+    cp->last_sync_offset = dmc.last_sync_offset;
+    call Rtc.getTime(&cp->last_rt);
+    cp->flags            = flags;
+    cp->pad              = 0;
+#ifdef DBLK_CIRCULAR
+    cp->dblk_tail        = dmc.dblk_tail;
+#else
+    cp->dblk_tail        = 0;
+#endif
+    cp->ckpt_sig_a       = DBLK_CKPT_SIG;
+    cp->chksum           = 0;
+    cp->chksum           = 0 - quad_sum(cp, DBLK_CKPT_QUADS);
+  }
+
+
+  void dm_release() {
+    if (call OW.getLoggingFlag(OW_LOG_SD))
+      call CollectEvent.logEvent(DT_EVENT_SD_REL, SD0_DM, 0,0,0);
+    call SDResource.release();
+  }
+
+
+#ifdef DBLK_CIRCULAR
+  task void erase_task();
+
+  /* number of data sectors */
+  uint32_t dm_span() {
+    return dmc.dblk_upper - dmc.dblk_lower;
+  }
+
+
+  /* a blk_id that went past the end comes around to the front */
+  uint32_t dm_wrap(uint32_t blk) {
+    if (blk > dmc.dblk_upper)
+      blk -= dm_span();
+    return blk;
+  }
+
+
+  /* sectors going forward from a to b */
+  uint32_t dm_dist(uint32_t a, uint32_t b) {
+    return (b >= a) ? b - a : b + dm_span() - a;
+  }
+
+
+  /* start of the erase unit after the one blk is in */
+  uint32_t dm_unit_nxt(uint32_t blk) {
+    blk -= (blk - dmc.dblk_lower - 1) % DBLK_ERASE_UNIT;
+    blk += DBLK_ERASE_UNIT;
+    if (blk > dmc.dblk_upper)
+      blk = dmc.dblk_lower + 1;
+    return blk;
+  }
+
+
+  /*
+   * head getting close to the tail?  Ask for the tail unit to be
+   * erased.  tail == dblk_nxt is a fresh DBLK, all of it is ahead of us.
+   */
+  void erase_check() {
+    uint32_t gap;
+
+    gap = dm_dist(dmc.dblk_nxt, dmc.dblk_tail);
+    if (!gap)
+      gap = dm_span();
+    if (gap >= DBLK_ERASE_AHEAD * DBLK_ERASE_UNIT)
+      return;
+    atomic {
+      if (erase_want)
+        return;
+      erase_want = TRUE;
+    }
+    post erase_task();
+  }
+
+
+  /*
+   * recnum of the first record that starts in this sector, 0 if we
+   * can't find one.  The sector starts in the middle of whatever was
+   * going on so a good header has to be followed by good headers up to
+   * the end of the sector (or zero pad, SYNC_FLUSH).
+   */
+  bool hdr_plausible(dt_header_t *hp) {
+    return (hp->len >= sizeof(dt_header_t) && hp->len <= DT_MAX_RLEN &&
+            hp->dtype < DT_MAX && call DblkManager.hdrValid(hp));
+  }
+
+
+  uint32_t sect_recnum(uint8_t *dp) {
+    dt_header_t *hp;
+    uint32_t     off, nxt;
+
+    for (off = 0; off + sizeof(dt_header_t) <= SD_BLOCKSIZE; off += 4) {
+      hp = (void *) &dp[off];
+      if (!hdr_plausible(hp))
+        continue;
+      nxt = (off + hp->len + 3) & ~3UL;
+      while (nxt + sizeof(dt_header_t) <= SD_BLOCKSIZE) {
+        if (((dt_header_t *) &dp[nxt])->len == 0)
+          nxt = SD_BLOCKSIZE;           /* pad out to the end */
+        else if (hdr_plausible((void *) &dp[nxt]))
+          nxt = (nxt + ((dt_header_t *) &dp[nxt])->len + 3) & ~3UL;
+        else
+          break;
+      }
+      if (nxt + sizeof(dt_header_t) <= SD_BLOCKSIZE)
+        continue;                       /* chain broke, not a header */
+      return hp->recnum;
+    }
+    return 0;
+  }
+#endif
+
+
+  /*
+   * scanning, is this sector on the far side of the stream.  Erased, or
+   * circular and older than the sector the scan started on.  A sector
+   * we can't get a recnum out of goes with what it looks like, written.
+   */
+  bool scan_empty(uint8_t *dp) {
+#ifdef DBLK_CIRCULAR
+    uint32_t r;
+#endif
+
+    if (call SDraw.chk_erased(dp))
+      return TRUE;
+#ifdef DBLK_CIRCULAR
+    if (scan_r0 && (r = sect_recnum(dp)) && r < scan_r0)
+      return TRUE;
+#endif
+    return FALSE;
+  }
+
+
+  /* circular scans run past the end and come around */
+  uint32_t scan_blk(uint32_t blk) {
+#ifdef DBLK_CIRCULAR
+    return dm_wrap(blk);
+#else
+    return blk;
+#endif
+  }
+
+
+  /* circular, offsets past the end of the area are the front again */
+  uint32_t dm_fold(uint32_t offset) {
+#ifdef DBLK_CIRCULAR
+    if (offset >= ((dm_span() + 1) << SD_BLOCKSIZE_NBITS))
+      offset -= dm_span() << SD_BLOCKSIZE_NBITS;
+#endif
+    return offset;
+  }
+
+
+  /*
+   * use a timestamp from the dblk as a candidate for the current
+   * datetime.
+   */
+  void rt_candidate(rtctime_t *rtp) {
+    rtctime_t cur_time;
+
+    if (call Rtc.rtcValid(rtp)) {
+      call Rtc.getTime(&cur_time);
+      if (call Rtc.compareTimes(&cur_time, rtp) < 0) {
+        /*
+         * dblk header time is better than cur_time.  (later than cur_time).
+         * however our clock might be fast, so gps will be trying to reset
+         * to an earlier time than dblk.  We don't want to do that.  So only
+         * use the dblk value if time_src is < GPS0.
+         */
+        if (call OW.getRtcSrc() < RTCSRC_GPS0) {
+          /* would be nice to have a CollectEvent here */
+          call OW.setRtcSrc(RTCSRC_DBLK);
+          call Rtc.syncSetTime(rtp);
+        }
+      }
+    }
+  }
+
+
+  task void mirror_task() {
+    if (!have_dir || mirroring || dmc.dm_state != DMS_DONE)
+      return;
+#ifdef DBLK_CIRCULAR
+    if (erasing)
+      return;                           /* eraseDone mirrors */
+#endif
+    mirroring = TRUE;
+    if (call OW.getLoggingFlag(OW_LOG_SD))
+      call CollectEvent.logEvent(DT_EVENT_SD_REQ, (dmc.dm_state << 16) | SD0_DM, 0,0,0);
+    if (call SDResource.request())
+      mirroring = FALSE;
+  }
+
+
+#ifdef DBLK_CIRCULAR
+  /* head is close to the tail, go get the SD and eat the oldest unit */
+  task void erase_task() {
+    if (dmc.dm_state != DMS_DONE || mirroring || erasing)
+      return;                           /* writeDone gets us going */
+    erasing = TRUE;
+    if (call OW.getLoggingFlag(OW_LOG_SD))
+      call CollectEvent.logEvent(DT_EVENT_SD_REQ, (dmc.dm_state << 16) | SD0_DM, 0,0,0);
+    if (call SDResource.request()) {
+      erasing = FALSE;
+      atomic erase_want = FALSE;        /* next sector written tries again */
+    }
+  }
+#endif
+
+
+  /* directory with a fresh checkpoint out to the SD, FALSE no buffer */
+  bool mirror_write() {
+    error_t err;
+
+    dm_dir_buf = call SlabArena.alloc();
+    if (!dm_dir_buf)
+      return FALSE;
+
+    /* rest of the dir sector is zeros, see tagfmtsd */
+    memset(dm_dir_buf, 0, SD_BLOCKSIZE);
+    memcpy(dm_dir_buf, &dm_dir, sizeof(dm_dir));
+    ckpt_fill((void *) &dm_dir_buf[DBLK_CKPT_OFFSET], 0);
+
+    /* SD characterisation, whatever SSWPolicy is using now */
+    if (call SDChar.get_sd_char(&dm_sdchar)) {
+      dm_sdchar.chksum = 0;
+      dm_sdchar.chksum = 0 - quad_sum(&dm_sdchar, DBLK_SDCHAR_QUADS);
+      memcpy(&dm_dir_buf[DBLK_SDCHAR_OFFSET], &dm_sdchar, sizeof(dm_sdchar));
+    }
+    if ((err = call SDwrite.write(dmc.dblk_lower, dm_dir_buf)))
+      dm_panic(11, err, 0);
+    return TRUE;
+  }
+
+
+  void boot_done() {
+    dmc.dm_state = DMS_DONE;
+    atomic mirror_syncs = 0;
+    post mirror_task();                 /* where we are, for next time */
+#ifdef DBLK_CIRCULAR
+    erase_check();
+#endif
+
+    // finally, let rest of system start run
+    signal Booted.booted();
+  }
+
+
   event void Boot.booted() {
     error_t err;
 
@@ -136,6 +521,7 @@ implementation {
     nop();                              /* BRK */
     if (do_erase) {
       do_erase = 0;
+      dblk_ckpt.ckpt_sig = 0;
       call FileSystem.erase(FS_LOC_DBLK);
     }
 #endif
@@ -146,15 +532,24 @@ implementation {
       dm_panic(1, lower, upper);
       return;
     }
+    upper = DBLK_SD_UPPER(lower, upper);        /* striped, logical */
+#ifdef DBLK_CIRCULAR
+    if (upper - lower < (DBLK_ERASE_AHEAD + 3) * DBLK_ERASE_UNIT) {
+      dm_panic(15, lower, upper);       /* too small to go around */
+      return;
+    }
+#endif
     dmc.dm_sig_a = dmc.dm_sig_b = DM_SIG;
 
     /* first sector is dblk directory, reserved */
     dmc.dblk_lower = lower;
     dmc.dblk_nxt   = lower + 1;
     dmc.dblk_upper = upper;
+    dmc.dblk_tail  = lower + 1;
     dmc.cur_recnum = 0;
     dmc.boot_recnum = 1;
     dmc.boot_offset = 512;
+    dmc.last_sync_offset = 0;
     dmc.dm_state = DMS_REQUEST;
     if (call OW.getLoggingFlag(OW_LOG_SD))
       call CollectEvent.logEvent(DT_EVENT_SD_REQ, (dmc.dm_state << 16) | SD0_DM, 0,0,0);
@@ -166,28 +561,124 @@ implementation {
 
   event void SDResource.granted() {
     error_t err;
+#ifdef DBLK_CIRCULAR
+    uint32_t blk_e;
+
+    if (erasing && dmc.dm_state == DMS_DONE) {
+      blk_e = dmc.dblk_tail + DBLK_ERASE_UNIT - 1;
+      if (blk_e > dmc.dblk_upper)
+        blk_e = dmc.dblk_upper;         /* last unit is short */
+      if ((err = call SDerase.erase(dmc.dblk_tail, blk_e)))
+        dm_panic(16, err, dmc.dblk_tail);
+      return;
+    }
+#endif
+
+    if (mirroring && dmc.dm_state == DMS_DONE) {
+      if (!mirror_write()) {
+        mirroring = FALSE;              /* no buffer, next time */
+        dm_release();
+      }
+      return;
+    }
 
     if (dmc.dm_state != DMS_REQUEST) {
       dm_panic(3, dmc.dm_state, 0);
       return;
     }
 
-    dmc.dm_state = DMS_START;
+    dmc.dm_state = DMS_DIR;
     dm_buf = call SSW.get_temp_buf();
     if (!dm_buf) {
       dm_panic(4, (parg_t) dm_buf, 0);
       return;
     }
-    if ((err = call SDread.read(dmc.dblk_nxt, dm_buf))) {
+    if ((err = call SDread.read(dmc.dblk_lower, dm_buf))) {
       dm_panic(5, err, 0);
       return;
     }
   }
 
 
+  event void SDwrite.writeDone(uint32_t blk_id, uint8_t *buf, error_t err) {
+    if (!mirroring || !buf || buf != dm_dir_buf || blk_id != dmc.dblk_lower)
+      dm_panic(13, blk_id, (parg_t) buf);
+    call SlabArena.free(dm_dir_buf);
+    dm_dir_buf = NULL;
+
+    /*
+     * a failed mirror only costs a longer scan next cold boot, the
+     * SSW will have plenty to say about a sick SD.
+     */
+    mirroring = FALSE;
+    dm_release();
+#ifdef DBLK_CIRCULAR
+    if (erase_want)
+      post erase_task();
+#endif
+  }
+
+
+  /*
+   * circular, the tail unit is gone.  The tail moves up to the next
+   * unit and goes out to the directory while we still have the SD.
+   * A failed erase leaves the tail where it is, the next sector
+   * written will have us try again.
+   */
+  event void SDerase.eraseDone(uint32_t blk_start, uint32_t blk_end, error_t err) {
+#ifdef DBLK_CIRCULAR
+    if (!erasing)
+      dm_panic(16, blk_start, blk_end);
+    erasing = FALSE;
+    atomic {
+      erase_want = FALSE;
+      if (!err && dmc.dblk_tail == blk_start)
+        dmc.dblk_tail = dm_unit_nxt(blk_start);
+    }
+    if (!err)
+      erase_check();                    /* still too close, another */
+    mirroring = TRUE;
+    if (have_dir && mirror_write())
+      return;
+    mirroring = FALSE;
+    dm_release();
+    if (erase_want)
+      post erase_task();
+#endif
+  }
+
+
+  /* checkpoint no good, find the end of the dblk the hard way */
+  void start_scan(uint8_t *dp) {
+    error_t err;
+
+    dmc.dblk_nxt = ckpt_hint ? ckpt_hint : dmc.dblk_lower + 1;
+    dmc.dm_state = DMS_START;
+    if ((err = call SDread.read(dmc.dblk_nxt, dp)))
+      dm_panic(5, err, 1);
+  }
+
+
+  /* checkpoint checked out, pick up where it says */
+  task void ckpt_resume_task() {
+    if (dmc.dm_state != DMS_CKPT1)
+      dm_panic(12, dmc.dm_state, 1);
+    dmc.cur_recnum       = dblk_ckpt.cur_recnum;
+    dmc.boot_recnum      = dmc.cur_recnum + 1;
+    dmc.boot_offset      = call DblkManager.dblk_nxt_offset();
+    dmc.last_sync_offset = dblk_ckpt.last_sync_offset;
+#ifdef DBLK_CIRCULAR
+    dmc.dblk_tail        = dblk_ckpt.dblk_tail;
+#endif
+    dblk_ckpt.ckpt_sig   = 0;           /* used, Collect reseals */
+    dm_release();
+    rt_candidate(&dblk_ckpt.last_rt);
+    boot_done();
+  }
+
+
   void task dblk_last_task() {
     dt_header_t *hdr;
-    rtctime_t   cur_time;
     uint32_t    dlen;
     error_t     err;
     bool        done = FALSE;
@@ -195,7 +686,7 @@ implementation {
     if (dmc.dm_state != DMS_LAST_REC)
       dm_panic(12, dmc.dm_state, 0);
 
-    while (!done && (cur_offset < call DblkManager.dblk_nxt_offset())) {
+    while (!done && (cur_offset < last_end)) {
       dlen = sizeof(dt_header_t);
       err = call DMF.mapAll(0, (uint8_t **) &hdr, cur_offset, &dlen);
       switch (err) {
@@ -211,6 +702,14 @@ implementation {
              */
             cur_offset += hdr->len;
             cur_offset = (cur_offset + 3) & ~(3UL);
+
+            /*
+             * SYNC_FLUSH closes the sector early (SSWPolicy.flush), the
+             * rest is zero pad.  Records pick up at the next sector.
+             */
+            if (found_hdr.dtype == DT_SYNC_FLUSH)
+              cur_offset = (cur_offset + SD_BLOCKSIZE - 1) &
+                ~((uint32_t) SD_BLOCKSIZE - 1);
           } else
             done = TRUE;
           break;
@@ -232,33 +731,97 @@ implementation {
     dmc.boot_recnum = dmc.cur_recnum + 1;
 
     /* use timestamp as candidate for current datetime */
-    if (call Rtc.rtcValid(&found_hdr.rt)) {
-      call Rtc.getTime(&cur_time);
-      if (call Rtc.compareTimes(&cur_time, &found_hdr.rt) < 0) {
-        /*
-         * dblk header time is better than cur_time.  (later than cur_time).
-         * however our clock might be fast, so gps will be trying to reset
-         * to an earlier time than dblk.  We don't want to do that.  So only
-         * use the dblk value if time_src is < GPS0.
-         */
-        if (call OW.getRtcSrc() < RTCSRC_GPS0) {
-          /* would be nice to have a CollectEvent here */
-          call OW.setRtcSrc(RTCSRC_DBLK);
-          call Rtc.syncSetTime(&found_hdr.rt);
-        }
-      }
+    rt_candidate(&found_hdr.rt);
+    boot_done();
+  }
+
+
+  /* end of dblk has been determined, now need to find last valid record to
+   * calculate the record number and datetime to start with.
+   *
+   * we start by first finding the last valid sync record. this is accomplished
+   * by calling Resync.start() with the terminal address set to  sixteen sectors
+   * before the end of dblk. This indicates we want to search backwards which
+   * should bring us to the last sync record.
+   *
+   * if we find the sync record immediately, then we can start the search for
+   * for the last record. otherwise we need to wait for the search to complete
+   * when Resync.done() event is called.
+   *
+   * check that the terminal offset is not set before start of dblk file (wrapped)
+   *
+   * boot_offset points at the first offset we will use next.  boot_recnum can't
+   * be set until after we have found the last record actually written.  See the
+   * SYNC code.
+   */
+  void find_last_sync() {
+    uint32_t term_offset;
+    error_t  err;
+
+    dmc.dm_state = DMS_SYNC;
+    dm_release();
+    cur_offset = call DblkManager.dblk_nxt_offset();
+    dmc.boot_offset = cur_offset;
+    last_end = cur_offset;
+#ifdef DBLK_CIRCULAR
+    /*
+     * just wrapped, the last SYNC is back at the end of the area.  Look
+     * back from past the end, SS.where folds it around to the front.
+     */
+    if (dmc.dblk_tail > dmc.dblk_nxt && cur_offset < (17 * SD_BLOCKSIZE)) {
+      cur_offset += dm_span() << SD_BLOCKSIZE_NBITS;
+      last_end = cur_offset;
     }
-    dmc.dm_state = DMS_DONE;
+#endif
+    /*
+     * nothing past the directory, a freshly formatted card.  No SYNC to
+     * find, cur_recnum/boot_recnum are already 0/1 from Boot.booted.
+     */
+    if (cur_offset <= SD_BLOCKSIZE) {
+      boot_done();
+      return;
+    }
+    term_offset = (cur_offset < (16 * SD_BLOCKSIZE)) ? 0 : cur_offset - (16 * SD_BLOCKSIZE);
+    err = call Resync.start(&cur_offset, term_offset);
+    switch (err) {
+      case SUCCESS:
+        dmc.last_sync_offset = dm_fold(cur_offset);
+        dmc.dm_state = DMS_LAST_REC;
+        post dblk_last_task();
+        break;
+      case EBUSY:
+        break;
+      default:
+        dm_panic(22, err, 0);
+    }
+  }
 
-    // finally, let rest of system start run
-    signal Booted.booted();
+
+  /*
+   * dblk_nxt is known.  Circular also needs the tail, the first unit
+   * start past the erased gap that has something in it.  The gap is
+   * never more than DBLK_ERASE_AHEAD + 1 units.  Nothing there, we
+   * haven't been around yet and the tail is the front.
+   */
+  void tail_start(uint8_t *dp) {
+#ifdef DBLK_CIRCULAR
+    error_t err;
+
+    dmc.dblk_tail = dmc.dblk_lower + 1;
+    tail_probes   = DBLK_ERASE_AHEAD + 2;
+    cur_blk       = dm_unit_nxt(dmc.dblk_nxt);
+    dmc.dm_state  = DMS_TAIL;
+    if ((err = call SDread.read(cur_blk, dp)))
+      dm_panic(8, err, 3);
+#else
+    find_last_sync();
+#endif
   }
 
 
   event void SDread.readDone(uint32_t blk_id, uint8_t *read_buf, error_t err) {
     uint8_t    *dp;
     bool        empty;
-    uint32_t    term_offset;
 
     nop();
     nop();                              /* BRK */
@@ -273,25 +836,108 @@ implementation {
         dm_panic(7, dmc.dm_state, 0);
         return;
 
+      case DMS_DIR:
+        /*
+         * the directory tells us whether we can mirror into it, and
+         * may hold a checkpoint hint.  Then see if the noinit
+         * checkpoint was sealed on the way down.
+         */
+        have_dir  = dir_valid((void *) dp);
+        ckpt_hint = 0;
+        if (have_dir) {
+          memcpy(&dm_dir, dp, sizeof(dm_dir));
+          dir_sd_mode();
+          memcpy(&dm_mirror, &dp[DBLK_CKPT_OFFSET], sizeof(dm_mirror));
+          if (ckpt_valid(&dm_mirror))
+            ckpt_hint = dm_mirror.dblk_nxt;
+          memcpy(&dm_sdchar, &dp[DBLK_SDCHAR_OFFSET], sizeof(dm_sdchar));
+          if (sdchar_valid(&dm_sdchar))
+            call SDChar.set_sd_char(&dm_sdchar);
+        }
+        if (!ckpt_valid(&dblk_ckpt) || !(dblk_ckpt.flags & DBLK_CKPT_EXACT)) {
+          dblk_ckpt.ckpt_sig = 0;
+          start_scan(dp);
+          return;
+        }
+        dmc.dblk_nxt = dblk_ckpt.dblk_nxt;
+        dmc.dm_state = DMS_CKPT;
+        if ((err = call SDread.read(dmc.dblk_nxt, dp)))
+          dm_panic(8, err, 1);
+        return;
+
+      case DMS_CKPT:
+        /* next to write has to be erased, and the one before not */
+        if (!call SDraw.chk_erased(dp)) {
+          start_scan(dp);
+          return;
+        }
+        dmc.dm_state = DMS_CKPT1;
+        cur_blk = dmc.dblk_nxt - 1;
+#ifdef DBLK_CIRCULAR
+        if (cur_blk == dmc.dblk_lower && dblk_ckpt.dblk_tail > dmc.dblk_nxt)
+          cur_blk = dmc.dblk_upper;     /* just wrapped, end of the area */
+#endif
+        if (cur_blk == dmc.dblk_lower) {
+          post ckpt_resume_task();      /* empty, nothing more to check */
+          return;
+        }
+        if ((err = call SDread.read(cur_blk, dp)))
+          dm_panic(8, err, 2);
+        return;
+
+      case DMS_CKPT1:
+        if (call SDraw.chk_erased(dp)) {
+          start_scan(dp);
+          return;
+        }
+        post ckpt_resume_task();
+        return;
+
       case DMS_START:
         /* if blk is erased, dmc.dblk_nxt is already correct. */
         if (call SDraw.chk_erased(dp))
           break;
         lower = dmc.dblk_nxt;
         upper = dmc.dblk_upper;
+#ifdef DBLK_CIRCULAR
+        scan_r0 = sect_recnum(dp);
+        if (ckpt_hint)
+          upper = lower + dm_span() - 1;        /* once around */
+#endif
 
-        cur_blk = (upper - lower)/2 + lower;
-        if (cur_blk == lower)
-          cur_blk = lower = upper;
+        if (ckpt_hint && lower < upper) {
+          /* mirror says we are close, gallop out from it */
+          gallop  = 1;
+          cur_blk = lower + 1;
+        } else {
+          gallop  = 0;
+          cur_blk = (upper - lower)/2 + lower;
+          if (cur_blk == lower)
+            cur_blk = lower = upper;
+        }
 
         dmc.dm_state = DMS_SCAN;
-        if ((err = call SDread.read(cur_blk, dp)))
+        if ((err = call SDread.read(scan_blk(cur_blk), dp)))
           dm_panic(8, err, 0);
         return;
 
       case DMS_SCAN:
-        empty = call SDraw.chk_erased(dp);
-        if (empty)
+        empty = scan_empty(dp);
+        if (gallop) {
+          if (empty) {
+            upper  = cur_blk;           /* found the far side */
+            gallop = 0;
+          } else {
+            lower = cur_blk;
+            if (lower < upper) {
+              gallop <<= 1;
+              cur_blk = ((upper - lower) > gallop) ? lower + gallop : upper;
+              if ((err = call SDread.read(scan_blk(cur_blk), dp)))
+                dm_panic(10, err, 1);
+              return;
+            }
+          }
+        } else if (empty)
           upper = cur_blk;
         else
           lower = cur_blk;
@@ -301,7 +947,7 @@ implementation {
            * if empty we be good.  Otherwise no available storage.
            */
           if (empty) {
-            dmc.dblk_nxt = cur_blk;
+            dmc.dblk_nxt = scan_blk(cur_blk);
             break;              /* break out of switch, we be done */
           }
           dm_panic(9, (parg_t) cur_blk, 0);
@@ -314,48 +960,27 @@ implementation {
         cur_blk = (upper - lower)/2 + lower;
         if (cur_blk == lower)
           cur_blk = lower = upper;
-        if ((err = call SDread.read(cur_blk, dp)))
+        if ((err = call SDread.read(scan_blk(cur_blk), dp)))
           dm_panic(10, err, 0);
         return;
-    }
-
-    /* end of dblk has been determined, now need to find last valid record to
-     * calculate the record number and datetime to start with.
-     *
-     * we start by first finding the last valid sync record. this is accomplished
-     * by calling Resync.start() with the terminal address set to  sixteen sectors
-     * before the end of dblk. This indicates we want to search backwards which
-     * should bring us to the last sync record.
-     *
-     * if we find the sync record immediately, then we can start the search for
-     * for the last record. otherwise we need to wait for the search to complete
-     * when Resync.done() event is called.
-     *
-     * check that the terminal offset is not set before start of dblk file (wrapped)
-     *
-     * boot_offset points at the first offset we will use next.  boot_recnum can't
-     * be set until after we have found the last record actually written.  See the
-     * SYNC code.
-     */
 
-    dmc.dm_state = DMS_SYNC;
-    if (call OW.getLoggingFlag(OW_LOG_SD))
-      call CollectEvent.logEvent(DT_EVENT_SD_REL, SD0_DM, 0,0,0);
-    call SDResource.release();
-    cur_offset = call DblkManager.dblk_nxt_offset();
-    dmc.boot_offset = cur_offset;
-    term_offset = (cur_offset < (16 * SD_BLOCKSIZE)) ? 0 : cur_offset - (16 * SD_BLOCKSIZE);
-    err = call Resync.start(&cur_offset, term_offset);
-    switch (err) {
-      case SUCCESS:
-        dmc.dm_state = DMS_LAST_REC;
-        post dblk_last_task();
-        break;
-      case EBUSY:
-        break;
-      default:
-        dm_panic(22, err, 0);
+#ifdef DBLK_CIRCULAR
+      case DMS_TAIL:
+        /* first unit start past the gap with something in it */
+        if (!call SDraw.chk_erased(dp))
+          dmc.dblk_tail = cur_blk;
+        else if (--tail_probes) {
+          cur_blk = dm_unit_nxt(cur_blk);
+          if ((err = call SDread.read(cur_blk, dp)))
+            dm_panic(8, err, 4);
+          return;
+        }
+        find_last_sync();
+        return;
+#endif
     }
+
+    tail_start(dp);
   }
 
 
@@ -365,6 +990,7 @@ implementation {
       dm_panic(33, dmc.dm_state, offset);
     if (err == SUCCESS) {
         cur_offset = offset;
+        dmc.last_sync_offset = dm_fold(offset);
         dmc.dm_state = DMS_LAST_REC;
         post dblk_last_task();
     } else
@@ -394,6 +1020,11 @@ implementation {
   }
 
 
+  async command uint32_t DblkManager.get_dblk_tail() {
+    return dmc.dblk_tail;
+  }
+
+
   async command uint32_t DblkManager.dblk_nxt_offset() {
     if (dmc.dblk_nxt)
       return (dmc.dblk_nxt - dmc.dblk_lower) << SD_BLOCKSIZE_NBITS;
@@ -401,12 +1032,32 @@ implementation {
   }
 
 
+  async command uint32_t DblkManager.tail_offset() {
+#ifdef DBLK_CIRCULAR
+    uint32_t tail;
+
+    tail = (dmc.dblk_tail - dmc.dblk_lower) << SD_BLOCKSIZE_NBITS;
+    if (tail > call DblkManager.dblk_nxt_offset())
+      return tail;
+#endif
+    return 0;
+  }
+
+
   async command uint32_t DblkManager.adv_dblk_nxt() {
     atomic {
       if (dmc.dblk_nxt) {
         dmc.dblk_nxt++;
+#ifdef DBLK_CIRCULAR
+        if (dmc.dblk_nxt > dmc.dblk_upper)
+          dmc.dblk_nxt = dmc.dblk_lower + 1;    /* around we go */
+        if (dmc.dblk_nxt == dmc.dblk_tail)
+          dmc.dblk_tail = dm_unit_nxt(dmc.dblk_tail);   /* erase fell behind */
+        erase_check();
+#else
         if (dmc.dblk_nxt > dmc.dblk_upper)
           dmc.dblk_nxt = 0;
+#endif
       }
     }
     return dmc.dblk_nxt;
@@ -433,6 +1084,33 @@ implementation {
   }
 
 
+  async command uint32_t DblkManager.last_sync_offset() {
+    return dmc.last_sync_offset;
+  }
+
+
+  /*
+   * Collect tells us about every SYNC it lays down.  Every
+   * DBLK_CKPT_MIRROR we mirror where we are into the directory.  seal
+   * comes from shutdown_flush after SSW has flushed everything, that
+   * is the one that makes the noinit checkpoint exact.
+   */
+  async command void DblkManager.checkpoint(uint32_t sync_offset, bool seal) {
+    atomic {
+      dmc.last_sync_offset = sync_offset;
+      if (seal) {
+        if (dmc.dm_state == DMS_DONE)   /* only if we know where we are */
+          ckpt_fill(&dblk_ckpt, DBLK_CKPT_EXACT);
+        return;
+      }
+      if (++mirror_syncs < DBLK_CKPT_MIRROR)
+        return;
+      mirror_syncs = 0;
+    }
+    post mirror_task();
+  }
+
+
   /*
    * Validate a header by verifing its CRC.
    *
@@ -462,5 +1140,8 @@ implementation {
 
   event void FileSystem.eraseDone(uint8_t which) { }
 
+  /* dm_dir_buf only lives across one mirror write, nothing to give back */
+  event void SlabArena.reclaim() { }
+
   async event void Panic.hook() { }
 }
@@ -34,6 +34,8 @@
 #include <typed_data.h>
 #include <sd0_users.h>
 #include <overwatch.h>
+#include <TagnetAdapter.h>
+#include <slab_arena.h>
 
 /*
  * DblkMapFile provides a virtualization of dblk stream storage
@@ -50,88 +52,80 @@
  * cached those bytes will be retured with no further disk activity.
  *
  * In MAP_ALL mode, all bytes requested must be in the cache
- * to satisfy the request.  If a partial number of bytes are
- * currently in the cache, these will be saved and the remainder
- * of the bytes brought in from the appropriate sector.
- *
- * MAP_ALL works both in a forward as well as a reverse direction.
- * Forward occurs when the partial is at the end of a sector and
- * new bytes are brought in from the following (forward) sector.
- * If the partial bytes requested occur at the start of the
- * cache, then we will fetch the previous sector (backward).
- *
- * If no portion of the requested data is in the cache, a full miss
- * occurs resulting in bringing in the sector that contains the
- * first part of any requested data.
+ * to satisfy the request.  MAP_ALL is limited to MAX_MAP_ALL bytes
+ * so a request can straddle at most one sector boundary.
  *
  * If the requested data can't be resolved without going past the
  * current EOF, an error return of EODATA (end of data) will
  * be returned.
  *
- * The size of the cache needs to be at least the size of one
- * disk sector in both modes.  When using MAP_ALL, we want to
- * end with all requested bytes in the cahce.  The maximum
- * size that can be requested will be a sector size + the size
- * any additional data that can be handled.  For our typical case,
- * of a sync header, this will be 24 bytes + 512 bytes.
+ * Cache
+ *
+ * The cache is sector slots, each holding one whole (quad aligned)
+ * sector of the dblk file, tagged with its file offset.  Slots are
+ * recycled least recently used first.
+ *
+ * Slot memory comes from the slab arena.  DMF_CACHE_SECTORS of them are
+ * always there (SLAB_RSV_DMF).  When all the slots are busy and the
+ * arena has slabs to lend we borrow rather than recycle, up to
+ * DMF_CACHE_MAX.  So when the rest of the system is quiet a download
+ * gets a bigger cache.  When someone else needs the slabs (arena
+ * reclaim) we give back the least recently used extras that aren't
+ * being read into.
+ *
+ * A map request is a hit when the sector holding offset is in a slot
+ * (MAP_ANY), or for MAP_ALL when every requested byte is in slots.  A
+ * MAP_ALL that straddles two sectors is assembled into the client's
+ * straddle buffer and the pointer returned points there.  Either way, a
+ * returned pointer is good until that client's next map call.
+ *
+ * On a miss, SS.where tells where the missing sector lives.  If it is
+ * still in Stream Storage memory (waiting to go out, or the partial
+ * buffer Collect is working on) it is copied into a slot and the
+ * request completes right away.  The slot holds only what SS gave us
+ * (quad granular), a later request past that goes back to SS.
  *
- * The steps below illustrate the MAP_ALL mode of operation
- * in the case where the requested data spans the disk sector
- * boundary. The DMF.mapAll() call must satisfy access to all
- * bytes requested or return busy while it assembles the right
- * data into the cache.  Assembling the data requires saving
- * some of the current sector to be prepended/appended to the
- * next sector of dblk file data retrieved. Once all data is in
- * the cache, the DMF.mapAll() call will succeed with
- * the cache address where offset of data starts and at
- * least length amount of data available.
+ * If the sector is on disk, the client is queued for it and gets EBUSY.
+ * data_avail is signalled to the client when the read completes and the
+ * client tries again.
  *
- * (1)  Cache state has one sector worth of data with last
- *      four bytes having the value '1234'
- *       {offset=0, blk_id=1, len=512, data=[...1234]}
- * (2)  User call DMF.mapAll requesting offset=508 and len=8
- * (2a) Call copy_block(src=508, dst=0, len=4) to copy the
- *      portion of data in the cache that partially satisfies
- *      the mapAll request from the end of the cache to the
- *      beginning, since it will be prepended to any additional
- *      data retrieved
- * (2b) Call SS.where(offset,...) to find out where more data
- *      can be found (in stream buffers or on disk). In this
- *      example, the call returns a new blk_id=2 specifying the
- *      next sector of data to retrieve from disk
- * (2c) Cache state after prepended data copy
- *       {offset=508,blk_id=2,len=4,data=[1234]}
- * (2d) Initiate SD read using (blk_id, &cache[cache.len], 512)
- *      to retrieve the next 512 bytes of data. It will be stored
- *      immediately after prepend data in cache (partial data
- *      from previous sector)
- * (2e) DMF.mapAll call returns <= (EBUSY) to indiate that it
- *      is busy handling the callers request
- * (3)  Time passes as disk read is performed
- * (4)  Signal of sd.readDone(sector=blk_id, buf=&cache[cache.len],
- *      len=512) verifies and updates state information based
- *      on success of the sector read.
- * (4a) Cache state after SD.readDone() success shows that the
- *      cache offset has been advanced to where the prepended
- *      data starts and the length includes both the prepend
- *      as well as the sector of data just read from disk.
- *       {offset=508,blk_id=2,len=516,data=[1234abcd...]}
- * (4b) DMF.data_avail() is called to signal that new data is
- *      available for user
- * (5)  Time passes as user task is scheduled
- * (6)  User calls DMF.mapAll(offset=508, len=8) again to
- *      see if data is now available.
- * (6a) Returns <= (SUCCESS, data=[1234abcd], len=8) succcess
- *      with pointer to cache where data is found and length
- *      that is equal to amount requested
+ * Read-ahead
  *
- * The control structure includes various data cells that indicate
- * the current state of the DblkMap system.
+ * Downloads (DblkBytes) and the Resync/Index searches walk the file
+ * forward.  If a miss is for the sector just past the last one read
+ * from the SD, we are being accessed sequentially and we read the
+ * sector along with up to DMF_READ_AHEAD sectors following it in one
+ * multi-block (CMD18) read while the SD is powered up.  Read-ahead
+ * stops short of sectors already cached and of sectors that haven't
+ * made it to the disk yet.
  *
- * Only one map() call can be pending at a time.  Either the map call
- * can be satisfied immediately (cache hit) or the underlying data store
- * will be accessed using split phase.  While this underlying read
- * is pending any other map() calls will be aborted with EBUSY.
+ * DMF_READ_AHEAD is at most DMF_CACHE_SECTORS - 2, a fill always
+ * leaves at least one slot that isn't being read into for SS copies
+ * made while the read is in flight.
+ *
+ * Clients
+ *
+ * Each client (cid, DblkMapFile.cid) has its own context: what it is
+ * waiting on, its own sequential detection, and its own straddle
+ * buffer.  The slots are shared, so Resync, DblkManager, DblkIndex and
+ * the tagnet DblkBytes reader all see each other's sectors.
+ *
+ * Only one SD read is in flight at a time.  Misses are queued, one
+ * entry per client, and served in order.  A client missing on a sector
+ * that the in-flight read is bringing in just waits on that read, and
+ * when a read completes every queued client whose sector came in is
+ * released.  Reads of the same block are coalesced.  A client only sees
+ * EBUSY for its own miss, hits and SS copies go through while another
+ * client's read is in flight.
+ *
+ * A MAP_ALL straddle copies the front half into the client's straddle
+ * buffer before going after the back half, so the front sector can be
+ * recycled by other clients in the meantime.
+ *
+ * Counters (hits, misses, sectors read, read-ahead, etc.) are kept in
+ * dmf_stats and are available through the DblkCacheStats tagnet
+ * adapter (<dblk>/.cache).  A PUT to .cache zeros them.  Use them to
+ * tune DMF_CACHE_SECTORS per platform.
  *
  * The cache is quad (4-byte) aligned and quad granular therefore
  * copies to the cache are quad aligned. Note that the Map interface
@@ -139,23 +133,52 @@
  */
 
 /*
- * CACHE_SIZE    amount of memory allocated for holding dblk data
- *               including space for one disk sector and largest
- *               amount of prepended data required by MapAll. This
- *               is currently defined as enough space to hold the
- *               sync record in support of sync search. This also
- *               covers the case of space for generic record
- *               header, which is part of the sync record. The
- *               maximum prepend length is one word less than the
- *               entire structure, since this is the worst case
- *               (otherwise the map would have succeeded)
- * MAX_MAP_ALL   maximum amount of data that can be prepended
- *               when handling MAP_ALL mode.
- * CACHE_WORD    granular size of cache is one 32-bit word
+ * DMF_CACHE_SECTORS  number of sector slots always in the cache (min
+ *                    2), at most the DMF slab reservation.  A platform
+ *                    can override in its platform.h.
+ * DMF_CACHE_MAX      most slots, the rest borrowed from the arena.
+ * DMF_READ_AHEAD     max number of sectors read ahead on a
+ *                    sequential miss, <= DMF_CACHE_SECTORS - 2.
+ * MAX_MAP_ALL        maximum amount of data that can be requested in
+ *                    MAP_ALL mode.  Currently the size of a sync record
+ *                    in support of sync search.  This also covers the
+ *                    generic record header, which is part of the sync
+ *                    record.
+ * STRADDLE_SIZE      room for a MAP_ALL rounded out to quads on
+ *                    both ends.
+ * CACHE_WORD         granular size of cache is one 32-bit word
  */
+#ifndef DMF_CACHE_SECTORS
+#define DMF_CACHE_SECTORS SLAB_RSV_DMF
+#endif
+
+#ifndef DMF_CACHE_MAX
+#define DMF_CACHE_MAX SLAB_MAX_DMF
+#endif
+
+#ifndef DMF_READ_AHEAD
+#define DMF_READ_AHEAD (DMF_CACHE_SECTORS - 2)
+#endif
+
+#if DMF_CACHE_SECTORS < 2
+#error "DMF_CACHE_SECTORS must be at least 2"
+#endif
+
+#if DMF_CACHE_SECTORS > SLAB_RSV_DMF || DMF_CACHE_MAX > SLAB_MAX_DMF
+#error "DMF cache sectors don't fit the DMF slab reservation/max"
+#endif
+
+#if DMF_CACHE_MAX < DMF_CACHE_SECTORS
+#error "DMF_CACHE_MAX must be at least DMF_CACHE_SECTORS"
+#endif
+
+#if DMF_READ_AHEAD > (DMF_CACHE_SECTORS - 2)
+#error "DMF_READ_AHEAD must be <= DMF_CACHE_SECTORS - 2"
+#endif
+
 #define MAX_MAP_ALL (sizeof(dt_sync_t))
-#define CACHE_SIZE (SD_BLOCKSIZE + MAX_MAP_ALL)
 #define CACHE_WORD (sizeof(uint32_t))
+#define STRADDLE_SIZE (MAX_MAP_ALL + 2 * CACHE_WORD)
 
 /*
  * Modes of operation provided by mapit.
@@ -178,22 +201,89 @@ typedef enum {
   DMF_IO_ERROR,
 } dmf_io_state_t;
 
+
+/*
+ * dmf_slot_t     one sector of the cache.
+ *
+ * stamp is the lru clock value of the last use, 0 says the slot is
+ * free.  A slot with a stamp but len 0 is waiting on an SD read.  buf
+ * NULL says the slot has no memory (not borrowed), it is never used.
+ */
+typedef struct {
+  uint8_t             *buf;          // slab holding the sector
+  uint32_t             offset;       // logical file offset of the sector
+  uint32_t             len;          // bytes valid, 0 = empty
+  uint32_t             id;           // physical blk number, info only
+  uint32_t             stamp;        // lru, last use
+  bool                 ahead;        // read-ahead, not yet used
+} dmf_slot_t;
+
+
 /*
- * dblk_map_cache_t   defines the information context representing
+ * dmf_stats_t    cache counters, exported via tagnet (<dblk>/.cache).
+ */
+typedef struct {
+  uint32_t             hits;         // map calls satisfied from the cache
+  uint32_t             misses;       // sectors needed from the SD
+  uint32_t             ss_copies;    // sectors copied from SS memory
+  uint32_t             sd_reads;     // SD read transactions
+  uint32_t             sd_blocks;    // sectors read from the SD
+  uint32_t             ahead;        // sectors read ahead
+  uint32_t             ahead_hits;   // read ahead sectors that got used
+  uint32_t             evictions;    // valid sectors recycled
+  uint32_t             coalesced;    // misses served by another's read
+  uint16_t             sectors;      // DMF_CACHE_SECTORS
+  uint16_t             read_ahead;   // DMF_READ_AHEAD
+  uint16_t             slots;        // slots with memory now
+  uint16_t             slots_max;    // most ever, arena high water
+  uint32_t             returned;     // borrowed slots given back
+} dmf_stats_t;
+
+
+typedef enum {
+  DMF_CL_IDLE = 0,
+  DMF_CL_QUEUED,                     // waiting its turn for the SD
+  DMF_CL_READING,                    // waiting on the in-flight read
+} dmf_cl_state_t;
+
+
+/*
+ * dmf_client_t   per client (cid) context.
+ *
+ * part_offset/part_len, front half of a MAP_ALL straddle already in
+ * straddle, part_len 0 says none.
+ */
+typedef struct {
+  dmf_cl_state_t       state;
+  uint32_t             need;         // sector offset waiting on
+  uint32_t             context;      // context of the request
+  uint32_t             seq_offset;   // just past last sector read for us
+  uint32_t             part_offset;  // straddle front, quad aligned
+  uint32_t             part_len;
+  uint8_t              straddle[STRADDLE_SIZE] __attribute__ ((aligned (4)));
+} dmf_client_t;
+
+
+/*
+ * dblk_map_control_t defines the information context representing
  *                    the dblk file cache.
  */
 typedef struct {
-  struct {
-    uint32_t             offset;     // logical file offset of cached data
-    uint32_t             len;        // how much is in the cache, 0 = empty
-    uint32_t             id;         // physical blk number, info only
-    uint32_t      target_offset;     // fill target offset.
-    uint32_t             extra;      // extra data length
-  } cache;
-
-  uint32_t             fill_blk_id;  // absolute SD blk_id in the cache
+  dmf_slot_t           slot[DMF_CACHE_MAX];
+  uint32_t             stamp;        // lru clock
+
+  uint32_t             fill_blk_id;  // first SD blk_id being read, 0 idle
+  uint32_t             fill_offset;  // file offset of fill_blk_id
+  uint16_t             fill_count;   // number of sectors being read
+  uint8_t              fill_slot[DMF_CACHE_SECTORS];
+  uint8_t             *fill_bufs[DMF_CACHE_SECTORS];
+  uint8_t              fill_cid;     // client the read was started for
+
+  uint8_t              q_head;       // request queue, cids
+  uint8_t              q_count;
+  uint8_t              q_max;        // deepest the queue has been
+
   error_t              err;          // last error encountered
-  uint8_t              cid;          // client ID.
   dmf_io_state_t       io_state;
 } dblk_map_control_t;
 
@@ -211,28 +301,37 @@ enum {
 #define RNDBLKUP(n)   (((n) + (SD_BLOCKSIZE-1)) & ~(SD_BLOCKSIZE-1))
 #define RNDBLKDN(n)   ((n) & ~(SD_BLOCKSIZE-1))
 
+enum {
+  DMF_CLIENTS = uniqueCount("DblkMapFile.cid"),
+};
+
 module DblkMapFileP {
-  provides  interface ByteMapFile as DMF[uint8_t cid];
+  provides {
+    interface ByteMapFile as DMF[uint8_t cid];
+    interface TagnetAdapter<tagnet_block_t> as DblkCacheStats;
+  }
   uses {
     interface StreamStorage as SS;
     interface SDread        as SDread;
+    interface SDreadMulti   as SDreadMulti;
     interface Resource      as SDResource;
     interface Panic;
     interface CollectEvent;
     interface OverWatch;
+    interface SlabArena;
   }
 }
 implementation {
   // dlbk control block
   dblk_map_control_t dmf_cb;
-
-  // dblk cache space
-  uint8_t  dmf_cache[CACHE_SIZE] __attribute__ ((aligned (4)));
+  dmf_client_t       dmf_clients[DMF_CLIENTS];
+  uint8_t            dmf_queue[DMF_CLIENTS];
+  dmf_stats_t        dmf_stats;
 
 
   void dmap_panic(uint8_t where, parg_t p0, parg_t p1) {
-    call Panic.panic(PANIC_DM, where, p0, p1, dmf_cb.cache.id,
-                     dmf_cb.cache.len);
+    call Panic.panic(PANIC_DM, where, p0, p1, dmf_cb.fill_blk_id,
+                     dmf_cb.fill_count);
   }
 
   uint32_t copy_block(uint32_t *src, uint32_t *dst, uint32_t count) {
@@ -252,278 +351,347 @@ implementation {
   }
 
 
-  /* return TRUE if offset is inside the current cache */
-  bool in_cache(uint32_t offset) {
-    if (dmf_cb.cache.len == 0)
-      return FALSE;
-    if (dmf_cb.cache.offset <= offset &&
-        offset < dmf_cb.cache.offset + dmf_cb.cache.len)
-      return TRUE;
-    return FALSE;
+  uint8_t *slot_buf(dmf_slot_t *sp) {
+    return sp->buf;
   }
 
 
-  error_t mapit(uint8_t cid, uint32_t context, uint8_t **bufp,
-                uint32_t offset, uint32_t *lenp, dblk_map_mode_t map_mode) {
-    uint32_t    blk_id;
-    uint32_t    len;
-    uint32_t    blk_offset;
-    uint8_t    *blk_buf;
-    uint32_t    len_avail;
-    bool        hit;
-    uint32_t    lower, upper;
-
-    /* if we are in the middle of reading SD data, no new requests */
-    if (dmf_cb.fill_blk_id)
-      return EBUSY;
+  /* return the slot holding sector sect_offset, NULL if not cached */
+  dmf_slot_t *find_slot(uint32_t sect_offset) {
+    dmf_slot_t *sp;
 
-    dmf_cb.cid = cid;
+    for (sp = &dmf_cb.slot[0]; sp < &dmf_cb.slot[DMF_CACHE_MAX]; sp++)
+      if (sp->len && sp->offset == sect_offset)
+        return sp;
+    return NULL;
+  }
 
-    if (!lenp || !bufp)                 /* nulls are very bad */
-      dmap_panic(0, 0, 0);
 
-    /* asking for nothing or more than fits in the cache for mapAll */
-    if ((*lenp == 0) || ((map_mode == MAP_ALL) && (*lenp > MAX_MAP_ALL))) {
-      dmap_panic(3, 0, 0);
+  void touch_slot(dmf_slot_t *sp) {
+    sp->stamp = ++dmf_cb.stamp;
+    if (sp->ahead) {
+      sp->ahead = FALSE;
+      dmf_stats.ahead_hits++;
     }
+  }
 
-    /*
-     * sanity check the cache.  The cache should be both quad aligned
-     * as well as quad granular.
-     */
-    if ((dmf_cb.cache.offset & 3) || (dmf_cb.cache.len & 3))
-      dmap_panic(4, dmf_cb.cache.offset, dmf_cb.cache.len);
 
-    /*
-     * see if we have a cache hit. we will have a cache hit iff:
-     *
-     * MAP_ANY: 1 or more of the requested bytes (starting at offset)
-     * are in the cache.
-     *
-     * MAP_ALL: all requested bytes must be in the cache for a hit.
-     */
-    hit = FALSE;
-    if (dmf_cb.cache.len) {             /* cache valid? */
-      switch (map_mode) {
-        case MAP_ANY:
-          if (in_cache(offset))
-            hit = TRUE;
-          break;
-        case MAP_ALL:
-          if (in_cache(offset) && in_cache(offset + *lenp - 1))
-            hit = TRUE;
-          break;
-        default:
-          break;
+  /* TRUE if sector sect_offset is coming in with the in-flight read */
+  bool in_fill(uint32_t sect_offset) {
+    return (dmf_cb.fill_blk_id &&
+            sect_offset >= dmf_cb.fill_offset &&
+            sect_offset < dmf_cb.fill_offset + dmf_cb.fill_count * SD_BLOCKSIZE);
+  }
+
+
+  /*
+   * claim_slot: get a slot to put sector sect_offset into.
+   *
+   * If the sector is already cached (a partial from SS) reuse that slot,
+   * otherwise recycle the least recently used (free slots have a 0
+   * stamp and go first).  Slots being read into (stamped, len 0) are
+   * off limits.  The slot is stamped so it won't be picked again by the
+   * same fill.
+   *
+   * If there are no free slots, rather than recycle try to give a slot
+   * without memory some.  Under DMF_CACHE_SECTORS this always works.
+   */
+  dmf_slot_t *claim_slot(uint32_t sect_offset) {
+    dmf_slot_t *sp, *lru, *empty;
+
+    lru = find_slot(sect_offset);
+    if (!lru) {
+      empty = NULL;
+      for (sp = &dmf_cb.slot[0]; sp < &dmf_cb.slot[DMF_CACHE_MAX]; sp++) {
+        if (!sp->buf) {
+          if (!empty)
+            empty = sp;
+          continue;
+        }
+        if (sp->stamp && !sp->len)      /* being filled */
+          continue;
+        if (!lru || sp->stamp < lru->stamp)
+          lru = sp;
+      }
+      if (empty && (!lru || lru->stamp)) {
+        empty->buf = call SlabArena.alloc();
+        if (empty->buf) {
+          empty->stamp = 0;
+          lru = empty;
+          dmf_stats.slots++;
+        }
       }
+      if (!lru)
+        dmap_panic(12, sect_offset, 0);
+      if (lru->len)
+        dmf_stats.evictions++;
     }
-    if (hit) {
-      *bufp = &dmf_cache[(offset - dmf_cb.cache.offset)];
+    lru->offset = sect_offset;
+    lru->len    = 0;
+    lru->id     = 0;
+    lru->ahead  = FALSE;
+    lru->stamp  = ++dmf_cb.stamp;
+    return lru;
+  }
 
-      /* check and possibly modify how much data we can make available */
-      len_avail = dmf_cb.cache.offset + dmf_cb.cache.len - offset;
-      if (len_avail < *lenp)
-        *lenp = len_avail;
-      return SUCCESS;
-    }
 
-    /*
-     * Cache Miss.
-     *
-     * If MAP_ALL, check for partial miss.
-     * If partial hit, copy any partial data to where it belongs.
-     * Afterwards, we will lay down a new sector to fill in the
-     * missing data.
-     *
-     * For MAP_ALL, look for any overlap that exists in the cache.
-     * If the overlap is at the end of the cache (forward), copy
-     * the end to the beginning of the cache and fill in behind
-     * the copied data.
-     *
-     * If the overlap is at the beginning (backward), copy the data
-     * to the end of the cache such that it will line up with the
-     * incoming sector data landing in the front of the cache.
-     */
-    hit = FALSE;
-    if (dmf_cb.cache.len) {             /* cache valid? */
-      if (map_mode == MAP_ALL) {
-        /* first check for forward straddle */
-        if (in_cache(offset) && !in_cache(offset + *lenp - 1)) {
-          /*
-           * copy only data that is in current whole sector in cache. Don't
-           * copy anything from extra. This occurs when previous reverse search
-           * filled in cache with extra and then partial miss in forward search
-           * straddles the end of the cache. We can't copy the extra because we
-           * can only read whole sectors and extra is in the next sector.
-           *
-           * Note: can't have partial copy which is greater than MAX_MAP_ALL,
-           * so cache.len will always be correct.
-           */
-          if (RNDBLKDN(offset) == RNDBLKDN(dmf_cb.cache.target_offset)) {
-            lower = RNDWORDDN(offset);
-            dmf_cb.cache.len = dmf_cb.cache.offset + dmf_cb.cache.len - lower;
-            if (dmf_cb.cache.len + SD_BLOCKSIZE > CACHE_SIZE)
-              dmap_panic(5, dmf_cb.cache.extra, 0);
-            copy_block(
-              (uint32_t *) &dmf_cache[lower - dmf_cb.cache.offset],
-              (uint32_t *) &dmf_cache[0],
-              dmf_cb.cache.len);
-            dmf_cb.cache.offset = lower;
-            dmf_cb.cache.target_offset = dmf_cb.cache.offset + dmf_cb.cache.len;
-            dmf_cb.cache.extra = 0;       /* nothing extra */
-            hit = TRUE;
-          }
-        } else
-          if (!in_cache(offset) && in_cache(offset + *lenp - 1)) {
-            /* backward straddle */
-            upper = RNDWORDUP(offset + *lenp);
-            dmf_cb.cache.extra = upper - dmf_cb.cache.offset;
-            if (dmf_cb.cache.extra + SD_BLOCKSIZE > CACHE_SIZE)
-              dmap_panic(6, dmf_cb.cache.extra, 0);
-            copy_block(
-              (uint32_t *) &dmf_cache[0],
-              (uint32_t *) &dmf_cache[SD_BLOCKSIZE],
-              dmf_cb.cache.extra);
-            dmf_cb.cache.target_offset = dmf_cb.cache.offset =
-              RNDBLKDN(offset);
-            dmf_cb.cache.len = 0;       /* for now empty, til we fill */
-            hit = TRUE;                 /* partial hit */
-          }
+  /*
+   * lookup: see if the request can be satisfied out of the cache.
+   *
+   * returns TRUE on a hit, *bufp and *lenp filled in.  On a miss, *needp
+   * is set to the file offset of the sector we need to go get.
+   */
+  bool lookup(dmf_client_t *cp, uint32_t offset, uint8_t **bufp,
+              uint32_t *lenp, dblk_map_mode_t map_mode, uint32_t *needp) {
+    dmf_slot_t *sp, *nsp;
+    uint32_t    sect, len_avail;
+    uint32_t    lower, upper, n;
+
+    sect  = RNDBLKDN(offset);
+    lower = RNDWORDDN(offset);
+    upper = RNDWORDUP(offset + *lenp);
+    n     = sect + SD_BLOCKSIZE - lower;
+
+    /* front of a straddle already put aside?  go for the back half */
+    if (map_mode != MAP_ALL || !cp->part_len ||
+        cp->part_offset != lower || cp->part_len != n ||
+        offset + *lenp <= sect + SD_BLOCKSIZE) {
+      sp = find_slot(sect);
+      if (!sp || offset >= sect + sp->len) {
+        *needp = sect;
+        return FALSE;
       }
+
+      len_avail = sect + sp->len - offset;
+      if (map_mode == MAP_ANY || *lenp <= len_avail) {
+        touch_slot(sp);
+        *bufp = &slot_buf(sp)[offset - sect];
+        if (len_avail < *lenp)
+          *lenp = len_avail;
+        return TRUE;
+      }
+
+      /*
+       * MAP_ALL running off the end of the slot.  A partial slot came
+       * from SS memory and there may be more there now.  Otherwise put
+       * the front aside and go after the next sector.  Sector boundaries
+       * are quad aligned, so rounding the ends out to quads keeps both
+       * copies quad granular.
+       */
+      if (sp->len < SD_BLOCKSIZE) {
+        *needp = sect;
+        return FALSE;
+      }
+      touch_slot(sp);
+      if (upper - lower > STRADDLE_SIZE)
+        dmap_panic(5, lower, upper);
+      cp->part_offset = lower;
+      cp->part_len = copy_block((uint32_t *) &slot_buf(sp)[lower - sect],
+                                (uint32_t *) &cp->straddle[0], n);
     }
-    if (!hit) {                         /* no partial */
-      dmf_cb.cache.len    = 0;          /* nothing in cache */
-      dmf_cb.cache.target_offset = dmf_cb.cache.offset = RNDBLKDN(offset);
-      dmf_cb.cache.extra  = 0;
+
+    nsp = find_slot(sect + SD_BLOCKSIZE);
+    if (!nsp || offset + *lenp > sect + SD_BLOCKSIZE + nsp->len) {
+      *needp = sect + SD_BLOCKSIZE;
+      return FALSE;
+    }
+    touch_slot(nsp);
+    copy_block((uint32_t *) slot_buf(nsp),
+               (uint32_t *) &cp->straddle[n], upper - lower - n);
+    cp->part_len = 0;
+    *bufp = &cp->straddle[offset - lower];
+    return TRUE;
+  }
+
+
+  /*
+   * start_fill: start the SD read for the client at the front of the
+   * queue.
+   *
+   * Read-ahead if the client is walking forward.  Stop at anything
+   * already cached, anything not on the disk yet, or eof.
+   */
+  void start_fill() {
+    dmf_client_t *cp;
+    dmf_slot_t   *sp;
+    uint32_t      sect_offset, blk_id, nxt_id;
+    uint32_t      len, blk_offset;
+    uint8_t      *blk_buf;
+    uint16_t      count, i;
+    uint8_t       cid;
+
+    while (dmf_cb.q_count) {
+      cid = dmf_queue[dmf_cb.q_head];
+      dmf_cb.q_head = (dmf_cb.q_head + 1) % DMF_CLIENTS;
+      dmf_cb.q_count--;
+      cp = &dmf_clients[cid];
+      if (cp->state != DMF_CL_QUEUED)
+        dmap_panic(13, cid, cp->state);
+      sect_offset = cp->need;
+      blk_id = call SS.where(cp->context, sect_offset, &len, &blk_offset, &blk_buf);
+      if (!blk_id || blk_buf || blk_offset != sect_offset)
+        dmap_panic(6, blk_offset, sect_offset);
+
+      count = 1;
+      if (sect_offset == cp->seq_offset) {
+        for (; count <= DMF_READ_AHEAD; count++) {
+          if (find_slot(sect_offset + count * SD_BLOCKSIZE))
+            break;
+          nxt_id = call SS.where(cp->context, sect_offset + count * SD_BLOCKSIZE,
+                                 &len, &blk_offset, &blk_buf);
+          if (nxt_id != blk_id + count || blk_buf)
+            break;
+        }
+      }
+
+      for (i = 0; i < count; i++) {
+        sp = claim_slot(sect_offset + i * SD_BLOCKSIZE);
+        sp->id    = blk_id + i;
+        sp->ahead = (i != 0);
+        dmf_cb.fill_slot[i] = sp - &dmf_cb.slot[0];
+        dmf_cb.fill_bufs[i] = slot_buf(sp);
+      }
+      cp->state = DMF_CL_READING;
+      dmf_cb.fill_cid    = cid;
+      dmf_cb.fill_blk_id = blk_id;
+      dmf_cb.fill_offset = sect_offset;
+      dmf_cb.fill_count  = count;
+      dmf_cb.io_state    = DMF_IO_IDLE;
+      if (call OverWatch.getLoggingFlag(OW_LOG_SD))
+        call CollectEvent.logEvent(DT_EVENT_SD_REQ,
+                                   (dmf_cb.io_state << 16) | SD0_DMF,
+                                   blk_id, count, cid);
+      dmf_cb.err = call SDResource.request();
+      if (dmf_cb.err != SUCCESS) {
+        dmf_cb.io_state = DMF_IO_ERROR;
+        dmap_panic(6, dmf_cb.err, 0);
+        dmf_cb.fill_blk_id  = 0;
+        return;
+      }
+      dmf_cb.io_state = DMF_IO_REQUESTED;
+      return;
     }
-    dmf_cb.cache.id = 0;          /* invalidate blk_id currently in cache*/
+  }
+
+
+  /*
+   * fill: bring sector sect_offset into the cache for client cid.
+   *
+   * returns SUCCESS  sector copied in from SS memory, look again.
+   *         EODATA   past eof.
+   *         EBUSY    on disk, client queued (or waiting on the read
+   *                  already bringing it in), data_avail will be
+   *                  signalled.
+   */
+  error_t fill(uint8_t cid, uint32_t context, uint32_t sect_offset) {
+    dmf_client_t *cp;
+    dmf_slot_t   *sp;
+    uint32_t      blk_id;
+    uint32_t      len;
+    uint32_t      blk_offset;
+    uint8_t      *blk_buf;
 
     /*
-     * Check Stream Storage where more data is located, stream
+     * Check Stream Storage where the data is located, stream
      * buffer or disk, or end of file.
      *
-     * Collect has the last buffer (eof buffer).  Collect only copies
-     * out records that are quad aligned (all header start on quad alignment)
-     * and quad granular (see header alignment).
-     *
-     * That means if we have a partial buffer that we copy into the cache
-     * it will be quad granular and the cache is always an aligned number of
-     * quad bytes.
+     * Collect only copies out records that are quad aligned (all headers
+     * start on quad alignment) and quad granular (see header alignment).
+     * So a partial buffer copied into the cache will be quad granular.
      */
-    blk_id = call SS.where(context,
-                           dmf_cb.cache.target_offset,
-                           &len,
-                           &blk_offset,
-                           &blk_buf);
-    if (!blk_id) {                      /* past eof   */
-      *bufp = NULL;                     /* no result  */
-      *lenp = 0;                        /* no result  */
+    blk_id = call SS.where(context, sect_offset, &len, &blk_offset, &blk_buf);
+    if (!blk_id)                        /* past eof */
       return EODATA;
-    }
 
     /* make sure new data is what we expected in cache alignment */
-    if (blk_offset != dmf_cb.cache.target_offset)
-      dmap_panic(6, blk_offset, dmf_cb.cache.target_offset);
-
-    /*
-     * we got something...
-     *
-     * blk_id     tells where this sector has been or will be written, abs blk_id
-     * len        tells how much data is available.
-     * blk_offset tells the offset of the start of the block.
-     * blk_buf    will have a pointer to a buffer if the data is in memory
-     *
-     * if we have to go get the data from disk, blk_buf will be NULL.
-     */
+    if (blk_offset != sect_offset)
+      dmap_panic(6, blk_offset, sect_offset);
 
     /*
      * data is in Stream Storage memory waiting to go out to SD.
-     * copy it into the cache and update our control cells.
-     *
-     * Also need to account for any data preserved in cache from before.
-     * len coming back from SS.where should be quad granular.
+     * copy it into a slot.
      */
     if (blk_buf) {
-      if (((dmf_cb.cache.len + len) > CACHE_SIZE) || (len & 3))
-        dmap_panic(7, dmf_cb.cache.len, len);
-      dmf_cb.cache.len += copy_block(
-        (uint32_t *) blk_buf,
-        (uint32_t *) &dmf_cache[dmf_cb.cache.target_offset
-                                - dmf_cb.cache.offset],
-        len);
-      dmf_cb.cache.id     = blk_id;
-      /* set bufp return value to address in cache for requested byte offset */
-      *bufp = &dmf_cache[(offset - dmf_cb.cache.offset)];
-
-      /* check and possibly modify how much data we can make available */
-      len_avail = dmf_cb.cache.offset + dmf_cb.cache.len - offset;
-      if (len_avail < *lenp){
-        if (map_mode == MAP_ALL) {
-          /*
-           * MAP_ALL with SS buffers and too few bytes has some corner cases.
-           *
-           * First we check for being beyond the EOF.  Bail out if EOF.  We
-           * check the len that comes back from SS.where and if less than
-           * SD_BLOCKSIZE we can't satisfy the MAP_ALL.  It is the last
-           * valid block in the Stream buffers and is partial.  ie. being
-           * actively worked on by Collect.
-           *
-           * The cache contains partial data copied from a partial write
-           * cache buffer.  And we ran off the end of it.  To avoid cache
-           * coherency problems, we need to invalidate the read cache
-           * (dmf_cache) to force an update from the write cache (stream
-           * writer) if a later request comes in for the same data.
-           *
-           * If not at the EOF, we must be doing a forward straddle.  (Do
-           * we need to verfy this?  Is it true that we can only be doing a
-           * forward straddle?).  We have already updated the cache variables
-           * above for the previous copy in from the SS buffer.  Just call
-           * mapit again.  We are limited to MAX_MAP_ALL so are guaranteed to
-           * update the cache with the remainder of the data we need and will
-           * then terminate successfully.
-           */
-          if (len < SD_BLOCKSIZE) {
-            *bufp = NULL;
-            *lenp = 0;
-            dmf_cb.cache.len = 0;
-            dmf_cb.cache.id  = 0;
-            return EODATA;
-          }
-          /*
-           * length was too small.  We ran off the end of the buffer we just
-           * copied in.  That means we are straddling and there may be more
-           * data.  We call mapit() again with the same parameters to see if
-           * we can copy more data in to satisfy the request.
-           */
-          return mapit(cid, context, bufp, offset, lenp, map_mode);
-        }
-        *lenp = len_avail;
-      }
+      if ((len > SD_BLOCKSIZE) || (len & 3))
+        dmap_panic(7, len, blk_id);
+      sp = claim_slot(sect_offset);
+      sp->len = copy_block((uint32_t *) blk_buf, (uint32_t *) slot_buf(sp), len);
+      sp->id  = blk_id;
+      dmf_stats.ss_copies++;
       return SUCCESS;
     }
 
+    /* on disk */
+    cp = &dmf_clients[cid];
+    cp->need    = sect_offset;
+    cp->context = context;
+    if (in_fill(sect_offset)) {         /* already on its way */
+      cp->state = DMF_CL_READING;
+      dmf_stats.coalesced++;
+      return EBUSY;
+    }
+    dmf_stats.misses++;
+    cp->state = DMF_CL_QUEUED;
+    dmf_queue[(dmf_cb.q_head + dmf_cb.q_count) % DMF_CLIENTS] = cid;
+    if (++dmf_cb.q_count > dmf_cb.q_max)
+      dmf_cb.q_max = dmf_cb.q_count;
+    if (!dmf_cb.fill_blk_id)
+      start_fill();
+    return EBUSY;
+  }
+
+
+  error_t mapit(uint8_t cid, uint32_t context, uint8_t **bufp,
+                uint32_t offset, uint32_t *lenp, dblk_map_mode_t map_mode) {
+    dmf_client_t *cp;
+    uint32_t      need, ss_need;
+    error_t       err;
+
+    if (cid >= DMF_CLIENTS)
+      dmap_panic(1, cid, DMF_CLIENTS);
+    cp = &dmf_clients[cid];
+
+    /* still waiting on a sector from the SD, wait for data_avail */
+    if (cp->state != DMF_CL_IDLE)
+      return EBUSY;
+
+    if (!lenp || !bufp)                 /* nulls are very bad */
+      dmap_panic(0, 0, 0);
+
+    /* asking for nothing or more than fits in the cache for mapAll */
+    if ((*lenp == 0) || ((map_mode == MAP_ALL) && (*lenp > MAX_MAP_ALL))) {
+      dmap_panic(3, 0, 0);
+    }
+
     /*
-     * Read next block of data from SD into the cache.
+     * Look in the cache, on a miss go fill.  A fill out of SS memory
+     * completes immediately so look again.  If we end up needing a
+     * sector we just got from SS then SS doesn't have enough (partial
+     * buffer being worked on by Collect), which is the EOF.
+     *
+     * At most two sectors are involved (MAP_ALL straddle) so this goes
+     * around at most three times.
      */
-    if (dmf_cb.cache.len % CACHE_WORD)          // panic if not word aligned
-      dmap_panic(5, dmf_cb.cache.len, blk_id);
-    if ((sizeof(dmf_cache) - dmf_cb.cache.len) < SD_BLOCKSIZE)
-      dmap_panic(7, dmf_cb.cache.len, sizeof(dmf_cache));
-    dmf_cb.fill_blk_id  = blk_id;
-    dmf_cb.io_state     = DMF_IO_IDLE;
-    if (call OverWatch.getLoggingFlag(OW_LOG_SD))
-      call CollectEvent.logEvent(DT_EVENT_SD_REQ,
-                                 (dmf_cb.io_state << 16) | SD0_DMF,
-                                 0,0,0);
-    dmf_cb.err = call SDResource.request();
-    if (dmf_cb.err != SUCCESS) {
-      dmf_cb.io_state = DMF_IO_ERROR;
-      dmap_panic(6, dmf_cb.err, 0);
-      dmf_cb.fill_blk_id  = 0;
-      return FAIL;
+    ss_need = (uint32_t) -1;
+    while (TRUE) {
+      if (lookup(cp, offset, bufp, lenp, map_mode, &need)) {
+        dmf_stats.hits++;
+        return SUCCESS;
+      }
+      if (need == ss_need)
+        err = EODATA;
+      else
+        err = fill(cid, context, need);
+      if (err != SUCCESS) {
+        if (err == EODATA) {
+          cp->part_len = 0;
+          *bufp = NULL;                 /* no result  */
+          *lenp = 0;
+        }
+        return err;
+      }
+      ss_need = need;
     }
-    dmf_cb.io_state = DMF_IO_REQUESTED;
-    return EBUSY;
   }
 
 
@@ -548,16 +716,87 @@ implementation {
   }
 
 
+  /*
+   * read_done: the in-flight read is finished.
+   *
+   * Everyone waiting on it, and anyone queued for a sector it brought in,
+   * gets data_avail.  The next queued miss (if any) is started before
+   * the signals go out.
+   */
+  void read_done(uint32_t blk_id, error_t err) {
+    dmf_client_t *cp;
+    dmf_slot_t   *sp;
+    uint32_t      ready, fill_end;
+    uint16_t      i;
+    uint8_t       cid;
+
+    if (blk_id != dmf_cb.fill_blk_id)   // panic if wrong read completed
+      dmap_panic(9, err, blk_id);
+    dmap_logRelease();
+    for (i = 0; i < dmf_cb.fill_count; i++) {
+      sp = &dmf_cb.slot[dmf_cb.fill_slot[i]];
+      if (err) {
+        sp->stamp = 0;                  /* back to free */
+        sp->ahead = FALSE;
+        continue;
+      }
+      sp->len = SD_BLOCKSIZE;
+    }
+
+    fill_end = dmf_cb.fill_offset + dmf_cb.fill_count * SD_BLOCKSIZE;
+    ready = 0;
+    for (cid = 0; cid < DMF_CLIENTS; cid++) {
+      cp = &dmf_clients[cid];
+      if (cp->state == DMF_CL_READING ||
+          (cp->state == DMF_CL_QUEUED && in_fill(cp->need))) {
+        if (cp->state == DMF_CL_QUEUED)
+          dmf_stats.coalesced++;
+        cp->state = DMF_CL_IDLE;
+        cp->seq_offset = err ? 0 : fill_end;
+        ready |= (1UL << cid);
+      }
+    }
+    dmf_cb.fill_blk_id = 0;             /* err or success, open lock */
+
+    /* pull anyone released out of the queue */
+    for (i = 0; i < dmf_cb.q_count; ) {
+      cid = dmf_queue[(dmf_cb.q_head + i) % DMF_CLIENTS];
+      if (dmf_clients[cid].state == DMF_CL_QUEUED) {
+        i++;
+        continue;
+      }
+      dmf_queue[(dmf_cb.q_head + i) % DMF_CLIENTS] = dmf_queue[dmf_cb.q_head];
+      dmf_cb.q_head = (dmf_cb.q_head + 1) % DMF_CLIENTS;
+      dmf_cb.q_count--;
+    }
+
+    if (err) {
+      dmf_cb.io_state = DMF_IO_ERROR;
+      dmf_cb.err = err;
+    } else {
+      dmf_stats.sd_reads++;
+      dmf_stats.sd_blocks += dmf_cb.fill_count;
+      dmf_stats.ahead     += dmf_cb.fill_count - 1;
+      dmf_cb.io_state   = DMF_IO_READY;
+    }
+    start_fill();
+
+    for (cid = 0; cid < DMF_CLIENTS; cid++)
+      if (ready & (1UL << cid))
+        signal DMF.data_avail[cid](err);
+  }
+
+
   event void SDResource.granted() {
-    dmf_cb.err = call SDread.read(dmf_cb.fill_blk_id,
-        &dmf_cache[dmf_cb.cache.target_offset - dmf_cb.cache.offset]);
+    if (dmf_cb.fill_count > 1)
+      dmf_cb.err = call SDreadMulti.read(dmf_cb.fill_blk_id,
+                                         dmf_cb.fill_bufs, dmf_cb.fill_count);
+    else
+      dmf_cb.err = call SDread.read(dmf_cb.fill_blk_id, dmf_cb.fill_bufs[0]);
     if (dmf_cb.err) {
       dmf_cb.io_state = DMF_IO_ERROR;
       dmap_panic(8, dmf_cb.err, 0);
-      dmf_cb.fill_blk_id = 0;
-      dmap_logRelease();
-      dmf_cb.io_state = DMF_IO_IDLE;
-      signal DMF.data_avail[dmf_cb.cid](dmf_cb.err);
+      read_done(dmf_cb.fill_blk_id, dmf_cb.err);
       return;
     }
     dmf_cb.io_state = DMF_IO_READING;
@@ -566,22 +805,17 @@ implementation {
 
 
   event void SDread.readDone(uint32_t blk_id, uint8_t *read_buf, error_t err) {
-    if (blk_id != dmf_cb.fill_blk_id ||         // panic if wrong read completed
-        read_buf != &dmf_cache[dmf_cb.cache.target_offset - dmf_cb.cache.offset]
-        || err)
+    if (dmf_cb.fill_count != 1 || read_buf != dmf_cb.fill_bufs[0] || err)
       dmap_panic(9, err, blk_id);
-    dmf_cb.fill_blk_id = 0;             /* err or success, open lock */
-    dmap_logRelease();
-    if (err) {
-      dmf_cb.io_state = DMF_IO_ERROR;
-      dmf_cb.err = err;
-      signal DMF.data_avail[dmf_cb.cid](err);
-      return;
-    }
-    dmf_cb.io_state   = DMF_IO_READY;
-    dmf_cb.cache.id   = blk_id;
-    dmf_cb.cache.len += (SD_BLOCKSIZE + dmf_cb.cache.extra);
-    signal DMF.data_avail[dmf_cb.cid](SUCCESS);
+    read_done(blk_id, err);
+  }
+
+
+  event void SDreadMulti.readDone(uint32_t blk_id, uint8_t **bufs,
+                                  uint16_t count, error_t err) {
+    if (count != dmf_cb.fill_count || bufs != dmf_cb.fill_bufs || err)
+      dmap_panic(9, err, blk_id);
+    read_done(blk_id, err);
   }
 
 
@@ -595,6 +829,58 @@ implementation {
   }
 
 
+  command bool DblkCacheStats.get_value(tagnet_block_t *stats, uint32_t *lenp) {
+    if (!stats || !lenp || *lenp < sizeof(dmf_stats))
+      dmap_panic(11, (parg_t) stats, (parg_t) lenp);
+    dmf_stats.sectors    = DMF_CACHE_SECTORS;
+    dmf_stats.read_ahead = DMF_READ_AHEAD;
+    dmf_stats.slots_max  = call SlabArena.high_water();
+    stats->block = (uint8_t *) &dmf_stats;
+    *lenp = sizeof(dmf_stats);
+    return TRUE;
+  }
+
+
+  /* any put zeros the counters */
+  command bool DblkCacheStats.set_value(tagnet_block_t *stats, uint32_t *lenp) {
+    uint16_t slots;
+
+    slots = dmf_stats.slots;            /* not a counter */
+    memset(&dmf_stats, 0, sizeof(dmf_stats));
+    dmf_stats.slots = slots;
+    return TRUE;
+  }
+
+
+  /*
+   * the arena wants slabs back.  Give back slots past DMF_CACHE_SECTORS,
+   * least recently used first.  Slots being read into are busy, and the
+   * last slot touched is left alone, the client that touched it may
+   * still be looking at it.
+   */
+  event void SlabArena.reclaim() {
+    dmf_slot_t *sp, *lru;
+
+    while (dmf_stats.slots > DMF_CACHE_SECTORS) {
+      lru = NULL;
+      for (sp = &dmf_cb.slot[0]; sp < &dmf_cb.slot[DMF_CACHE_MAX]; sp++) {
+        if (!sp->buf || (sp->stamp && !sp->len))
+          continue;
+        if (sp->stamp && sp->stamp == dmf_cb.stamp)
+          continue;
+        if (!lru || sp->stamp < lru->stamp)
+          lru = sp;
+      }
+      if (!lru)
+        return;
+      call SlabArena.free(lru->buf);
+      memset(lru, 0, sizeof(*lru));
+      dmf_stats.slots--;
+      dmf_stats.returned++;
+    }
+  }
+
+
           event void SS.dblk_stream_full() { }
           event void SS.dblk_advanced(uint32_t last) { }
   async   event void Panic.hook()          { }
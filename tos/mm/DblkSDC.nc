@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkSDC: an SD port for a DBLK user, use in place of SD0_ArbC.
+ *
+ * DBLK_SD_MODE SINGLE (the default) this is just SD0_ArbC.  MIRROR or
+ * STRIPE gets a port on each card, through DblkSDP.  See dblk_sd.h.
+ */
+
+#include <dblk_sd.h>
+
+generic configuration DblkSDC() {
+  provides {
+    interface SDread;
+    interface SDreadMulti;
+    interface SDwrite;
+    interface SDwriteMulti;
+    interface SDerase;
+
+    interface Resource;
+  }
+}
+
+implementation {
+#if DBLK_SD_MODE == DBLK_SD_SINGLE
+  components new SD0_ArbC() as SD;
+
+  Resource     = SD;
+  SDread       = SD;
+  SDreadMulti  = SD;
+  SDwrite      = SD;
+  SDwriteMulti = SD;
+  SDerase      = SD;
+#else
+  enum {
+    CLIENT_ID = unique(DBLK_SD_RESOURCE),
+  };
+
+  components DblkSDP, DblkSDsaC;        /* DblkSDsaC wires DblkSDP */
+  components new SD0_ArbC() as SD0;
+  components new SD1_ArbC() as SD1;
+
+  Resource     = DblkSDP.Resource[CLIENT_ID];
+  SDread       = DblkSDP.SDread[CLIENT_ID];
+  SDreadMulti  = DblkSDP.SDreadMulti[CLIENT_ID];
+  SDwrite      = DblkSDP.SDwrite[CLIENT_ID];
+  SDwriteMulti = DblkSDP.SDwriteMulti[CLIENT_ID];
+  SDerase      = DblkSDP.SDerase[CLIENT_ID];
+
+  DblkSDP.Res0[CLIENT_ID]    -> SD0;
+  DblkSDP.Res1[CLIENT_ID]    -> SD1;
+  DblkSDP.Read0[CLIENT_ID]   -> SD0;
+  DblkSDP.Read1[CLIENT_ID]   -> SD1;
+  DblkSDP.ReadM0[CLIENT_ID]  -> SD0;
+  DblkSDP.ReadM1[CLIENT_ID]  -> SD1;
+  DblkSDP.Write0[CLIENT_ID]  -> SD0;
+  DblkSDP.Write1[CLIENT_ID]  -> SD1;
+  DblkSDP.WriteM0[CLIENT_ID] -> SD0;
+  DblkSDP.WriteM1[CLIENT_ID] -> SD1;
+  DblkSDP.Erase0[CLIENT_ID]  -> SD0;
+  DblkSDP.Erase1[CLIENT_ID]  -> SD1;
+#endif
+}
@@ -0,0 +1,738 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkSD: the DBLK on two SDs, mirrored or striped.  See dblk_sd.h.
+ *
+ * Sits in front of SD0 and SD1 and looks like one SD to the DBLK users
+ * (SSWrite, DblkManager, DblkMapFile).  Each client (DblkSDC) has its
+ * own arbitrated port on each card.  Blocks coming in are DBLK blocks,
+ * logical.  We map them to a card and a physical block, split multi
+ * block runs per card, and put the completions back together.  A client
+ * only gets its completion when every card involved is done.
+ *
+ * Resource: a client needs both cards, request asks for both and
+ * granted goes up when we have both.  All clients ask SD0 then SD1 in
+ * the same call so the two FCFS queues stay in the same order and we
+ * can't end up holding one card each.  Nobody else uses SD1.
+ *
+ * The two cards run on their own SPI ports and drivers so a striped
+ * group programs on both at the same time.
+ *
+ * SDsa (stand alone) is the same thing for the crash path, SSW.flush_all.
+ * SDerase (circular DBLK, DblkManager eating its tail) splits like a
+ * multi block run.
+ */
+
+#include <panic.h>
+#include <platform_panic.h>
+#include <fs_loc.h>
+#include <slab_arena.h>
+#include <dblk_sd.h>
+
+#ifndef PANIC_SS
+enum {
+  __pcode_ss = unique(UQ_PANIC_SUBSYS)
+};
+
+#define PANIC_SS __pcode_ss
+#endif
+
+/* no run of sector buffers can be longer than the arena */
+#define DSD_MAX_MULTI SLAB_COUNT
+
+typedef enum {
+  DSD_IDLE = 0,
+  DSD_READ,
+  DSD_READ_MULTI,
+  DSD_WRITE,
+  DSD_WRITE_MULTI,
+  DSD_ERASE,
+} dsd_op_t;
+
+/*
+ * per client control
+ *
+ * blk/buf/bufs/count:  what the client asked for (logical).
+ * blk_e:               last blk of an erase (logical).
+ * cbufs/cnt/pblk:      per card piece of a multi block run.
+ * pend:                cards still working (1 << card).
+ * granted:             cards we own (1 << card).
+ * failover:            mirror read retried on SD1.
+ */
+typedef struct {
+  dsd_op_t  op;
+  uint32_t  blk;
+  uint32_t  blk_e;
+  uint8_t  *buf;
+  uint8_t **bufs;
+  uint16_t  count;
+  uint8_t  *cbufs[DBLK_SD_CARDS][DSD_MAX_MULTI];
+  uint16_t  cnt[DBLK_SD_CARDS];
+  uint32_t  pblk[DBLK_SD_CARDS];
+  uint8_t   pend;
+  uint8_t   granted;
+  bool      failover;
+  error_t   err;
+} dsd_client_t;
+
+#define DSD_CLIENTS uniqueCount(DBLK_SD_RESOURCE)
+#define DSD_BOTH    ((1 << DBLK_SD_CARDS) - 1)
+
+module DblkSDP {
+  provides {
+    interface Resource     [uint8_t cid];
+    interface SDread       [uint8_t cid];
+    interface SDreadMulti  [uint8_t cid];
+    interface SDwrite      [uint8_t cid];
+    interface SDwriteMulti [uint8_t cid];
+    interface SDerase      [uint8_t cid];
+    interface SDsa;
+  }
+  uses {
+    interface Resource     as Res0    [uint8_t cid];
+    interface Resource     as Res1    [uint8_t cid];
+    interface SDread       as Read0   [uint8_t cid];
+    interface SDread       as Read1   [uint8_t cid];
+    interface SDreadMulti  as ReadM0  [uint8_t cid];
+    interface SDreadMulti  as ReadM1  [uint8_t cid];
+    interface SDwrite      as Write0  [uint8_t cid];
+    interface SDwrite      as Write1  [uint8_t cid];
+    interface SDwriteMulti as WriteM0 [uint8_t cid];
+    interface SDwriteMulti as WriteM1 [uint8_t cid];
+    interface SDerase      as Erase0  [uint8_t cid];
+    interface SDerase      as Erase1  [uint8_t cid];
+    interface SDsa         as SDsa0;
+    interface SDsa         as SDsa1;
+    interface FileSystem;
+    interface Panic;
+  }
+}
+implementation {
+  dsd_client_t dsd[DSD_CLIENTS];
+
+  uint32_t dsd_failovers;               /* mirror reads that went to SD1 */
+
+
+  void dsd_panic(uint8_t where, parg_t p0, parg_t p1) {
+    call Panic.panic(PANIC_SS, where, p0, p1, 0, 0);
+  }
+
+
+  dsd_client_t *dsd_get(uint8_t cid, bool idle) {
+    dsd_client_t *cp;
+
+    if (cid >= DSD_CLIENTS)
+      dsd_panic(30, cid, 0);
+    cp = &dsd[cid];
+    if (idle && cp->op != DSD_IDLE)
+      dsd_panic(30, cid, cp->op);
+    return cp;
+  }
+
+
+  /*
+   * dsd_map: logical blk to card, *pblk gets the physical blk.
+   *
+   * Only striped DBLK data moves.  The directory (lower) and anything
+   * outside the DBLK is card 0, same blk.
+   */
+  uint8_t dsd_map(uint32_t blk, uint32_t *pblk) {
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+    uint32_t lower, s;
+
+    lower = call FileSystem.area_start(FS_LOC_DBLK);
+    if (lower && blk > lower) {
+      s = blk - lower - 1;
+      *pblk = lower + 1 + (s >> 1);
+      return s & 1;
+    }
+#endif
+    *pblk = blk;
+    return 0;
+  }
+
+
+  /* does a write of blk go to both cards */
+  bool dsd_both(uint32_t blk) {
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+    uint32_t lower;
+
+    lower = call FileSystem.area_start(FS_LOC_DBLK);
+    return (!lower || blk <= lower ||
+            blk > DBLK_SD_UPPER(lower, call FileSystem.area_end(FS_LOC_DBLK)));
+#else
+    return TRUE;
+#endif
+  }
+
+
+  /*
+   * dsd_split: split a striped multi block run into per card runs.
+   * The pieces on each card are physically contiguous (the directory at
+   * lower is followed on card 0 by data sector 0 at lower + 1).
+   */
+  void dsd_split(dsd_client_t *cp) {
+    uint32_t pblk;
+    uint16_t i;
+    uint8_t  card;
+
+    if (!cp->count || cp->count > DSD_MAX_MULTI)
+      dsd_panic(33, cp->count, cp->blk);
+    cp->cnt[0] = cp->cnt[1] = 0;
+    for (i = 0; i < cp->count; i++) {
+      card = dsd_map(cp->blk + i, &pblk);
+      if (!cp->cnt[card])
+        cp->pblk[card] = pblk;
+      else if (pblk != cp->pblk[card] + cp->cnt[card])
+        dsd_panic(32, cp->blk + i, pblk);
+      cp->cbufs[card][cp->cnt[card]++] = cp->bufs[i];
+    }
+  }
+
+
+  void dsd_done(uint8_t cid, dsd_client_t *cp, uint8_t card, error_t err) {
+    dsd_op_t op;
+
+    if (!(cp->pend & (1 << card)))
+      dsd_panic(34, cid, card);
+    cp->pend &= ~(1 << card);
+    if (err && !cp->err)
+      cp->err = err;
+    if (cp->pend)
+      return;
+    op = cp->op;
+    cp->op = DSD_IDLE;
+    switch (op) {
+      case DSD_READ:
+        signal SDread.readDone[cid](cp->blk, cp->buf, cp->err);
+        break;
+      case DSD_READ_MULTI:
+        signal SDreadMulti.readDone[cid](cp->blk, cp->bufs, cp->count, cp->err);
+        break;
+      case DSD_WRITE:
+        signal SDwrite.writeDone[cid](cp->blk, cp->buf, cp->err);
+        break;
+      case DSD_WRITE_MULTI:
+        signal SDwriteMulti.writeDone[cid](cp->blk, cp->bufs, cp->count, cp->err);
+        break;
+      case DSD_ERASE:
+        signal SDerase.eraseDone[cid](cp->blk, cp->blk_e, cp->err);
+        break;
+      default:
+        dsd_panic(34, cid, op);
+    }
+  }
+
+
+  /* mirrored read came back bad from SD0, try SD1.  TRUE if started */
+  bool dsd_failover(uint8_t cid, dsd_client_t *cp) {
+#if DBLK_SD_MODE == DBLK_SD_MIRROR
+    error_t err;
+
+    if (cp->failover)
+      return FALSE;
+    cp->failover = TRUE;
+    if (cp->op == DSD_READ)
+      err = call Read1.read[cid](cp->blk, cp->buf);
+    else
+      err = call ReadM1.read[cid](cp->blk, cp->bufs, cp->count);
+    if (err)
+      return FALSE;
+    cp->pend = (1 << 1);
+    dsd_failovers++;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+  }
+
+
+  /*
+   * Resource, both cards or nothing.
+   */
+  command error_t Resource.request[uint8_t cid]() {
+    dsd_client_t *cp;
+    error_t err;
+
+    cp = dsd_get(cid, FALSE);
+    cp->granted = 0;
+    if ((err = call Res0.request[cid]()))
+      return err;
+    if ((err = call Res1.request[cid]()))
+      dsd_panic(31, cid, err);          /* SD0 is already queued */
+    return SUCCESS;
+  }
+
+
+  command error_t Resource.immediateRequest[uint8_t cid]() {
+    dsd_client_t *cp;
+
+    cp = dsd_get(cid, FALSE);
+    if (call Res0.immediateRequest[cid]())
+      return EBUSY;
+    if (call Res1.immediateRequest[cid]()) {
+      call Res0.release[cid]();
+      return EBUSY;
+    }
+    cp->granted = DSD_BOTH;
+    return SUCCESS;
+  }
+
+
+  command error_t Resource.release[uint8_t cid]() {
+    dsd_client_t *cp;
+    error_t err0, err1;
+
+    cp = dsd_get(cid, FALSE);
+    cp->granted = 0;
+    err0 = call Res0.release[cid]();
+    err1 = call Res1.release[cid]();
+    return err0 ? err0 : err1;
+  }
+
+
+  command bool Resource.isOwner[uint8_t cid]() {
+    return call Res0.isOwner[cid]() && call Res1.isOwner[cid]();
+  }
+
+
+  void dsd_granted(uint8_t cid, uint8_t card) {
+    dsd_client_t *cp;
+
+    cp = dsd_get(cid, FALSE);
+    cp->granted |= (1 << card);
+    if (cp->granted == DSD_BOTH)
+      signal Resource.granted[cid]();
+  }
+
+  event void Res0.granted[uint8_t cid]() { dsd_granted(cid, 0); }
+  event void Res1.granted[uint8_t cid]() { dsd_granted(cid, 1); }
+
+
+  /*
+   * single block
+   */
+  command error_t SDread.read[uint8_t cid](uint32_t blk, uint8_t *buf) {
+    dsd_client_t *cp;
+    uint32_t pblk;
+    uint8_t  card;
+    error_t  err;
+
+    cp = dsd_get(cid, TRUE);
+    card = dsd_map(blk, &pblk);
+    err = card ? call Read1.read[cid](pblk, buf)
+               : call Read0.read[cid](pblk, buf);
+    if (err)
+      return err;
+    cp->op = DSD_READ;
+    cp->blk = blk;
+    cp->buf = buf;
+    cp->err = SUCCESS;
+    cp->failover = FALSE;
+    cp->pend = (1 << card);
+    return SUCCESS;
+  }
+
+
+  event void Read0.readDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t err) {
+    dsd_client_t *cp;
+
+    cp = dsd_get(cid, FALSE);
+    if (err && dsd_failover(cid, cp))
+      return;
+    dsd_done(cid, cp, 0, err);
+  }
+
+
+  /* striped piece or a failover, either way it's the answer */
+  event void Read1.readDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 1, err);
+  }
+
+
+  command error_t SDwrite.write[uint8_t cid](uint32_t blk, uint8_t *buf) {
+    dsd_client_t *cp;
+    uint32_t pblk;
+    uint8_t  card;
+    error_t  err;
+
+    cp = dsd_get(cid, TRUE);
+    cp->op  = DSD_WRITE;
+    cp->blk = blk;
+    cp->buf = buf;
+    cp->err = SUCCESS;
+    if (dsd_both(blk)) {
+      if ((err = call Write0.write[cid](blk, buf))) {
+        cp->op = DSD_IDLE;
+        return err;
+      }
+      cp->pend = DSD_BOTH;
+      if ((err = call Write1.write[cid](blk, buf))) {
+        cp->pend = 1;                   /* SD0 still owes us */
+        cp->err  = err;
+      }
+      return SUCCESS;
+    }
+    card = dsd_map(blk, &pblk);
+    err = card ? call Write1.write[cid](pblk, buf)
+               : call Write0.write[cid](pblk, buf);
+    if (err) {
+      cp->op = DSD_IDLE;
+      return err;
+    }
+    cp->pend = (1 << card);
+    return SUCCESS;
+  }
+
+
+  event void Write0.writeDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 0, err);
+  }
+
+
+  event void Write1.writeDone[uint8_t cid](uint32_t blk, uint8_t *buf, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 1, err);
+  }
+
+
+  /*
+   * multi block.  Mirrored reads come off SD0, mirrored writes go to
+   * both.  Striped, each card gets its piece.
+   */
+  error_t dsd_multi(uint8_t cid, dsd_client_t *cp, bool wr) {
+    error_t err;
+    uint8_t card;
+
+#if DBLK_SD_MODE == DBLK_SD_MIRROR
+    if (!cp->count || cp->count > DSD_MAX_MULTI)
+      dsd_panic(33, cp->count, cp->blk);
+    if (wr) {
+      if ((err = call WriteM0.write[cid](cp->blk, cp->bufs, cp->count)))
+        return err;
+      cp->pend = DSD_BOTH;
+      if ((err = call WriteM1.write[cid](cp->blk, cp->bufs, cp->count))) {
+        cp->pend = 1;
+        cp->err  = err;
+      }
+      return SUCCESS;
+    }
+    if ((err = call ReadM0.read[cid](cp->blk, cp->bufs, cp->count)))
+      return err;
+    cp->pend = 1;
+    return SUCCESS;
+#else
+    dsd_split(cp);
+    cp->pend = 0;
+    for (card = 0; card < DBLK_SD_CARDS; card++) {
+      if (!cp->cnt[card])
+        continue;
+      if (wr)
+        err = card ? call WriteM1.write[cid](cp->pblk[1], cp->cbufs[1], cp->cnt[1])
+                   : call WriteM0.write[cid](cp->pblk[0], cp->cbufs[0], cp->cnt[0]);
+      else
+        err = card ? call ReadM1.read[cid](cp->pblk[1], cp->cbufs[1], cp->cnt[1])
+                   : call ReadM0.read[cid](cp->pblk[0], cp->cbufs[0], cp->cnt[0]);
+      if (err) {
+        if (!cp->pend)
+          return err;                   /* nothing started */
+        cp->err = err;                  /* card 0 is running, report it */
+        break;
+      }
+      cp->pend |= (1 << card);
+    }
+    return SUCCESS;
+#endif
+  }
+
+
+  command error_t SDreadMulti.read[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                uint16_t count) {
+    dsd_client_t *cp;
+    error_t err;
+
+    cp = dsd_get(cid, TRUE);
+    cp->op    = DSD_READ_MULTI;
+    cp->blk   = blk;
+    cp->bufs  = bufs;
+    cp->count = count;
+    cp->err   = SUCCESS;
+    cp->failover = FALSE;
+    if ((err = dsd_multi(cid, cp, FALSE)))
+      cp->op = DSD_IDLE;
+    return err;
+  }
+
+
+  event void ReadM0.readDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                          uint16_t count, error_t err) {
+    dsd_client_t *cp;
+
+    cp = dsd_get(cid, FALSE);
+    if (err && dsd_failover(cid, cp))
+      return;
+    dsd_done(cid, cp, 0, err);
+  }
+
+
+  event void ReadM1.readDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                          uint16_t count, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 1, err);
+  }
+
+
+  command error_t SDwriteMulti.write[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                  uint16_t count) {
+    dsd_client_t *cp;
+    error_t err;
+
+    cp = dsd_get(cid, TRUE);
+    cp->op    = DSD_WRITE_MULTI;
+    cp->blk   = blk;
+    cp->bufs  = bufs;
+    cp->count = count;
+    cp->err   = SUCCESS;
+    if ((err = dsd_multi(cid, cp, TRUE)))
+      cp->op = DSD_IDLE;
+    return err;
+  }
+
+
+  event void WriteM0.writeDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                            uint16_t count, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 0, err);
+  }
+
+
+  event void WriteM1.writeDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                            uint16_t count, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 1, err);
+  }
+
+
+  /*
+   * busy stats for the group, both cards.  blk is the logical start,
+   * count is blocks programmed on either card.  The two cards program
+   * at the same time so total_us is card time, not elapsed.
+   */
+  command void SDwriteMulti.busy_stats[uint8_t cid](sd_busy_stats_t *bsp) {
+    dsd_client_t   *cp;
+    sd_busy_stats_t bs1;
+
+    cp = dsd_get(cid, FALSE);
+    call WriteM0.busy_stats[cid](bsp);
+    call WriteM1.busy_stats[cid](&bs1);
+    bsp->blk          = cp->blk;
+    bsp->count       += bs1.count;
+    bsp->timer_polls += bs1.timer_polls;
+    bsp->total_us    += bs1.total_us;
+    if (bs1.max_us > bsp->max_us)
+      bsp->max_us = bs1.max_us;
+    if (bs1.count && (!bsp->min_us || bs1.min_us < bsp->min_us))
+      bsp->min_us = bs1.min_us;
+  }
+
+
+  /*
+   * erase a logical run [blk, blk_e].  Mirrored both cards get all of
+   * it.  Striped, each card gets its sectors out of the run, which are
+   * contiguous on that card.  Card's piece in *sp/*ep, FALSE if none.
+   */
+  bool dsd_erase_range(uint32_t blk, uint32_t blk_e, uint8_t card,
+                       uint32_t *sp, uint32_t *ep) {
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+    if (!dsd_both(blk)) {
+      if (dsd_map(blk, sp) != card)
+        blk++;
+      if (dsd_map(blk_e, ep) != card)
+        blk_e--;
+      if (blk > blk_e)
+        return FALSE;
+      dsd_map(blk, sp);
+      dsd_map(blk_e, ep);
+      return TRUE;
+    }
+#endif
+    *sp = blk;
+    *ep = blk_e;
+    return TRUE;
+  }
+
+
+  command error_t SDerase.erase[uint8_t cid](uint32_t blk, uint32_t blk_e) {
+    dsd_client_t *cp;
+    uint32_t s, e;
+    uint8_t  card;
+    error_t  err;
+
+    cp = dsd_get(cid, TRUE);
+    if (blk_e < blk)
+      return EINVAL;
+    cp->op    = DSD_ERASE;
+    cp->blk   = blk;
+    cp->blk_e = blk_e;
+    cp->err   = SUCCESS;
+    cp->pend  = 0;
+    for (card = 0; card < DBLK_SD_CARDS; card++) {
+      if (!dsd_erase_range(blk, blk_e, card, &s, &e))
+        continue;
+      err = card ? call Erase1.erase[cid](s, e)
+                 : call Erase0.erase[cid](s, e);
+      if (err) {
+        if (!cp->pend) {
+          cp->op = DSD_IDLE;
+          return err;                   /* nothing started */
+        }
+        cp->err = err;                  /* card 0 is running, report it */
+        break;
+      }
+      cp->pend |= (1 << card);
+    }
+    return SUCCESS;
+  }
+
+
+  event void Erase0.eraseDone[uint8_t cid](uint32_t blk_s, uint32_t blk_e, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 0, err);
+  }
+
+
+  event void Erase1.eraseDone[uint8_t cid](uint32_t blk_s, uint32_t blk_e, error_t err) {
+    dsd_done(cid, dsd_get(cid, FALSE), 1, err);
+  }
+
+
+  /*
+   * stand alone, crash path.  Same mapping, run to completion.
+   */
+  async command bool SDsa.inSA() {
+    return call SDsa0.inSA() && call SDsa1.inSA();
+  }
+
+
+  async command error_t SDsa.reset() {
+    error_t err0, err1;
+
+    err0 = call SDsa0.reset();
+    err1 = call SDsa1.reset();
+    return err0 ? err0 : err1;
+  }
+
+
+  async command void SDsa.off() {
+    call SDsa0.off();
+    call SDsa1.off();
+  }
+
+
+  async command void SDsa.read(uint32_t blk, uint8_t *buf) {
+    uint32_t pblk;
+
+    if (dsd_map(blk, &pblk))
+      call SDsa1.read(pblk, buf);
+    else
+      call SDsa0.read(pblk, buf);
+  }
+
+
+  async command void SDsa.write(uint32_t blk, uint8_t *buf) {
+    uint32_t pblk;
+
+    if (dsd_both(blk)) {
+      call SDsa0.write(blk, buf);
+      call SDsa1.write(blk, buf);
+      return;
+    }
+    if (dsd_map(blk, &pblk))
+      call SDsa1.write(pblk, buf);
+    else
+      call SDsa0.write(pblk, buf);
+  }
+
+
+  /*
+   * multi-block on the crash path.  A striped run alternates cards so
+   * there is no single CMD25 to hand it to.  Run it a sector at a time
+   * through SDsa.write, which does the mapping.
+   */
+  norace uint32_t sa_mw_blk;
+
+  async command void SDsa.write_multi_start(uint32_t blk, uint32_t count) {
+    sa_mw_blk = blk;
+  }
+
+
+  async command void SDsa.write_multi_blk(uint8_t *buf) {
+    call SDsa.write(sa_mw_blk++, buf);
+  }
+
+
+  async command void SDsa.write_multi_stop() { }
+
+
+  default command error_t Res0.request[uint8_t cid]()           { return FAIL; }
+  default command error_t Res0.immediateRequest[uint8_t cid]()  { return FAIL; }
+  default command error_t Res0.release[uint8_t cid]()           { return FAIL; }
+  default command bool    Res0.isOwner[uint8_t cid]()           { return FALSE; }
+  default command error_t Res1.request[uint8_t cid]()           { return FAIL; }
+  default command error_t Res1.immediateRequest[uint8_t cid]()  { return FAIL; }
+  default command error_t Res1.release[uint8_t cid]()           { return FAIL; }
+  default command bool    Res1.isOwner[uint8_t cid]()           { return FALSE; }
+
+  default command error_t Read0.read[uint8_t cid](uint32_t blk, uint8_t *buf)  { return FAIL; }
+  default command error_t Read1.read[uint8_t cid](uint32_t blk, uint8_t *buf)  { return FAIL; }
+  default command error_t Write0.write[uint8_t cid](uint32_t blk, uint8_t *buf) { return FAIL; }
+  default command error_t Write1.write[uint8_t cid](uint32_t blk, uint8_t *buf) { return FAIL; }
+  default command error_t ReadM0.read[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                   uint16_t count)  { return FAIL; }
+  default command error_t ReadM1.read[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                   uint16_t count)  { return FAIL; }
+  default command error_t WriteM0.write[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                     uint16_t count) { return FAIL; }
+  default command error_t WriteM1.write[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                                     uint16_t count) { return FAIL; }
+  default command error_t Erase0.erase[uint8_t cid](uint32_t blk_s,
+                                                   uint32_t blk_e)  { return FAIL; }
+  default command error_t Erase1.erase[uint8_t cid](uint32_t blk_s,
+                                                   uint32_t blk_e)  { return FAIL; }
+  default command void WriteM0.busy_stats[uint8_t cid](sd_busy_stats_t *bsp) {
+    memset(bsp, 0, sizeof(*bsp));
+  }
+  default command void WriteM1.busy_stats[uint8_t cid](sd_busy_stats_t *bsp) {
+    memset(bsp, 0, sizeof(*bsp));
+  }
+
+  default event void Resource.granted[uint8_t cid]()            { }
+  default event void SDread.readDone[uint8_t cid](uint32_t blk, uint8_t *buf,
+                                                  error_t err)  { }
+  default event void SDwrite.writeDone[uint8_t cid](uint32_t blk, uint8_t *buf,
+                                                    error_t err) { }
+  default event void SDreadMulti.readDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                          uint16_t count, error_t err) { }
+  default event void SDwriteMulti.writeDone[uint8_t cid](uint32_t blk, uint8_t **bufs,
+                                          uint16_t count, error_t err) { }
+  default event void SDerase.eraseDone[uint8_t cid](uint32_t blk_s, uint32_t blk_e,
+                                                    error_t err) { }
+
+  event void FileSystem.eraseDone(uint8_t which) { }
+
+  async event void Panic.hook() { }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * DblkSDsaC: stand alone SD for writing the DBLK from the crash path.
+ * SD0C's SDsa, or DblkSDP's when the DBLK is on both cards.  Also where
+ * DblkSDP gets wired to the rest of the system.
+ */
+
+#include <dblk_sd.h>
+
+configuration DblkSDsaC {
+  provides interface SDsa;
+}
+
+implementation {
+#if DBLK_SD_MODE == DBLK_SD_SINGLE
+  components SD0C;
+  SDsa = SD0C;
+#else
+  components DblkSDP, SD0C, SD1C;
+  SDsa = DblkSDP;
+  DblkSDP.SDsa0 -> SD0C;
+  DblkSDP.SDsa1 -> SD1C;
+
+  components FileSystemC, PanicC;
+  DblkSDP.FileSystem -> FileSystemC;
+  DblkSDP.Panic      -> PanicC;
+#endif
+}
@@ -27,6 +27,8 @@
  */
 
 #include <fs_loc.h>
+#include <TagnetAdapter.h>
+#include <slab_arena.h>
 
 configuration FileSystemC {
   provides {
@@ -34,6 +36,7 @@ configuration FileSystemC {
     interface FileSystem  as FS;
     interface ByteMapFile as DblkFileMap[uint8_t cid];
     interface ByteMapFile as PanicFileMap;
+    interface TagnetAdapter<tagnet_block_t> as DblkCacheStats;
   }
   uses interface Boot;			/* incoming signal */
 }
@@ -49,10 +52,11 @@ implementation {
 
   DblkFileMap  = DMF.DMF;
   PanicFileMap = PMF.PMF;
+  DblkCacheStats = DMF.DblkCacheStats;
 
   components     SSWriteC;
   components new SD0_ArbC() as SD_FS;   /* filesystem   SD   */
-  components new SD0_ArbC() as SD_DMF;  /* DblkMapFile  SD   */
+  components new DblkSDC()  as SD_DMF;  /* DblkMapFile  SD   */
   components new SD0_ArbC() as SD_PMF;  /* PanicMapFile SD   */
   components     SD0C       as SDsa;    /* StandAlone for FS */
 
@@ -67,9 +71,13 @@ implementation {
 
   DMF.SDResource    -> SD_DMF;
   DMF.SDread        -> SD_DMF;
+  DMF.SDreadMulti   -> SD_DMF;
 
   DMF.SS            -> SSWriteC;
 
+  components SlabArenaC;
+  DMF.SlabArena     -> SlabArenaC.SlabArena[SLAB_OWNER_DMF];
+
   components PanicC;
   FS_P.Panic -> PanicC;
   DMF.Panic         -> PanicC;
@@ -26,6 +26,7 @@
  */
 
 #include <image_mgr.h>
+#include <slab_arena.h>
 
 configuration ImageManagerC {
   provides {
@@ -68,4 +69,7 @@ implementation {
   components OverWatchC;
   IM_P.OverWatch    -> OverWatchC;
   IM_P.CollectEvent -> CollectC;
+
+  components SlabArenaC;
+  IM_P.SlabArena    -> SlabArenaC.SlabArena[SLAB_OWNER_IM];
 }
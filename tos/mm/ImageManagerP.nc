@@ -24,6 +24,7 @@
 #include <sd.h>
 #include <image_info.h>
 #include <image_mgr.h>
+#include <slab_arena.h>
 
 #ifndef PANIC_IM
 enum {
@@ -40,9 +41,17 @@ enum {
  *
  * image_manager_working_buffer (IMWB).  An SD sized (SD_BLOCKSIZE, 512)
  * buffer for interacting with the SD.  Used to collect (marshal) incoming
- * data for writing to the SD.
+ * data for writing to the SD.  Comes out of the slab arena (our
+ * reservation) on boot.
  *
- * buf_ptr (BP): when active points into the IMWB otherwise NULL.
+ * alternate buffer (ALT).  When filling, if the arena can lend us one,
+ * a second buffer.  Incoming data goes into one while the other is
+ * being written, the uploader doesn't have to wait on the SD for every
+ * sector.  Goes back when the fill is done (or if the arena reclaims it
+ * while we aren't writing).  No ALT, single buffered as always.
+ *
+ * buf_ptr (BP): when active points into the buffer being filled
+ *   (fill_buf, IMWB or ALT) otherwise NULL.
  * filling_slot_pointer (FSP): when active points at the directory slot
  *   that is being filled.
  *
@@ -83,9 +92,15 @@ enum {
  * Filling: IM is filling a slot.  Incoming data is marshalled in the IMWB.
  *  when full, FILL_REQ_SD then FILL_WRITING, then back to FILL_WAITING.
  *
+ *  Double buffered (ALT), writes keep going into the other buffer during
+ *  FILL_REQ_SD/FILL_WRITING.  If that one fills too we hold the caller
+ *  off (held, write_continue) and write it as soon as the first is out.
+ *  A finish or alloc_abort while a buffer is going out is pended and
+ *  run when the write completes.
+ *
  * FILL_WAITING        filling buffer.  BP and FSP active.
- * FILL_REQ_SD         req SD for IMWB flush.
- * FILL_WRITING        writing buffer (IMWB) to SD.
+ * FILL_REQ_SD         req SD for buffer flush.
+ * FILL_WRITING        writing buffer (wr_buf) to SD.
  *
  * Filling (last buffer): last piece of the image has been received.
  *  write out last buffer.  ie. FILL_LAST_REQ_SD and FILL_LAST_WRITE.
@@ -173,13 +188,25 @@ typedef struct {
 
   image_dir_slot_t *filling_slot_p;     /* filling, pnt to slot being filled */
 
-  uint8_t  *buf_ptr;                    /* filling, pntr into IMWB       */
-  uint16_t  bytes_remaining;            /* filling, bytes left in IMWB   */
+  uint8_t  *buf_ptr;                    /* filling, pntr into fill_buf   */
+  uint16_t  bytes_remaining;            /* filling, bytes left in fill_buf */
+
+  uint8_t  *fill_buf;                   /* filling, IMWB or ALT          */
+  uint8_t  *wr_buf;                     /* buffer going to the SD        */
+  uint8_t  *alt_buf;                    /* ALT, NULL single buffered     */
+  bool      held;                       /* caller told to wait           */
+  uint8_t   pend;                       /* IM_PEND_, waiting on a write  */
 
   im_state_t im_state;                  /* current state */
   uint8_t    cid;                       /* client id */
 } imcb_t;                               /* ImageManager Control Block (imcb) */
 
+enum {
+  IM_PEND_NONE = 0,
+  IM_PEND_FINISH,
+  IM_PEND_ABORT,
+};
+
 
 module ImageManagerP {
   provides {
@@ -199,6 +226,7 @@ module ImageManagerP {
     interface Platform;
     interface Panic;
     interface OverWatch;
+    interface SlabArena;
   }
 }
 implementation {
@@ -207,8 +235,9 @@ implementation {
    * to accumulate incoming bytes when writing an image to a slot.
    *
    * The IMWB is aligned to allow quad word aligned access, ie chk_zero.
+   * Slabs are.
    */
-  uint8_t     im_wrk_buf[SD_BLOCKSIZE] __attribute__((aligned(4)));
+  uint8_t    *im_wrk_buf;
 
   /*
    * control cells, imcb, ImageManager Control Block
@@ -232,6 +261,17 @@ implementation {
     return TRUE;
   }
 
+  /* done filling, ALT goes back */
+  void drop_bufs() {
+    if (imcb.alt_buf)
+      call SlabArena.free(imcb.alt_buf);
+    imcb.alt_buf  = NULL;
+    imcb.fill_buf = NULL;
+    imcb.wr_buf   = NULL;
+    imcb.held     = FALSE;
+    imcb.pend     = IM_PEND_NONE;
+  }
+
   /*
    * validate_slot:
    *
@@ -248,6 +288,7 @@ implementation {
     imcb.filling_slot_p->slot_state = SLOT_VALID;
     imcb.filling_slot_p = NULL;         /* not filling anymore */
     imcb.buf_ptr = NULL;                /* not filling anymore */
+    drop_bufs();
 
     dir = &imcb.dir;
     dir->chksum = 0;
@@ -427,10 +468,13 @@ implementation {
 
         /*
          * filling so buf_ptr must be either within bounds of the
-         * IMWB or just beyond (im_wrk_buf[SD_BLOCKSIZE])
+         * buffer being filled (IMWB or ALT) or just beyond
+         * (fill_buf[SD_BLOCKSIZE])
          */
-        if (imcb.buf_ptr < im_wrk_buf ||
-            imcb.buf_ptr > &im_wrk_buf[SD_BLOCKSIZE]) {
+        if ((imcb.fill_buf != im_wrk_buf &&
+             (!imcb.fill_buf || imcb.fill_buf != imcb.alt_buf)) ||
+            imcb.buf_ptr < imcb.fill_buf ||
+            imcb.buf_ptr > &imcb.fill_buf[SD_BLOCKSIZE]) {
           panic_val = 12;
           break;
         }
@@ -469,7 +513,7 @@ implementation {
 
     if (imcb.filling_blk > imcb.filling_limit_blk)
       im_panic(3, imcb.filling_blk, imcb.filling_limit_blk);
-    err = call SDwrite.write(imcb.filling_blk, im_wrk_buf);
+    err = call SDwrite.write(imcb.filling_blk, imcb.wr_buf);
     if (err)
       im_panic(4, err, 0);
   }
@@ -540,6 +584,10 @@ implementation {
     }
 #endif
 
+    im_wrk_buf = call SlabArena.alloc();  /* our reservation */
+    if (!im_wrk_buf)
+      im_panic(7, 0, 0);
+
     imcb.region_start_blk = call FS.area_start(FS_LOC_IMAGE);
     imcb.region_end_blk   = call FS.area_end(FS_LOC_IMAGE);
 
@@ -755,7 +803,13 @@ implementation {
     imcp->filling_limit_blk = ep->start_sec + IMAGE_SIZE_SECTORS - 1;
     imcp->filling_slot_p = ep;
 
-    imcp->buf_ptr = &im_wrk_buf[0];
+    /* ALT if the arena can spare it */
+    imcp->alt_buf  = call SlabArena.alloc();
+    imcp->fill_buf = im_wrk_buf;
+    imcp->wr_buf   = NULL;
+    imcp->held     = FALSE;
+    imcp->pend     = IM_PEND_NONE;
+    imcp->buf_ptr  = imcp->fill_buf;
     imcp->bytes_remaining = SD_BLOCKSIZE;
     imcp->cid = cid;
     imcp->im_state = IMS_FILL_WAITING;
@@ -776,19 +830,18 @@ implementation {
    * alloc_abort can only be called in IMS_FILL_WAITING.  This
    * means if IM.write ever returns non-zero, one MUST wait
    * for a IM.write_complete before calling alloc_abort.
+   *
+   * Double buffered, a buffer can be going out without the caller
+   * having been held.  The abort is pended until the write is done.
    */
-  command error_t IM.alloc_abort[uint8_t cid]() {
+  void im_abort(uint8_t cid) {
     image_dir_t *dir;
     image_dir_slot_t *sp;
 
-    verify_IM();
-
-    if (imcb.im_state != IMS_FILL_WAITING || imcb.cid != cid)
-      im_panic(8, imcb.im_state, cid);
-
     sp  = imcb.filling_slot_p;
     imcb.filling_slot_p->slot_state = SLOT_EMPTY;
     imcb.buf_ptr = NULL;
+    drop_bufs();
     imcb.filling_slot_p = NULL;
     imcb.im_state = IMS_IDLE;
     imcb.cid      = -1;
@@ -797,6 +850,29 @@ implementation {
     dir->chksum = 0 - call Checksum.sum32_aligned((void *) dir, sizeof(*dir));
     call CollectEvent.logEvent(DT_EVENT_IMG_MGR, IMGMGR_EV_ABORT,
                                (uint32_t) sp, 0, cid);
+  }
+
+
+  /* a buffer going out that the caller wasn't held for */
+  bool im_writing_behind() {
+    return ((imcb.im_state == IMS_FILL_REQ_SD ||
+             imcb.im_state == IMS_FILL_WRITING) &&
+            imcb.alt_buf && !imcb.held && imcb.pend == IM_PEND_NONE);
+  }
+
+
+  command error_t IM.alloc_abort[uint8_t cid]() {
+    verify_IM();
+
+    if (imcb.cid != cid)
+      im_panic(8, imcb.im_state, cid);
+    if (im_writing_behind()) {
+      imcb.pend = IM_PEND_ABORT;
+      return SUCCESS;
+    }
+    if (imcb.im_state != IMS_FILL_WAITING)
+      im_panic(8, imcb.im_state, cid);
+    im_abort(cid);
     return SUCCESS;
   }
 
@@ -1050,13 +1126,9 @@ implementation {
    * return: error_t
    */
 
-  command error_t IM.finish[uint8_t cid]() {
+  void im_finish(uint8_t cid) {
     error_t err;
 
-    verify_IM();
-    if (imcb.im_state != IMS_FILL_WAITING)
-      im_panic(22, imcb.im_state, 0);
-
     /*
      * we need to enforce the minimum size constraint.  The minimum
      * is the vector table + image_info.
@@ -1079,8 +1151,10 @@ implementation {
     if (imcb.bytes_remaining == SD_BLOCKSIZE) {
       imcb.im_state = IMS_FILL_SYNC_REQ_SD;
       validate_slot();
+    } else {
+      imcb.wr_buf   = imcb.fill_buf;
+      imcb.im_state = IMS_FILL_LAST_REQ_SD;
     }
-    else imcb.im_state = IMS_FILL_LAST_REQ_SD;
 
     err = im_logRequest();
     if (err)
@@ -1088,6 +1162,22 @@ implementation {
 
     call CollectEvent.logEvent(DT_EVENT_IMG_MGR, IMGMGR_EV_FINISH,
                                (uint32_t) imcb.filling_slot_p, 0, cid);
+  }
+
+
+  /*
+   * Double buffered, the last full buffer can still be going out
+   * (the caller wasn't held).  Pend the finish until it is done.
+   */
+  command error_t IM.finish[uint8_t cid]() {
+    verify_IM();
+    if (im_writing_behind()) {
+      imcb.pend = IM_PEND_FINISH;
+      return SUCCESS;
+    }
+    if (imcb.im_state != IMS_FILL_WAITING)
+      im_panic(22, imcb.im_state, 0);
+    im_finish(cid);
     return SUCCESS;
   }
 
@@ -1117,35 +1207,47 @@ implementation {
    */
   command uint32_t IM.write[uint8_t cid](uint8_t *buf, uint32_t len) {
     uint32_t copy_len;
-    uint32_t bytes_left;
     error_t  err;
 
     if (!len)                           /* nothing to do? */
       return 0;                         /* we consumed nothing, go figure */
-    if (imcb.im_state != IMS_FILL_WAITING)
+    if (imcb.im_state != IMS_FILL_WAITING && !im_writing_behind())
       im_panic(24, imcb.im_state, 0);
 
     verify_IM();
 
-    if (len <= imcb.bytes_remaining) {
-      copy_len = len;
-      imcb.bytes_remaining -= len;
-      bytes_left = 0;
-    } else {
-      copy_len = imcb.bytes_remaining;
-      imcb.bytes_remaining = 0;
-      bytes_left = len - copy_len;
-    }
-
-    memcpy_ua(imcb.buf_ptr, buf, copy_len);
-    imcb.buf_ptr += copy_len;
-    if (bytes_left) {
-      imcb.im_state = IMS_FILL_REQ_SD;
-      err = im_logRequest();
-      if (err)
-        im_panic(25, err, 0);
+    while (len) {
+      if (!imcb.bytes_remaining) {
+        /*
+         * fill_buf is full and more is coming, send it.  If the other
+         * buffer is still going out (or there isn't one) the caller has
+         * to wait for write_continue.
+         */
+        if (imcb.im_state != IMS_FILL_WAITING) {
+          imcb.held = TRUE;
+          break;
+        }
+        imcb.wr_buf   = imcb.fill_buf;
+        imcb.im_state = IMS_FILL_REQ_SD;
+        err = im_logRequest();
+        if (err)
+          im_panic(25, err, 0);
+        if (!imcb.alt_buf) {
+          imcb.held = TRUE;
+          break;
+        }
+        imcb.fill_buf = (imcb.wr_buf == im_wrk_buf) ? imcb.alt_buf : im_wrk_buf;
+        imcb.buf_ptr  = imcb.fill_buf;
+        imcb.bytes_remaining = SD_BLOCKSIZE;
+      }
+      copy_len = (len < imcb.bytes_remaining) ? len : imcb.bytes_remaining;
+      memcpy_ua(imcb.buf_ptr, buf, copy_len);
+      imcb.buf_ptr += copy_len;
+      imcb.bytes_remaining -= copy_len;
+      buf += copy_len;
+      len -= copy_len;
     }
-    return bytes_left;
+    return len;
   }
 
 
@@ -1261,6 +1363,7 @@ implementation {
 
 
   event void SDwrite.writeDone(uint32_t blk, uint8_t *buf, error_t error) {
+    uint8_t *done;
     uint8_t pcid;
 
     switch(imcb.im_state) {
@@ -1276,12 +1379,42 @@ implementation {
         return;
 
       case IMS_FILL_WRITING:
-        imcb.im_state = IMS_FILL_WAITING;
         imcb.filling_blk++;
-        imcb.buf_ptr = &im_wrk_buf[0];
-        imcb.bytes_remaining = SD_BLOCKSIZE;
-        signal IM.write_continue[imcb.cid]();
+        if (imcb.held && imcb.alt_buf) {
+          /*
+           * the other buffer filled while this one was going out.  We
+           * still have the SD, send it and refill the one just written.
+           */
+          done = imcb.wr_buf;
+          imcb.wr_buf   = imcb.fill_buf;
+          imcb.fill_buf = done;
+          imcb.buf_ptr  = done;
+          imcb.bytes_remaining = SD_BLOCKSIZE;
+          imcb.held = FALSE;
+          write_slot_blk();
+          signal IM.write_continue[imcb.cid]();
+          return;
+        }
+        imcb.im_state = IMS_FILL_WAITING;
+        if (!imcb.alt_buf) {            /* single buffered, start over */
+          imcb.buf_ptr = imcb.fill_buf;
+          imcb.bytes_remaining = SD_BLOCKSIZE;
+        }
+        if (imcb.held) {
+          imcb.held = FALSE;
+          signal IM.write_continue[imcb.cid]();
+        }
         im_logRelease();
+        switch (imcb.pend) {
+          case IM_PEND_FINISH:
+            imcb.pend = IM_PEND_NONE;
+            im_finish(imcb.cid);
+            break;
+          case IM_PEND_ABORT:
+            imcb.pend = IM_PEND_NONE;
+            im_abort(imcb.cid);
+            break;
+        }
         return;
 
       case IMS_FILL_LAST_WRITE:
@@ -1332,6 +1465,26 @@ implementation {
     }
   }
 
+  /*
+   * the arena wants ALT back.  Only if nothing is going out, if we are
+   * filling ALT move what's there over to the IMWB.
+   */
+  event void SlabArena.reclaim() {
+    uint16_t used;
+
+    if (!imcb.alt_buf || imcb.im_state != IMS_FILL_WAITING)
+      return;
+    if (imcb.fill_buf == imcb.alt_buf) {
+      used = SD_BLOCKSIZE - imcb.bytes_remaining;
+      memcpy(im_wrk_buf, imcb.alt_buf, used);
+      imcb.fill_buf = im_wrk_buf;
+      imcb.buf_ptr  = &im_wrk_buf[used];
+    }
+    call SlabArena.free(imcb.alt_buf);
+    imcb.alt_buf = NULL;
+  }
+
+
   default event void IM.write_continue[uint8_t cid]() { }
   default event void IM.finish_complete[uint8_t cid]() { }
   default event void IM.delete_complete[uint8_t cid]() { }
@@ -42,6 +42,26 @@ interface Resync {
    */
   command error_t start(uint32_t *p_offset, uint32_t term_offset);
 
+  /**
+   * prev: go back some number of SYNCs
+   *
+   * Starting with the SYNC record at *p_offset, follow the prev_sync
+   * chain back count SYNCs.  A damaged link is repaired by scanning
+   * backwards for the SYNC before it.  If the chain runs out first, the
+   * oldest SYNC reached is the answer.
+   *
+   * @param uint32_t *p_offset   pointer to the offset of a SYNC record.
+   * @param uint16_t  count      how many SYNCs to go back, 0 just checks
+   *                             the starting SYNC.
+   *
+   * @return error_t    SUCCESS SYNC found, *p_offset updated.
+   *                    EBUSY   still looking, done() will be signalled.
+   *                    EINVAL  *p_offset isn't a SYNC record.
+   *
+   * same completion rules as start().
+   */
+  command error_t prev(uint32_t *p_offset, uint16_t count);
+
   /**
    * done: signal completion of resync process
    *
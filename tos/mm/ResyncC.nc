@@ -36,6 +36,9 @@ implementation {
   components FileSystemC as FS;
   ResyncP.DMF -> FS.DblkFileMap[DMF_CID];
 
+  components DblkManagerC;
+  ResyncP.DblkManager -> DblkManagerC;
+
   components PanicC;
   ResyncP.Panic -> PanicC;
 }
@@ -22,30 +22,129 @@
  * Contact: Eric B. Decker <cire831@gmail.com>
  */
 
+/*
+ * Dblk Record Resync
+ *
+ * The following provides Collect's resync functionality.  The primary
+ * purpose of resync is to find the proper record alignment in the dblk
+ * file.  This is sometimes lost or corrupted due to system failures. Other
+ * times we just want to jump to an arbitrary position in the file and find
+ * the record boundary. The sync record is used as the marker for this
+ * alignment since it is laid down in the dblk file on a periodic basis and
+ * has a well known format for correctly matching.
+ *
+ * Resync.start  command to initiate a search for a sync
+ *               record starting at the specified offset
+ *               in the dblk file. The terminal offset
+ *               sets how far to search.  If less than the
+ *               start the search runs backwards.
+ *
+ * Resync.prev   starting from a sync record, follow the prev_sync
+ *               chain back some number of syncs.
+ *
+ *               SUCCESS: found result, new offset
+ *                        returned
+ *               EODATA:  not found within range, (beyond end
+ *                        of file or terminal range).
+ *               EBUSY:   disk io is in progress, result
+ *                        will be signalled when done
+ *
+ * Resync.done   event to signal completion of search.
+ *               returns offset
+ *
+ * Assumptions
+ * - sync records are word aligned
+ * - sync records are fixed length
+ * - sync records can span across sector boundaries
+ * - sync record structure definition is fixed (any
+ *   future changes will affect this code)
+ * - majik field is last field in sync record structure
+ * - prev_sync of a sync record is the file offset of the sync
+ *   laid down before it (Collect keeps this across reboots).
+ *
+ * Algorithm (scan, start)
+ * - if already searching, return EBUSY
+ * - start a deadman timer
+ * - initialize state variables
+ * - repeat until sync record found or unrecoverable error:
+ *   - map (DMF.map) the rest of the sector holding the candidate's
+ *     majik (going backwards, the front of the sector up to the
+ *     majik).  Walk the sector a word at a time looking for
+ *     SYNC_MAJIK, each word passed moves the candidate by 4.  A sector
+ *     that doesn't have the majik costs one map.
+ *   - on a majik hit, mapAll the whole candidate and check the
+ *     majik, type, length, recsum.
+ *   - if valid sync record, we are done.  Otherwise step past the
+ *     candidate and keep scanning.
+ *   - EBUSY from DMF says it is off getting the sector, we pick up
+ *     where we left off on data_avail.
+ * - terminate search and return EODATA when terminal
+ *   offset has been exceeded or end of file is detected
+ * - return SUCCESS and offset where sync record is located
+ *   if sync record is detected
+ *
+ * Algorithm (chain, prev)
+ * - verify the sync at the candidate (mapAll), it becomes the answer.
+ * - if we have gone back far enough, done.
+ * - otherwise the candidate becomes its prev_sync.  A prev_sync that
+ *   is 0 or doesn't go backwards is the start of the chain, done.
+ * - if the candidate doesn't verify (chain damaged) scan backwards
+ *   from it for the sync before it and carry on.
+ * - prev never fails once it has a good starting sync.  If the chain
+ *   runs out early we return the oldest sync we got to.
+ * - circular DBLK that has wrapped (dblk_dir.h), "backwards" is stream
+ *   order (stream_pos).  The first sync in front points back to the end
+ *   of the area, a link into the erased gap or past the tail ends the
+ *   chain.  A repair near the front scans back across the wrap, offsets
+ *   past the end of the area fold around to the front (DMF, SS.where)
+ *   so we scan from there and fold what we find.
+ *
+ * Each sync is SYNC_MAX_SECTORS or less behind the one after it, so
+ * going back N syncs costs about N sector reads rather than N *
+ * SYNC_MAX_SECTORS * 128 mapAlls.
+ */
+
+#include <typed_data.h>
+#include <sd.h>
+
+/* where the majik lives in a dt_sync_t */
+#define SYNC_MAJIK_OFFSET   (sizeof(dt_sync_t) - sizeof(uint32_t))
+
+/* how far back to scan when the prev_sync chain is damaged */
+#define SYNC_CHAIN_WINDOW   (2 * SYNC_MAX_SECTORS * SD_BLOCKSIZE)
+
 module ResyncP {
   provides interface Resync[uint8_t cid];
   uses {
     interface Panic;
     interface ByteMapFile as DMF;
+    interface DblkManager;
     interface Timer<TMilli> as ResyncTimer;
   }
 }
 implementation {
-  typedef enum search_direction {
+  typedef enum search_mode {
     SRCH_FWD,
     SRCH_REV,
-  } search_direction_t;
+    SRCH_CHAIN,                         /* following prev_sync */
+  } search_mode_t;
 
   // structure to manage state variables for reSync operation
   typedef struct {
-    uint32_t cur_offset;    /* last place visited */
+    uint32_t cur_offset;    /* candidate sync offset */
     uint32_t lower;         /* lower bound of search space in dblk */
     uint32_t upper;         /* upper bound exclusive of search space  */
     uint32_t found_offset;  /* offset of found sync record, 0 if none */
+    uint32_t chain_offset;  /* last good sync in the chain */
+    uint32_t tail;          /* chain, wrapped circular, 0 not */
+    uint32_t area;          /* chain, wrapped, end of the area */
+    uint16_t chain;         /* syncs still to go back */
+    bool     chaining;      /* doing a prev, scans are chain repairs */
+    bool     verify;        /* majik seen at cur_offset, check it */
     bool     in_progress;   /* search already in progress, try later */
     error_t  err;           /* error encountered during search */
     uint8_t  cid;           /* client id, current user */
-    search_direction_t direction; /* go forward or backward from start */
+    search_mode_t mode;     /* forward, backward, or chain */
   } scb_t;
 
   /* Sync Search Control Block (scb) */
@@ -53,63 +152,6 @@ implementation {
     .found_offset = -EINVAL,
   };
 
-  /*
-   * Dblk Record Resync
-   *
-   * The following provides Collect's resync functionality.  The primary
-   * purpose of resync is to find the proper record alignment in the dblk
-   * file.  This is sometimes lost or corrupted due to system failures. Other
-   * times we just want to jump to an arbitrary position in the file and find
-   * the record boundary. The sync record is used as the marker for this
-   * alignment since it is laid down in the dblk file on a periodic basis and
-   * has a well known format for correctly matching.
-   *
-   * resyncStart   command to initiate a search for a sync
-   *               record starting at the specified offset
-   *               in the dblk file. The terminal offset
-   *               sets how far to search. If -1 then
-   *               search to end of file.
-   *
-   *               SUCCESS: found result, new offset
-   *                        returned
-   *               EODATA:  not found within range, (beyond end
-   *                        of file or terminal range).
-   *               EBUSY:   disk io is in progress, result
-   *                        will be signalled when done
-   *
-   * resyncDone    event to signal completion of search.
-   *               returns offset
-   *
-   * Assumptions
-   * - sync records are word aligned
-   * - sync records are fixed length
-   * - sync records can span across sector boundaries
-   * - sync record structure definition is fixed (any
-   *   future changes will affect this code)
-   * - majik field is last field in sync record structure
-   *
-   * Algorithm
-   * - if already searching, return EBUSY
-   * - start a deadman timer
-   * - initialize state variables
-   * - repeat until sync record found or unrecoverable error:
-   *   - call dmf.mapAll() with candidate offset and size of
-   *     sync record. It returns success if all data is
-   *     available or EBUSY if it needs to retrieve more data.
-   *     It signal dmf.data_avail when is data and can now be
-   *     accessed
-   *   - check buffer to see if sync record is present, look
-   *     for majik field, type, length, recsum
-   *   - if valid sync record, then signal Collect.resyncDone
-   *     and record file offset
-   *   - otherwise, increment the offset by 4 bytes and try
-   *     again
-   * - terminate search and return EODATA when terminal
-   *   offset has been exceeded or end of file is detected
-   * - return SUCCESS and offset where sync record is located
-   *   if sync record is detected
-   *
-   */
 
   bool sync_valid(dt_sync_t *sync) {
     uint16_t chksum;
@@ -134,6 +176,30 @@ implementation {
     return TRUE;
   }
 
+  /*
+   * where offset is in the data stream.  Wrapped circular, the tail is
+   * first and the end of the area comes before the front.  Anything past
+   * the area isn't in the stream.
+   */
+  uint32_t stream_pos(uint32_t offset) {
+    if (!scb.tail)
+      return offset;
+    if (offset >= scb.area)
+      return (uint32_t) -1;
+    if (offset >= scb.tail)
+      return offset - scb.tail;
+    return offset + scb.area - scb.tail;
+  }
+
+
+  /* an offset past the end of the area is the front, same as SS.where */
+  uint32_t stream_fold(uint32_t offset) {
+    if (scb.tail && offset >= scb.area)
+      offset -= scb.area - SD_BLOCKSIZE;
+    return offset;
+  }
+
+
   /*
    * core routines for finding sync records
    */
@@ -142,37 +208,227 @@ implementation {
   }
 
   uint32_t next_offset(uint32_t offset) {
-    if (scb.direction == SRCH_FWD) return offset + sizeof(uint32_t);
-    else                           return offset - sizeof(uint32_t);
+    if (scb.mode == SRCH_FWD) return offset + sizeof(uint32_t);
+    else                      return offset - sizeof(uint32_t);
+  }
+
+
+  /*
+   * scan_fwd: look for the majik from cur_offset to the end of its
+   * sector.  Sets verify if it finds one.
+   */
+  error_t scan_fwd() {
+    uint32_t *wp;
+    uint32_t  moff, dlen, n;
+    error_t   err;
+
+    moff = scb.cur_offset + SYNC_MAJIK_OFFSET;
+    dlen = SD_BLOCKSIZE - (moff % SD_BLOCKSIZE);
+    err = call DMF.map(0, (uint8_t **) &wp, moff, &dlen);
+    if (err)
+      return err;
+    if (!wp)
+      call Panic.panic(PANIC_SS, 6, dlen, (parg_t) wp, 1, 0);
+    n = dlen / sizeof(uint32_t);
+    if (!n)                             /* partial quad at the EOF */
+      return EODATA;
+    while (n && in_range(scb.cur_offset)) {
+      if (*wp == SYNC_MAJIK) {
+        scb.verify = TRUE;
+        break;
+      }
+      scb.cur_offset += sizeof(uint32_t);
+      wp++;
+      n--;
+    }
+    return SUCCESS;
   }
 
+
+  /*
+   * scan_rev: look for the majik from cur_offset back to the front of
+   * its sector.  Sets verify if it finds one.
+   */
+  error_t scan_rev() {
+    uint32_t *bp, *wp;
+    uint32_t  moff, blk, dlen, n, i;
+    error_t   err;
+
+    moff = scb.cur_offset + SYNC_MAJIK_OFFSET;
+    blk  = moff - (moff % SD_BLOCKSIZE);
+    i    = (moff - blk) / sizeof(uint32_t);
+    dlen = moff - blk + sizeof(uint32_t);
+    err = call DMF.map(0, (uint8_t **) &bp, blk, &dlen);
+    if (err)
+      return err;
+    if (!bp)
+      call Panic.panic(PANIC_SS, 6, dlen, (parg_t) bp, 2, 0);
+    n = dlen / sizeof(uint32_t);
+    if (i >= n) {
+      /*
+       * the candidate's majik isn't out there yet (EOF).  Back up to
+       * the last whole quad we have, if none, the previous sector.
+       */
+      scb.cur_offset -= (i - n + 1) * sizeof(uint32_t);
+      if (!n)
+        return SUCCESS;
+      i = n - 1;
+    }
+    wp = bp + i;
+    while (in_range(scb.cur_offset)) {
+      if (*wp == SYNC_MAJIK) {
+        scb.verify = TRUE;
+        break;
+      }
+      scb.cur_offset -= sizeof(uint32_t);
+      if (wp == bp)                     /* off the front of the sector */
+        break;
+      wp--;
+    }
+    return SUCCESS;
+  }
+
+
+  /*
+   * chain_step: verify the candidate and move to its prev_sync.
+   *
+   * returns TRUE when the chain walk is done, found_offset is the
+   * answer.  FALSE says keep going, scb.err says why we stopped.
+   */
+  bool chain_step() {
+    dt_sync_t *sync;
+    uint32_t   dlen, prev;
+
+    dlen = sizeof(dt_sync_t);
+    scb.err = call DMF.mapAll(0, (uint8_t **) &sync, scb.cur_offset, &dlen);
+    if (scb.err == EBUSY)
+      return FALSE;
+    if (scb.err == SUCCESS &&
+        (dlen != sizeof(dt_sync_t) || !sync))
+      call Panic.panic(PANIC_SS, 6, dlen, (parg_t) sync, 3, 0);
+    if (scb.err || !sync_valid(sync)) {
+      if (!scb.chain_offset) {          /* starting sync no good */
+        scb.err = EINVAL;
+        return FALSE;
+      }
+      /*
+       * chain damaged.  The link itself is good (the sync it came from
+       * passed its recsum), what it points at isn't.  Scan back from
+       * there for the sync before it.
+       */
+      scb.err   = SUCCESS;
+      scb.mode  = SRCH_REV;
+      scb.upper = scb.cur_offset;
+      if (scb.tail && scb.upper < scb.tail &&
+          scb.upper < SYNC_CHAIN_WINDOW + SD_BLOCKSIZE)
+        scb.upper += scb.area - SD_BLOCKSIZE;   /* back across the wrap */
+      scb.lower = (scb.upper > SYNC_CHAIN_WINDOW) ?
+        scb.upper - SYNC_CHAIN_WINDOW : 0;
+      if (scb.tail && scb.upper > scb.tail && scb.lower < scb.tail)
+        scb.lower = scb.tail;           /* not into the erased gap */
+      scb.cur_offset = scb.upper - sizeof(dt_sync_t);
+      scb.verify = FALSE;
+      return FALSE;
+    }
+    scb.chain_offset = scb.cur_offset;
+    scb.found_offset = scb.cur_offset;
+    if (!scb.chain)
+      return TRUE;
+    prev = sync->prev_sync;
+    if (!prev || (prev & 3) ||
+        stream_pos(prev) >= stream_pos(scb.cur_offset))
+      return TRUE;                      /* front of the chain */
+    scb.chain--;
+    scb.cur_offset = prev;
+    return FALSE;
+  }
+
+
   bool sync_search() {
     dt_sync_t    *sync = NULL;
-    uint32_t      dlen = sizeof(dt_sync_t);
+    uint32_t      dlen;
 
-    if ((scb.direction != SRCH_FWD) && (scb.direction != SRCH_REV))
-      call Panic.panic(PANIC_SS, 5, scb.direction,0,0,0);
+    while (TRUE) {
+      switch (scb.mode) {
+        default:
+          call Panic.panic(PANIC_SS, 5, scb.mode,0,0,0);
+          return FALSE;
 
-    scb.err = EODATA;
-    while (in_range(scb.cur_offset)) {
-      scb.err = call DMF.mapAll(0, (uint8_t **) &sync, scb.cur_offset, &dlen);
-      if(scb.err != SUCCESS) break;         // error reported, don't continue
-      // got data, now verify
-      if (dlen != sizeof(dt_sync_t) || !sync)
-        call Panic.panic(PANIC_SS, 6, dlen, (parg_t) sync, 0,0);
-      if (sync_valid(sync)) {
-        scb.found_offset = scb.cur_offset;
-        return TRUE;                        // success, found sync record
+        case SRCH_CHAIN:
+          if (chain_step()) {
+            scb.err = SUCCESS;
+            return TRUE;
+          }
+          if (scb.err) break;
+          continue;
+
+        case SRCH_FWD:
+        case SRCH_REV:
+          if (!in_range(scb.cur_offset)) {
+            scb.err = EODATA;
+            break;
+          }
+          if (!scb.verify) {
+            if (scb.mode == SRCH_FWD) scb.err = scan_fwd();
+            else                      scb.err = scan_rev();
+            if (scb.err) break;
+            continue;
+          }
+          dlen = sizeof(dt_sync_t);
+          scb.err = call DMF.mapAll(0, (uint8_t **) &sync, scb.cur_offset, &dlen);
+          if (scb.err != SUCCESS) break;    // error reported, don't continue
+          // got data, now verify
+          if (dlen != sizeof(dt_sync_t) || !sync)
+            call Panic.panic(PANIC_SS, 6, dlen, (parg_t) sync, 0,0);
+          scb.verify = FALSE;
+          if (sync_valid(sync)) {
+            if (scb.chaining) {         // chain repaired, back to walking it
+              scb.cur_offset = stream_fold(scb.cur_offset);
+              scb.mode = SRCH_CHAIN;
+              continue;
+            }
+            scb.found_offset = scb.cur_offset;
+            return TRUE;                    // success, found sync record
+          }
+          scb.cur_offset = next_offset(scb.cur_offset); // step search position
+          continue;
       }
-      scb.cur_offset = next_offset(scb.cur_offset); // step search position
+      break;
     }
+
     /* in case of EBUSY, this routine will be called again to continue
-     * when mapAll() has more data, else report unrecoverable error
-    */
-    if(scb.err != EBUSY) scb.found_offset = -scb.err;
+     * when DMF has more data, else report unrecoverable error.  A chain
+     * walk that can't go any further reports the oldest sync it got to.
+     */
+    if (scb.err == EBUSY)
+      return FALSE;
+    if (scb.chaining && scb.chain_offset) {
+      scb.err = SUCCESS;
+      scb.found_offset = scb.chain_offset;
+      return TRUE;
+    }
+    scb.found_offset = -scb.err;
     return FALSE;
   }
 
+
+  /* run the search as far as we can, *p_offset gets the answer if done */
+  void search_run(uint32_t *p_offset) {
+    call ResyncTimer.startOneShot(5000);    // five second deadman timer
+
+    /* if search is immediately successful or unrecoverable error is
+     * detected, then we're. Else report busy to indicate that caller's
+     * data_avail() will be called when search is complete.
+    */
+    *p_offset = 0;                  // start by indicating no data found
+    if (sync_search() || (scb.err != EBUSY)) {
+      *p_offset = scb.found_offset; // return found offset or fatal error
+      call ResyncTimer.stop();
+      scb.in_progress = FALSE;
+    }
+  }
+
+
   /*
    * start the resync operation.
    */
@@ -185,9 +441,12 @@ implementation {
 
     scb.cid = cid;
     scb.in_progress  = TRUE;
+    scb.chaining     = FALSE;
+    scb.tail         = 0;               /* offsets are what we are given */
+    scb.verify       = FALSE;
     scb.found_offset = 0;
-    scb.direction   = (term_offset > *p_offset) ? SRCH_FWD : SRCH_REV;
-    if (scb.direction == SRCH_FWD) {
+    scb.mode = (term_offset > *p_offset) ? SRCH_FWD : SRCH_REV;
+    if (scb.mode == SRCH_FWD) {
       scb.lower = *p_offset & ~3;
       scb.upper = term_offset & ~3;
       scb.cur_offset = scb.lower;
@@ -196,18 +455,35 @@ implementation {
       scb.upper = *p_offset & ~3;
       scb.cur_offset = scb.upper - sizeof(dt_sync_t);
     }
-    call ResyncTimer.startOneShot(5000);    // five second deadman timer
+    search_run(p_offset);
+    return scb.err;
+  }
 
-    /* if search is immediately successful or unrecoverable error is
-     * detected, then we're. Else report busy to indicate that caller's
-     * data_avail() will be called when search is complete.
-    */
-    *p_offset = 0;                  // start by indicating no data found
-    if (sync_search() || (scb.err != EBUSY)) {
-      *p_offset = scb.found_offset; // return found offset or fatal error
-      call ResyncTimer.stop();
-      scb.in_progress = FALSE;
-    }
+
+  /*
+   * go back count syncs from the sync at *p_offset.
+   */
+  command error_t Resync.prev[uint8_t cid](uint32_t *p_offset,
+                                           uint16_t count) {
+    if (!p_offset)
+      call Panic.panic(PANIC_SS, 7, 1,0,0,0);
+
+    if (scb.in_progress) return EBUSY;
+    if (!*p_offset || (*p_offset & 3)) return EINVAL;
+
+    scb.cid = cid;
+    scb.in_progress  = TRUE;
+    scb.chaining     = TRUE;
+    scb.verify       = FALSE;
+    scb.found_offset = 0;
+    scb.chain_offset = 0;
+    scb.chain        = count;
+    scb.mode         = SRCH_CHAIN;
+    scb.tail         = call DblkManager.tail_offset();
+    scb.area         = (call DblkManager.get_dblk_high() -
+                        call DblkManager.get_dblk_low() + 1) << SD_BLOCKSIZE_NBITS;
+    scb.cur_offset   = *p_offset;
+    search_run(p_offset);
     return scb.err;
   }
 
@@ -219,6 +495,7 @@ implementation {
 
     // if search is successful or unrecoverable error detected,
     // then search is done.
+    call ResyncTimer.startOneShot(5000);    // made progress, restart deadman
     if (sync_search() || (scb.err != EBUSY)) {
       call ResyncTimer.stop();
       scb.in_progress = FALSE;
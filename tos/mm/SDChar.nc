@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SD characterisation, between the Dblk directory (DblkManager) and
+ * SSWPolicy.  See dblk_dir.h.
+ */
+
+#include <dblk_dir.h>
+
+interface SDChar {
+  /**
+   * set_sd_char: characterisation out of the Dblk directory, at boot.
+   * Only called with a valid one (sigs and checksum already checked).
+   */
+  command void set_sd_char(dblk_sdchar_t *scp);
+
+  /**
+   * get_sd_char: what we know about the card, for the Dblk directory
+   * mirror.  sigs are filled in, the checksum is left to the caller.
+   *
+   * @return  bool      TRUE    *scp filled in.
+   *                    FALSE   nothing worth writing down.
+   */
+  command bool get_sd_char(dblk_sdchar_t *scp);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SSW write policy.  Decides when the SSW should push data out even
+ * though it doesn't have a full group, and how big a group is.  See
+ * SSWPolicyP.
+ */
+
+interface SSWPolicy {
+  /**
+   * filled: a sector filled up on its own (not padded).  Feeds the
+   * fill rate estimate.
+   *
+   * @param   uint32_t  t     when (LocalTime, ms).
+   */
+  command void filled(uint32_t t);
+
+  /**
+   * sd_cost: how long it took to get the SD (request to granted, which
+   * includes power up).  Feeds the SD cost estimate.
+   *
+   * @param   uint32_t  ms    measured cost.
+   */
+  command void sd_cost(uint32_t ms);
+
+  /**
+   * pending: the SSW is idle and holds data that isn't on the SD yet.
+   * Arms (or rearms) the deadline for it.
+   *
+   * @param   uint32_t  oldest  when the oldest data not on the SD showed
+   *                            up (LocalTime, ms).
+   */
+  command void pending(uint32_t oldest);
+
+  /**
+   * urgent: pending data includes critical lane records.  Follows
+   * pending, pending by itself says none.  Flush within
+   * SSW_CRIT_LATENCY of the oldest of them.
+   *
+   * @param   uint32_t  t       when the oldest critical record went in
+   *                            (LocalTime, ms).
+   */
+  command void urgent(uint32_t t);
+
+  /**
+   * idle: nothing pending (or the writer has been kicked), disarm.
+   */
+  command void idle();
+
+  /**
+   * flush: pending data is about to get too old.  Get it out.
+   */
+  event void flush();
+
+  /**
+   * close_partial: asked from flush when the sector Collect is filling
+   * has data in it.  Pad it out now, or give it a little longer to fill
+   * on its own (flush will be signalled again).  Never deferred if
+   * critical records are pending.
+   *
+   * @param   uint16_t  used    bytes used in the partial sector.
+   *
+   * @return  bool      TRUE    close it (pad) now.
+   *                    FALSE   deferred.
+   */
+  command bool close_partial(uint16_t used);
+
+  /**
+   * set_max_age/max_age: data at risk bound, ms.  0 turns the policy
+   * off, the SSW only writes when it has a group.
+   */
+  command void     set_max_age(uint32_t ms);
+  command uint32_t max_age();
+
+  /**
+   * group: how many full sectors the SSW collects before firing up the
+   * SD.  SSW_GROUP until we know something about the card.
+   */
+  command uint8_t  group();
+
+  /**
+   * write_cost: a multi-block write finished.  Feeds learning the card
+   * when we don't have a characterisation for it (SDChar).
+   *
+   * @param   uint16_t  count   sectors in the write.
+   * @param   uint32_t  us      start of the write to writeDone.
+   */
+  command void write_cost(uint16_t count, uint32_t us);
+}
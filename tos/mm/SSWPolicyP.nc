@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SSW write policy
+ *
+ * The SSW normally waits for SSW_GROUP full buffers before firing up
+ * the SD, that amortizes the power up cost.  At high data rates that is
+ * all we need, a group fills long before anything gets old.  At low
+ * rates data can sit in RAM for hours, gone if we brown out.
+ *
+ * The policy bounds how old (max_age) data not on the SD can get.  Three
+ * inputs:
+ *
+ * o max_age, the data at risk bound.  Per regime, see stream_storage.h.
+ * o sd_cost, how long it takes to get the SD up and granted (request to
+ *   granted, the SSW measures this, ssw_delay).  Running average.
+ * o fill_ms, how long a sector takes to fill.  Running average.
+ *
+ * When the SSW goes idle holding data it tells us when the oldest of it
+ * showed up (pending).  We set the deadline to oldest + max_age minus
+ * two sd_costs (one to get the SD, one of slop for the write and for a
+ * deferral, below).  If a group fills before then the SSW writes as it
+ * always has and nothing extra gets spent.  If not, flush is signalled
+ * and the SSW pushes out what it has.
+ *
+ * If the sector Collect is filling has data in it, it gets closed out
+ * (padded, see Collect.close_sector) so it goes out too.  Unless the fill
+ * rate says it will fill on its own within sd_cost, then we wait that
+ * long once (deferred) rather than burn the rest of a sector on padding.
+ *
+ * Critical lane records (urgent) get a much shorter leash.  The deadline
+ * becomes the oldest of them plus SSW_CRIT_LATENCY if that is sooner, and
+ * the partial sector is always closed, no deferring.  SSW_CRIT_LATENCY is
+ * the window for other records to pile in behind the critical one and
+ * share the SD cycle, the SD cost comes on top.  This is independent of
+ * max_age, with max_age 0 critical records still get pushed.
+ *
+ * Grouping.  How many sectors make a group depends on the card, see SD
+ * characterisation in dblk_dir.h.  From it we get m, the cost of one
+ * more sector in a multi-block write, and the fixed cost of an SD cycle
+ * (power up + the command overhead, wr1 - m).  The group is the smallest
+ * n with fixed <= SSW_FIXED_PCT% of (fixed + n * m), clamped to
+ * SSW_GROUP_MIN..SSW_GROUP_MAX.  A known pwr_us also seeds sd_cost, so
+ * the flush lead is right from the first write instead of SSW_SD_COST.
+ * Without a characterisation the group stays SSW_GROUP.
+ *
+ * Collect keeps filling while the SD comes up, sd_cost / fill_ms sectors
+ * worth.  At high rates the group gets cut back so that plus the one
+ * being filled still fits in SLAB_RSV_SSW, see fit_group.
+ *
+ * Learning.  If the directory had nothing (or the host couldn't tell us
+ * pwr_us) we watch SSW_SDC_LEARN writes: time vs. sectors gets a least
+ * squares line, slope is m and the intercept the command overhead.
+ * sd_cost (binary ms, converted to uS) stands in for pwr_us.
+ * The result (DBLK_SDC_SRC_TAG) is used right away and DblkManager picks
+ * it up (get_sd_char) on its next directory mirror.  A host measured
+ * characterisation (tagfmtsd -C) keeps its write costs, those came off
+ * the card without our interrupts and task latency in them.  All we fill
+ * in is pwr_us, what the host couldn't see.
+ */
+
+#include <dblk_dir.h>
+#include "stream_storage.h"
+
+module SSWPolicyP {
+  provides {
+    interface SSWPolicy;
+    interface SDChar;
+  }
+  uses {
+    interface Timer<TMilli> as AgeTimer;
+    interface LocalTime<TMilli>;
+    interface Regime;
+  }
+}
+implementation {
+  uint32_t max_age    = SSW_MAX_AGE;
+  uint32_t sd_cost_ms = SSW_SD_COST;
+  uint32_t fill_ms;                     /* per sector, 0 don't know */
+  uint32_t last_fill;
+  bool     have_fill;
+
+  uint32_t oldest;                      /* oldest pending data */
+  bool     armed;
+  bool     deferred;                    /* already gave it more time */
+
+  uint32_t crit_latency = SSW_CRIT_LATENCY;
+  uint32_t crit_oldest;                 /* oldest pending critical record */
+  bool     crit;                        /* critical records pending */
+
+  /* SD characterisation, sdc_sig 0 nothing known */
+  dblk_sdchar_t sdc;
+  uint8_t  ssw_group = (SSW_GROUP > SSW_GROUP_MAX) ? SSW_GROUP_MAX : SSW_GROUP;
+  uint8_t  ssw_fit   = (SSW_GROUP > SSW_GROUP_MAX) ? SSW_GROUP_MAX : SSW_GROUP;
+
+  /* learning, least squares of write time (uS) on sectors */
+  bool     learning = TRUE;
+  uint16_t lrn_n;
+  uint16_t lrn_max_cnt;
+  uint32_t lrn_sx, lrn_sxx;
+  uint64_t lrn_sy, lrn_sxy;
+
+
+  /*
+   * cut the group back so Collect has somewhere to go while the SD comes
+   * up, sd_cost worth of sectors at the fill rate plus the one it is in.
+   * Only refit once per SD cycle (sd_cost, regroup) so buffer_full and
+   * the writer task see the same group.
+   */
+  void fit_group() {
+    uint32_t room;
+
+    ssw_fit = ssw_group;
+    if (!fill_ms)
+      return;
+    room = (sd_cost_ms + fill_ms - 1) / fill_ms + 1;
+    if (room + ssw_group <= SLAB_RSV_SSW)
+      return;
+    ssw_fit = (room + SSW_GROUP_MIN < SLAB_RSV_SSW) ? SLAB_RSV_SSW - room
+                                                     : SSW_GROUP_MIN;
+  }
+
+
+  /*
+   * pick the group from what we know about the card.
+   */
+  void regroup() {
+    uint32_t m, c, fixed;
+    uint64_t n;
+
+    if (sdc.sdc_sig != DBLK_SDCHAR_SIG) {
+      fit_group();                      /* stay with SSW_GROUP */
+      return;
+    }
+    if (sdc.wrm_cnt > 1 && sdc.wrm_us > sdc.wr1_us)
+      m = (sdc.wrm_us - sdc.wr1_us) / (sdc.wrm_cnt - 1);
+    else
+      m = sdc.wr1_us;
+    if (!m)
+      m = 1;
+    c = (sdc.wr1_us > m) ? sdc.wr1_us - m : 0;
+    fixed = (sdc.pwr_us ? sdc.pwr_us :
+             ((uint64_t) sd_cost_ms * 1000000) / 1024) + c;
+
+    /* fixed <= pct (fixed + n m)  ==>  n >= fixed (100 - pct) / (pct m) */
+    n = (uint64_t) fixed * (100 - SSW_FIXED_PCT);
+    n = (n + (uint64_t) SSW_FIXED_PCT * m - 1) / ((uint64_t) SSW_FIXED_PCT * m);
+    if (n < SSW_GROUP_MIN) n = SSW_GROUP_MIN;
+    if (n > SSW_GROUP_MAX) n = SSW_GROUP_MAX;
+    ssw_group = n;
+    fit_group();
+  }
+
+
+  /*
+   * enough writes seen, fit time = c + m * count.  All the same size,
+   * or a silly slope, and it all goes to m (c = 0), conservative.
+   * Host measured, sd_cost has had time to settle, that is pwr_us.
+   */
+  void learn_done() {
+    int64_t  den, m, c;
+    uint16_t cnt;
+
+    learning = FALSE;
+    if (sdc.sdc_sig == DBLK_SDCHAR_SIG && sdc.src != DBLK_SDC_SRC_TAG) {
+      /* host's wr1/wrm stand */
+      sdc.pwr_us = ((uint64_t) sd_cost_ms * 1000000) / 1024;
+      sdc.chksum = 0;
+      regroup();
+      return;
+    }
+    den = (int64_t) lrn_n * lrn_sxx - (int64_t) lrn_sx * lrn_sx;
+    m = 0;
+    c = 0;
+    if (den > 0) {
+      m = ((int64_t) lrn_n * lrn_sxy - (int64_t) lrn_sx * lrn_sy) / den;
+      c = ((int64_t) lrn_sy - m * lrn_sx) / lrn_n;
+    }
+    if (m <= 0) {
+      m = lrn_sy / lrn_sx;
+      c = 0;
+    }
+    if (c < 0)
+      c = 0;
+    cnt = (lrn_max_cnt > 1) ? lrn_max_cnt : SSW_GROUP_MAX;
+
+    sdc.sdc_sig   = DBLK_SDCHAR_SIG;
+    sdc.pwr_us    = ((uint64_t) sd_cost_ms * 1000000) / 1024;
+    sdc.wr1_us    = c + m;
+    sdc.wrm_cnt   = cnt;
+    sdc.wrm_us    = c + m * cnt;
+    sdc.src       = DBLK_SDC_SRC_TAG;
+    sdc.pad       = 0;
+    sdc.sdc_sig_a = DBLK_SDCHAR_SIG;
+    sdc.chksum    = 0;
+    regroup();
+  }
+
+
+  void arm() {
+    uint32_t lead, due, now;
+    int32_t  delta, crit_delta;
+    bool     have;
+
+    have  = FALSE;
+    delta = 0;
+    now   = call LocalTime.get();
+    if (armed && max_age) {
+      lead  = deferred ? sd_cost_ms : 2 * sd_cost_ms;
+      due   = oldest + max_age - lead;
+      delta = (int32_t) (due - now);
+      if (delta < 0 || lead >= max_age)
+        delta = 0;
+      have = TRUE;
+    }
+    if (armed && crit && crit_latency) {
+      crit_delta = (int32_t) (crit_oldest + crit_latency - now);
+      if (crit_delta < 0)
+        crit_delta = 0;
+      if (!have || crit_delta < delta)
+        delta = crit_delta;
+      have = TRUE;
+    }
+    if (!have) {
+      call AgeTimer.stop();
+      return;
+    }
+    call AgeTimer.startOneShot(delta);
+  }
+
+
+  command void SSWPolicy.filled(uint32_t t) {
+    uint32_t interval;
+
+    if (have_fill) {
+      interval = t - last_fill;
+      if (fill_ms)
+        fill_ms = (3 * fill_ms + interval) / 4;
+      else if ((fill_ms = interval))
+        /*
+         * first fill rate.  A group off the card's characterisation
+         * (SDChar.set_sd_char at boot) hasn't been fit to anything yet,
+         * don't wait for the first SD cycle, Collect overruns us while
+         * the SD comes up.  Only shrinks, buffer_full hasn't looked
+         * at group() yet.
+         */
+        fit_group();
+    }
+    last_fill = t;
+    have_fill = TRUE;
+  }
+
+
+  command void SSWPolicy.sd_cost(uint32_t ms) {
+    sd_cost_ms = (3 * sd_cost_ms + ms) / 4;
+    if (sdc.sdc_sig == DBLK_SDCHAR_SIG && !sdc.pwr_us)
+      regroup();                        /* sd_cost is standing in */
+    else
+      fit_group();
+  }
+
+
+  command void SSWPolicy.pending(uint32_t t) {
+    if (!armed || t != oldest)
+      deferred = FALSE;                 /* new oldest, new deal */
+    oldest = t;
+    armed  = TRUE;
+    crit   = FALSE;                     /* urgent follows if any */
+    arm();
+  }
+
+
+  command void SSWPolicy.urgent(uint32_t t) {
+    crit_oldest = t;
+    crit  = TRUE;
+    armed = TRUE;
+    arm();
+  }
+
+
+  command void SSWPolicy.idle() {
+    armed    = FALSE;
+    deferred = FALSE;
+    crit     = FALSE;
+    call AgeTimer.stop();
+  }
+
+
+  command bool SSWPolicy.close_partial(uint16_t used) {
+    uint64_t left_ms;
+
+    if (crit || deferred || !fill_ms || used >= SD_BLOCKSIZE)
+      return TRUE;
+    left_ms = (uint64_t) fill_ms * (SD_BLOCKSIZE - used) / SD_BLOCKSIZE;
+    if (left_ms > sd_cost_ms)
+      return TRUE;                      /* not any time soon, pad */
+    deferred = TRUE;
+    arm();
+    return FALSE;
+  }
+
+
+  command void SSWPolicy.set_max_age(uint32_t ms) {
+    max_age = ms;
+    arm();
+  }
+
+
+  command uint32_t SSWPolicy.max_age() {
+    return max_age;
+  }
+
+
+  command uint8_t SSWPolicy.group() {
+    return ssw_fit;
+  }
+
+
+  command void SSWPolicy.write_cost(uint16_t count, uint32_t us) {
+    if (!learning || !count)
+      return;
+    lrn_n++;
+    lrn_sx  += count;
+    lrn_sxx += (uint32_t) count * count;
+    lrn_sy  += us;
+    lrn_sxy += (uint64_t) count * us;
+    if (count > lrn_max_cnt)
+      lrn_max_cnt = count;
+    if (lrn_n >= SSW_SDC_LEARN)
+      learn_done();
+  }
+
+
+  command void SDChar.set_sd_char(dblk_sdchar_t *scp) {
+    if (!scp || scp->sdc_sig != DBLK_SDCHAR_SIG)
+      return;
+    sdc = *scp;
+    if (sdc.pwr_us) {
+      sd_cost_ms = ((uint64_t) sdc.pwr_us * 1024) / 1000000;
+      learning = FALSE;                 /* all there, nothing to learn */
+    }
+    regroup();
+  }
+
+
+  command bool SDChar.get_sd_char(dblk_sdchar_t *scp) {
+    if (!scp || sdc.sdc_sig != DBLK_SDCHAR_SIG)
+      return FALSE;
+    *scp = sdc;
+    return TRUE;
+  }
+
+
+  event void AgeTimer.fired() {
+    signal SSWPolicy.flush();
+  }
+
+
+  event void Regime.regimeChange() {
+#ifdef SSW_REGIME_MAX_AGE
+    const uint32_t ages[] = SSW_REGIME_MAX_AGE;
+    uint8_t regime;
+
+    regime = call Regime.getCurRegime();
+    if (regime < sizeof(ages)/sizeof(ages[0]))
+      call SSWPolicy.set_max_age(ages[regime]);
+#endif
+  }
+
+
+  default event void SSWPolicy.flush() { }
+}
@@ -74,6 +74,30 @@ interface SSWrite {
    */
   command void buffer_full(ss_wr_buf_t *buf_handle);
 
+  /**
+   * Collect has laid down a record from lane in the buffer.  The first
+   * one per lane starts the latency clock for that buffer.  A critical
+   * record (SSW_LANE_CRIT) also has us push things out early.
+   *
+   * @param buf_handle  buffer the record's header went into (ALLOC or FULL).
+   * @param lane        SSW_LANE_BULK or SSW_LANE_CRIT.
+   */
+  command void mark_lane(ss_wr_buf_t *buf_handle, uint8_t lane);
+
+  /**
+   * get per lane latency stats, collect to on the SD.
+   *
+   * @param lane        which lane.
+   * @return            ssw_lane_stats_t *, NULL if bad lane.
+   */
+  command ssw_lane_stats_t *lane_stats(uint8_t lane);
+
+  /**
+   * high water mark of full buffers (ssw_max_full).  How close we have
+   * come to running out.
+   */
+  command uint8_t max_full();
+
   /**
    * call when Collect has been kicked by a SysReboot.shutdown_flush to
    * force SSW to flush to disk any pending buffers.
@@ -42,11 +42,11 @@ implementation {
   SS  = SSW_P;
   MainC.SoftwareInit -> SSW_P;
 
-  components new SD0_ArbC() as SD;
-  components SD0C;
+  components new DblkSDC() as SD;
+  components DblkSDsaC;
   SSW_P.SDResource -> SD;
-  SSW_P.SDwrite    -> SD;
-  SSW_P.SDsa       -> SD0C;
+  SSW_P.SDwriteMulti -> SD;
+  SSW_P.SDsa       -> DblkSDsaC;
 
   components PanicC, LocalTimeMilliC;
   SSW_P.Panic      -> PanicC;
@@ -62,5 +62,14 @@ implementation {
 
   components OverWatchC;
   SSW_P.OverWatch    -> OverWatchC;
+
+  components SSWPolicyC;
+  SSW_P.SSWPolicy    -> SSWPolicyC;
+
+  components SlabArenaC;
+  SSW_P.SlabArena    -> SlabArenaC.SlabArena[SLAB_OWNER_SSW];
+
+  components PlatformC;
+  SSW_P.Platform     -> PlatformC;
   SSW_P.CollectEvent -> CollectC;
 }
@@ -29,7 +29,10 @@
  * The data storage area contains typed data described by typed_data.h.
  *
  * SSWrite provides a pool of buffers to its users and manages when those
- * buffers get written to the SD.
+ * buffers get written to the SD.  The memory comes from the slab arena
+ * (SlabArena), a slab is attached when Collect gets a buffer and goes
+ * back when the buffer has been written.  We have SLAB_RSV_SSW for sure
+ * and borrow beyond that when the data is coming in hot.
  *
  * Overview:
  *
@@ -38,7 +41,19 @@
  * to complete operations.
  *
  * This implementation is fully event driven and uses the split phase SD
- * driver.
+ * driver.  All full buffers pending when the writer runs are streamed to
+ * the SD as one multi-block write (SDwriteMulti), which avoids paying the
+ * per-command and per-sector program-busy overhead on every buffer.
+ *
+ * How long data may wait for a group is bounded by SSWPolicy.  When the
+ * policy says data is getting too old we write what we have, and have
+ * Collect close out (pad) the sector it is working on so that goes too.
+ *
+ * Collect tells us which lane (see stream_storage.h) each record is in,
+ * mark_lane.  A critical record in any buffer we are holding has the
+ * policy flush within SSW_CRIT_LATENCY rather than waiting on the group.
+ * When each buffer makes it to the SD, how long its oldest record per
+ * lane waited goes into ssw_lane_stats.
  *
  * Power management of the SD is handled by the SD driver.  SSWrite
  * will request the h/w, and when granted, the SD will be powered up and
@@ -75,7 +90,7 @@ module SSWriteP {
     interface StreamStorage as SS;
   }
   uses {
-    interface SDwrite;
+    interface SDwriteMulti;
     interface SDsa;
     interface DblkManager;
     interface Resource as SDResource;
@@ -85,31 +100,26 @@ module SSWriteP {
     interface CollectEvent;
     interface Collect;
     interface OverWatch;
+    interface SSWPolicy;
+    interface SlabArena;
+    interface Platform;
   }
 }
 
 implementation {
 
   ss_wr_buf_t ssw_handles[SSW_NUM_BUFS];
-  ss_wr_buf_t * const ssw_p[SSW_NUM_BUFS] = {
-    &ssw_handles[0],
-    &ssw_handles[1],
-    &ssw_handles[2],
-    &ssw_handles[3],
-    &ssw_handles[4],
-    &ssw_handles[5],
-    &ssw_handles[6],
-    &ssw_handles[7],
-    &ssw_handles[8],
-    &ssw_handles[9],
-  };
-
-#if SSW_NUM_BUFS != 10
-#warning "SSW_NUM_BUFS is other than 10"
-#endif
+
+#define SSW_P(i) (&ssw_handles[i])
 
   norace ss_control_t ssc;              /* all global control cells */
 
+  /*
+   * buffer pointers for the current multi-block write.  In disk order,
+   * ssw_grp_bufs[0] goes to ssc.dblk.  Owned by the SD until writeDone.
+   */
+  uint8_t *ssw_grp_bufs[SSW_NUM_BUFS];
+
 
   /*
    * instrumentation for measuring how long things take.
@@ -117,19 +127,39 @@ implementation {
   uint32_t ssw_delay;                   // how long are we held off?
   uint32_t ssw_write_grp_start;         // when we start the write of the group.
   uint32_t ssw_sd_cycles;               // how many times we attempt to turn SD on
+  uint32_t ssw_wr_us;                   // usecsRaw at SDwriteMulti.write, SSWPolicy.write_cost
+
+  /*
+   * ssw_force:   SSWPolicy says write what we have, don't wait for a group.
+   * ssw_closing: Collect is closing out a partial sector for us, the
+   *              buffer_full that follows isn't a real fill.
+   */
+  bool     ssw_force;
+  bool     ssw_closing;
+  uint32_t ssw_forced;                  // how many forced (short) writes
+
+  ssw_lane_stats_t ssw_lane_stats[SSW_LANES];
 
 #define ss_panic(where, arg) do { call Panic.panic(PANIC_SS, where, arg, 0, 0, 0); } while (0)
 
+  /* done with a buffer, its slab goes back to the arena */
+  void ssw_free_buf(ss_wr_buf_t *sswp) {
+    sswp->stamp = call LocalTime.get();
+    sswp->buf_state = SS_BUF_STATE_FREE;
+    sswp->lanes = 0;
+    call SlabArena.free(sswp->buf);
+    sswp->buf = NULL;
+  }
+
+
   void flush_buffers(void) {
     while (ssc.cur_handle->buf_state == SS_BUF_STATE_FULL) {
-      ssc.cur_handle->stamp = call LocalTime.get();
-      ssc.cur_handle->buf_state = SS_BUF_STATE_FREE;
-      memset(ssc.cur_handle->buf, 0, SD_BLOCKSIZE);
+      ssw_free_buf(ssc.cur_handle);
       ssc.ssw_out++;
       if (ssc.ssw_out >= SSW_NUM_BUFS)
         ssc.ssw_out = 0;
       ssc.ssw_num_full--;
-      ssc.cur_handle = ssw_p[ssc.ssw_out];
+      ssc.cur_handle = SSW_P(ssc.ssw_out);
     }
     ssc.cur_handle = NULL;
   }
@@ -141,15 +171,54 @@ implementation {
     ssc.majik_a     = SSC_MAJIK;
     ssc.majik_b     = SSC_MAJIK;
 
-    /* ssw_p[x]->buf_state starts in FREE (0) */
+    /* SSW_P(x)->buf_state starts in FREE (0), no slab */
     for (i = 0; i < SSW_NUM_BUFS; i++)
-      ssw_p[i]->majik = SS_BUF_SANE;
-
-    /* no need to zero the buffer, done by start up code */
+      SSW_P(i)->majik = SS_BUF_SANE;
     return SUCCESS;
   }
 
 
+  /*
+   * ssw_arm_policy: tell SSWPolicy about the oldest data we are holding
+   * that isn't on the SD yet.  Only while idle, when writing we look
+   * again when the write finishes.
+   *
+   * Oldest is the first full buffer if any, else the buffer Collect is
+   * filling if it has anything in it.  alloc_stamp is when Collect got
+   * the buffer, which it only does when it has something to put in it.
+   *
+   * If any of those buffers hold a critical record, the policy also gets
+   * when the oldest one showed up (urgent).
+   */
+  void ssw_arm_policy() {
+    ss_wr_buf_t *sswp;
+    uint8_t      idx, n;
+
+    if (ssc.state != SSW_IDLE)
+      return;
+    sswp = SSW_P(ssc.ssw_out);
+    if (!ssc.ssw_num_full &&
+        (sswp->buf_state != SS_BUF_STATE_ALLOC || !call Collect.buf_offset())) {
+      call SSWPolicy.idle();
+      return;
+    }
+    call SSWPolicy.pending(sswp->alloc_stamp);
+    idx = ssc.ssw_out;
+    for (n = 0; n < SSW_NUM_BUFS; n++) {
+      sswp = SSW_P(idx);
+      if (sswp->buf_state != SS_BUF_STATE_FULL &&
+          sswp->buf_state != SS_BUF_STATE_ALLOC)
+        break;
+      if (sswp->lanes & (1 << SSW_LANE_CRIT)) {
+        call SSWPolicy.urgent(sswp->lane_t0[SSW_LANE_CRIT]);
+        return;
+      }
+      if (++idx >= SSW_NUM_BUFS)
+        idx = 0;
+    }
+  }
+
+
   /*
    * SSWrite.buffer_full()
    *
@@ -157,7 +226,8 @@ implementation {
    * filled the buffer.
    *
    * The main SSWriter task will be kicked if current state is IDLE and
-   * we have at least SSW_GROUP buffers.
+   * we have at least SSWPolicy.group() buffers, or SSWPolicy has said to write
+   * what we have.
    */
 
   task void SSWriter_task();
@@ -171,7 +241,7 @@ implementation {
      * in should be where in_index points.
      */
     in_index = ssc.ssw_in;
-    sswp = ssw_p[in_index];
+    sswp = SSW_P(in_index);
     if (in_index >= SSW_NUM_BUFS)
       ss_panic(10, in_index);
 
@@ -188,21 +258,29 @@ implementation {
 
     handle->stamp = call LocalTime.get();
     handle->buf_state = SS_BUF_STATE_FULL;
+    if (!ssw_closing)
+      call SSWPolicy.filled(handle->stamp);
     ssc.ssw_num_full++;
     if (ssc.ssw_num_full > ssc.ssw_max_full)
       ssc.ssw_max_full = ssc.ssw_num_full;
-    if (ssc.state == SSW_IDLE && ssc.ssw_num_full >= SSW_GROUP)
-      post SSWriter_task();
     ssc.ssw_in++;
     if (ssc.ssw_in >= SSW_NUM_BUFS)
       ssc.ssw_in = 0;
+    if (ssc.state != SSW_IDLE)
+      return;
+    if (ssc.ssw_num_full >= call SSWPolicy.group() || ssw_force) {
+      call SSWPolicy.idle();
+      post SSWriter_task();
+      return;
+    }
+    ssw_arm_policy();
   }
 
 
   command ss_wr_buf_t* SSW.get_free_buf_handle() {
     ss_wr_buf_t *sswp;
 
-    sswp = ssw_p[ssc.ssw_alloc];
+    sswp = SSW_P(ssc.ssw_alloc);
     if (ssc.ssw_alloc >= SSW_NUM_BUFS ||
         ssc.majik_a != SSC_MAJIK ||
         ssc.majik_b != SSC_MAJIK ||
@@ -211,14 +289,30 @@ implementation {
       ss_panic(13, ssc.ssw_alloc);
 
     if (sswp->buf_state == SS_BUF_STATE_FREE) {
-      if (sswp->majik != SS_BUF_SANE)
+      if (sswp->majik != SS_BUF_SANE || sswp->buf)
         ss_panic(14, sswp->majik);
 
+      /*
+       * Past SLAB_RSV_SSW this is a borrow, which can come up dry if
+       * others are holding the lendable slabs and can't let go.  Same
+       * as running out of buffers.
+       */
+      sswp->buf = call SlabArena.alloc();
+      if (!sswp->buf)
+        ss_panic(15, ssc.ssw_num_full);
+      memset(sswp->buf, 0, SD_BLOCKSIZE); /* Collect counts on zeros */
+
       sswp->stamp = call LocalTime.get();
+      sswp->alloc_stamp = sswp->stamp;
+      sswp->lanes = 0;
       sswp->buf_state = SS_BUF_STATE_ALLOC;
       ssc.ssw_alloc++;
       if (ssc.ssw_alloc >= SSW_NUM_BUFS)
         ssc.ssw_alloc = 0;
+
+      /* first data we are holding starts the clock */
+      if (ssc.state == SSW_IDLE && !ssc.ssw_num_full)
+        call SSWPolicy.pending(sswp->alloc_stamp);
       return sswp;
     }
     ss_panic(15, -1);
@@ -226,6 +320,60 @@ implementation {
   }
 
 
+  /*
+   * mark_lane: Collect put a record from lane into handle.  Collect calls
+   * us after the record is down, by then its sector may have gone FULL,
+   * that's fine, it hasn't gone anywhere until the writer task runs.
+   */
+  command void SSW.mark_lane(ss_wr_buf_t *handle, uint8_t lane) {
+    if (!handle || handle->majik != SS_BUF_SANE || lane >= SSW_LANES ||
+        (handle->buf_state != SS_BUF_STATE_ALLOC &&
+         handle->buf_state != SS_BUF_STATE_FULL))
+      call Panic.panic(PANIC_SS, 29, (parg_t) handle, lane,
+                       handle ? handle->buf_state : 0, 0);
+    if (handle->lanes & (1 << lane))
+      return;                           /* clock already running */
+    handle->lanes |= (1 << lane);
+    handle->lane_t0[lane] = call LocalTime.get();
+    if (lane == SSW_LANE_CRIT)
+      ssw_arm_policy();
+  }
+
+
+  command ssw_lane_stats_t *SSW.lane_stats(uint8_t lane) {
+    if (lane >= SSW_LANES)
+      return NULL;
+    return &ssw_lane_stats[lane];
+  }
+
+
+  command uint8_t SSW.max_full() {
+    return ssc.ssw_max_full;
+  }
+
+
+  /* sswp made it to the SD, account for how long its records waited */
+  void ssw_lane_done(ss_wr_buf_t *sswp, uint32_t now, uint32_t *grp_max) {
+    ssw_lane_stats_t *lp;
+    uint32_t lat;
+    uint8_t  lane;
+
+    for (lane = 0; lane < SSW_LANES; lane++) {
+      if (!(sswp->lanes & (1 << lane)))
+        continue;
+      lat = now - sswp->lane_t0[lane];
+      lp  = &ssw_lane_stats[lane];
+      lp->count++;
+      lp->last_ms   = lat;
+      lp->total_ms += lat;
+      if (lat > lp->max_ms)
+        lp->max_ms = lat;
+      if (lat > grp_max[lane])
+        grp_max[lane] = lat;
+    }
+  }
+
+
   command uint8_t *SSW.buf_handle_to_buf(ss_wr_buf_t *handle) {
     if (!handle || handle->majik != SS_BUF_SANE ||
         handle->buf_state != SS_BUF_STATE_ALLOC)
@@ -268,19 +416,19 @@ implementation {
 
 
   /*
-   * get_temp_buf: return one of the SSW's buffers
+   * get_temp_buf: return a buffer nobody is using.
    *
    * Intended to be used while the system is single threaded by a user
-   * that needs to access the SD and needs a buffer.
+   * that needs to access the SD and needs a buffer.  It comes out of
+   * the slab arena but isn't taken, the next one in gets it.
    */
   async command uint8_t *SSW.get_temp_buf() {
-    uint32_t i;
+    uint8_t *buf;
 
-    for (i = 0; i < SSW_NUM_BUFS; i++)
-      if (ssw_p[i]->buf_state == SS_BUF_STATE_FREE)
-        return ssw_p[i]->buf;
-    ss_panic(17, i);
-    return NULL;
+    buf = call SlabArena.scratch();
+    if (!buf)
+      ss_panic(17, 0);
+    return buf;
   }
 
 
@@ -290,15 +438,17 @@ implementation {
    * The SSWriter_task is what performs the main function of the Stream writer.
    *
    * The task gets posted anytime a buffer becomes available.  The writer stays
-   * idle until SSW_GROUP buffers are available.  This amortizes any start up
-   * cost of powering the SD up across that many buffers.  We assume that the
+   * idle until SSWPolicy.group() buffers are available (or SSWPolicy says the data
+   * has waited long enough).  This amortizes any start up
+   * cost of powering the SD up across that many buffers.  Once the SD has
+   * been granted, every full buffer is sent as one multi-block write.  We assume that the
    * SD is off.  This could be changed easily by allowing a peek at the SD state
    * and starting the write up if the SD is already on.  This would reduce the
    * amount of pending data.  ie.  if we crash, right now we lose any data that
    * hasn't been written out yet.
    *
    * IDLE: not doing anything yet, possibly collecting buffers.
-   *       when SSW_GROUP buffers have been collected start writing.  request
+   *       when SSWPolicy.group() buffers have been collected start writing.  request
    *       the h/w.
    *
    * REQUESTED: h/w has been requested.  waiting for the grant.
@@ -306,16 +456,57 @@ implementation {
    * WRITING: buffers are being sent to the h/w.  waiting for writeDone event.
    */
 
+  /*
+   * ssw_write_group: launch a multi-block write of the full buffers.
+   *
+   * Starting at ssw_out, collect the run of FULL buffers.  Buffers are
+   * filled and written in strict order and dblk_nxt advances by one per
+   * buffer so the run lands in contiguous sectors starting at ssc.dblk.
+   * The run is clipped so it doesn't go past the end of the DBLK area.
+   */
+  void ssw_write_group() {
+    ss_wr_buf_t *sswp;
+    uint32_t     max_blks;
+    uint8_t      idx, n;
+    error_t      err;
+
+    max_blks = call DblkManager.get_dblk_high() - ssc.dblk + 1;
+    idx = ssc.ssw_out;
+    n   = 0;
+    while (n < ssc.ssw_num_full && n < max_blks) {
+      sswp = SSW_P(idx);
+      if (sswp->buf_state != SS_BUF_STATE_FULL)
+        break;
+      sswp->stamp = call LocalTime.get();
+      sswp->buf_state = SS_BUF_STATE_WRITING;
+      ssw_grp_bufs[n++] = sswp->buf;
+      if (++idx >= SSW_NUM_BUFS)
+        idx = 0;
+    }
+    if (n == 0)
+      call Panic.panic(PANIC_SS, 27, ssc.ssw_out, ssc.ssw_num_full, max_blks, 0);
+    ssc.ssw_num_writing = n;
+    ssw_wr_us = call Platform.usecsRaw();
+    err = call SDwriteMulti.write(ssc.dblk, ssw_grp_bufs, n);
+    if (err)
+      ss_panic(26, err);
+  }
+
+
   task void SSWriter_task() {
     error_t err;
 
     /*
      * This task should only get kicked if not doing anything
      */
-    if (ssc.state != SSW_IDLE || ssc.ssw_num_full < SSW_GROUP)
-      call Panic.panic(PANIC_SS, 18, ssc.state, ssc.ssw_num_full, 0, 0);
-
-    ssc.cur_handle = ssw_p[ssc.ssw_out];
+    if (ssc.state != SSW_IDLE || !ssc.ssw_num_full ||
+        (ssc.ssw_num_full < call SSWPolicy.group() && !ssw_force))
+      call Panic.panic(PANIC_SS, 18, ssc.state, ssc.ssw_num_full, ssw_force, 0);
+    if (ssc.ssw_num_full < call SSWPolicy.group())
+      ssw_forced++;
+    ssw_force = FALSE;
+
+    ssc.cur_handle = SSW_P(ssc.ssw_out);
     if (ssc.cur_handle->buf_state != SS_BUF_STATE_FULL)
       ss_panic(19, ssc.cur_handle->buf_state);
 
@@ -373,13 +564,10 @@ implementation {
 
     w_t0 = call LocalTime.get();
     ssw_delay = w_t0 - ssw_delay;       /* for logging later */
+    call SSWPolicy.sd_cost(ssw_delay);
     ssw_write_grp_start = w_t0;
-    ssc.cur_handle->stamp = w_t0;
-    ssc.cur_handle->buf_state = SS_BUF_STATE_WRITING;
     ssc.state = SSW_WRITING;
-    err = call SDwrite.write(ssc.dblk, ssc.cur_handle->buf);
-    if (err)
-      ss_panic(23, err);
+    ssw_write_group();
   }
 
 
@@ -391,27 +579,99 @@ implementation {
                                  ssw_sd_cycles, ssw_delay, w_diff);
     if (call SDResource.release())
       ss_panic(25, 0);
+    ssw_arm_policy();                   /* anything left start its clock */
+  }
+
+
+  /*
+   * SSWPolicy says the data we are holding is getting too old.  Write
+   * what we have, closing out the sector Collect is working on if it
+   * has anything in it (unless the policy would rather let it fill).
+   *
+   * If we are already writing, nothing to do.  When the write finishes
+   * we rearm and come back here if still needed.
+   */
+  event void SSWPolicy.flush() {
+    uint32_t used;
+    bool     closed;
+
+    if (ssc.state != SSW_IDLE)
+      return;
+    used = call Collect.buf_offset();
+    if (used && !call SSWPolicy.close_partial(used))
+      return;                           /* deferred, policy will call back */
+    ssw_force = TRUE;
+    if (used) {
+      ssw_closing = TRUE;
+      closed = call Collect.close_sector();
+      ssw_closing = FALSE;
+      if (closed)
+        return;                         /* buffer_full kicked the writer */
+    }
+    if (ssc.ssw_num_full) {
+      call SSWPolicy.idle();
+      post SSWriter_task();
+      return;
+    }
+    ssw_force = FALSE;                  /* nothing to write after all */
+    ssw_arm_policy();
   }
 
 
-  event void SDwrite.writeDone(uint32_t blk, uint8_t *buf, error_t err) {
+  event void SDwriteMulti.writeDone(uint32_t blk, uint8_t **bufs,
+                                    uint16_t count, error_t err) {
+    sd_busy_stats_t bs;
+    uint32_t now, grp_max[SSW_LANES];
+    uint16_t i;
+
+    if (err || blk != ssc.dblk || bufs != ssw_grp_bufs ||
+        count != ssc.ssw_num_writing)
+      call Panic.panic(PANIC_SS, 24, err, blk, ssc.dblk, count);
+    call SSWPolicy.write_cost(count, call Platform.usecsRaw() - ssw_wr_us);
+
+    /*
+     * card program (busy) time for the group, per blk.  This is what
+     * bounds how fast we can stream so keep an eye on it.
+     */
+    if (call OverWatch.getLoggingFlag(OW_LOG_SD)) {
+      call SDwriteMulti.busy_stats(&bs);
+      call CollectEvent.logEvent(DT_EVENT_SSW_BLK_TIME, bs.blk,
+                                 (bs.count << 16) | bs.timer_polls,
+                                 bs.max_us, bs.total_us);
+    }
+
+    now = call LocalTime.get();
+    memset(grp_max, 0, sizeof(grp_max));
+    for (i = 0; i < count; i++) {
+      ssc.cur_handle = SSW_P(ssc.ssw_out);
+      if (ssc.cur_handle->buf_state != SS_BUF_STATE_WRITING ||
+          ssc.cur_handle->buf != bufs[i])
+        call Panic.panic(PANIC_SS, 23, i, (parg_t) ssc.cur_handle,
+                         ssc.cur_handle->buf_state, (parg_t) bufs[i]);
+      ssw_lane_done(ssc.cur_handle, now, grp_max);
+      ssw_free_buf(ssc.cur_handle);
+      ssc.ssw_out++;
+      if (ssc.ssw_out >= SSW_NUM_BUFS)
+        ssc.ssw_out = 0;
+      ssc.ssw_num_full--;
+      signal SS.dblk_advanced(blk + i);                 /* tell what we last did */
+      ssc.dblk = call DblkManager.adv_dblk_nxt();
+    }
+    ssc.ssw_num_writing = 0;
+    ssc.cur_handle = SSW_P(ssc.ssw_out);                /* point to nxt buf */
 
-    if (err || blk != ssc.dblk || ssc.cur_handle->buf_state != SS_BUF_STATE_WRITING)
-      call Panic.panic(PANIC_SS, 24, err, blk, ssc.dblk, ssc.cur_handle->buf_state);
+    /* worst wait in the group per lane, crit/bulk: ms */
+    if (call OverWatch.getLoggingFlag(OW_LOG_SD))
+      call CollectEvent.logEvent(DT_EVENT_SSW_LANE_TIME,
+                                 grp_max[SSW_LANE_CRIT], grp_max[SSW_LANE_BULK],
+                                 ssw_lane_stats[SSW_LANE_CRIT].max_ms,
+                                 ssw_lane_stats[SSW_LANE_BULK].max_ms);
 
-    ssc.cur_handle->stamp = call LocalTime.get();
-    ssc.cur_handle->buf_state = SS_BUF_STATE_FREE;
-    memset(ssc.cur_handle->buf, 0, SD_BLOCKSIZE);
-    ssc.ssw_out++;
-    if (ssc.ssw_out >= SSW_NUM_BUFS)
-      ssc.ssw_out = 0;
-    ssc.cur_handle = ssw_p[ssc.ssw_out];                /* point to nxt buf */
-    ssc.ssw_num_full--;
-    signal SS.dblk_advanced(blk);                       /* tell what we last did */
-    if ((ssc.dblk = call DblkManager.adv_dblk_nxt()) == 0) {
+    if (ssc.dblk == 0) {
       /*
        * adv_nxt_blk returning 0 says we ran off the end of
-       * the file system area.
+       * the file system area.  The group was clipped so this
+       * can only happen on its last block.
        */
       signal SS.dblk_stream_full();
       flush_buffers();
@@ -422,13 +682,10 @@ implementation {
 
     if (ssc.cur_handle->buf_state == SS_BUF_STATE_FULL) {
       /*
-       * more work to do, stay in SSW_WRITING.
+       * more buffers filled while we were writing.  stay in
+       * SSW_WRITING and send them along while the SD is still up.
        */
-      ssc.cur_handle->stamp = call LocalTime.get();
-      ssc.cur_handle->buf_state = SS_BUF_STATE_WRITING;
-      err = call SDwrite.write(ssc.dblk, ssc.cur_handle->buf);
-      if (err)
-        ss_panic(26, err);
+      ssw_write_group();
       return;
     }
     ssc.state = SSW_IDLE;
@@ -471,11 +728,17 @@ implementation {
       return;
     dblk = call DblkManager.get_dblk_nxt();
     while (num_full) {
-      handle = ssw_p[idx];
+      handle = SSW_P(idx);
       if (dblk == 0)                    /* any unexpected, just bail */
         return;
+      /*
+       * WRITING, a group was on its way to the SD when we went down.
+       * SDsa.reset killed it and it never got to writeDone (dblk_nxt
+       * hasn't moved), write it again.
+       */
       if (handle->majik != SS_BUF_SANE ||
-          handle->buf_state != SS_BUF_STATE_FULL)
+          (handle->buf_state != SS_BUF_STATE_FULL &&
+           handle->buf_state != SS_BUF_STATE_WRITING))
         return;                         /* that's weird, somethings wrong */
       call SDsa.write(dblk, handle->buf);
       idx++;
@@ -499,7 +762,7 @@ implementation {
      */
     if (idx != ssc.ssw_in)              /* should be next in from collector */
       return;                           /* stop what we are doing, if not   */
-    handle = ssw_p[idx];
+    handle = SSW_P(idx);
     if (dblk == 0)                      /* if no where to go, bail */
       return;
     if (handle->majik != SS_BUF_SANE ||
@@ -508,9 +771,12 @@ implementation {
 
     /*
      * If the buffer is ALLOC'd then the Collector has gotten it and has
-     * definitely put something into it.  Just write it out.
+     * definitely put something into it.  Just write it out.  And move
+     * dblk_nxt past it, Collect seals the checkpoint from dblk_nxt next
+     * and the fast boot wants dblk_nxt erased.
      */
     call SDsa.write(dblk, handle->buf);
+    call DblkManager.adv_dblk_nxt();
   }
 
 
@@ -524,6 +790,29 @@ implementation {
   }
 
 
+#ifdef DBLK_CIRCULAR
+  /* offsets past the end of the DBLK area come around to the front */
+  uint32_t ssw_fold(uint32_t offset) {
+    uint32_t span;
+
+    span = (call DblkManager.get_dblk_high() - call DblkManager.get_dblk_low())
+      << SD_BLOCKSIZE_NBITS;
+    if (offset >= span + SD_BLOCKSIZE)
+      offset -= span;
+    return offset;
+  }
+
+
+  /* tail to the end of the area, only once the head has wrapped */
+  bool ssw_old_data(uint32_t offset) {
+    uint32_t tail_offset;
+
+    tail_offset = call DblkManager.tail_offset();
+    return (tail_offset && offset >= tail_offset);
+  }
+#endif
+
+
   /*
    * StreamStorage.where(): return information where a given file
    *    offset lives. assume we want at least one byte.
@@ -550,6 +839,7 @@ implementation {
     uint32_t rel_blk;                   /* relative block id    */
     uint32_t blk_id;                    /* absolute block id    */
     uint32_t idx;                       /* buffer index, cached */
+    uint32_t sect_offset;               /* what was asked for   */
 
     if (!lenp || !blk_offsetp || !bufp)
       ss_panic(28, 0);
@@ -558,17 +848,34 @@ implementation {
     *blk_offsetp = 0;
     *bufp = NULL;
 
+    dblk_low = call DblkManager.get_dblk_low();
+    dblk_nxt = call DblkManager.get_dblk_nxt();
+    sect_offset = offset & ~((uint32_t) SD_BLOCKSIZE - 1);
+
+#ifdef DBLK_CIRCULAR
+    /*
+     * circular DBLK (dblk_dir.h).  Offsets past the end of the area fold
+     * back to the front (a record straddling the wrap), the caller still
+     * gets back the sector offset it asked for.  Old data from the tail
+     * to the end of the area is past the eof but it is on the disk.
+     */
+    offset = ssw_fold(offset);
+    if (ssw_old_data(offset)) {
+      *lenp = SD_BLOCKSIZE;
+      *blk_offsetp = sect_offset;
+      return (offset >> SD_BLOCKSIZE_NBITS) + dblk_low;
+    }
+#endif
+
     /* past eof, just bail */
     if (offset >= call SS.eof_offset())
       return 0;
 
-    dblk_low = call DblkManager.get_dblk_low();
-    dblk_nxt = call DblkManager.get_dblk_nxt();
     rel_blk  = offset >> SD_BLOCKSIZE_NBITS;
     blk_id   = rel_blk + dblk_low;
 
     *lenp = SD_BLOCKSIZE;
-    *blk_offsetp = rel_blk << SD_BLOCKSIZE_NBITS;
+    *blk_offsetp = sect_offset;
 
     if (offset < call DblkManager.dblk_nxt_offset())
       return blk_id;
@@ -603,5 +910,9 @@ implementation {
   default event void SS.dblk_advanced(uint32_t last) { }
 
         event void Collect.collectBooted() { }
+
+  /* our slabs hold data waiting for the SD, none of it can go back */
+  event void SlabArena.reclaim() { }
+
   async event void Panic.hook() { }
 }
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * Definitions shared between Collect and its producers.
+ *
+ * A record reservation (Collect.reserve) hands the producer pointers
+ * directly into the SSW sector buffers.  The header is returned as a
+ * single contiguous dt_header_t.  The data area is described by one or
+ * more segments, one per sector the data lands in.
+ *
+ * A record is limited to DT_MAX_RLEN (1024) and always starts with at
+ * least 4 bytes available in the current sector.  So it can touch at most
+ * three sectors, which bounds the number of segments.
+ *
+ * collect_seg_t is also used as the iov element for Collect.collect_iov,
+ * a list of (buf, len) areas that together make up one record.  The
+ * first area is the header.
+ */
+
+#ifndef __COLLECT_H__
+#define __COLLECT_H__
+
+#define COLLECT_MAX_SEGS 3
+#define COLLECT_MAX_IOV  8
+
+typedef struct {
+  uint8_t  *buf;                        /* where the bytes live */
+  uint16_t  len;                        /* how many             */
+} collect_seg_t;
+
+typedef struct {
+  uint16_t      nsegs;                  /* number of data segments */
+  uint16_t      dlen;                   /* total data length       */
+  collect_seg_t seg[COLLECT_MAX_SEGS];
+} collect_rsv_t;
+
+
+/*
+ * collect_rsv_fill: copy len bytes from src into the reserved data area
+ * starting at data offset 'offset'.  Handles the sector splits.
+ *
+ * returns number of bytes actually placed (clipped at rsv->dlen).
+ */
+static inline uint16_t collect_rsv_fill(collect_rsv_t *rsv, uint16_t offset,
+                                        uint8_t *src, uint16_t len) {
+  uint8_t  *dp;
+  uint16_t  i, n, placed;
+
+  placed = 0;
+  for (i = 0; i < rsv->nsegs && len; i++) {
+    if (offset >= rsv->seg[i].len) {
+      offset -= rsv->seg[i].len;        /* not in this segment */
+      continue;
+    }
+    dp = rsv->seg[i].buf + offset;
+    n  = rsv->seg[i].len - offset;
+    if (n > len)
+      n = len;
+    placed += n;
+    len    -= n;
+    offset  = 0;
+    while (n--)
+      *dp++ = *src++;
+  }
+  return placed;
+}
+
+#endif  /* __COLLECT_H__ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2019, Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * copy_sum: copy len bytes from src to dst and return the byte sum of
+ * what was copied (the recsum definition, see CollectP stamp_header).
+ *
+ * If both ends are quad aligned we move a word at a time.  The bytes
+ * of each word are summed as two pairs of 16 bit lanes (even bytes and
+ * odd bytes) which are folded together at the end.  Each lane picks up
+ * at most 255 per word, so the lanes can't carry into each other as
+ * long as len <= SD_BLOCKSIZE, which copy_block_out guarantees.
+ * Unaligned sources (we trap on unaligned accesses) and any tail are
+ * done a byte at a time.
+ *
+ * Lives in a header so sa_tests/copy_sum_bench.c can time the same code
+ * on the host.
+ */
+
+#ifndef __COPY_SUM_H__
+#define __COPY_SUM_H__
+
+static inline uint16_t copy_sum(uint8_t *dst, uint8_t *src, uint16_t len) {
+  uint32_t *wdst, *wsrc;
+  uint32_t  w, even, odd;
+  uint16_t  sum;
+
+  sum = 0;
+  if ((((uintptr_t) dst | (uintptr_t) src) & 0x03) == 0) {
+    wdst = (void *) dst;
+    wsrc = (void *) src;
+    even = odd = 0;
+    for (; len >= 4; len -= 4) {
+      w = *wsrc++;
+      *wdst++ = w;
+      even += w & 0x00ff00ff;
+      odd  += (w >> 8) & 0x00ff00ff;
+    }
+    even += odd;
+    sum   = (uint16_t) (even + (even >> 16));
+    dst   = (void *) wdst;
+    src   = (void *) wsrc;
+  }
+  while (len--) {
+    sum += *src;
+    *dst++ = *src++;
+  }
+  return sum;
+}
+
+#endif  /* __COPY_SUM_H__ */
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#ifndef __DBLK_SD_H__
+#define __DBLK_SD_H__
+
+/*
+ * Where the DBLK lives.
+ *
+ * SINGLE       SD0 only.  What we have always done.
+ * MIRROR       every DBLK write goes to both SD0 and SD1.  Reads come
+ *              from SD0, SD1 if SD0 errors.
+ * STRIPE       DBLK data sectors alternate between the cards, sector
+ *              0 of the data on SD0, 1 on SD1, 2 on SD0...  Each card
+ *              powers up for half as long and both program at the same
+ *              time.  The DBLK is twice as big.
+ *
+ * Only platforms with a second SD slot (PLATFORM_SD1, mm6a, dev6a) can
+ * do anything but SINGLE.  Both cards have to be formatted the same
+ * (tagfmtsd, same locator and DBLK area).  The directory sector (first
+ * sector of the DBLK area) and anything outside the DBLK data is
+ * written to both cards and read from SD0.
+ *
+ * Changing modes needs an erased DBLK.  The mode is recorded in the
+ * directory (dblk_dir_t.sd_mode) when DblkManager mirrors its checkpoint
+ * and DblkManager won't run on a DBLK laid down in a different mode.
+ *
+ * Striped, logical DBLK sector s (s = 0 first data sector, lower + 1)
+ * lives on card (s & 1) at lower + 1 + (s >> 1).  tagdump --stripe puts
+ * the two card dumps back together.
+ */
+
+#define DBLK_SD_SINGLE  0
+#define DBLK_SD_MIRROR  1
+#define DBLK_SD_STRIPE  2
+
+#ifndef DBLK_SD_MODE
+#define DBLK_SD_MODE    DBLK_SD_SINGLE
+#endif
+
+#if DBLK_SD_MODE != DBLK_SD_SINGLE && !defined(PLATFORM_SD1)
+#error "DBLK_SD_MODE MIRROR/STRIPE needs a platform with SD1"
+#endif
+
+#define DBLK_SD_CARDS     2
+#define DBLK_SD_RESOURCE  "DblkSD.Resource"
+
+/*
+ * logical upper (inclusive) from the DBLK area's physical lower/upper.
+ * Striped, each card holds upper - lower data sectors.
+ */
+#if DBLK_SD_MODE == DBLK_SD_STRIPE
+#define DBLK_SD_UPPER(lower, upper) ((lower) + 2 * ((upper) - (lower)))
+#else
+#define DBLK_SD_UPPER(lower, upper) (upper)
+#endif
+
+#endif  /* __DBLK_SD_H__ */
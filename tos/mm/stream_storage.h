@@ -27,18 +27,124 @@
 #define __STREAM_STORAGE_H__
 
 #include "sd.h"
+#include <slab_arena.h>
 
-/* number of buffers that StreamStorage is using */
-#define SSW_NUM_BUFS   10
+/*
+ * number of buffer handles (the ring) StreamStorage is using.
+ *
+ * The buffers themselves come out of the slab arena when Collect asks
+ * for one and go back when written.  SLAB_RSV_SSW of them are always
+ * there, past that (heavy logging) they are borrowed, up to
+ * SLAB_MAX_SSW.  See slab_arena.h.
+ */
+#define SSW_NUM_BUFS   SLAB_MAX_SSW
 
 /*
  * SSW_GROUP defines how many buffers to group together before trying to fire up the SD
  * to write them out.   Amortizes the turn on cost over this many buffers.  Note that there
  * need to be more than this number of buffers so the collection system has something to
  * write into while the writes are happening.
+ *
+ * The group (and any other full buffers) is streamed to the SD as a single
+ * multi-block write transaction.
  */
 #define SSW_GROUP  4
 
+#if SLAB_RSV_SSW <= SSW_GROUP
+#error "SLAB_RSV_SSW must be more than SSW_GROUP"
+#endif
+
+/*
+ * SSW_GROUP is where we start.  Once we know what the card costs (SD
+ * characterisation, dblk_dir.h) SSWPolicy picks the group at run time,
+ * between SSW_GROUP_MIN and SSW_GROUP_MAX.  The group is the smallest
+ * that keeps the fixed cost of an SD cycle (power up plus command
+ * overhead) at or under SSW_FIXED_PCT percent of the cycle.
+ *
+ * SSW_GROUP_MAX leaves Collect a couple of reserved buffers to fill while
+ * the group is going out.
+ */
+#ifndef SSW_GROUP_MIN
+#define SSW_GROUP_MIN  2
+#endif
+
+#ifndef SSW_GROUP_MAX
+#define SSW_GROUP_MAX  (SLAB_RSV_SSW - 2)
+#endif
+
+#ifndef SSW_FIXED_PCT
+#define SSW_FIXED_PCT  25
+#endif
+
+#if SSW_GROUP_MIN < 1 || SSW_GROUP_MAX < SSW_GROUP_MIN || SLAB_RSV_SSW <= SSW_GROUP_MAX
+#error "SSW_GROUP_MIN/SSW_GROUP_MAX out of whack with SLAB_RSV_SSW"
+#endif
+
+/*
+ * SSW_SDC_LEARN: number of SD cycles SSWPolicy watches before it will
+ * hand back a learned characterisation (DBLK_SDC_SRC_TAG).
+ */
+#ifndef SSW_SDC_LEARN
+#define SSW_SDC_LEARN  16
+#endif
+
+/*
+ * Data at risk.  Records sitting in SSW buffers (including the sector
+ * Collect is filling) are lost if we go down hard.  At low data rates
+ * waiting for SSW_GROUP can take hours.
+ *
+ * SSW_MAX_AGE (ms) bounds how long data waits before SSWPolicy has the
+ * SSW force it out, padding a partial sector if need be.  0 turns this
+ * off.  It can be set per regime, SSW_REGIME_MAX_AGE (optional, platform)
+ * is a table of max ages indexed by regime.
+ *
+ * SSW_SD_COST (ms) is the starting guess for how long it takes to get
+ * the SD powered up and granted.  Refined from measurements.
+ */
+#ifndef SSW_MAX_AGE
+#define SSW_MAX_AGE  (5 * 60 * 1024UL)
+#endif
+
+#define SSW_SD_COST  256
+
+/*
+ * Lanes.  Records are sorted (see CollectP, collect_lane) into critical
+ * (events, syncs, reboots, panic warnings) and bulk (sensor data and
+ * the like).  Both lanes go into the same sectors in the order they
+ * were collected, the on disk format doesn't know about lanes.  What
+ * differs is how long they are allowed to sit.
+ *
+ * Bulk waits for a group (or SSW_MAX_AGE).  A critical record has the
+ * SSW push out what it has, after waiting up to SSW_CRIT_LATENCY (ms)
+ * for anything else to show up and share the SD cycle.  0 turns the
+ * critical lane off, everything is bulk.
+ *
+ * Time from collect to the sector being on the SD is tracked per lane,
+ * ssw_lane_stats_t.
+ */
+enum {
+  SSW_LANE_BULK = 0,
+  SSW_LANE_CRIT,
+  SSW_LANES,
+};
+
+#ifndef SSW_CRIT_LATENCY
+#define SSW_CRIT_LATENCY  (10 * 1024UL)
+#endif
+
+/*
+ * count:       sectors written holding records from the lane.
+ * last_ms:     latency of the most recent, oldest record in the sector.
+ * max_ms:      worst seen.
+ * total_ms:    sum, total_ms/count is the average.
+ */
+typedef struct {
+  uint32_t count;
+  uint32_t last_ms;
+  uint32_t max_ms;
+  uint32_t total_ms;
+} ssw_lane_stats_t;
+
 /*
  * Stream Storage Buffer States
  *
@@ -58,10 +164,10 @@
  *
  * A buffer cycle is as follows:
  *
- * 1) Initially a buffer is marked FREE.
+ * 1) Initially a buffer is marked FREE.  It has no memory (buf NULL).
  *
  * 2) The data collector requests the buffer via get_buffer and
- *    the buffer transitions to ALLOC.
+ *    the buffer transitions to ALLOC.  A zeroed slab is attached.
  *
  * 3) The data collector fills the buffer and hands it off to
  *    StreamStorage via the command SSWrite.buffer_full
@@ -69,7 +175,8 @@
  * 4) Full buffers are handed to the SD driver in the order they
  *    are received (filled up).  marked WRITING.
  *
- * 5) Upon successful completion, the buffer is marked FREE.
+ * 5) Upon successful completion, the buffer is marked FREE and its
+ *    slab goes back to the arena.
  */
 
 typedef enum {
@@ -90,7 +197,10 @@ typedef struct {
   ss_buf_majik_t majik;
   ss_buf_state_t buf_state;
   uint32_t stamp;
-  uint8_t  buf[SD_BLOCKSIZE] __attribute__ ((aligned (4)));     /* 512 */
+  uint32_t alloc_stamp;                 /* when Collect got it, data age */
+  uint8_t *buf;                         /* slab, while ALLOC..WRITING */
+  uint8_t  lanes;                       /* 1 << lane, lanes holding records */
+  uint32_t lane_t0[SSW_LANES];          /* first record in, per lane */
 } ss_wr_buf_t;
 
 
@@ -106,8 +216,10 @@ typedef struct {
  * ssw_out: 	 Buffer being written out via dma to the stream storage device.
  * ssw_in:	 Next buffer that should be coming back from the collector.
  * ssw_alloc:    Next buffer to be given out.
- * ssw_num_full: number of full buffers including the one being written.
+ * ssw_num_full: number of full buffers including the ones being written.
  * ssw_max_full: maximum number of full buffers ever
+ * ssw_num_writing: number of buffers handed to the SD in the current
+ *               multi-block write.  0 if not writing.
  */
 
 typedef enum {
@@ -129,7 +241,7 @@ typedef struct {
   uint8_t     ssw_alloc;	/* next buffer to be allocated. */
   uint8_t     ssw_num_full;	/* number of full buffers including active */
   uint8_t     ssw_max_full;	/* maximum that ever went, max */
-  uint8_t     pad;
+  uint8_t     ssw_num_writing;	/* buffers in the current multi-block write */
 
   uint16_t    majik_b;		/* tombstone */
 } ss_control_t;
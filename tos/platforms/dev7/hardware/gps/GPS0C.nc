@@ -21,6 +21,8 @@
  *          Daniel J. Maltbie <dmaltbie@daloma.org>
  */
 
+#include <slab_arena.h>
+
 configuration GPS0C {
   provides {
     interface GPSControl;
@@ -73,7 +75,7 @@ implementation {
   Gsd4eUP.Platform -> PlatformC;
 
   /* and wire in the Protocol Handler */
-  components SirfBinP, MsgBufP;
+  components SirfBinP, MsgBufP, SlabArenaC;
   Gsd4eUP.SirfProto     -> SirfBinP;
   SirfBinP.MsgBuf       -> MsgBufP;
   SirfBinP.Collect      -> CollectC;
@@ -83,6 +85,7 @@ implementation {
   MainC.SoftwareInit -> MsgBufP;
   MsgBufP.Rtc        -> PlatformC;
   MsgBufP.Panic      -> PanicC;
+  MsgBufP.SlabArena  -> SlabArenaC.SlabArena[SLAB_OWNER_MSGBUF];
 
   MsgReceive  = MsgBufP;
   MsgTransmit = Gsd4eUP;
@@ -38,7 +38,9 @@
 configuration SD0C {
   provides {
     interface SDread[uint8_t cid];
+    interface SDreadMulti[uint8_t cid];
     interface SDwrite[uint8_t cid];
+    interface SDwriteMulti[uint8_t cid];
     interface SDerase[uint8_t cid];
     interface SDsa;
     interface SDraw;
@@ -50,7 +52,9 @@ implementation {
   components new SDspP() as SDdvrP;
 
   SDread   = SDdvrP;
+  SDreadMulti = SDdvrP;
   SDwrite  = SDdvrP;
+  SDwriteMulti = SDdvrP;
   SDerase  = SDdvrP;
   SDsa     = SDdvrP;
   SDraw    = SDdvrP;
@@ -31,6 +31,10 @@ class DblkManager(gdb.Command):
             state, lower, xnext, upper, fnd, cur))
         print('                   {:08x}    {:08x}    {:08x}'.format(
             lower_off, xnext_off, upper_off))
+        tail = int(gdb.parse_and_eval(dmcb.format('dblk_tail')))
+        if tail and tail != lower + 1:
+            print('      tail: {:x}  ({:08x}), circular, wrapped'.format(
+                tail, (tail - lower) << 9))
 
 class DblkMap(gdb.Command):
     """Display DblkMap control blocks"""
@@ -40,25 +44,52 @@ class DblkMap(gdb.Command):
     def invoke (self, args, from_tty):
         dmap   = 'DblkMapFileP__{}'
         dmf_cb = 'DblkMapFileP__dmf_cb.{}'
-        dm_cache = 'DblkMapFileP__dmf_cb.cache.{}'
+        dm_slot = 'DblkMapFileP__dmf_cb.slot[{}].{}'
+        dm_stats = 'DblkMapFileP__dmf_stats.{}'
 
         fill_id = int(gdb.parse_and_eval(dmf_cb.format('fill_blk_id')))
+        fill_n  = int(gdb.parse_and_eval(dmf_cb.format('fill_count')))
         err     = gdb.parse_and_eval(dmf_cb.format('err'))
-        cid     = int(gdb.parse_and_eval(dmf_cb.format('cid')))
+        fill_cid = int(gdb.parse_and_eval(dmf_cb.format('fill_cid')))
+        q_count = int(gdb.parse_and_eval(dmf_cb.format('q_count')))
+        q_max   = int(gdb.parse_and_eval(dmf_cb.format('q_max')))
         state   = gdb.parse_and_eval(dmf_cb.format('io_state'))
-
-        offset  = int(gdb.parse_and_eval(dm_cache.format('offset')))
-        clen    = int(gdb.parse_and_eval(dm_cache.format('len')))
-        c_blkid = int(gdb.parse_and_eval(dm_cache.format('id')))
-        target  = int(gdb.parse_and_eval(dm_cache.format('target_offset')))
-        extra   = int(gdb.parse_and_eval(dm_cache.format('extra')))
+        stamp   = int(gdb.parse_and_eval(dmf_cb.format('stamp')))
+        nslots  = int(gdb.parse_and_eval(
+            'sizeof(DblkMapFileP__dmf_cb.slot)/sizeof(DblkMapFileP__dmf_cb.slot[0])'))
 
         state   = state.__str__().replace('DMF_','')
 
-        print('dblkMap: state: {}  cid: {}  err: {:9s}  fill: {:x}'.format(
-            state, cid, err, fill_id))
-        print('  cache: ({:04x}) {:08x}/{:03x}  target: {:08x}  extra: {:03x}'.format(
-            c_blkid, offset, clen, target, extra))
+        print('dblkMap: state: {}  cid: {}  err: {:9s}  fill: {:x}/{}'.format(
+            state, fill_cid, err, fill_id, fill_n))
+        print('  stamp: {}  queued: {}  q_max: {}'.format(stamp, q_count, q_max))
+        dm_cl = 'DblkMapFileP__dmf_clients[{}].{}'
+        ncl = int(gdb.parse_and_eval(
+            'sizeof(DblkMapFileP__dmf_clients)/sizeof(DblkMapFileP__dmf_clients[0])'))
+        for i in range(ncl):
+            cstate = gdb.parse_and_eval(dm_cl.format(i, 'state'))
+            cstate = cstate.__str__().replace('DMF_CL_','')
+            need   = int(gdb.parse_and_eval(dm_cl.format(i, 'need')))
+            seq    = int(gdb.parse_and_eval(dm_cl.format(i, 'seq_offset')))
+            plen   = int(gdb.parse_and_eval(dm_cl.format(i, 'part_len')))
+            print('  cid {}: {:8s} need: {:08x}  seq: {:08x}  part: {:02x}'.format(
+                i, cstate, need, seq, plen))
+        for i in range(nslots):
+            offset  = int(gdb.parse_and_eval(dm_slot.format(i, 'offset')))
+            slen    = int(gdb.parse_and_eval(dm_slot.format(i, 'len')))
+            s_blkid = int(gdb.parse_and_eval(dm_slot.format(i, 'id')))
+            s_stamp = int(gdb.parse_and_eval(dm_slot.format(i, 'stamp')))
+            ahead   = int(gdb.parse_and_eval(dm_slot.format(i, 'ahead')))
+            s_buf   = int(gdb.parse_and_eval(dm_slot.format(i, 'buf')))
+            if not s_buf:
+                print('  slot {}: --'.format(i))
+                continue
+            print('  slot {}: ({:04x}) {:08x}/{:03x}  stamp: {:6d} {}'.format(
+                i, s_blkid, offset, slen, s_stamp, 'A' if ahead else ''))
+        fields = [ 'hits', 'misses', 'ss_copies', 'sd_reads', 'sd_blocks',
+                   'ahead', 'ahead_hits', 'evictions', 'coalesced' ]
+        print('  stats:', '  '.join(['{}: {}'.format(f,
+            int(gdb.parse_and_eval(dm_stats.format(f)))) for f in fields]))
 
 class ResyncCtl(gdb.Command):
     """Display Resync control blocks"""
@@ -92,6 +123,54 @@ class ResyncCtl(gdb.Command):
         print('resync: {:08x} <= {:08x} < {:08x}  {}  {}({})  {}  f: {}'.format(
             lower, cur, upper, xdir, busy, cid, err, fnd))
 
+class SlabArena(gdb.Command):
+    """Display slab arena usage, per owner"""
+    def __init__ (self):
+        super(SlabArena, self).__init__("slabArena", gdb.COMMAND_USER)
+
+    def invoke (self, args, from_tty):
+        owners = [ 'ssw', 'dmf', 'im', 'msgbuf', 'dm' ]
+        sa_st  = 'SlabArenaP__slab_stats.{}'
+        sa_own = 'SlabArenaP__slab_stats.owner[{}].{}'
+        nslabs = int(gdb.parse_and_eval(
+            'sizeof(SlabArenaP__slab_owner)/sizeof(SlabArenaP__slab_owner[0])'))
+        free   = int(gdb.parse_and_eval(sa_st.format('free')))
+        peak   = int(gdb.parse_and_eval(sa_st.format('peak')))
+        print('slabArena: slabs: {}  free: {}  peak: {}'.format(nslabs, free, peak))
+        print('  owner   rsv max  cnt  hw  borrows  fails  reclaims')
+        for i, name in enumerate(owners):
+            rsv = int(gdb.parse_and_eval('SlabArenaP__slab_rsv[{}]'.format(i)))
+            mx  = int(gdb.parse_and_eval('SlabArenaP__slab_max[{}]'.format(i)))
+            cnt = int(gdb.parse_and_eval(sa_own.format(i, 'count')))
+            hw  = int(gdb.parse_and_eval(sa_own.format(i, 'high_water')))
+            bor = int(gdb.parse_and_eval(sa_own.format(i, 'borrows')))
+            fls = int(gdb.parse_and_eval(sa_own.format(i, 'fails')))
+            rcl = int(gdb.parse_and_eval(sa_own.format(i, 'reclaims')))
+            print('  {:6s}  {:3d} {:3d}  {:3d} {:3d}  {:7d}  {:5d}  {:8d}'.format(
+                name, rsv, mx, cnt, hw, bor, fls, rcl))
+
+class SSWLanes(gdb.Command):
+    """Display SSW per lane latency, collect to on the SD"""
+    def __init__ (self):
+        super(SSWLanes, self).__init__("sswLanes", gdb.COMMAND_USER)
+
+    def invoke (self, args, from_tty):
+        lanes  = [ 'bulk', 'crit' ]
+        ls     = 'SSWriteP__ssw_lane_stats[{}].{}'
+        forced = int(gdb.parse_and_eval('SSWriteP__ssw_forced'))
+        print('sswLanes: forced: {}'.format(forced))
+        print('  lane     count     last      max      avg  (ms)')
+        for i, name in enumerate(lanes):
+            cnt   = int(gdb.parse_and_eval(ls.format(i, 'count')))
+            last  = int(gdb.parse_and_eval(ls.format(i, 'last_ms')))
+            mx    = int(gdb.parse_and_eval(ls.format(i, 'max_ms')))
+            total = int(gdb.parse_and_eval(ls.format(i, 'total_ms')))
+            avg   = total / cnt if cnt else 0
+            print('  {:4s}  {:8d} {:8d} {:8d} {:8d}'.format(
+                name, cnt, last, mx, avg))
+
 DblkManager()
 DblkMap()
 ResyncCtl()
+SlabArena()
+SSWLanes()
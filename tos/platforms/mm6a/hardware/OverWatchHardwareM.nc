@@ -32,6 +32,7 @@ extern void __soft_reset();
 module OverWatchHardwareM {
   provides interface OverWatchHardware as OWhw;
   uses     interface SysReboot;
+  uses     interface HwCrc32;
 }
 implementation {
 
@@ -245,6 +246,14 @@ implementation {
   }
 
 
+  /*
+   * crc32: zlib CRC-32 from the chip's CRC engine, see Msp432Crc32P.
+   */
+  async command uint32_t OWhw.crc32(uint32_t crc, uint8_t *buf, uint32_t len) {
+    return call HwCrc32.crc32(crc, buf, len);
+  }
+
+
   /*
    * Flash interaction code
    */
@@ -47,7 +47,9 @@
 generic configuration SD0_ArbC() {
   provides {
     interface SDread;
+    interface SDreadMulti;
     interface SDwrite;
+    interface SDwriteMulti;
     interface SDerase;
 
     interface Resource;
@@ -67,6 +69,8 @@ implementation {
   ResourceRequested        = ArbP.ResourceRequested[CLIENT_ID];
 
   SDread  = SD.SDread[CLIENT_ID];
+  SDreadMulti = SD.SDreadMulti[CLIENT_ID];
   SDwrite = SD.SDwrite[CLIENT_ID];
+  SDwriteMulti = SD.SDwriteMulti[CLIENT_ID];
   SDerase = SD.SDerase[CLIENT_ID];
 }
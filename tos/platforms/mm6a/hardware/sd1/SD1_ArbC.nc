@@ -49,7 +49,9 @@
 generic configuration SD1_ArbC() {
   provides {
     interface SDread;
+    interface SDreadMulti;
     interface SDwrite;
+    interface SDwriteMulti;
     interface SDerase;
 
     interface Resource;
@@ -69,6 +71,8 @@ implementation {
   ResourceRequested        = ArbP.ResourceRequested[CLIENT_ID];
 
   SDread  = SD.SDread[CLIENT_ID];
+  SDreadMulti = SD.SDreadMulti[CLIENT_ID];
   SDwrite = SD.SDwrite[CLIENT_ID];
+  SDwriteMulti = SD.SDwriteMulti[CLIENT_ID];
   SDerase = SD.SDerase[CLIENT_ID];
 }
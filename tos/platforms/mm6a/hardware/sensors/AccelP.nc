@@ -200,32 +200,28 @@ implementation {
 
   /*
    * Drain has gone off, we want to drain the fifo.
-   * Depending on the resolution we want we will generate 8 bit, 10 bit or
-   * 16 bit data.
    *
-   * The fifo on the accel is 32 x 16 x 3.  We add one extra to handle the
-   * overflow (fifo shut down) case.  We postpend (-1, -1, -1) to the data
-   * stream to indicate a break in the data stream.
+   * The record is reserved directly in the stream buffers (Collect.reserve)
+   * and each sample is compressed (8 bit, the high byte of each axis) as it
+   * comes out of the chip.  No intermediate sample buffer.
+   *
+   * The fifo on the accel is 32 x 16 x 3.  If it overflowed (fifo shut
+   * down) we add one extra sample of all -1 (0xff) to indicate a break in
+   * the data stream.
    */
   event void DrainTimer.fired() {
-    uint32_t datasize;
-    uint32_t nsamples, fifo_len, idx;
+    uint32_t datasize, dest;
+    uint32_t nsamples, fifo_len;
     bool     overflowed;
 
-    acceln_sample_t      data[FIFO_BUF_SIZE];
-    dt_sensor_nsamples_t adt;           /* accel dt + nsample */
-
-#ifdef USE_ACCEL8
-    uint8_t *dp;
-    uint32_t src, dest;
-#endif
+    acceln_sample_t       s;
+    uint8_t               s8[3];
+    dt_sensor_nsamples_t *adtp;         /* accel dt + nsample */
+    collect_rsv_t         rsv;
 
-    memset(data, 0, sizeof(data));
     dump_registers();
     overflowed = call Accel.fifoOverflowed();
     fifo_len   = call Accel.fifoLen();
-    nsamples   = fifo_len;
-    idx = 0;
     if (!fifo_len) {
       /*
        * for some reason the fifo pipeline has shutdown.
@@ -235,36 +231,36 @@ implementation {
       dump_registers();
       return;
     }
+    if (fifo_len > FIFO_BUF_SIZE)
+      fifo_len = FIFO_BUF_SIZE;
+    nsamples = fifo_len;
+    if (overflowed && fifo_len == LISX_FIFO_SIZE)
+      nsamples++;
+
+    datasize = nsamples * sizeof(s8);
+    adtp = (void *) call Collect.reserve(sizeof(*adtp), datasize, &rsv);
+    dest = 0;
     while (fifo_len) {
-      if (idx >= FIFO_BUF_SIZE)
-        break;
-      call Accel.read((void *) &data[idx++], 6);
+      call Accel.read((void *) &s, 6);
       fifo_len--;
       dump_registers();
+      s8[0] = (uint8_t) (s.x >> 8);
+      s8[1] = (uint8_t) (s.y >> 8);
+      s8[2] = (uint8_t) (s.z >> 8);
+      dest += collect_rsv_fill(&rsv, dest, s8, sizeof(s8));
     }
-    if (overflowed && idx == LISX_FIFO_SIZE) {
-      data[idx].x   = -1;
-      data[idx].y   = -1;
-      data[idx++].z = -1;
-      nsamples++;
+    if (dest < datasize) {              /* overflow marker */
+      s8[0] = s8[1] = s8[2] = 0xff;
+      collect_rsv_fill(&rsv, dest, s8, sizeof(s8));
       call Accel.restartFifo();
       dump_registers();
     }
-    datasize = nsamples * sizeof(acceln_sample_t);
-    dp = (uint8_t *) data;
-    src = 1;
-    for (dest = 0; dest < datasize/2; dest++) {
-      dp[dest] = dp[src];
-      src += 2;
-    }
-    datasize = datasize/2;
-    adt.len = sizeof(adt) + datasize;
-    adt.dtype = DT_SNS_ACCEL_N8S;
-    adt.sched_delta = 0;
-    adt.nsamples = nsamples;
-    adt.datarate = m_datarate;
-    call Collect.collect((void *) &adt,  sizeof(adt),
-                         (void *) &data, datasize);
+    adtp->len = sizeof(*adtp) + datasize;
+    adtp->dtype = DT_SNS_ACCEL_N8S;
+    adtp->sched_delta = 0;
+    adtp->nsamples = nsamples;
+    adtp->datarate = m_datarate;
+    call Collect.commit((void *) adtp);
   }
 
 
@@ -66,6 +66,14 @@ extern uint32_t __platform_usecsRaw();
 #define FS_ENABLE_ERASE
 #define IM_ERASE_ENABLE
 #define DBLK_ERASE_ENABLE
+// #define DBLK_CIRCULAR                /* wrap and eat the oldest, dblk_dir.h */
+
+/*
+ * second SD slot (hardware/sd1).  The DBLK can be mirrored or striped
+ * across both, see dblk_sd.h.
+ */
+#define PLATFORM_SD1
+// #define DBLK_SD_MODE DBLK_SD_STRIPE
 
 #define SI446x_HW_CTS
 
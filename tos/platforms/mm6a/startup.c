@@ -89,6 +89,9 @@ const image_info_t image_info __attribute__ ((section(".image_meta"))) = {
     .image_chk    = 0,
     .hw_ver       = { .hw_model = HW_MODEL, .hw_rev = HW_REV },
     .plus_len     = IMAGE_INFO_PLUS_SIZE,
+
+    /* CRC-32 over full image, filled in by binfin */
+    .image_crc32  = 0,
   },
   .iip = {
     .tlv_block    = { IIP_TLV_END, 0 },        /* type, len, values */
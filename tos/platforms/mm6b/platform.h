@@ -66,6 +66,7 @@ extern uint32_t __platform_usecsRaw();
 #define FS_ENABLE_ERASE
 #define IM_ERASE_ENABLE
 #define DBLK_ERASE_ENABLE
+// #define DBLK_CIRCULAR                /* wrap and eat the oldest, dblk_dir.h */
 
 #define SI446x_HW_CTS
 
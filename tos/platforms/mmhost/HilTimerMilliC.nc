@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HilTimerMilliC for mmhost.  The usual tinyos timer stack sitting on
+ * HostClockP's simulated Alarm/Counter.
+ */
+
+#include "Timer.h"
+
+configuration HilTimerMilliC {
+  provides {
+    interface Init;
+    interface Timer<TMilli> as TimerMilli[uint8_t num];
+    interface LocalTime<TMilli>;
+  }
+}
+implementation {
+  enum {
+    TIMER_COUNT = uniqueCount(UQ_TIMER_MILLI),
+  };
+
+  components HostClockP;
+  components new AlarmToTimerC(TMilli);
+  components new VirtualizeTimerC(TMilli, TIMER_COUNT);
+  components new CounterToLocalTimeC(TMilli);
+
+  Init = HostClockP;
+
+  TimerMilli = VirtualizeTimerC;
+  VirtualizeTimerC.TimerFrom -> AlarmToTimerC;
+  AlarmToTimerC.Alarm -> HostClockP;
+
+  LocalTime = CounterToLocalTimeC;
+  CounterToLocalTimeC.Counter -> HostClockP;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostClockP: mmhost simulated clock.
+ *
+ * now_us is the only time there is.  TMilli is binary milliseconds
+ * (1024/sec) like the real platforms, Counter and Alarm are derived from
+ * now_us and feed HilTimerMilliC (timers and LocalTime).  HostClock
+ * clients (the SD latency model) get uS one shots.
+ *
+ * McuSleepC calls HostSim.advance when the task queue is empty.
+ */
+
+#include "Timer.h"
+#include "mmhost.h"
+
+module HostClockP {
+  provides {
+    interface Init;
+    interface HostSim;
+    interface HostClock[uint8_t id];
+    interface Counter<TMilli, uint32_t>;
+    interface Alarm<TMilli, uint32_t>;
+  }
+}
+implementation {
+  enum {
+    HC_CLIENTS = uniqueCount(HOST_CLOCK_ID),
+  };
+
+  norace uint64_t now_us;
+
+  norace bool     alarm_armed;
+  norace uint32_t alarm_t;                /* ticks, absolute */
+
+  norace bool     hc_armed[HC_CLIENTS];
+  norace uint64_t hc_t[HC_CLIENTS];
+
+
+  uint32_t us2ticks(uint64_t us) {
+    return (uint32_t) ((us * 1024) / 1000000);
+  }
+
+  /* first uS at which ticks has been reached */
+  uint64_t ticks2us(uint32_t ticks) {
+    return (((uint64_t) ticks * 1000000) + 1023) / 1024;
+  }
+
+
+  command error_t Init.init() {
+    now_us = 0;
+    alarm_armed = FALSE;
+    return SUCCESS;
+  }
+
+
+  async command uint64_t HostSim.now_us() {
+    return now_us;
+  }
+
+
+  async command bool HostSim.advance() {
+    uint64_t next, t;
+    bool     found;
+    uint8_t  i;
+
+    found = FALSE;
+    next  = 0;
+    if (alarm_armed) {
+      next  = ticks2us(alarm_t);
+      found = TRUE;
+    }
+    for (i = 0; i < HC_CLIENTS; i++) {
+      if (hc_armed[i] && (!found || hc_t[i] < next)) {
+        next  = hc_t[i];
+        found = TRUE;
+      }
+    }
+    if (!found)
+      return FALSE;
+
+    if (next > now_us)
+      now_us = next;
+
+    /* everything now due, alarm first, clients in id order */
+    if (alarm_armed && (int32_t) (us2ticks(now_us) - alarm_t) >= 0) {
+      alarm_armed = FALSE;
+      signal Alarm.fired();
+    }
+    for (i = 0; i < HC_CLIENTS; i++) {
+      t = hc_t[i];
+      if (hc_armed[i] && t <= now_us) {
+        hc_armed[i] = FALSE;
+        signal HostClock.woke[i]();
+      }
+    }
+    return TRUE;
+  }
+
+
+  async command void HostSim.spin(uint32_t us) {
+    now_us += us;
+  }
+
+
+  async command uint64_t HostClock.now_us[uint8_t id]() {
+    return now_us;
+  }
+
+  async command void HostClock.wake_at[uint8_t id](uint64_t t_us) {
+    hc_t[id]     = t_us;
+    hc_armed[id] = TRUE;
+  }
+
+  async command void HostClock.cancel[uint8_t id]() {
+    hc_armed[id] = FALSE;
+  }
+
+
+  /* Counter, 32 bit TMilli, wraps after ~48 days of simulated time */
+  async command uint32_t Counter.get()             { return us2ticks(now_us); }
+  async command bool     Counter.isOverflowPending() { return FALSE; }
+  async command void     Counter.clearOverflow()   { }
+
+
+  async command void Alarm.start(uint32_t dt) {
+    call Alarm.startAt(us2ticks(now_us), dt);
+  }
+
+  async command void Alarm.stop() {
+    alarm_armed = FALSE;
+  }
+
+  async command bool Alarm.isRunning() {
+    return alarm_armed;
+  }
+
+  async command void Alarm.startAt(uint32_t t0, uint32_t dt) {
+    alarm_t     = t0 + dt;
+    alarm_armed = TRUE;
+  }
+
+  async command uint32_t Alarm.getNow() {
+    return us2ticks(now_us);
+  }
+
+  async command uint32_t Alarm.getAlarm() {
+    return alarm_t;
+  }
+
+
+  default async event void HostClock.woke[uint8_t id]() { }
+  default async event void Counter.overflow()           { }
+}
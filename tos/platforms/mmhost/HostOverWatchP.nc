@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostOverWatchP: OverWatch for mmhost.
+ *
+ * Provides the globals startup.c normally provides (image_info and
+ * ow_control_block) and a flag-only OverWatch.  Anything that would
+ * reboot into another image ends the run instead.
+ *
+ * logging_flags can be seeded from MMHOST_LOG_FLAGS (hex or decimal).
+ */
+
+#include <overwatch.h>
+#include <image_info.h>
+#include <sysreboot.h>
+#include <platform_reset_defs.h>
+
+const image_info_t image_info = {
+  .iib = {
+    .ii_sig       = IMAGE_INFO_SIG,
+    .plus_len     = IMAGE_INFO_PLUS_SIZE,
+  },
+  .iip = {
+    .tlv_block    = { IIP_TLV_END, 0 },
+  }
+};
+
+ow_control_block_t ow_control_block;
+
+module HostOverWatchP {
+  provides {
+    interface Boot as Booted;
+    interface OverWatch;
+  }
+  uses {
+    interface Boot;
+    interface SysReboot;
+    interface Rtc;
+  }
+}
+
+implementation {
+
+  event void Boot.booted() {
+    ow_control_block_t *owcp;
+    char *s;
+
+    owcp = &ow_control_block;
+    owcp->ow_sig       = OW_SIG;
+    owcp->ow_sig_b     = OW_SIG;
+    owcp->ow_sig_c     = OW_SIG;
+    owcp->ow_boot_mode = OW_BOOT_NIB;
+    owcp->rtc_src      = RTCSRC_BOOT;
+
+    /* no previous boot on the host, REBOOT shows them the same */
+    call Rtc.getTime(&owcp->boot_time);
+    call Rtc.copyTime(&owcp->prev_boot, &owcp->boot_time);
+    if ((s = getenv("MMHOST_LOG_FLAGS")))
+      owcp->logging_flags = strtoul(s, NULL, 0);
+    signal Booted.booted();
+  }
+
+
+  void host_ow_exit(char *why, uint32_t arg) {
+    fprintf(stderr, "*** mmhost: OverWatch %s (%u)\n", why, arg);
+    call SysReboot.reboot(SYSREBOOT_OW_REQUEST);
+  }
+
+  async command void OverWatch.install() {
+    host_ow_exit("install", 0);
+  }
+
+  async command void OverWatch.force_boot(ow_boot_mode_t boot_mode,
+                                          ow_reboot_reason_t reason) {
+    host_ow_exit("force_boot", reason);
+  }
+
+  async command void OverWatch.flush_boot(ow_boot_mode_t boot_mode,
+                                          ow_reboot_reason_t reason) {
+    call SysReboot.flush();
+    host_ow_exit("flush_boot", reason);
+  }
+
+  async command void OverWatch.fail(ow_reboot_reason_t reason) {
+    host_ow_exit("fail", reason);
+  }
+
+  async command void OverWatch.reboot(ow_reboot_reason_t reason) {
+    host_ow_exit("reboot", reason);
+  }
+
+  async command void OverWatch.strange(uint32_t loc) {
+    fprintf(stderr, "*** mmhost: OverWatch strange %08x\n", loc);
+    call OverWatch.fail(ORR_STRANGE);
+  }
+
+
+  async command ow_boot_mode_t OverWatch.getBootMode() {
+    return ow_control_block.ow_boot_mode;
+  }
+
+  async command void OverWatch.clearReset()     { }
+  async command void OverWatch.clearPanicInfo() { }
+
+  async command ow_control_block_t *OverWatch.getControlBlock() {
+    return &ow_control_block;
+  }
+
+  async command uint32_t OverWatch.getImageBase() {
+    return 0;
+  }
+
+  async command void OverWatch.setFault(uint32_t fault_mask) {
+    ow_control_block.fault_mask_nib |= fault_mask;
+  }
+
+  async command void OverWatch.clrFault(uint32_t fault_mask) {
+    ow_control_block.fault_mask_nib &= ~fault_mask;
+  }
+
+  command void OverWatch.checkFaults() { }
+
+  async command void OverWatch.halt_and_CF() {
+    host_ow_exit("halt_and_CF", 0);
+  }
+
+  async command void OverWatch.incPanicCount() {
+    ow_control_block.panic_count++;
+  }
+
+  async command void OverWatch.sysBootStart() { }
+  async command void OverWatch.sysBootDone()  { }
+
+
+  async command bool OverWatch.getLoggingFlag(uint32_t log_e) {
+    if (log_e > OW_LOG_MAX) return FALSE;
+    return (ow_control_block.logging_flags >> log_e) & 1;
+  }
+
+  async command void OverWatch.setLoggingFlag(uint32_t log_e) {
+    if (log_e > OW_LOG_MAX) return;
+    ow_control_block.logging_flags |= (1UL << log_e);
+  }
+
+  async command void OverWatch.clrLoggingFlag(uint32_t log_e) {
+    if (log_e > OW_LOG_MAX) return;
+    ow_control_block.logging_flags &= ~(1UL << log_e);
+  }
+
+  async command void OverWatch.setLoggingFlagsM(uint32_t log_m) {
+    ow_control_block.logging_flags |= log_m;
+  }
+
+  async command void OverWatch.clrLoggingFlagsM(uint32_t log_m) {
+    ow_control_block.logging_flags &= ~log_m;
+  }
+
+  async command void OverWatch.forceLoggingFlags(uint32_t log_val) {
+    ow_control_block.logging_flags = log_val;
+  }
+
+  async command uint32_t OverWatch.getLoggingFlags() {
+    return ow_control_block.logging_flags;
+  }
+
+
+  async command bool OverWatch.getDebugFlag(uint32_t dbg_e) {
+    if (dbg_e > OW_DBG_MAX) return FALSE;
+    return (ow_control_block.ow_debug >> dbg_e) & 1;
+  }
+
+  async command void OverWatch.setDebugFlag(uint32_t dbg_e) {
+    if (dbg_e > OW_DBG_MAX) return;
+    ow_control_block.ow_debug |= (1UL << dbg_e);
+  }
+
+  async command void OverWatch.clrDebugFlag(uint32_t dbg_e) {
+    if (dbg_e > OW_DBG_MAX) return;
+    ow_control_block.ow_debug &= ~(1UL << dbg_e);
+  }
+
+  async command void OverWatch.forceDebugFlags(uint32_t dbg_val) {
+    ow_control_block.ow_debug = dbg_val;
+  }
+
+  async command uint32_t OverWatch.getDebugFlags() {
+    return ow_control_block.ow_debug;
+  }
+
+
+  async command rtc_src_t OverWatch.getRtcSrc() {
+    return ow_control_block.rtc_src;
+  }
+
+  async command void OverWatch.setRtcSrc(rtc_src_t src) {
+    ow_control_block.rtc_src = src;
+  }
+
+  async event void SysReboot.shutdown_flush() { }
+}
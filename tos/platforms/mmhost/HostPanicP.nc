@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostPanicP: Panic and PanicManager for mmhost.
+ *
+ * Panic.panic prints pcode/where/args and the sim time and exits(1).
+ * Panic.warn prints and keeps going.  The panic area is never written
+ * so PanicManager always reports no panics (EODATA).
+ */
+
+#include <panic.h>
+
+module HostPanicP {
+  provides {
+    interface Panic;
+    interface PanicManager;
+  }
+  uses interface HostSim;
+}
+
+implementation {
+
+  void host_panic_print(char *kind, uint8_t pcode, uint8_t where,
+          parg_t arg0, parg_t arg1, parg_t arg2, parg_t arg3) {
+    fprintf(stderr, "*** mmhost: %s %02x/%d: %lx %lx %lx %lx  (t %llu us)\n",
+            kind, pcode, where,
+            (unsigned long) arg0, (unsigned long) arg1,
+            (unsigned long) arg2, (unsigned long) arg3,
+            (unsigned long long) call HostSim.now_us());
+  }
+
+
+  async command void Panic.warn(uint8_t pcode, uint8_t where,
+          parg_t arg0, parg_t arg1, parg_t arg2, parg_t arg3) {
+    host_panic_print("warn", pcode, where, arg0, arg1, arg2, arg3);
+  }
+
+
+  async command void Panic.panic(uint8_t pcode, uint8_t where,
+          parg_t arg0, parg_t arg1, parg_t arg2, parg_t arg3) {
+    signal Panic.hook();
+    host_panic_print("PANIC", pcode, where, arg0, arg1, arg2, arg3);
+    exit(1);
+  }
+
+
+  command uint32_t PanicManager.getPanicBase()                { return 0; }
+  command uint32_t PanicManager.getPanicLimit()               { return 0; }
+  command uint32_t PanicManager.getPanicIndex()               { return 0; }
+  command uint32_t PanicManager.getMaxPanicIndex()            { return 0; }
+  command uint32_t PanicManager.getPanicSize()                { return PBLK_SIZE; }
+  command uint32_t PanicManager.panicIndex2Sector(uint32_t i) { return 0; }
+
+
+  task void populate_task() {
+    signal PanicManager.populateDone(EODATA);
+  }
+
+  command error_t PanicManager.populate() {
+    post populate_task();
+    return SUCCESS;
+  }
+
+
+  default async event void Panic.hook() { }
+  default event void PanicManager.populateDone(error_t err) { }
+}
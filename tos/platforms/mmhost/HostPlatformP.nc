@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostPlatformP: Platform, PlatformNodeId, SysReboot, and Rtc for mmhost.
+ *
+ * Rtc is simulated: the wall clock starts at HOST_RTC_EPOCH when the
+ * process starts and runs off HostSim.now_us.  setTime moves the offset.
+ * sub_sec is 32768 jiffies like the msp432 RTC.
+ *
+ * A reboot on the host is the end of the run, we exit.
+ *
+ * noinit (hardware.h) is the mmhost_noinit section.  If MMHOST_NOINIT
+ * names a file we load the section from it in Init (a file that doesn't
+ * match the section size is ignored, power up) and write it back on the
+ * way out (atexit), reboot, panic, or the app exiting.  Running again
+ * with the same file is a reset that kept its ram.  Remove the file for
+ * a power up.
+ */
+
+#include <hardware.h>
+#include <sysreboot.h>
+#include <rtctime.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* 2019-01-01 00:00:00 UTC */
+#define HOST_RTC_EPOCH 1546300800ULL
+
+/* from the linker, weak in case nothing in the build is noinit */
+extern uint8_t __start_mmhost_noinit[] __attribute__((weak));
+extern uint8_t __stop_mmhost_noinit[]  __attribute__((weak));
+
+module HostPlatformP {
+  provides {
+    interface Init;
+    interface Platform;
+    interface PlatformNodeId;
+    interface SysReboot;
+    interface Rtc;
+  }
+  uses {
+    interface Init as PeripheralInit;
+    interface HostSim;
+    interface LocalTime<TMilli>;
+  }
+}
+
+implementation {
+  norace int64_t rtc_offset_us;         /* rtc - sim, uS */
+
+  uint8_t node_id[PLATFORM_SERIAL_NUM_SIZE] = { 'm', 'm', 'h', 'o', 's', 't' };
+
+  size_t noinit_size() {
+    return __stop_mmhost_noinit - __start_mmhost_noinit;
+  }
+
+
+  void noinit_save() {
+    char *file;
+    int   fd;
+
+    if (!(file = getenv("MMHOST_NOINIT")) || !noinit_size())
+      return;
+    fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return;
+    if (write(fd, __start_mmhost_noinit, noinit_size()) < 0)
+      fprintf(stderr, "*** mmhost: noinit write to %s failed\n", file);
+    close(fd);
+  }
+
+
+  void noinit_load() {
+    char *file;
+    int   fd;
+    off_t size;
+
+    if (!(file = getenv("MMHOST_NOINIT")) || !noinit_size())
+      return;
+    atexit(noinit_save);
+    fd = open(file, O_RDONLY);
+    if (fd < 0)
+      return;                           /* power up */
+    size = lseek(fd, 0, SEEK_END);
+    if (size == noinit_size() &&
+        pread(fd, __start_mmhost_noinit, size, 0) != size)
+      memset(__start_mmhost_noinit, 0, size);
+    close(fd);
+  }
+
+
+  command error_t Init.init() {
+    noinit_load();
+    rtc_offset_us = HOST_RTC_EPOCH * 1000000ULL;
+    call PeripheralInit.init();
+    return SUCCESS;
+  }
+
+
+  async command error_t SysReboot.reboot(sysreboot_t reboot_type) {
+    fprintf(stderr, "*** mmhost: reboot (%d) at %llu us\n", reboot_type,
+            (unsigned long long) call HostSim.now_us());
+    exit(3);
+    return SUCCESS;
+  }
+
+  async command error_t SysReboot.soft_reboot(sysreboot_t reboot_type) {
+    return call SysReboot.reboot(reboot_type);
+  }
+
+  async command void SysReboot.clear(sysreboot_t reboot_type) { }
+
+  async command void SysReboot.flush() {
+    signal SysReboot.shutdown_flush();
+  }
+
+
+  async command uint32_t Platform.localTime()      { return call LocalTime.get(); }
+  async command uint32_t Platform.usecsRaw()       { return (uint32_t) call HostSim.now_us(); }
+  async command uint32_t Platform.usecsRawSize()   { return 32; }
+
+  uint32_t __platform_usecsRaw() @C() @spontaneous() {
+    return call Platform.usecsRaw();
+  }
+
+  /* TA1 equivalent, 32Ki jiffies, 16 bits */
+  async command uint32_t Platform.jiffiesRaw() {
+    return (uint16_t) ((call HostSim.now_us() * 32768) / 1000000);
+  }
+
+  async command uint32_t Platform.jiffiesRawSize() { return 16; }
+
+  async command bool Platform.set_unaligned_traps(bool set_on) {
+    return FALSE;
+  }
+
+  async command int Platform.getIntPriority(int irq_number) {
+    return 0;
+  }
+
+
+  async command uint8_t *PlatformNodeId.node_id(unsigned int *lenp) {
+    if (lenp)
+      *lenp = PLATFORM_SERIAL_NUM_SIZE;
+    return node_id;
+  }
+
+
+  /*
+   * Rtc
+   */
+  async command void Rtc.rtcStop()  { }
+  async command void Rtc.rtcStart() { }
+
+  async command bool Rtc.rtcValid(rtctime_t *timep) {
+    return (timep && timep->year >= 2018);
+  }
+
+  async command void Rtc.getTime(rtctime_t *timep) {
+    uint64_t  rtc_us;
+    time_t    secs;
+    struct tm tm;
+
+    rtc_us = call HostSim.now_us() + rtc_offset_us;
+    secs   = rtc_us / 1000000;
+    gmtime_r(&secs, &tm);
+    timep->year    = tm.tm_year + 1900;
+    timep->mon     = tm.tm_mon + 1;
+    timep->day     = tm.tm_mday;
+    timep->dow     = tm.tm_wday;
+    timep->hr      = tm.tm_hour;
+    timep->min     = tm.tm_min;
+    timep->sec     = tm.tm_sec;
+    timep->sub_sec = call Rtc.micro2subsec(rtc_us % 1000000);
+  }
+
+  async command uint64_t Rtc.rtc2epoch(rtctime_t *timep) {
+    struct tm tm;
+    uint64_t  epoch;
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = timep->year - 1900;
+    tm.tm_mon  = timep->mon - 1;
+    tm.tm_mday = timep->day;
+    tm.tm_hour = timep->hr;
+    tm.tm_min  = timep->min;
+    tm.tm_sec  = timep->sec;
+    epoch = (uint64_t) timegm(&tm) * 1000000;
+    return epoch + call Rtc.subsec2micro(timep->sub_sec);
+  }
+
+  async command void Rtc.setTime(rtctime_t *timep) {
+    rtc_offset_us = call Rtc.rtc2epoch(timep) - call HostSim.now_us();
+  }
+
+  command void Rtc.syncSetTime(rtctime_t *timep) {
+    call Rtc.setTime(timep);
+  }
+
+  async command void Rtc.clearTime(rtctime_t *timep) {
+    memset(timep, 0, sizeof(*timep));
+  }
+
+  async command void Rtc.copyTime(rtctime_t *dtimep, rtctime_t *stimep) {
+    memcpy(dtimep, stimep, sizeof(*dtimep));
+  }
+
+  async command int Rtc.compareTimes(rtctime_t *time0p, rtctime_t *time1p) {
+    uint64_t t0, t1;
+
+    t0 = call Rtc.rtc2epoch(time0p);
+    t1 = call Rtc.rtc2epoch(time1p);
+    if (t0 < t1) return -1;
+    if (t0 > t1) return  1;
+    return 0;
+  }
+
+  async command uint32_t Rtc.subsec2micro(uint16_t jiffies) {
+    return ((uint32_t) jiffies * 1000000) / 32768;
+  }
+
+  async command uint16_t Rtc.micro2subsec(uint32_t micros) {
+    return ((uint64_t) micros * 32768) / 1000000;
+  }
+
+
+  default command error_t PeripheralInit.init() { return SUCCESS; }
+  default async event void SysReboot.shutdown_flush() { }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostSim: drive the mmhost simulated clock.
+ *
+ * Time on mmhost only moves when the scheduler runs out of tasks.
+ * McuSleep.sleep calls advance, which jumps the clock to the earliest
+ * armed wakeup (Alarm or HostClock client) and fires it.  Code runs in
+ * zero simulated time, the SD latency model is what costs time.
+ */
+
+interface HostSim {
+  /* current simulated time, uS since boot */
+  async command uint64_t now_us();
+
+  /*
+   * jump to and fire the next thing due.
+   *
+   * @return  FALSE if nothing is armed.  With no tasks pending that
+   *          means nothing will ever happen again.
+   */
+  async command bool advance();
+
+  /*
+   * busy wait, time passes but nothing fires.  Used by stand alone
+   * (SDsa) code that on the real h/w spins with interrupts off.
+   */
+  async command void spin(uint32_t us);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * - Neither the name of the copyright holders nor the names of
+ *   its contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL STANFORD
+ * UNIVERSITY OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @author Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost McuSleep.  Nothing to do means time passes, HostSim.advance
+ * jumps the simulated clock to the next wakeup and fires it.  If nothing
+ * is armed we are wedged, no task and nothing coming, so say so and
+ * leave.  The benchmark exits on its own when it is done.
+ */
+
+#include "hardware.h"
+
+module McuSleepC {
+  provides {
+    interface McuSleep;                 /* external */
+    interface McuPowerState;            /* external */
+  }
+  uses {
+    interface McuPowerOverride;         /* external */
+    interface HostSim;                  /* Platform wires */
+  }
+}
+implementation {
+  async command void McuSleep.sleep() {
+    if (!call HostSim.advance()) {
+      fprintf(stderr, "*** mmhost: idle at %llu us, nothing pending\n",
+              (unsigned long long) call HostSim.now_us());
+      exit(2);
+    }
+  }
+
+  default async command mcu_power_t McuPowerOverride.lowestState() {
+    return HOST_POWER_SLEEP;
+  }
+
+  async command void McuSleep.irq_preamble()  { }
+  async command void McuSleep.irq_postamble() { }
+  async command void McuPowerState.update()   { }
+}
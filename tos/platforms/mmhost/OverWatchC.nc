@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost OverWatchC.  Shadows system/OverWatch/OverWatchC.  There is
+ * no OWT/GOLD/NIB on the host; Boot passes straight through to Booted
+ * and the control block lives in ordinary host memory.
+ */
+
+#include <overwatch.h>
+
+configuration OverWatchC {
+  provides {
+    interface Boot as Booted;		/* out Booted signal */
+    interface OverWatch as OW;
+  }
+  uses interface Boot;			/* incoming signal */
+}
+
+implementation {
+  components HostOverWatchP as OW_P;
+  OW     = OW_P;
+  Booted = OW_P;
+  Boot   = OW_P;
+
+  components PlatformC;
+  OW_P.SysReboot -> PlatformC;
+  OW_P.Rtc       -> PlatformC;
+}
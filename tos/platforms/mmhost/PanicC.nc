@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost PanicC.  Shadows system/panic/PanicC.  A panic on the host is
+ * reported on stderr and ends the run, there is nothing to dump.
+ */
+
+#include "panic.h"
+
+configuration PanicC {
+  provides {
+    interface Panic;
+    interface PanicManager;
+  }
+}
+
+implementation {
+  components HostPanicP, HostClockP;
+  Panic        = HostPanicP;
+  PanicManager = HostPanicP;
+  HostPanicP.HostSim -> HostClockP;
+}
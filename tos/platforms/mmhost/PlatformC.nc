@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#include "hardware.h"
+
+/*
+ * mmhost PlatformC.  Platform, SysReboot, NodeId and Rtc off the
+ * simulated clock, see HostPlatformP.  Pulls in McuSleepC so the
+ * scheduler sleeping is what moves time.
+ */
+
+configuration PlatformC {
+  provides {
+    interface Init as PlatformInit;
+    interface Platform;
+    interface PlatformNodeId;
+    interface SysReboot;
+    interface Rtc;
+  }
+  uses interface Init as PeripheralInit;
+}
+
+implementation {
+  components HostPlatformP;
+  Platform       = HostPlatformP;
+  PlatformNodeId = HostPlatformP;
+  PlatformInit   = HostPlatformP;
+  PeripheralInit = HostPlatformP.PeripheralInit;
+  SysReboot      = HostPlatformP;
+  Rtc            = HostPlatformP;
+
+  components HostClockP;
+  HostPlatformP.HostSim -> HostClockP;
+
+  components LocalTimeMilliC;
+  HostPlatformP.LocalTime -> LocalTimeMilliC;
+
+  components McuSleepC;
+  McuSleepC.HostSim -> HostClockP;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost SystemBootC.
+ *
+ * Same chain as mm6a less the pieces that don't exist on the host
+ * (CoreTime, PowerManager, ImageManager).
+ *
+ * 1) Bring up the SD/StreamStorage, FileSystem
+ * 2) OverWatch (pass through)
+ * 3) DblkManager, find the end of the DBLK
+ * 4) Post Restart/Reboot record.  (Collect)
+ *
+ * BootLow never fires, the host is never low on power.
+ */
+
+configuration SystemBootC {
+  provides interface Boot;
+  provides interface Boot as BootLow;
+  uses interface Init     as SoftwareInit;
+}
+implementation {
+  components MainC;
+  SoftwareInit = MainC.SoftwareInit;
+
+  components FileSystemC   as FS;
+  components OverWatchC    as OW;
+  components DblkManagerC  as DM;
+  components CollectC      as SYNC;
+  components HostBootLowP;
+
+  BootLow   = HostBootLowP;
+
+  FS.Boot   -> MainC;
+  OW.Boot   -> FS.Booted;
+  DM.Boot   -> OW.Booted;
+  SYNC.Boot -> DM.Booted;
+  SYNC.EndIn-> SYNC.Booted;
+  Boot      =  SYNC.EndOut;
+}
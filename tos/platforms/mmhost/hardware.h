@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost hardware.h
+ *
+ * There isn't any.  mmhost is a linux process, single threaded, and the
+ * only "interrupts" are the simulated clock firing out of McuSleep.sleep.
+ * So atomic is free and interrupt enable/disable doesn't do anything.
+ */
+
+#ifndef __HARDWARE_H__
+#define __HARDWARE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <platform.h>
+
+typedef uint8_t __nesc_atomic_t;
+
+inline __nesc_atomic_t __nesc_atomic_start(void) @spontaneous() {
+  return 0;
+}
+
+inline void __nesc_atomic_end(__nesc_atomic_t reenable_interrupts) @spontaneous() { }
+
+inline void __nesc_enable_interrupt()  { }
+inline void __nesc_disable_interrupt() { }
+
+typedef uint8_t mcu_power_t @combine("mcombine");
+
+enum {
+  HOST_POWER_SLEEP = 0,
+};
+
+mcu_power_t mcombine(mcu_power_t m1, mcu_power_t m2) @safe() {
+  return (m1 < m2) ? m1: m2;
+}
+
+#define nop() __asm__ volatile ("nop")
+
+/*
+ * noinit goes in its own section.  With MMHOST_NOINIT set HostPlatformP
+ * loads the section from that file before anything runs and writes it
+ * back when we exit.  That is the ram that survives a reset.  No file
+ * (or no MMHOST_NOINIT) is a power up.
+ */
+#define noinit __attribute__((section("mmhost_noinit")))
+
+#endif  /* __HARDWARE_H__ */
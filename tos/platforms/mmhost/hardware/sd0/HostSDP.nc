@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * HostSDP: mmhost SDn, a file pretending to be an SD card.
+ *
+ * Sectors live in MMHOST_SD_IMAGE (env, default "sd0.img") for SD0 and
+ * MMHOST_SD1_IMAGE ("sd1.img") for SD1, sector n at byte n * 512.  Card
+ * size is the file size.  Use tagfmtsd on the file like a real card.
+ * SD1 only gets opened if something wires SD1C (DBLK_SD_MODE mirror or
+ * stripe).
+ *
+ * Split phase ops (SDread, SDwrite, Multi, SDerase) are accepted, the
+ * cost from the latency model (mmhost.h) is armed on our HostClock and
+ * the op completes (file i/o and the Done signal) from a task when the
+ * clock gets there.  One op at a time, same as SDspP (EBUSY).
+ *
+ * Power is driven by the arbiter like SDspP.  RDO.requested on a cold
+ * card costs pwr_us before we release to the client.  RDO.granted
+ * (nobody wants us) powers down, idle_ms lets the card stay warm.
+ *
+ * SDsa is synchronous.  Time moves by HostSim.spin, nothing else runs.
+ *
+ * SDraw is mostly inert, there is no SPI.  blocks, erase_state and the
+ * buffer helpers work.  cid/csd/scr hand back synthetic registers (CSD
+ * v2 sized to the file).  The erased state is 0x00.
+ *
+ * panic where codes (PANIC_SD):
+ *
+ *   89, 91     SDsa multi-block misuse, same as SDspP
+ *   120        can't open/size the image (p1 sd_num)
+ *   121        pread/pwrite failed or short
+ *   122        op completed in a weird state
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <linux/falloc.h>
+#include <panic.h>
+#include <sd.h>
+#include "mmhost.h"
+
+#ifndef PANIC_SD
+enum {
+  __pcode_sd = unique(UQ_PANIC_SUBSYS)
+};
+
+#define PANIC_SD __pcode_sd
+#endif
+
+typedef enum {
+  HSD_OFF = 0,
+  HSD_OFF_TO_ON,
+  HSD_IDLE,
+  HSD_READ,
+  HSD_READ_MULTI,
+  HSD_WRITE,
+  HSD_WRITE_MULTI,
+  HSD_ERASE,
+} hsd_state_t;
+
+enum {
+  HSD_CID_NONE  = 0xff,
+  HSD_SA_MW_NONE = 0,
+  HSD_SA_MW_OPEN = 1,
+};
+
+generic module HostSDP(uint8_t sd_num) {
+  provides {
+    interface Init;
+    interface SDread[uint8_t cid];
+    interface SDreadMulti[uint8_t cid];
+    interface SDwrite[uint8_t cid];
+    interface SDwriteMulti[uint8_t cid];
+    interface SDerase[uint8_t cid];
+    interface SDsa;
+    interface SDraw;
+    interface HostSD;
+  }
+  uses {
+    interface ResourceDefaultOwner;
+    interface HostClock;
+    interface HostSim;
+    interface Panic;
+  }
+}
+
+implementation {
+
+  norace struct {
+    int         fd;
+    uint32_t    blocks;
+    hsd_state_t state;
+    uint8_t     cur_cid;
+    uint32_t    blk_start;
+    uint32_t    blk_end;                /* erase, inclusive */
+    uint8_t    *data_ptr;
+    uint8_t   **mw_bufs;
+    uint16_t    mw_count;
+    uint64_t    warm_until;             /* power held until, uS */
+    bool        sa;                     /* in stand alone */
+    uint8_t     sa_mw;
+    uint32_t    sa_mw_blk;
+    uint32_t    sa_mw_cnt;
+  } hsd;
+
+  norace host_sd_model_t hsd_model;
+  norace host_sd_stats_t hsd_stats;
+  norace sd_busy_stats_t mw_bstats;
+
+
+  void hsd_panic(uint8_t where, parg_t p0, parg_t p1) {
+    call Panic.panic(PANIC_SD, where, p0, p1, hsd.state, 0);
+  }
+
+
+  uint32_t env_knob(char *name, uint32_t def) {
+    char *s;
+
+    if ((s = getenv(name)))
+      return strtoul(s, NULL, 0);
+    return def;
+  }
+
+
+  command error_t Init.init() {
+    char *image;
+    off_t size;
+
+    hsd_model.pwr_us   = env_knob("MMHOST_SD_PWR_US",   MMHOST_SD_PWR_US);
+    hsd_model.cmd_us   = env_knob("MMHOST_SD_CMD_US",   MMHOST_SD_CMD_US);
+    hsd_model.xfer_us  = env_knob("MMHOST_SD_XFER_US",  MMHOST_SD_XFER_US);
+    hsd_model.prog_us  = env_knob("MMHOST_SD_PROG_US",  MMHOST_SD_PROG_US);
+    hsd_model.erase_us = env_knob("MMHOST_SD_ERASE_US", MMHOST_SD_ERASE_US);
+    hsd_model.idle_ms  = env_knob("MMHOST_SD_IDLE_MS",  MMHOST_SD_IDLE_MS);
+
+    if (sd_num == 0) {
+      if (!(image = getenv("MMHOST_SD_IMAGE")))
+        image = MMHOST_SD_IMAGE;
+    } else if (!(image = getenv("MMHOST_SD1_IMAGE")))
+      image = MMHOST_SD1_IMAGE;
+    hsd.fd = open(image, O_RDWR);
+    if (hsd.fd < 0) {
+      fprintf(stderr, "*** mmhost: can't open SD%d image %s\n", sd_num, image);
+      hsd_panic(120, 0, sd_num);
+    }
+    size = lseek(hsd.fd, 0, SEEK_END);
+    if (size < SD_BLOCKSIZE)
+      hsd_panic(120, 1, sd_num);
+    hsd.blocks  = size / SD_BLOCKSIZE;
+    hsd.state   = HSD_OFF;
+    hsd.cur_cid = HSD_CID_NONE;
+    return SUCCESS;
+  }
+
+
+  /*
+   * file i/o, one sector.  Anything short is fatal, the image is
+   * supposed to be the whole card.
+   */
+  void hsd_pread(uint32_t blk, uint8_t *buf) {
+    if (blk >= hsd.blocks ||
+        pread(hsd.fd, buf, SD_BLOCKSIZE,
+              (off_t) blk * SD_BLOCKSIZE) != SD_BLOCKSIZE)
+      hsd_panic(121, blk, 0);
+  }
+
+  void hsd_pwrite(uint32_t blk, uint8_t *buf) {
+    if (blk >= hsd.blocks ||
+        pwrite(hsd.fd, buf, SD_BLOCKSIZE,
+               (off_t) blk * SD_BLOCKSIZE) != SD_BLOCKSIZE)
+      hsd_panic(121, blk, 1);
+  }
+
+  /* erase to 0x00.  punch if the fs lets us, else write zeros */
+  void hsd_erase(uint32_t blk_start, uint32_t blk_end) {
+    uint8_t  zeros[SD_BLOCKSIZE];
+    uint32_t blk;
+
+    if (blk_end >= hsd.blocks)
+      blk_end = hsd.blocks - 1;
+    if (blk_start > blk_end)
+      return;
+    if (!fallocate(hsd.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                   (off_t) blk_start * SD_BLOCKSIZE,
+                   (off_t) (blk_end - blk_start + 1) * SD_BLOCKSIZE))
+      return;
+    memset(zeros, 0, sizeof(zeros));
+    for (blk = blk_start; blk <= blk_end; blk++)
+      hsd_pwrite(blk, zeros);
+  }
+
+
+  /*
+   * start a split phase op, cost is its duration in uS.  The card is
+   * busy from now until HostClock.woke.
+   */
+  void hsd_start(hsd_state_t op, uint8_t cid, uint32_t cost) {
+    hsd.state   = op;
+    hsd.cur_cid = cid;
+    hsd_stats.busy_us += cost;
+    call HostClock.wake_at(call HostSim.now_us() + cost);
+  }
+
+
+  task void hsd_done_task() {
+    hsd_state_t op;
+    uint8_t     cid;
+    uint16_t    i;
+
+    op  = hsd.state;
+    cid = hsd.cur_cid;
+    switch (op) {
+      default:
+        hsd_panic(122, op, cid);
+        return;
+
+      case HSD_OFF_TO_ON:
+        hsd.state = HSD_IDLE;
+        call ResourceDefaultOwner.release();
+        return;
+
+      case HSD_READ:
+        hsd_pread(hsd.blk_start, hsd.data_ptr);
+        hsd.state = HSD_IDLE; hsd.cur_cid = HSD_CID_NONE;
+        signal SDread.readDone[cid](hsd.blk_start, hsd.data_ptr, SUCCESS);
+        return;
+
+      case HSD_READ_MULTI:
+        for (i = 0; i < hsd.mw_count; i++)
+          hsd_pread(hsd.blk_start + i, hsd.mw_bufs[i]);
+        hsd.state = HSD_IDLE; hsd.cur_cid = HSD_CID_NONE;
+        signal SDreadMulti.readDone[cid](hsd.blk_start, hsd.mw_bufs,
+                                         hsd.mw_count, SUCCESS);
+        return;
+
+      case HSD_WRITE:
+        hsd_pwrite(hsd.blk_start, hsd.data_ptr);
+        hsd.state = HSD_IDLE; hsd.cur_cid = HSD_CID_NONE;
+        signal SDwrite.writeDone[cid](hsd.blk_start, hsd.data_ptr, SUCCESS);
+        return;
+
+      case HSD_WRITE_MULTI:
+        for (i = 0; i < hsd.mw_count; i++)
+          hsd_pwrite(hsd.blk_start + i, hsd.mw_bufs[i]);
+        hsd.state = HSD_IDLE; hsd.cur_cid = HSD_CID_NONE;
+        signal SDwriteMulti.writeDone[cid](hsd.blk_start, hsd.mw_bufs,
+                                           hsd.mw_count, SUCCESS);
+        return;
+
+      case HSD_ERASE:
+        hsd_erase(hsd.blk_start, hsd.blk_end);
+        hsd.state = HSD_IDLE; hsd.cur_cid = HSD_CID_NONE;
+        signal SDerase.eraseDone[cid](hsd.blk_start, hsd.blk_end, SUCCESS);
+        return;
+    }
+  }
+
+
+  async event void HostClock.woke() {
+    post hsd_done_task();
+  }
+
+
+  /*
+   * Power.  Arbiter tells us when someone wants the card (requested) and
+   * when nobody does (granted).
+   */
+  async event void ResourceDefaultOwner.granted() {
+    hsd.state = HSD_OFF;
+    hsd.warm_until = call HostSim.now_us() +
+      (uint64_t) hsd_model.idle_ms * 1000;
+  }
+
+
+  async event void ResourceDefaultOwner.requested() {
+    if (hsd.state != HSD_OFF)
+      hsd_panic(122, hsd.state, 0);
+    if (hsd_model.idle_ms && call HostSim.now_us() < hsd.warm_until) {
+      hsd.state = HSD_IDLE;
+      call ResourceDefaultOwner.release();
+      return;
+    }
+    hsd_stats.power_ups++;
+    hsd_start(HSD_OFF_TO_ON, HSD_CID_NONE, hsd_model.pwr_us);
+  }
+
+
+  async event void ResourceDefaultOwner.immediateRequested() {
+    hsd_panic(122, hsd.state, 1);
+  }
+
+
+  async event void Panic.hook() { }
+
+
+  /*
+   * Split phase entry points.  Same checks SDspP makes.
+   */
+  command error_t SDread.read[uint8_t cid](uint32_t blk_id, uint8_t *buf) {
+    if (hsd.state != HSD_IDLE)
+      return EBUSY;
+    if (!buf)
+      return EINVAL;
+    hsd.blk_start = blk_id;
+    hsd.data_ptr  = buf;
+    hsd_stats.reads++;
+    hsd_stats.sectors_rd++;
+    hsd_start(HSD_READ, cid, hsd_model.cmd_us + hsd_model.xfer_us);
+    return SUCCESS;
+  }
+
+
+  command error_t SDreadMulti.read[uint8_t cid](uint32_t blk,
+                                                uint8_t **bufs, uint16_t count) {
+    if (hsd.state != HSD_IDLE)
+      return EBUSY;
+    if (!bufs || !count)
+      return EINVAL;
+    hsd.blk_start = blk;
+    hsd.mw_bufs   = bufs;
+    hsd.mw_count  = count;
+    hsd_stats.reads++;
+    hsd_stats.sectors_rd += count;
+    hsd_start(HSD_READ_MULTI, cid,
+              hsd_model.cmd_us + count * hsd_model.xfer_us);
+    return SUCCESS;
+  }
+
+
+  command error_t SDwrite.write[uint8_t cid](uint32_t blk, uint8_t *buf) {
+    if (hsd.state != HSD_IDLE)
+      return EBUSY;
+    if (!buf)
+      return EINVAL;
+    hsd.blk_start = blk;
+    hsd.data_ptr  = buf;
+    hsd_stats.writes++;
+    hsd_stats.sectors_wr++;
+    hsd_start(HSD_WRITE, cid,
+              hsd_model.cmd_us + hsd_model.xfer_us + hsd_model.prog_us);
+    return SUCCESS;
+  }
+
+
+  command error_t SDwriteMulti.write[uint8_t cid](uint32_t blk,
+                                                  uint8_t **bufs, uint16_t count) {
+    if (hsd.state != HSD_IDLE)
+      return EBUSY;
+    if (!bufs || !count)
+      return EINVAL;
+    hsd.blk_start = blk;
+    hsd.mw_bufs   = bufs;
+    hsd.mw_count  = count;
+    hsd_stats.writes++;
+    hsd_stats.sectors_wr += count;
+
+    mw_bstats.blk         = blk;
+    mw_bstats.count       = count;
+    mw_bstats.timer_polls = 0;
+    mw_bstats.min_us      = hsd_model.prog_us;
+    mw_bstats.max_us      = hsd_model.prog_us;
+    mw_bstats.total_us    = count * hsd_model.prog_us;
+
+    hsd_start(HSD_WRITE_MULTI, cid, hsd_model.cmd_us +
+              count * (hsd_model.xfer_us + hsd_model.prog_us));
+    return SUCCESS;
+  }
+
+
+  command void SDwriteMulti.busy_stats[uint8_t cid](sd_busy_stats_t *bsp) {
+    if (bsp)
+      *bsp = mw_bstats;
+  }
+
+
+  command error_t SDerase.erase[uint8_t cid](uint32_t blk_start,
+                                             uint32_t blk_end) {
+    if (hsd.state != HSD_IDLE)
+      return EBUSY;
+    if (blk_end < blk_start)
+      return EINVAL;
+    hsd.blk_start = blk_start;
+    hsd.blk_end   = blk_end;
+    hsd_stats.erases++;
+    hsd_start(HSD_ERASE, cid, hsd_model.cmd_us + hsd_model.erase_us);
+    return SUCCESS;
+  }
+
+
+  /*
+   * SDsa, synchronous.  Time passes via HostSim.spin.
+   */
+  async command bool SDsa.inSA() {
+    return hsd.sa;
+  }
+
+  async command error_t SDsa.reset() {
+    hsd.sa = TRUE;
+    hsd.sa_mw = HSD_SA_MW_NONE;
+    call HostSim.spin(hsd_model.pwr_us);
+    return SUCCESS;
+  }
+
+  async command void SDsa.off() {
+    hsd.sa = FALSE;
+    hsd.sa_mw = HSD_SA_MW_NONE;
+  }
+
+  async command void SDsa.read(uint32_t blk_id, uint8_t *buf) {
+    hsd_pread(blk_id, buf);
+    hsd_stats.sectors_rd++;
+    call HostSim.spin(hsd_model.cmd_us + hsd_model.xfer_us);
+  }
+
+  async command void SDsa.write(uint32_t blk, uint8_t *buf) {
+    hsd_pwrite(blk, buf);
+    hsd_stats.sa_writes++;
+    hsd_stats.sectors_wr++;
+    call HostSim.spin(hsd_model.cmd_us + hsd_model.xfer_us +
+                      hsd_model.prog_us);
+  }
+
+  async command void SDsa.write_multi_start(uint32_t blk, uint32_t count) {
+    if (hsd.sa_mw != HSD_SA_MW_NONE)
+      hsd_panic(89, hsd.sa_mw_blk, 0);
+    hsd.sa_mw_blk = blk;
+    hsd.sa_mw_cnt = 0;
+    hsd.sa_mw = HSD_SA_MW_OPEN;
+    call HostSim.spin(hsd_model.cmd_us);
+  }
+
+  async command void SDsa.write_multi_blk(uint8_t *buf) {
+    if (hsd.sa_mw == HSD_SA_MW_NONE)
+      hsd_panic(91, 0, 0);
+    hsd_pwrite(hsd.sa_mw_blk, buf);
+    hsd.sa_mw_blk++;
+    hsd.sa_mw_cnt++;
+    hsd_stats.sa_writes++;
+    hsd_stats.sectors_wr++;
+    call HostSim.spin(hsd_model.xfer_us + hsd_model.prog_us);
+  }
+
+  async command void SDsa.write_multi_stop() {
+    hsd.sa_mw = HSD_SA_MW_NONE;
+  }
+
+
+  /*
+   * SDraw.  No SPI on the host; the low level bits are inert.
+   */
+  command void    SDraw.start_op()          { }
+  command void    SDraw.end_op()            { }
+  command uint8_t SDraw.get()               { return 0xff; }
+  command void    SDraw.put(uint8_t byte)   { }
+  command uint8_t SDraw.send_cmd(uint8_t cmd, uint32_t arg) { return 0; }
+  command uint8_t SDraw.raw_acmd(uint8_t cmd, uint32_t arg) { return 0; }
+  command uint8_t SDraw.raw_cmd(uint8_t cmd, uint32_t arg)  { return 0; }
+
+  command void SDraw.send_recv(uint8_t *tx, uint8_t *rx, uint16_t len) {
+    if (rx)
+      memset(rx, 0xff, len);
+  }
+
+  async command uint32_t SDraw.blocks() {
+    return hsd.blocks;
+  }
+
+  /* TRUE if the card erases to 0xff, we erase to 0x00 */
+  async command bool SDraw.erase_state() {
+    return FALSE;
+  }
+
+  bool chk_buffer(uint8_t *sd_buf, uint8_t val) {
+    uint16_t i;
+
+    for (i = 0; i < SD_BLOCKSIZE; i++)
+      if (sd_buf[i] != val)
+        return FALSE;
+    return TRUE;
+  }
+
+  async command bool SDraw.chk_zero(uint8_t *sd_buf) {
+    return chk_buffer(sd_buf, 0);
+  }
+
+  async command bool SDraw.chk_erased(uint8_t *sd_buf) {
+    return chk_buffer(sd_buf, 0);
+  }
+
+  async command bool SDraw.zero_fill(uint8_t *sd_buf, uint32_t offset) {
+    if (offset >= SD_BLOCKSIZE)
+      return FALSE;
+    memset(sd_buf + offset, 0, SD_BLOCKSIZE - offset);
+    return TRUE;
+  }
+
+  /* powered up, SDHC (CCS) */
+  command uint32_t SDraw.ocr() {
+    return 0xc0ff8000;
+  }
+
+  /* MID 0, OID "MH", PNM "MMHST", rev 1.0 */
+  command error_t SDraw.cid(uint8_t *buf) {
+    memset(buf, 0, 16);
+    memcpy(&buf[1], "MHMMHST", 7);
+    buf[8] = 0x10;
+    return SUCCESS;
+  }
+
+  /* CSD v2, C_SIZE = blocks/1024 - 1 */
+  command error_t SDraw.csd(uint8_t *buf) {
+    uint32_t c_size;
+
+    memset(buf, 0, 16);
+    c_size = hsd.blocks / 1024;
+    if (c_size)
+      c_size--;
+    buf[0] = 0x40;
+    buf[7] = (c_size >> 16) & 0x3f;
+    buf[8] = (c_size >>  8) & 0xff;
+    buf[9] = (c_size      ) & 0xff;
+    return SUCCESS;
+  }
+
+  command error_t SDraw.scr(uint8_t *buf) {
+    memset(buf, 0, 8);
+    return SUCCESS;
+  }
+
+
+  command host_sd_model_t *HostSD.model() {
+    return &hsd_model;
+  }
+
+  command host_sd_stats_t *HostSD.stats() {
+    return &hsd_stats;
+  }
+
+
+  default event void SDread.readDone[uint8_t cid](uint32_t blk_id,
+                                                  uint8_t *buf, error_t err) { }
+  default event void SDreadMulti.readDone[uint8_t cid](uint32_t blk,
+                         uint8_t **bufs, uint16_t count, error_t err) { }
+  default event void SDwrite.writeDone[uint8_t cid](uint32_t blk,
+                                                    uint8_t *buf, error_t err) { }
+  default event void SDwriteMulti.writeDone[uint8_t cid](uint32_t blk,
+                         uint8_t **bufs, uint16_t count, error_t err) { }
+  default event void SDerase.eraseDone[uint8_t cid](uint32_t blk_start,
+                                                    uint32_t blk_end, error_t err) { }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost SD0C.  Same face as the h/w SD0C (SDread, SDwrite, ..., SDsa,
+ * SDraw, ResourceDefaultOwner) but backed by a file and the mmhost
+ * latency model, see HostSDP and mmhost.h.
+ *
+ * SD0_ArbC/SD0_ArbP and sd0_users.h come from platforms/mm6a.
+ */
+
+#include "mmhost.h"
+
+configuration SD0C {
+  provides {
+    interface SDread[uint8_t cid];
+    interface SDreadMulti[uint8_t cid];
+    interface SDwrite[uint8_t cid];
+    interface SDwriteMulti[uint8_t cid];
+    interface SDerase[uint8_t cid];
+    interface SDsa;
+    interface SDraw;
+    interface HostSD;
+  }
+  uses interface ResourceDefaultOwner;          /* power control */
+}
+
+implementation {
+  components new HostSDP(0) as SDdvrP;
+
+  SDread   = SDdvrP;
+  SDreadMulti = SDdvrP;
+  SDwrite  = SDdvrP;
+  SDwriteMulti = SDdvrP;
+  SDerase  = SDdvrP;
+  SDsa     = SDdvrP;
+  SDraw    = SDdvrP;
+  HostSD   = SDdvrP;
+
+  ResourceDefaultOwner = SDdvrP;
+
+  components MainC;
+  MainC.SoftwareInit -> SDdvrP;
+
+  components PanicC;
+  SDdvrP.Panic -> PanicC;
+
+  components HostClockP;
+  SDdvrP.HostClock -> HostClockP.HostClock[unique(HOST_CLOCK_ID)];
+  SDdvrP.HostSim   -> HostClockP;
+}
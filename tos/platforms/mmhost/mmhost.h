@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#ifndef __MMHOST_H__
+#define __MMHOST_H__
+
+/*
+ * mmhost knobs.
+ *
+ * SD0 is a file, MMHOST_SD_IMAGE (env) or "sd0.img".  SD1 (only with
+ * DBLK_SD_MODE mirror/stripe) is MMHOST_SD1_IMAGE or "sd1.img".  Format
+ * them with tagfmtsd like a real card.
+ *
+ * SD latency model, all uS.  Defaults are in the neighborhood of what
+ * we see from the 2G/4G industrial cards in SPI mode.  Each can be
+ * overridden from the environment, same name:
+ *
+ *   MMHOST_SD_PWR_US     power up and reset, first request after idle
+ *   MMHOST_SD_CMD_US     per transaction, command/response overhead
+ *   MMHOST_SD_XFER_US    per sector, moving 512 bytes over SPI
+ *   MMHOST_SD_PROG_US    per sector written, program busy
+ *   MMHOST_SD_ERASE_US   per erase command
+ *   MMHOST_SD_IDLE_MS    power held this long after the last client lets
+ *                        go (0, drop at once like SDspP)
+ *
+ * Multi-block writes pay CMD once and XFER + PROG per sector.  Reads pay
+ * CMD and XFER.
+ */
+
+#define HOST_CLOCK_ID "HostClock.id"
+
+#define MMHOST_SD_IMAGE     "sd0.img"
+#define MMHOST_SD1_IMAGE    "sd1.img"
+
+#define MMHOST_SD_PWR_US    100000
+#define MMHOST_SD_CMD_US    150
+#define MMHOST_SD_XFER_US   260
+#define MMHOST_SD_PROG_US   1200
+#define MMHOST_SD_ERASE_US  25000
+#define MMHOST_SD_IDLE_MS   0
+
+typedef struct {
+  uint32_t pwr_us;
+  uint32_t cmd_us;
+  uint32_t xfer_us;
+  uint32_t prog_us;
+  uint32_t erase_us;
+  uint32_t idle_ms;
+} host_sd_model_t;
+
+typedef struct {
+  uint32_t reads;                       /* read transactions    */
+  uint32_t writes;                      /* write transactions   */
+  uint32_t erases;
+  uint32_t sa_writes;                   /* stand alone sectors  */
+  uint32_t sectors_rd;
+  uint32_t sectors_wr;
+  uint32_t power_ups;
+  uint64_t busy_us;                     /* total time SD busy   */
+} host_sd_stats_t;
+
+#endif  /* __MMHOST_H__ */
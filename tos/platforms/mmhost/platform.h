@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+/*
+ * mmhost: the storage pipeline (Collect, SSWrite, DblkManager, DblkMapFile,
+ * Resync) built for linux against a file backed SD0.  See 00_README.
+ *
+ * SD0 always, SD1 only gets pulled in by DBLK_SD_MODE mirror/stripe
+ * (dblk_sd.h).  No radio, gps, or sensors.
+ */
+
+#define REQUIRE_PLATFORM
+#define REQUIRE_PANIC
+
+#define FS_ENABLE_ERASE
+#define DBLK_ERASE_ENABLE
+// #define DBLK_CIRCULAR                /* wrap and eat the oldest, dblk_dir.h */
+
+#define TOSH_DATA_LENGTH 250
+#define PLATFORM_SERIAL_NUM_SIZE 6
+#define PLATFORM_SD1
+
+#include <panic.h>
+#include <platform_panic.h>
+
+#endif // __PLATFORM_H__
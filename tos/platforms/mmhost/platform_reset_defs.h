@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * mmhost platform reset definitions.  platforms/mm's version is built on
+ * the msp432 RSTCTL bits, the host only needs the reboot reason.
+ */
+
+#ifndef __PLATFORM_RESET_DEFS_H__
+#define __PLATFORM_RESET_DEFS_H__
+
+#include <sysreboot.h>
+
+enum {
+  SYSREBOOT_OW_REQUEST = SYSREBOOT_EXTEND,
+};
+
+#endif  /* __PLATFORM_RESET_DEFS_H__ */
@@ -211,6 +211,12 @@
 #include <platform_panic.h>
 #include <msgbuf.h>
 #include <rtctime.h>
+#include <slab_arena.h>
+
+/* msg_buf is carved out of the slab arena, MSGBUF reservation */
+#if MSG_BUF_SIZE > (SLAB_RSV_MSGBUF * SLAB_SIZE)
+#error "MSG_BUF_SIZE doesn't fit in the MSGBUF slab reservation"
+#endif
 
 
 #ifndef PANIC_GPS
@@ -240,6 +246,7 @@ enum {
   MSGW_RELEASE,
   MSGW_RELEASE_1,
   MSGW_RELEASE_2,
+  MSGW_INIT,
 };
 
 
@@ -252,10 +259,11 @@ module MsgBufP {
   uses {
     interface Rtc;
     interface Panic;
+    interface SlabArena;
   }
 }
 implementation {
-         uint8_t    msg_buf[MSG_BUF_SIZE];      /* underlying storage */
+         uint8_t   *msg_buf;                    /* underlying storage, arena */
          msg_slot_t msg_msgs[MSG_MAX_MSGS];     /* msg slots */
   norace mbc_t      gmc;                        /* msgbuffer control */
 
@@ -270,6 +278,11 @@ implementation {
 
 
   command error_t Init.init() {
+    msg_buf = call SlabArena.alloc_contig(
+      (MSG_BUF_SIZE + SLAB_SIZE - 1) / SLAB_SIZE);
+    if (!msg_buf)
+      gps_panic(MSGW_INIT, MSG_BUF_SIZE, 0);
+
     /* initilize the control cells for the msg queue and free space */
     gmc.free     = msg_buf;
     gmc.free_len = MSG_BUF_SIZE;
@@ -704,5 +717,8 @@ implementation {
   default event void MsgReceive.msg_available(uint8_t *msg, uint16_t len,
         rtctime_t *arrival_rtp, uint32_t mark_j) { }
 
+  /* msg_buf is ours for good, nothing borrowed to give back */
+  event void SlabArena.reclaim() { }
+
   async event void Panic.hook() { }
 }
@@ -55,6 +55,9 @@ implementation {
   OW_P.LocalTime    -> LocalTimeMilliC;
   OW_P.CollectEvent -> CollectC;
 
+  components HwCrc32C;
+  OWHW_M.HwCrc32 -> HwCrc32C;
+
   components PlatformC;
   OWHW_M.SysReboot -> PlatformC;
   OW_P.Rtc         -> PlatformC;
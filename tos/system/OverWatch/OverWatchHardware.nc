@@ -94,6 +94,15 @@ interface OverWatchHardware {
    */
   async command uint32_t getImageBase();
 
+  /*
+   * crc32: run a CRC-32 (IEEE 802.3, zlib compatible) over a buffer.
+   *
+   * crc is the result of a previous call (0 to start) which allows a
+   * crc to be computed over discontiguous pieces.  Uses the CRC h/w
+   * if present.
+   */
+  async command uint32_t crc32(uint32_t crc, uint8_t *buf, uint32_t len);
+
   /*
    * flash access.
    */
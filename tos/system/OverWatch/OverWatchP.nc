@@ -96,18 +96,48 @@ implementation {
   uint32_t owt_len;
   uint32_t owt_len_to_send = 128;
 
+  /*
+   * image_crc: compute the CRC-32 of an image as binfin did.
+   *
+   * binfin computes the crc with image_chk and image_crc32 both zero.
+   * We can't zero them in flash, so the image is fed in pieces with
+   * zeros standing in for those two fields.
+   */
+  uint32_t image_crc(image_info_t *iip) {
+    uint8_t *start, *chk, *crcp, *end;
+    uint32_t zero, crc;
+
+    zero  = 0;
+    start = (void *) iip->iib.image_start;
+    end   = start + iip->iib.image_length;
+    chk   = (void *) &iip->iib.image_chk;
+    crcp  = (void *) &iip->iib.image_crc32;
+    if (chk < start || crcp + sizeof(uint32_t) > end)
+      return ~iip->iib.image_crc32;     /* not inside, can't match */
+    crc = call OWhw.crc32(0,   start, chk - start);
+    crc = call OWhw.crc32(crc, (void *) &zero, sizeof(zero));
+    crc = call OWhw.crc32(crc, chk + sizeof(uint32_t),
+                          crcp - (chk + sizeof(uint32_t)));
+    crc = call OWhw.crc32(crc, (void *) &zero, sizeof(zero));
+    crc = call OWhw.crc32(crc, crcp + sizeof(uint32_t),
+                          end - (crcp + sizeof(uint32_t)));
+    return crc;
+  }
+
+
   /*
    * check_image: verify an image
    *
-   * Verify its checksum.
+   * Verify its crc (or checksum).
    *
    * 1) Verify the signature of the image_info block.
    * 2) extract the image size from the structure.  This is in bytes.
    *    Must be >= IMAGE_MIN_SIZE and < IMAGE_MAX_SIZE.
-   * 3) calculate the checksum across the entire image.
+   * 3) calculate the CRC-32 across the entire image (h/w CRC).  Older
+   *    images without image_crc32 fall back to the byte checksum.
    *
-   * Note: if iip->image_chk is 0, we currently assume the checksum is
-   * disabled.
+   * Note: if both image_crc32 and image_chk are 0, we currently assume
+   * the checksum is disabled.
    */
   bool check_image(image_info_t *iip) {
     uint32_t image_sum, modifier;
@@ -127,6 +157,13 @@ implementation {
         ow_control_block.chk_fails++;
         return FALSE;
     }
+    if (iip->iib.image_crc32) {
+      if (image_crc(iip) != iip->iib.image_crc32) {
+        ow_control_block.chk_fails++;
+        return FALSE;
+      }
+      return TRUE;
+    }
     if (iip->iib.image_chk) {
       /*
        * the original sum is done with image_chk set to 0.  After we
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * SlabArena: sector sized (SLAB_SIZE) buffers out of the shared arena.
+ * Wired per owner, SlabArenaC.SlabArena[SLAB_OWNER_xxx].  See
+ * slab_arena.h.
+ */
+
+#include <slab_arena.h>
+
+interface SlabArena {
+  /**
+   * alloc: get a slab.
+   *
+   * Always works while the owner is under its reservation.  Past that
+   * the slab is borrowed from the lendable pool, up to the owner's max.
+   * If the pool is dry, owners holding borrowed slabs get reclaim (right
+   * then) and we look again.
+   *
+   * @return  uint8_t *   slab, quad aligned, SLAB_SIZE.  Not zeroed.
+   *                      NULL, nothing for you.
+   */
+  command uint8_t *alloc();
+
+  /**
+   * alloc_contig: get n slabs back to back.  For owners that need one
+   * larger area (MsgBuf).  Only out of the reservation and intended to
+   * be used from init.
+   *
+   * @param   uint8_t     n       number of slabs.
+   * @return  uint8_t *   first slab, NULL if it can't be done.
+   */
+  command uint8_t *alloc_contig(uint8_t n);
+
+  /**
+   * free: give a slab back.  Must be one this owner got from alloc.
+   */
+  command void free(uint8_t *slab);
+
+  /**
+   * count/high_water: slabs held now and the most ever held.
+   */
+  command uint8_t count();
+  command uint8_t high_water();
+
+  /**
+   * reclaim: someone needs a slab and the lendable pool is dry.  Only
+   * signalled to owners holding more than their reservation.  Give back
+   * (free) anything borrowed that can be, before returning.
+   */
+  event void reclaim();
+
+  /**
+   * scratch: a slab nobody is holding, without taking it.
+   *
+   * Only while single threaded (booting, or after we've crashed), see
+   * SSWrite.get_temp_buf.
+   */
+  async command uint8_t *scratch();
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * Shared sector buffer arena.  Wire by owner,
+ *
+ *   Foo.SlabArena -> SlabArenaC.SlabArena[SLAB_OWNER_FOO];
+ *
+ * See slab_arena.h and SlabArenaP.
+ */
+
+#include <slab_arena.h>
+
+configuration SlabArenaC {
+  provides interface SlabArena[uint8_t owner];
+}
+implementation {
+  components SlabArenaP;
+  SlabArena = SlabArenaP;
+
+  components PanicC;
+  SlabArenaP.Panic -> PanicC;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+/*
+ * Slab Arena
+ *
+ * One static array of SLAB_COUNT sector sized slabs.  slab_owner[] says
+ * who holds each one (owner + 1, 0 is free), so the arena is good to go
+ * out of the startup code's zeroing, no init needed.  MsgBuf grabs its
+ * area from its SoftwareInit.
+ *
+ * Reservations aren't particular slabs, they are accounting.  The slabs
+ * still owed to owners under their reservation (owed) are held back,
+ * anything free beyond that can be lent.  An owner under its
+ * reservation always gets one.
+ *
+ * When a borrow comes up dry we ask everyone else holding borrowed
+ * slabs to give them back (reclaim, synchronous) and look again.  This
+ * is what gets the DMF to let go of its extra cache sectors when the SSW
+ * needs to soak up a burst.
+ *
+ * Per owner counts, high water marks, borrows, fails, and reclaims are
+ * kept in slab_stats.
+ */
+
+#include <panic.h>
+#include <platform_panic.h>
+#include <slab_arena.h>
+
+#ifndef PANIC_MISC
+enum {
+  __pcode_misc = unique(UQ_PANIC_SUBSYS)
+};
+
+#define PANIC_MISC __pcode_misc
+#endif
+
+module SlabArenaP {
+  provides interface SlabArena[uint8_t owner];
+  uses     interface Panic;
+}
+implementation {
+  uint8_t      slab_mem[SLAB_COUNT][SLAB_SIZE] __attribute__ ((aligned (4)));
+  uint8_t      slab_owner[SLAB_COUNT];  /* owner + 1, 0 free */
+  slab_stats_t slab_stats;
+
+  const uint8_t slab_rsv[SLAB_OWNERS] = {
+    SLAB_RSV_SSW, SLAB_RSV_DMF, SLAB_RSV_IM, SLAB_RSV_MSGBUF, SLAB_RSV_DM,
+  };
+
+  const uint8_t slab_max[SLAB_OWNERS] = {
+    SLAB_MAX_SSW, SLAB_MAX_DMF, SLAB_MAX_IM, SLAB_MAX_MSGBUF, SLAB_MAX_DM,
+  };
+
+
+  void slab_panic(uint8_t where, parg_t p0, parg_t p1) {
+    call Panic.panic(PANIC_MISC, where, p0, p1, 0, 0);
+  }
+
+
+  /* slabs held back for owners still under their reservation */
+  uint8_t owed() {
+    uint8_t o, n;
+
+    n = 0;
+    for (o = 0; o < SLAB_OWNERS; o++)
+      if (slab_stats.owner[o].count < slab_rsv[o])
+        n += slab_rsv[o] - slab_stats.owner[o].count;
+    return n;
+  }
+
+
+  uint8_t n_free() {
+    uint8_t o, n;
+
+    n = SLAB_COUNT;
+    for (o = 0; o < SLAB_OWNERS; o++)
+      n -= slab_stats.owner[o].count;
+    return n;
+  }
+
+
+  bool can_take(uint8_t owner, uint8_t n) {
+    slab_owner_stats_t *op;
+
+    op = &slab_stats.owner[owner];
+    if (op->count + n > slab_max[owner])
+      return FALSE;
+    if (op->count + n <= slab_rsv[owner])
+      return TRUE;                      /* already held back for it */
+    return (n_free() >= owed() + n);
+  }
+
+
+  void take(uint8_t owner, uint8_t idx) {
+    slab_owner_stats_t *op;
+
+    if (slab_owner[idx])
+      slab_panic(3, idx, slab_owner[idx]);
+    slab_owner[idx] = owner + 1;
+    op = &slab_stats.owner[owner];
+    if (op->count >= slab_rsv[owner])
+      op->borrows++;
+    op->count++;
+    if (op->count > op->high_water)
+      op->high_water = op->count;
+    slab_stats.free = n_free();
+    if (SLAB_COUNT - slab_stats.free > slab_stats.peak)
+      slab_stats.peak = SLAB_COUNT - slab_stats.free;
+  }
+
+
+  /* ask everyone else with borrowed slabs to give them back */
+  void reclaim_others(uint8_t owner) {
+    uint8_t o;
+
+    for (o = 0; o < SLAB_OWNERS; o++) {
+      if (o == owner || slab_stats.owner[o].count <= slab_rsv[o])
+        continue;
+      slab_stats.owner[o].reclaims++;
+      signal SlabArena.reclaim[o]();
+    }
+  }
+
+
+  command uint8_t *SlabArena.alloc[uint8_t owner]() {
+    uint8_t idx;
+
+    if (owner >= SLAB_OWNERS)
+      slab_panic(1, owner, 0);
+    if (!can_take(owner, 1)) {
+      if (slab_stats.owner[owner].count < slab_max[owner])
+        reclaim_others(owner);
+      if (!can_take(owner, 1)) {
+        slab_stats.owner[owner].fails++;
+        return NULL;
+      }
+    }
+    for (idx = 0; idx < SLAB_COUNT; idx++) {
+      if (!slab_owner[idx]) {
+        take(owner, idx);
+        return slab_mem[idx];
+      }
+    }
+    slab_panic(4, owner, n_free());     /* accounting is off */
+    return NULL;
+  }
+
+
+  command uint8_t *SlabArena.alloc_contig[uint8_t owner](uint8_t n) {
+    uint8_t idx, i;
+
+    if (owner >= SLAB_OWNERS || !n)
+      slab_panic(1, owner, n);
+    if (slab_stats.owner[owner].count + n > slab_rsv[owner]) {
+      slab_stats.owner[owner].fails++;
+      return NULL;
+    }
+    for (idx = 0; idx + n <= SLAB_COUNT; idx++) {
+      for (i = 0; i < n; i++)
+        if (slab_owner[idx + i])
+          break;
+      if (i < n)
+        continue;
+      for (i = 0; i < n; i++)
+        take(owner, idx + i);
+      return slab_mem[idx];
+    }
+    slab_stats.owner[owner].fails++;
+    return NULL;
+  }
+
+
+  command void SlabArena.free[uint8_t owner](uint8_t *slab) {
+    uint32_t off;
+    uint8_t  idx;
+
+    off = slab - &slab_mem[0][0];
+    if (owner >= SLAB_OWNERS || slab < &slab_mem[0][0] ||
+        off >= sizeof(slab_mem) || (off % SLAB_SIZE))
+      slab_panic(2, (parg_t) slab, owner);
+    idx = off / SLAB_SIZE;
+    if (slab_owner[idx] != owner + 1 || !slab_stats.owner[owner].count)
+      slab_panic(2, (parg_t) slab, slab_owner[idx]);
+    slab_owner[idx] = 0;
+    slab_stats.owner[owner].count--;
+    slab_stats.free = n_free();
+  }
+
+
+  command uint8_t SlabArena.count[uint8_t owner]() {
+    if (owner >= SLAB_OWNERS)
+      slab_panic(1, owner, 0);
+    return slab_stats.owner[owner].count;
+  }
+
+
+  command uint8_t SlabArena.high_water[uint8_t owner]() {
+    if (owner >= SLAB_OWNERS)
+      slab_panic(1, owner, 0);
+    return slab_stats.owner[owner].high_water;
+  }
+
+
+  /*
+   * from the top, allocs come from the bottom.  Keeps a scratch user
+   * (booting) clear of anyone else's allocs for as long as possible.
+   */
+  async command uint8_t *SlabArena.scratch[uint8_t owner]() {
+    uint8_t idx;
+
+    for (idx = SLAB_COUNT; idx; idx--)
+      if (!slab_owner[idx - 1])
+        return slab_mem[idx - 1];
+    return NULL;
+  }
+
+
+  default event void SlabArena.reclaim[uint8_t owner]() { }
+
+  async event void Panic.hook() { }
+}
@@ -51,6 +51,12 @@ typedef struct {
   /* checksums when writing regions out */
   uint32_t ram_checksum;
   uint32_t io_checksum;
+
+  /* ram section, see collect_ram */
+  bool     ram_rle;                    /* compressed */
+  uint32_t ram_len;                    /* bytes laid down in ram section */
+  uint32_t rle_words;                  /* words out of rle_ram */
+  uint32_t rle_limit;                  /* words we can emit, 0 count only */
 } pcb_t;
 
 
@@ -365,25 +371,127 @@ implementation {
   }
 
 
+  /*
+   * RAM compression, see PRLE_LIT/PRLE_RUN in panic.h
+   *
+   * rle_ram walks the ram region twice.  Once with rle_limit 0 to see
+   * what it compresses to, and once for real pushing words out through
+   * pcb.buf.  A full pcb.buf goes straight out the open SDsa multi-block
+   * write.  Anything past rle_limit words is dropped, ram can change
+   * between the passes (we are running on it) and we don't get to
+   * wander into the i/o sectors.
+   */
+  void rle_put(uint32_t w) {
+    if (pcb.rle_limit) {
+      if (pcb.rle_words >= pcb.rle_limit)
+        return;
+      *(uint32_t *) pcb.bptr = w;
+      pcb.bptr += 4;
+      pcb.remaining -= 4;
+      if (!pcb.remaining) {
+        call SDsa.write_multi_blk(pcb.buf);
+        pcb.bptr = pcb.buf;
+        pcb.remaining = SD_BLOCKSIZE;
+      }
+    }
+    pcb.rle_words++;
+  }
+
+
+  void rle_lit(uint32_t *s, uint32_t *e) {
+    uint32_t n;
+
+    while (s < e) {
+      n = e - s;
+      if (n > PRLE_CNT_MASK)
+        n = PRLE_CNT_MASK;
+      rle_put(PRLE_LIT | n);
+      while (n--)
+        rle_put(*s++);
+    }
+  }
+
+
+  /* returns bytes of compressed output */
+  uint32_t rle_ram(const panic_region_t *ram_desc, uint32_t limit) {
+    uint32_t *p, *q, *lit, *end;
+    uint32_t  n;
+
+    pcb.rle_words = 0;
+    pcb.rle_limit = limit;
+    p   = (uint32_t *) ram_desc->base_addr;
+    end = p + ram_desc->len / 4;
+    lit = p;
+    while (p < end) {
+      q = p + 1;
+      while (q < end && *q == *p && (uint32_t) (q - p) < PRLE_CNT_MASK)
+        q++;
+      n = q - p;
+      if (n >= PRLE_MIN_RUN) {
+        rle_lit(lit, p);
+        rle_put(PRLE_RUN | n);
+        rle_put(*p);
+        lit = q;
+      }
+      p = q;
+    }
+    rle_lit(lit, end);
+    return pcb.rle_words * 4;
+  }
+
+
+  /*
+   * lay the ram region down in the ram section of the panic block.
+   *
+   * One SDsa multi-block write, no command and program wait per sector.
+   * Compressed if that saves at least a sector, otherwise a straight
+   * copy.  Fills in pcb.ram_rle and pcb.ram_len (bytes in the ram
+   * section).  Returns sectors written.
+   */
   uint32_t collect_ram(const panic_region_t *ram_desc, uint32_t delta) {
     uint32_t  len  = ram_desc->len;
     uint8_t  *base = ram_desc->base_addr;
-    uint32_t  blk;
+    uint32_t  blk, nsecs, clen;
 
     blk = pcb.block + delta;
+    clen = rle_ram(ram_desc, 0);
+    if (clen + SD_BLOCKSIZE <= len) {
+      nsecs = (clen + SD_BLOCKSIZE - 1) / SD_BLOCKSIZE;
+      if (pcb.pcb_sig != PCB_SIG || blk + nsecs > pcb.high)
+        call OverWatch.strange(0x86);
+      call SDsa.write_multi_start(blk, nsecs);
+      pcb.bptr      = pcb.buf;
+      pcb.remaining = SD_BLOCKSIZE;
+      clen = rle_ram(ram_desc, PBLK_RAM_SIZE * SD_BLOCKSIZE / 4);
+      if (pcb.remaining != SD_BLOCKSIZE) {
+        call SDraw.zero_fill(pcb.buf, SD_BLOCKSIZE - pcb.remaining);
+        call SDsa.write_multi_blk(pcb.buf);
+      }
+      call SDsa.write_multi_stop();
+      pcb.ram_rle = TRUE;
+      pcb.ram_len = clen;
+      return (clen + SD_BLOCKSIZE - 1) / SD_BLOCKSIZE;
+    }
+
+    nsecs = len / SD_BLOCKSIZE;
+    if (pcb.pcb_sig != PCB_SIG || blk + nsecs > pcb.high)
+      call OverWatch.strange(0x86);
+    call SDsa.write_multi_start(blk, nsecs);
     while (len > 0) {
-      panic_write(blk, base);
-      blk++;
+      call SDsa.write_multi_blk(base);
       base += SD_BLOCKSIZE;
       len  -= SD_BLOCKSIZE;
     }
-    return blk - pcb.block;
+    call SDsa.write_multi_stop();
+    pcb.ram_rle = FALSE;
+    pcb.ram_len = ram_desc->len;
+    return nsecs;
   }
 
 
-  uint32_t checksum_ram(const panic_region_t *ram_desc, uint32_t delta) {
-    uint32_t  len  = ram_desc->len;
-    uint8_t  *base = ram_desc->base_addr;
+  /* read back what collect_ram laid down, pcb.ram_len bytes */
+  uint32_t checksum_ram(uint32_t delta) {
+    uint32_t  len  = pcb.ram_len;
     uint32_t  checksum, sec_chk;
     uint32_t  blk;
 
@@ -394,8 +502,7 @@ implementation {
       sec_chk = byte_checksum_buf(pcb.buf, SD_BLOCKSIZE);
       checksum += sec_chk;
       blk++;
-      base += SD_BLOCKSIZE;             /* for reference only */
-      len  -= SD_BLOCKSIZE;
+      len = (len > SD_BLOCKSIZE) ? len - SD_BLOCKSIZE : 0;
     }
     pcb.ram_checksum = checksum;
     return checksum;
@@ -713,8 +820,8 @@ implementation {
      * checksum_ram fills in pcb.ram_checksum.
      */
 
-    collect_ram(&ram_region,  PBLK_RAM);
-    checksum_ram(&ram_region, PBLK_RAM);
+    collect_ram(&ram_region, PBLK_RAM);
+    checksum_ram(PBLK_RAM);
 
     /* fill in hdr0 */
     memset(pcb.buf, 0, SD_BLOCKSIZE);
@@ -745,9 +852,9 @@ implementation {
 
     /* fill in additional info */
     addp                = &b0p->additional_info;
-    addp->ai_sig        = PANIC_ADDITIONS;
+    addp->ai_sig        = pcb.ram_rle ? PANIC_ADDITIONS_RLE : PANIC_ADDITIONS;
     addp->ram_offset    = block2offset(pcb.block + PBLK_RAM);
-    addp->ram_size      = PBLK_RAM_SIZE * 512;
+    addp->ram_size      = pcb.ram_len;
     addp->io_offset     = block2offset(pcb.block + PBLK_IO);
     addp->fcrumb_offset = block2offset(pcb.block + PBLK_FCRUMBS);
 
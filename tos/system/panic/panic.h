@@ -132,7 +132,8 @@ typedef unsigned int parg_t;
  *
  * Following the panic header is a 128 sector region  containing the
  * full 64K RAM contents.  It is described by the ram_header at the end
- * of panic_hdr1.  It must be physically at the end of the sector.
+ * of panic_hdr1.  It must be physically at the end of the sector.  The
+ * RAM contents may be compressed, see PANIC_ADDITIONS_RLE.
  *
  * Following the RAM section is a 12 sector (6KB) I/O region.  Each I/O
  * region in the I/O secton is described by region discriptor immediately
@@ -292,12 +293,36 @@ typedef struct {
 } crash_info_t;
 
 
-#define PANIC_ADDITIONS 0x44664144
+#define PANIC_ADDITIONS     0x44664144
+#define PANIC_ADDITIONS_RLE 0x44664152
+
+/*
+ * If ai_sig is PANIC_ADDITIONS_RLE the RAM section has been compressed
+ * and ram_size is the number of bytes of compressed data in the RAM
+ * section (the rest of the section is zero).  The expanded size comes
+ * from the ram_header in hdr1.  Otherwise the RAM section is a straight
+ * copy and ram_size is its size.
+ *
+ * The compressed RAM section is a stream of 32 bit words, little endian.
+ * Each run starts with a token, type in the upper byte and a word count
+ * in the lower 24 bits:
+ *
+ *   PRLE_LIT | n       n words follow, copy as is.
+ *   PRLE_RUN | n       one word follows, repeat it n times.
+ *
+ * The big wins are the unused stack (0x7a7a5115) and zeroed buffers.
+ * Repeats shorter than PRLE_MIN_RUN words are left in the literals.
+ */
+#define PRLE_LIT        0x4c000000
+#define PRLE_RUN        0x52000000
+#define PRLE_TYPE_MASK  0xff000000
+#define PRLE_CNT_MASK   0x00ffffff
+#define PRLE_MIN_RUN    4
 
 typedef struct {
   uint32_t ai_sig;                      /* panic_additions sig */
   uint32_t ram_offset;                  /* starting file offset for RAM dump */
-  uint32_t ram_size;                    /* 64 KiB (bytes) */
+  uint32_t ram_size;                    /* 64 KiB (bytes), RLE: compressed */
   uint32_t io_offset;                   /* starting file offset for I/O dump */
   uint32_t fcrumb_offset;               /* flash crumb, file offset          */
 } panic_additional_t;
@@ -324,8 +349,9 @@ typedef struct {
  * the start of the RAM section.
  *
  * ram_checksum is a 32 bit byte checksum over all the bytes in the Ram
- * section.  It is computed on the fly as the Ram sectors are written out
- * to the panic block.
+ * section.  It is computed by reading back the Ram sectors after they
+ * have been written to the panic block.  When compressed, only the
+ * sectors holding compressed data are summed.
  *
  * io_checksum similarly is the external checksum over all i/o section bytes.
  * this includes an i/o section headers.
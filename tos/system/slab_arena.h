@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Eric B. Decker
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * See COPYING in the top level directory of this source tree.
+ *
+ * Contact: Eric B. Decker <cire831@gmail.com>
+ */
+
+#ifndef __SLAB_ARENA_H__
+#define __SLAB_ARENA_H__
+
+#include <sd.h>
+
+/*
+ * Slab Arena, the big sector sized buffers all come out of one place.
+ *
+ * Each owner has a reservation (RSV), that many slabs are always there
+ * for it.  On top of the reservations are SLAB_LEND slabs that anyone
+ * can borrow, up to the owner's max (MAX).  Who gets the extras depends
+ * on what we are doing, SSW during heavy sensor logging, DMF during
+ * downloads, ImageManager (double buffering) during an image upload.
+ *
+ * All of these are compile time, a platform can override any of them in
+ * its platform.h.  The arena is SLAB_COUNT slabs, the sum of the
+ * reservations plus SLAB_LEND.
+ *
+ * Before the arena the owners carved out 18 sectors for themselves,
+ * SSW 10, the DMF cache 4, IM 1, MsgBuf 1024 bytes (2), and the DM
+ * directory buffer 1.  The defaults are the same 18.  Each owner keeps
+ * what it had as its reservation and DM's directory buffer becomes the
+ * one lendable slab.  A platform with RAM to spare raises SLAB_LEND.
+ *
+ * SSW          stream storage write buffers.
+ * DMF          DblkMapFile cache slots.
+ * IM           ImageManager working buffer(s).
+ * MSGBUF       gps message buffer.  contiguous, taken at init.
+ * DM           DblkManager, directory mirror writes.  borrows.
+ */
+
+#define SLAB_SIZE SD_BLOCKSIZE
+
+enum {
+  SLAB_OWNER_SSW = 0,
+  SLAB_OWNER_DMF,
+  SLAB_OWNER_IM,
+  SLAB_OWNER_MSGBUF,
+  SLAB_OWNER_DM,
+  SLAB_OWNERS,
+};
+
+#ifndef SLAB_RSV_SSW
+#define SLAB_RSV_SSW     10
+#endif
+#ifndef SLAB_MAX_SSW
+#define SLAB_MAX_SSW     11
+#endif
+
+#ifndef SLAB_RSV_DMF
+#define SLAB_RSV_DMF     4
+#endif
+#ifndef SLAB_MAX_DMF
+#define SLAB_MAX_DMF     5
+#endif
+
+#ifndef SLAB_RSV_IM
+#define SLAB_RSV_IM      1
+#endif
+#ifndef SLAB_MAX_IM
+#define SLAB_MAX_IM      2
+#endif
+
+#ifndef SLAB_RSV_MSGBUF
+#define SLAB_RSV_MSGBUF  2
+#endif
+#define SLAB_MAX_MSGBUF  SLAB_RSV_MSGBUF
+
+#ifndef SLAB_RSV_DM
+#define SLAB_RSV_DM      0
+#endif
+#ifndef SLAB_MAX_DM
+#define SLAB_MAX_DM      1
+#endif
+
+#ifndef SLAB_LEND
+#define SLAB_LEND        1
+#endif
+
+#define SLAB_COUNT (SLAB_RSV_SSW + SLAB_RSV_DMF + SLAB_RSV_IM + \
+                    SLAB_RSV_MSGBUF + SLAB_RSV_DM + SLAB_LEND)
+
+/*
+ * per owner accounting.
+ *
+ * count:       slabs held now.
+ * high_water:  most ever held.
+ * borrows:     allocs that came out of the lendable pool.
+ * fails:       allocs turned down.
+ * reclaims:    times we asked the owner to give borrowed slabs back.
+ */
+typedef struct {
+  uint8_t  count;
+  uint8_t  high_water;
+  uint16_t borrows;
+  uint16_t fails;
+  uint16_t reclaims;
+} slab_owner_stats_t;
+
+typedef struct {
+  slab_owner_stats_t owner[SLAB_OWNERS];
+  uint8_t            free;              /* slabs not held by anyone */
+  uint8_t            peak;              /* most ever held at once */
+} slab_stats_t;
+
+#endif  /* __SLAB_ARENA_H__ */